@@ -56,6 +56,7 @@ IceTImage icetGLDrawFrame(void)
     IceTDrawCallbackType original_callback;
     IceTDouble total_time;
     IceTBoolean ok_to_proceed;
+    IceTInt frame_count;
 
     total_time = icetWallTime();
 
@@ -69,9 +70,12 @@ IceTImage icetGLDrawFrame(void)
     }
 
   /* Hand control to the core layer to render and composite. */
+    icetGetIntegerv(ICET_FRAME_COUNT, &frame_count);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_TRUE);
     image = icetDrawFrame(projection_matrix,
                           modelview_matrix,
                           background_color);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_FALSE);
 
     finalizeOpenGLRender(image,
                          projection_matrix,
@@ -82,6 +86,11 @@ IceTImage icetGLDrawFrame(void)
     total_time = icetWallTime() - total_time;
     correctOpenGLRenderTimes(total_time);
 
+  /* The core layer only counts frames it finished drawing. */
+    if (*icetUnsafeStateGetInteger(ICET_FRAME_COUNT) != frame_count) {
+        icetTimingRecordFrame();
+    }
+
     return image;
 }
 
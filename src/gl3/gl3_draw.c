@@ -67,6 +67,7 @@ IceTImage icetGL3DrawFrame(const IceTDouble *projection_matrix,
     IceTDrawCallbackType original_callback;
     IceTDouble start_time;
     IceTBoolean ok_to_proceed;
+    IceTInt frame_count;
 
     start_time = icetWallTime();
 
@@ -78,15 +79,23 @@ IceTImage icetGL3DrawFrame(const IceTDouble *projection_matrix,
     }
 
     /* Hand control to the core layer to render and composite. */
+    icetGetIntegerv(ICET_FRAME_COUNT, &frame_count);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_TRUE);
     image = icetDrawFrame(projection_matrix,
                           modelview_matrix,
                           background_color);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_FALSE);
 
     finalizeOpenGL3Render(background_color,
                           original_callback);
 
     correctOpenGL3RenderTimes(icetWallTime() - start_time);
 
+    /* The core layer only counts frames it finished drawing. */
+    if (*icetUnsafeStateGetInteger(ICET_FRAME_COUNT) != frame_count) {
+        icetTimingRecordFrame();
+    }
+
     return image;
 }
 
@@ -97,8 +106,8 @@ static GLuint setupColorTexture(IceTBoolean *dirty)
     GLuint color_texture_id =
         *icetUnsafeStateGetInteger(ICET_GL3_COLOR_TEXTURE);
 
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &width);
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &height);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &height);
 
     if (color_texture_id != 0)
     {
@@ -172,8 +181,8 @@ static GLuint setupDepthTexture(IceTBoolean *dirty)
     GLuint depth_texture_id =
         *icetUnsafeStateGetInteger(ICET_GL3_DEPTH_TEXTURE);
 
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &width);
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &height);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &height);
 
     if (depth_texture_id != 0)
     {
@@ -235,7 +244,7 @@ static void setupFramebuffer()
     IceTBoolean buffer_dirty = ICET_FALSE;
 
     /* Determine what size buffer to use. */
-    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
     physical_width = MIN(global_viewport[2], max_size);
     physical_height = MIN(global_viewport[3], max_size);
@@ -273,8 +282,8 @@ static GLuint setupDepthR32fTexture(IceTBoolean *dirty)
     GLuint depth_r32f_texture_id =
         *icetUnsafeStateGetInteger(ICET_GL3_DEPTH_R32F_TEXTURE);
 
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &width);
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &height);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &height);
 
     if (depth_r32f_texture_id != 0)
     {
@@ -336,8 +345,8 @@ static GLuint setupDepthR32fTexture(IceTBoolean *dirty)
             pariFreeGpuBuffer(compressed_gpu_buffer, PARI_IMAGE_ACTIVE_PIXEL);
         }
 
-        icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
-        icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+        icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+        icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
 
         resource_depth = pariRegisterImage(depth_r32f_texture_id, &description_depth);
         compressed_gpu_buffer = pariAllocateGpuBuffer(max_width, max_height, PARI_IMAGE_ACTIVE_PIXEL);
@@ -363,7 +372,7 @@ static void setupDepthFramebuffer()
     IceTBoolean buffer_dirty = ICET_FALSE;
 
     /* Determine what size buffer to use. */
-    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
     physical_width = MIN(global_viewport[2], max_size);
     physical_height = MIN(global_viewport[3], max_size);
@@ -175,15 +175,15 @@ IceTSparseImage icetGL3GetCompressedRenderedBufferImage(
         TODO: Expose Image macros from image.c so that if these values change
         they get updated everywhere.
         ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX  -->  6
-        ICET_IMAGE_DATA_START_INDEX          -->  7
+        ICET_IMAGE_DATA_START_INDEX          -->  8
         */
-        compressed_image = ((IceTUInt*)target_image.opaque_internals + 7);
+        compressed_image = ((IceTUInt*)target_image.opaque_internals + 8);
 
         pariGetSubRgbaDepthTextureAsActivePixel(resource_color, description_color, resource_depth,
             description_depth, compressed_gpu_buffer, tile_width, tile_height, target_viewport,
             rendered_viewport,compressed_image, &compressed_size);
 
-        *((IceTUInt*)target_image.opaque_internals + 6) = 7 * sizeof(IceTUInt) + compressed_size;
+        *((IceTUInt*)target_image.opaque_internals + 6) = 8 * sizeof(IceTUInt) + compressed_size;
 
 
         icetGetDoublev(ICET_COMPRESS_TIME, &old_time);
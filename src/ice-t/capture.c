@@ -0,0 +1,463 @@
+/* -*- c -*- *******************************************************/
+/*
+ * Copyright (C) 2011 Sandia Corporation
+ * Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+ * the U.S. Government retains certain rights in this software.
+ *
+ * This source code is released under the New BSD License.
+ */
+
+/* Frame capture writes the image each process feeds into compositing, along
+   with the state needed to composite it again, so that frames can later be
+   replayed through icetCompositeImage.  Each process appends one record per
+   frame to its own file.  A record is a fixed header of 32-bit integers
+   followed by variable length state and the packaged image. */
+
+#include <IceT.h>
+
+#include <IceTDevDiagnostics.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPTURE_MAGIC           0x49434150      /* "ICAP" */
+#define CAPTURE_VERSION         1
+
+#define CAPTURE_HEADER_MAGIC            0
+#define CAPTURE_HEADER_VERSION          1
+#define CAPTURE_HEADER_RANK             2
+#define CAPTURE_HEADER_NUM_PROCESSES    3
+#define CAPTURE_HEADER_FRAME            4
+#define CAPTURE_HEADER_ENCODING         5
+#define CAPTURE_HEADER_COLOR_FORMAT     6
+#define CAPTURE_HEADER_DEPTH_FORMAT     7
+#define CAPTURE_HEADER_COMPOSITE_MODE   8
+#define CAPTURE_HEADER_ORDER            9
+#define CAPTURE_HEADER_NUM_TILES        10
+#define CAPTURE_HEADER_NUM_BOUNDING_VERTS 11
+#define CAPTURE_HEADER_VALID_VIEWPORT   12
+#define CAPTURE_HEADER_GLOBAL_VIEWPORT  16
+#define CAPTURE_HEADER_IMAGE_SIZE       20
+#define CAPTURE_HEADER_SIZE             21
+
+static void captureRankFileName(const char *filename, char *rank_filename)
+{
+    const char *rank_marker = strstr(filename, "%d");
+
+    if (rank_marker != NULL) {
+        IceTInt rank;
+        size_t prefix_length = (size_t)(rank_marker - filename);
+        icetGetIntegerv(ICET_RANK, &rank);
+        memcpy(rank_filename, filename, prefix_length);
+        sprintf(rank_filename + prefix_length,
+                "%d%s", (int)rank, rank_marker + 2);
+    } else {
+        strcpy(rank_filename, filename);
+    }
+}
+
+void icetCaptureFrames(const char *filename, IceTEnum encoding)
+{
+    IceTInt num_proc;
+    char *rank_filename;
+    FILE *file;
+
+    icetStateSetInteger(ICET_CAPTURE_ENCODING, ICET_FALSE);
+    icetGetStateBuffer(ICET_CAPTURE_FILE_NAME, 0);
+
+    if (filename == NULL) { return; }
+
+    if ((encoding != ICET_CAPTURE_RAW) && (encoding != ICET_CAPTURE_SPARSE)) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid capture encoding 0x%X.", encoding);
+        return;
+    }
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    if ((strstr(filename, "%d") == NULL) && (num_proc > 1)) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Capture file name %s needs a %%d to distinguish the"
+                       " files of the %d processes.",
+                       filename, num_proc);
+        return;
+    }
+
+    rank_filename = icetGetStateBuffer(ICET_CAPTURE_FILE_NAME,
+                                       (IceTSizeType)strlen(filename) + 16);
+    captureRankFileName(filename, rank_filename);
+
+    /* Start a new file.  Frames are appended as they are drawn. */
+    file = fopen(rank_filename, "wb");
+    if (file == NULL) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Could not open capture file %s.", rank_filename);
+        icetGetStateBuffer(ICET_CAPTURE_FILE_NAME, 0);
+        return;
+    }
+    fclose(file);
+
+    icetStateSetInteger(ICET_CAPTURE_ENCODING, encoding);
+}
+
+static IceTBoolean captureEnabled(void)
+{
+    return (*icetUnsafeStateGetInteger(ICET_CAPTURE_ENCODING) != ICET_FALSE);
+}
+
+void icetCaptureFrameBegin(void)
+{
+    IceTInt global_viewport[4];
+    IceTImage capture_image;
+
+    if (!captureEnabled()) { return; }
+
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
+    capture_image = icetGetStateBufferImage(ICET_CAPTURE_BUF,
+                                            global_viewport[2],
+                                            global_viewport[3]);
+    icetClearImage(capture_image);
+}
+
+void icetCaptureTile(IceTInt tile,
+                     const IceTImage tile_image,
+                     const IceTInt *screen_viewport,
+                     const IceTInt *target_viewport)
+{
+    const IceTInt *tile_viewport;
+    const IceTInt *global_viewport;
+    IceTInt capture_viewport[4];
+
+    if (!captureEnabled()) { return; }
+    if ((screen_viewport[2] < 1) || (screen_viewport[3] < 1)) { return; }
+    if (icetImageIsNull(tile_image)) { return; }
+
+    /* Place the pixels where they belong in the global viewport. */
+    tile_viewport
+        = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS) + 4*tile;
+    global_viewport = icetUnsafeStateGetInteger(ICET_SCALED_GLOBAL_VIEWPORT);
+    capture_viewport[0]
+        = tile_viewport[0] + target_viewport[0] - global_viewport[0];
+    capture_viewport[1]
+        = tile_viewport[1] + target_viewport[1] - global_viewport[1];
+    capture_viewport[2] = screen_viewport[2];
+    capture_viewport[3] = screen_viewport[3];
+
+    icetImageCopyRegion(tile_image,
+                        screen_viewport,
+                        icetRetrieveStateImage(ICET_CAPTURE_BUF),
+                        capture_viewport);
+}
+
+void icetCaptureFrameEnd(void)
+{
+    IceTInt header[CAPTURE_HEADER_SIZE];
+    IceTImage capture_image;
+    IceTEnum encoding;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt num_tiles;
+    IceTInt num_bounding_verts;
+    IceTFloat background_color[4];
+    IceTDouble projection_matrix[16];
+    IceTDouble modelview_matrix[16];
+    IceTInt *display_nodes;
+    IceTVoid *package_buffer;
+    IceTSizeType package_size;
+    IceTVoid *sparse_buffer = NULL;
+    const char *filename;
+    FILE *file;
+
+    if (!captureEnabled()) { return; }
+
+    icetGetEnumv(ICET_CAPTURE_ENCODING, &encoding);
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    icetGetIntegerv(ICET_NUM_BOUNDING_VERTS, &num_bounding_verts);
+    capture_image = icetRetrieveStateImage(ICET_CAPTURE_BUF);
+
+    if (encoding == ICET_CAPTURE_SPARSE) {
+        IceTSparseImage sparse_image;
+        IceTDouble compress_time;
+        sparse_buffer = malloc(icetSparseImageBufferSize(
+                                           icetImageGetWidth(capture_image),
+                                           icetImageGetHeight(capture_image)));
+        sparse_image = icetSparseImageAssignBuffer(
+                                            sparse_buffer,
+                                            icetImageGetWidth(capture_image),
+                                            icetImageGetHeight(capture_image));
+        /* Keep the compression of the capture out of the frame times. */
+        icetGetDoublev(ICET_COMPRESS_TIME, &compress_time);
+        icetCompressImage(capture_image, sparse_image);
+        icetStateSetDouble(ICET_COMPRESS_TIME, compress_time);
+        icetSparseImagePackageForSend(sparse_image,
+                                      &package_buffer,
+                                      &package_size);
+    } else {
+        icetImagePackageForSend(capture_image, &package_buffer, &package_size);
+    }
+
+    header[CAPTURE_HEADER_MAGIC] = CAPTURE_MAGIC;
+    header[CAPTURE_HEADER_VERSION] = CAPTURE_VERSION;
+    header[CAPTURE_HEADER_RANK] = rank;
+    header[CAPTURE_HEADER_NUM_PROCESSES] = num_proc;
+    icetGetIntegerv(ICET_FRAME_COUNT, &header[CAPTURE_HEADER_FRAME]);
+    header[CAPTURE_HEADER_ENCODING] = (IceTInt)encoding;
+    header[CAPTURE_HEADER_COLOR_FORMAT]
+        = (IceTInt)icetImageGetColorFormat(capture_image);
+    header[CAPTURE_HEADER_DEPTH_FORMAT]
+        = (IceTInt)icetImageGetDepthFormat(capture_image);
+    icetGetIntegerv(ICET_COMPOSITE_MODE,
+                    &header[CAPTURE_HEADER_COMPOSITE_MODE]);
+    if (icetIsEnabled(ICET_ORDERED_COMPOSITE)) {
+        header[CAPTURE_HEADER_ORDER]
+            = icetUnsafeStateGetInteger(ICET_PROCESS_ORDERS)[rank];
+    } else {
+        header[CAPTURE_HEADER_ORDER] = -1;
+    }
+    header[CAPTURE_HEADER_NUM_TILES] = num_tiles;
+    header[CAPTURE_HEADER_NUM_BOUNDING_VERTS] = num_bounding_verts;
+    icetGetIntegerv(ICET_CONTAINED_VIEWPORT,
+                    &header[CAPTURE_HEADER_VALID_VIEWPORT]);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT,
+                    &header[CAPTURE_HEADER_GLOBAL_VIEWPORT]);
+    header[CAPTURE_HEADER_IMAGE_SIZE] = (IceTInt)package_size;
+
+    /* Record the true background color rather than the one IceT may have
+       substituted to correct a colored background. */
+    icetGetFloatv(ICET_TRUE_BACKGROUND_COLOR, background_color);
+    icetGetDoublev(ICET_PROJECTION_MATRIX, projection_matrix);
+    icetGetDoublev(ICET_MODELVIEW_MATRIX, modelview_matrix);
+    display_nodes = malloc(num_tiles*sizeof(IceTInt));
+    icetGetIntegerv(ICET_DISPLAY_NODES, display_nodes);
+
+    filename = (const char *)icetUnsafeStateGetBuffer(ICET_CAPTURE_FILE_NAME);
+    file = fopen(filename, "ab");
+    if (file == NULL) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Could not open capture file %s.", filename);
+    } else {
+        fwrite(header, sizeof(IceTInt), CAPTURE_HEADER_SIZE, file);
+        fwrite(background_color, sizeof(IceTFloat), 4, file);
+        fwrite(projection_matrix, sizeof(IceTDouble), 16, file);
+        fwrite(modelview_matrix, sizeof(IceTDouble), 16, file);
+        fwrite(icetUnsafeStateGetDouble(ICET_GEOMETRY_BOUNDS),
+               sizeof(IceTDouble), 3*num_bounding_verts, file);
+        fwrite(icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS),
+               sizeof(IceTInt), 4*num_tiles, file);
+        fwrite(display_nodes, sizeof(IceTInt), num_tiles, file);
+        fwrite(package_buffer, 1, package_size, file);
+        if (ferror(file)) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Error writing capture file %s.", filename);
+        }
+        fclose(file);
+    }
+
+    free(display_nodes);
+    if (sparse_buffer != NULL) { free(sparse_buffer); }
+}
+
+/* Restores the captured tile layout.  If the captured display processes do
+   not exist in this job, the tiles are given to the first processes or, if
+   there are too few processes, replaced with a single tile. */
+static void captureRestoreTiles(IceTInt num_tiles,
+                                const IceTInt *tile_viewports,
+                                const IceTInt *display_nodes,
+                                const IceTInt *global_viewport)
+{
+    IceTInt num_proc;
+    IceTBoolean displays_exist = ICET_TRUE;
+    IceTInt tile;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    for (tile = 0; tile < num_tiles; tile++) {
+        if (display_nodes[tile] >= num_proc) { displays_exist = ICET_FALSE; }
+    }
+
+    icetResetTiles();
+    if (num_tiles > num_proc) {
+        icetRaiseDebug("Too few processes for captured tiles."
+                       " Using one tile.");
+        icetAddTile(global_viewport[0], global_viewport[1],
+                    global_viewport[2], global_viewport[3], 0);
+        return;
+    }
+    for (tile = 0; tile < num_tiles; tile++) {
+        const IceTInt *viewport = tile_viewports + 4*tile;
+        icetAddTile(viewport[0], viewport[1], viewport[2], viewport[3],
+                    displays_exist ? display_nodes[tile] : tile);
+    }
+}
+
+/* Reads the record of the given frame.  The variable length parts are
+   returned in buffers that the caller must free. */
+static IceTBoolean captureReadRecord(FILE *file,
+                                     const char *filename,
+                                     IceTInt frame,
+                                     IceTInt *header,
+                                     IceTFloat *background_color,
+                                     IceTDouble *projection_matrix,
+                                     IceTDouble *modelview_matrix,
+                                     IceTDouble **bounds,
+                                     IceTInt **tile_viewports,
+                                     IceTInt **display_nodes,
+                                     IceTVoid **package_buffer)
+{
+    IceTInt record;
+    IceTInt num_bounding_verts;
+    IceTInt num_tiles;
+    size_t image_size;
+
+    /* Records are variable length, so read through the ones before the one
+       requested. */
+    for (record = 0; record <= frame; record++) {
+        if (   (fread(header, sizeof(IceTInt), CAPTURE_HEADER_SIZE, file)
+                != CAPTURE_HEADER_SIZE)
+            || (header[CAPTURE_HEADER_MAGIC] != CAPTURE_MAGIC)
+            || (header[CAPTURE_HEADER_VERSION] != CAPTURE_VERSION) ) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Capture file %s has no frame %d.",
+                           filename, frame);
+            return ICET_FALSE;
+        }
+        if (record < frame) {
+            long record_size = (long)(
+                      4*sizeof(IceTFloat)
+                    + 32*sizeof(IceTDouble)
+                    + 3*header[CAPTURE_HEADER_NUM_BOUNDING_VERTS]
+                      *sizeof(IceTDouble)
+                    + 5*header[CAPTURE_HEADER_NUM_TILES]*sizeof(IceTInt)
+                    + header[CAPTURE_HEADER_IMAGE_SIZE]);
+            fseek(file, record_size, SEEK_CUR);
+        }
+    }
+
+    num_bounding_verts = header[CAPTURE_HEADER_NUM_BOUNDING_VERTS];
+    num_tiles = header[CAPTURE_HEADER_NUM_TILES];
+    image_size = (size_t)header[CAPTURE_HEADER_IMAGE_SIZE];
+    *bounds = malloc(3*num_bounding_verts*sizeof(IceTDouble) + 1);
+    *tile_viewports = malloc(4*num_tiles*sizeof(IceTInt));
+    *display_nodes = malloc(num_tiles*sizeof(IceTInt));
+    *package_buffer = malloc(image_size);
+
+    if (   (fread(background_color, sizeof(IceTFloat), 4, file) != 4)
+        || (fread(projection_matrix, sizeof(IceTDouble), 16, file) != 16)
+        || (fread(modelview_matrix, sizeof(IceTDouble), 16, file) != 16)
+        || (   fread(*bounds, sizeof(IceTDouble), 3*num_bounding_verts, file)
+            != (size_t)(3*num_bounding_verts))
+        || (   fread(*tile_viewports, sizeof(IceTInt), 4*num_tiles, file)
+            != (size_t)(4*num_tiles))
+        || (   fread(*display_nodes, sizeof(IceTInt), num_tiles, file)
+            != (size_t)num_tiles)
+        || (fread(*package_buffer, 1, image_size, file) != image_size) ) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Capture file %s is truncated.", filename);
+        return ICET_FALSE;
+    }
+
+    return ICET_TRUE;
+}
+
+IceTImage icetLoadCapturedFrame(const char *filename,
+                                IceTInt frame,
+                                IceTInt *valid_pixels_viewport,
+                                IceTDouble *projection_matrix,
+                                IceTDouble *modelview_matrix,
+                                IceTFloat *background_color,
+                                IceTInt *info)
+{
+    IceTInt header[CAPTURE_HEADER_SIZE];
+    IceTFloat captured_background[4];
+    IceTDouble captured_projection[16];
+    IceTDouble captured_modelview[16];
+    IceTDouble *bounds = NULL;
+    IceTInt *tile_viewports = NULL;
+    IceTInt *display_nodes = NULL;
+    IceTVoid *package_buffer = NULL;
+    IceTImage image;
+    FILE *file;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Could not open capture file %s.", filename);
+        return icetImageNull();
+    }
+
+    if (!captureReadRecord(file, filename, frame, header,
+                           captured_background,
+                           captured_projection,
+                           captured_modelview,
+                           &bounds,
+                           &tile_viewports,
+                           &display_nodes,
+                           &package_buffer)) {
+        image = icetImageNull();
+    } else {
+        /* Restore the state needed to composite the image. */
+        icetSetColorFormat((IceTEnum)header[CAPTURE_HEADER_COLOR_FORMAT]);
+        icetSetDepthFormat((IceTEnum)header[CAPTURE_HEADER_DEPTH_FORMAT]);
+        icetCompositeMode((IceTEnum)header[CAPTURE_HEADER_COMPOSITE_MODE]);
+        captureRestoreTiles(header[CAPTURE_HEADER_NUM_TILES],
+                            tile_viewports,
+                            display_nodes,
+                            &header[CAPTURE_HEADER_GLOBAL_VIEWPORT]);
+        icetBoundingVertices(header[CAPTURE_HEADER_NUM_BOUNDING_VERTS],
+                             ICET_DOUBLE, 0,
+                             header[CAPTURE_HEADER_NUM_BOUNDING_VERTS],
+                             bounds);
+
+        image = icetGetStateBufferImage(
+                                ICET_CAPTURE_BUF,
+                                header[CAPTURE_HEADER_GLOBAL_VIEWPORT + 2],
+                                header[CAPTURE_HEADER_GLOBAL_VIEWPORT + 3]);
+        if (header[CAPTURE_HEADER_ENCODING] == (IceTInt)ICET_CAPTURE_SPARSE) {
+            icetDecompressImage(
+                        icetSparseImageUnpackageFromReceive(package_buffer),
+                        image);
+        } else {
+            icetImageCopyPixels(icetImageUnpackageFromReceive(package_buffer),
+                                0,
+                                image,
+                                0,
+                                icetImageGetNumPixels(image));
+        }
+
+        if (valid_pixels_viewport != NULL) {
+            memcpy(valid_pixels_viewport,
+                   &header[CAPTURE_HEADER_VALID_VIEWPORT],
+                   4*sizeof(IceTInt));
+        }
+        if (projection_matrix != NULL) {
+            memcpy(projection_matrix,
+                   captured_projection,
+                   16*sizeof(IceTDouble));
+        }
+        if (modelview_matrix != NULL) {
+            memcpy(modelview_matrix,
+                   captured_modelview,
+                   16*sizeof(IceTDouble));
+        }
+        if (background_color != NULL) {
+            memcpy(background_color, captured_background, 4*sizeof(IceTFloat));
+        }
+        if (info != NULL) {
+            info[ICET_CAPTURE_INFO_RANK] = header[CAPTURE_HEADER_RANK];
+            info[ICET_CAPTURE_INFO_NUM_PROCESSES]
+                = header[CAPTURE_HEADER_NUM_PROCESSES];
+            info[ICET_CAPTURE_INFO_FRAME] = header[CAPTURE_HEADER_FRAME];
+            info[ICET_CAPTURE_INFO_ORDER] = header[CAPTURE_HEADER_ORDER];
+        }
+    }
+
+    fclose(file);
+    if (bounds != NULL) { free(bounds); }
+    if (tile_viewports != NULL) { free(tile_viewports); }
+    if (display_nodes != NULL) { free(display_nodes); }
+    if (package_buffer != NULL) { free(package_buffer); }
+    return image;
+}
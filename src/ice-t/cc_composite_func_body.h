@@ -45,17 +45,21 @@
 {
     IceTEnum _color_format;
     IceTEnum _depth_format;
+    IceTSizeType _auxiliary_size;
     IceTEnum _composite_mode;
 
     icetGetEnumv(ICET_COMPOSITE_MODE, &_composite_mode);
 
     _color_format = icetSparseImageGetColorFormat(FRONT_SPARSE_IMAGE);
     _depth_format = icetSparseImageGetDepthFormat(FRONT_SPARSE_IMAGE);
+    _auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(FRONT_SPARSE_IMAGE);
 
     if (   (_color_format != icetSparseImageGetColorFormat(BACK_SPARSE_IMAGE))
         || (_color_format != icetSparseImageGetColorFormat(DEST_SPARSE_IMAGE))
         || (_depth_format != icetSparseImageGetDepthFormat(BACK_SPARSE_IMAGE))
         || (_depth_format != icetSparseImageGetDepthFormat(DEST_SPARSE_IMAGE))
+        || (_auxiliary_size != ICET_IMAGE_AUXILIARY_SIZE(BACK_SPARSE_IMAGE))
+        || (_auxiliary_size != ICET_IMAGE_AUXILIARY_SIZE(DEST_SPARSE_IMAGE))
            ) {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Input buffers do not agree for compressed-compressed"
@@ -63,7 +67,34 @@
     }
 
     if (_composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
-        if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+        if (   (_depth_format == ICET_IMAGE_DEPTH_FLOAT)
+            && (_auxiliary_size > 0) ) {
+          /* Use Z buffer for active pixel testing and compositing.  The
+             winning pixel is copied whole, auxiliary channels and all. */
+            IceTSizeType _color_size = colorPixelSize(_color_format);
+            IceTSizeType _pixel_size
+                = _color_size + sizeof(IceTFloat) + _auxiliary_size;
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE(src1_pointer, src2_pointer, dest_pointer)         \
+    {                                                                   \
+        const IceTFloat *src1_depth                                     \
+            = (const IceTFloat *)(src1_pointer + _color_size);          \
+        const IceTFloat *src2_depth                                     \
+            = (const IceTFloat *)(src2_pointer + _color_size);          \
+        if (src1_depth[0] < src2_depth[0]) {                            \
+            memcpy(dest_pointer, src1_pointer, _pixel_size);            \
+        } else {                                                        \
+            memcpy(dest_pointer, src2_pointer, _pixel_size);            \
+        }                                                               \
+        src1_pointer += _pixel_size;                                    \
+        src2_pointer += _pixel_size;                                    \
+        dest_pointer += _pixel_size;                                    \
+    }
+#define CCC_PIXEL_SIZE _pixel_size
+#include "cc_composite_template_body.h"
+        } else if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
           /* Use Z buffer for active pixel testing and compositing. */
             if (_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
 #define UNPACK_PIXEL(pointer, color, depth)     \
@@ -268,6 +299,113 @@
             icetRaiseError(ICET_INVALID_VALUE,
                            "Cannot use blend composite with a depth buffer.");
         }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(_composite_mode)) {
+      /* Front and back do not matter.  REDUCE_COLOR is redefined for each
+       * mode so that every mode gets its own loop. */
+        if (_depth_format == ICET_IMAGE_DEPTH_NONE) {
+            if (_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+#define REDUCE_COMPOSITE(front_pointer, back_pointer, dest_pointer)     \
+    {                                                                   \
+        const IceTUByte *front_color = (const IceTUByte *)front_pointer;\
+        const IceTUByte *back_color = (const IceTUByte *)back_pointer;  \
+        IceTUByte *dest_color = (IceTUByte *)dest_pointer;              \
+        *((IceTUInt *)dest_color) = *((const IceTUInt *)front_color);   \
+        REDUCE_COLOR(back_color, dest_color);                           \
+        front_pointer += sizeof(IceTUInt);                              \
+        back_pointer += sizeof(IceTUInt);                               \
+        dest_pointer += sizeof(IceTUInt);                               \
+    }
+                if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define REDUCE_COLOR ICET_MAX_UBYTE
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (sizeof(IceTUInt))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define REDUCE_COLOR ICET_MIN_UBYTE
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (sizeof(IceTUInt))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                } else {
+#define REDUCE_COLOR ICET_ADD_UBYTE
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (sizeof(IceTUInt))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                }
+#undef REDUCE_COMPOSITE
+            } else if (_color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+#define REDUCE_COMPOSITE(front_pointer, back_pointer, dest_pointer)     \
+    {                                                                   \
+        const IceTFloat *front_color = (const IceTFloat *)front_pointer;\
+        const IceTFloat *back_color = (const IceTFloat *)back_pointer;  \
+        IceTFloat *dest_color = (IceTFloat *)dest_pointer;              \
+        dest_color[0] = front_color[0];                                 \
+        dest_color[1] = front_color[1];                                 \
+        dest_color[2] = front_color[2];                                 \
+        dest_color[3] = front_color[3];                                 \
+        REDUCE_COLOR(back_color, dest_color);                           \
+        front_pointer += 4*sizeof(IceTFloat);                           \
+        back_pointer += 4*sizeof(IceTFloat);                            \
+        dest_pointer += 4*sizeof(IceTFloat);                            \
+    }
+                if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define REDUCE_COLOR ICET_MAX_FLOAT
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (4*sizeof(IceTFloat))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define REDUCE_COLOR ICET_MIN_FLOAT
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (4*sizeof(IceTFloat))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                } else {
+#define REDUCE_COLOR ICET_ADD_FLOAT
+#define CCC_FRONT_COMPRESSED_IMAGE FRONT_SPARSE_IMAGE
+#define CCC_BACK_COMPRESSED_IMAGE BACK_SPARSE_IMAGE
+#define CCC_DEST_COMPRESSED_IMAGE DEST_SPARSE_IMAGE
+#define CCC_COMPOSITE REDUCE_COMPOSITE
+#define CCC_PIXEL_SIZE (4*sizeof(IceTFloat))
+#include "cc_composite_template_body.h"
+#undef REDUCE_COLOR
+                }
+#undef REDUCE_COMPOSITE
+            } else if (_color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+                icetRaiseError(
+                    ICET_INVALID_VALUE,
+                    "Cannot use reduction composite without alpha channel");
+            } else if (_color_format == ICET_IMAGE_COLOR_NONE) {
+                icetRaiseWarning(ICET_INVALID_OPERATION,
+                                 "Compositing image with no data.");
+                icetClearSparseImage(DEST_SPARSE_IMAGE);
+            } else {
+                icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                               "Encountered invalid color format 0x%X.",
+                               _color_format);
+            }
+        } else {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Cannot use reduction composite with a depth"
+                           " buffer.");
+        }
     } else {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Encountered invalid composite mode 0x%X.",
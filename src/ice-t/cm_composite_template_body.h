@@ -0,0 +1,115 @@
+/* -*- c -*- *******************************************************/
+/*
+ * Copyright (C) 2011 Sandia Corporation
+ * Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+ * the U.S. Government retains certain rights in this software.
+ *
+ * This source code is released under the New BSD License.
+ */
+
+/* This is not a traditional header file, but rather a "macro" file that defines
+ * a template for compositing several compressed images into a full image in
+ * one pass.  (If this were C++, we would actually use templates.)  The
+ * compressed images are walked together, so each pixel of the output image is
+ * loaded and stored once no matter how many images are active over it.  The
+ * pixels of the compressed images are applied in the order the images are
+ * given, so the result is the same as compositing them one at a time.
+ *
+ * The following macros must be defined:
+ *      CM_COMPRESSED_IMAGES - an array of compressed images to composite.
+ *      CM_NUM_IMAGES - the number of images in CM_COMPRESSED_IMAGES.  At
+ *              most ICET_COMPOSITE_MANY_MAX.
+ *      CM_NUM_PIXELS - the number of pixels in each image.
+ *      CM_COMPOSITE(src_pointer, pixel) - composite the compressed pixel data
+ *              at src_pointer into the given pixel index of the output.
+ *      CM_PIXEL_SIZE - the number of bytes required to store the data
+ *              for one pixel.
+ *
+ * All of the above macros are undefined at the end of this file.
+ */
+
+#ifndef ICET_IMAGE_DATA
+#error Need ICET_IMAGE_DATA macro.  Is this included in image.c?
+#endif
+#ifndef INACTIVE_RUN_LENGTH
+#error Need INACTIVE_RUN_LENGTH macro.  Is this included in image.c?
+#endif
+#ifndef ACTIVE_RUN_LENGTH
+#error Need ACTIVE_RUN_LENGTH macro.  Is this included in image.c?
+#endif
+#ifndef ICET_COMPOSITE_MANY_MAX
+#error Need ICET_COMPOSITE_MANY_MAX macro.  Is this included in image.c?
+#endif
+
+{
+    /* Use IceTByte for byte-based pointer arithmetic. */
+    const IceTByte *_src[ICET_COMPOSITE_MANY_MAX];
+    IceTSizeType _num_inactive[ICET_COMPOSITE_MANY_MAX];
+    IceTSizeType _num_active[ICET_COMPOSITE_MANY_MAX];
+    IceTInt _active_images[ICET_COMPOSITE_MANY_MAX];
+    IceTSizeType _pixel;
+    IceTInt _image;
+
+    for (_image = 0; _image < CM_NUM_IMAGES; _image++) {
+        _src[_image] = ICET_IMAGE_DATA(CM_COMPRESSED_IMAGES[_image]);
+        _num_inactive[_image] = _num_active[_image] = 0;
+    }
+
+    _pixel = 0;
+    while (_pixel < CM_NUM_PIXELS) {
+        IceTSizeType _segment = CM_NUM_PIXELS - _pixel;
+        IceTInt _num_active_images = 0;
+        IceTSizeType _i;
+
+        /* Find the longest segment over which every image stays either
+           inactive or active. */
+        for (_image = 0; _image < CM_NUM_IMAGES; _image++) {
+            while (   (_num_inactive[_image] == 0)
+                   && (_num_active[_image] == 0) ) {
+                _num_inactive[_image] = INACTIVE_RUN_LENGTH(_src[_image]);
+                _num_active[_image] = ACTIVE_RUN_LENGTH(_src[_image]);
+                _src[_image] += RUN_LENGTH_SIZE;
+                if (  _pixel + _num_inactive[_image] + _num_active[_image]
+                    > CM_NUM_PIXELS ) {
+                    icetRaiseError(ICET_INVALID_VALUE,
+                                   "Corrupt compressed image.");
+                    return;
+                }
+            }
+            if (_num_inactive[_image] > 0) {
+                if (_num_inactive[_image] < _segment) {
+                    _segment = _num_inactive[_image];
+                }
+            } else {
+                if (_num_active[_image] < _segment) {
+                    _segment = _num_active[_image];
+                }
+                _active_images[_num_active_images++] = _image;
+            }
+        }
+
+        for (_i = 0; (_num_active_images > 0) && (_i < _segment); _i++) {
+            IceTInt _a;
+            for (_a = 0; _a < _num_active_images; _a++) {
+                IceTInt _active = _active_images[_a];
+                CM_COMPOSITE(_src[_active], _pixel + _i);
+                _src[_active] += CM_PIXEL_SIZE;
+            }
+        }
+
+        for (_image = 0; _image < CM_NUM_IMAGES; _image++) {
+            if (_num_inactive[_image] > 0) {
+                _num_inactive[_image] -= _segment;
+            } else {
+                _num_active[_image] -= _segment;
+            }
+        }
+        _pixel += _segment;
+    }
+}
+
+#undef CM_COMPRESSED_IMAGES
+#undef CM_NUM_IMAGES
+#undef CM_NUM_PIXELS
+#undef CM_COMPOSITE
+#undef CM_PIXEL_SIZE
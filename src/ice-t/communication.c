@@ -13,14 +13,52 @@
 #include <IceTDevContext.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevPorting.h>
+#include <IceTDevTiming.h>
 
-#define icetAddSentBytes(num_sending)                                   \
-    icetStateSetInteger(ICET_BYTES_SENT,                                \
-                        icetUnsafeStateGetInteger(ICET_BYTES_SENT)[0]   \
-                        + (num_sending))
+static void icetAddSentBytes(IceTInt num_sending, int dest)
+{
+    icetStateSetInteger(ICET_BYTES_SENT,
+                        icetUnsafeStateGetInteger(ICET_BYTES_SENT)[0]
+                        + num_sending);
+    icetTimingRoundSent(dest, num_sending);
+}
+
+#define icetAddSent(count, datatype, dest)                              \
+    icetAddSentBytes((IceTInt)count*icetTypeWidth(datatype), dest)
+
+/* Messages are only timed while a round is recording statistics or a trace
+   is being written.  Otherwise the start time is not read. */
+#define icetCommTimingActive()                                          \
+    (icetUnsafeStateGetBoolean(ICET_COMM_TIMING_ACTIVE)[0])
+
+static IceTDouble icetCommStartTime(void)
+{
+    return icetCommTimingActive() ? icetWallTime() : 0.0;
+}
+
+static void icetAddWaitTime(IceTDouble start_time)
+{
+    if (!icetCommTimingActive()) { return; }
+    icetTimingRoundAccumulate(ICET_ROUND_WAIT_TIME,
+                              icetWallTime() - start_time);
+}
+
+static void icetTraceTimedComm(const char *name,
+                               IceTDouble start_time,
+                               IceTSizeType bytes,
+                               IceTInt peer,
+                               IceTInt tag)
+{
+    if (!icetCommTimingActive()) { return; }
+    icetTraceComm(name, start_time, bytes, peer, tag);
+}
 
-#define icetAddSent(count, datatype)                                    \
-    icetAddSentBytes((IceTInt)count*icetTypeWidth(datatype))
+#define icetTraceMessage(name, start_time, count, datatype, peer, tag)  \
+    icetTraceTimedComm(name,                                            \
+                       start_time,                                      \
+                       (IceTSizeType)(count)*icetTypeWidth(datatype),   \
+                       peer,                                            \
+                       tag)
 
 #define icetCommCheckCount(count)                                       \
     if (count > 1073741824) {                                           \
@@ -53,9 +91,12 @@ void icetCommSend(const void *buf,
                   int tag)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(count);
-    icetAddSent(count, datatype);
+    icetAddSent(count, datatype, dest);
     comm->Send(comm, buf, (int)count, datatype, dest, tag);
+    icetAddWaitTime(start_time);
+    icetTraceMessage("send", start_time, count, datatype, dest, tag);
 }
 
 void icetCommRecv(void *buf,
@@ -65,8 +106,11 @@ void icetCommRecv(void *buf,
                   int tag)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(count);
     comm->Recv(comm, buf, (int)count, datatype, src, tag);
+    icetAddWaitTime(start_time);
+    icetTraceMessage("recv", start_time, count, datatype, src, tag);
 }
 
 void icetCommSendrecv(const void *sendbuf,
@@ -81,11 +125,19 @@ void icetCommSendrecv(const void *sendbuf,
                       int recvtag)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(sendcount);
     icetCommCheckCount(recvcount);
-    icetAddSent(sendcount, sendtype);
+    icetAddSent(sendcount, sendtype, dest);
     comm->Sendrecv(comm, sendbuf, (int)sendcount, sendtype, dest, sendtag,
                    recvbuf, (int)recvcount, recvtype, src, recvtag);
+    icetAddWaitTime(start_time);
+    icetTraceMessage("sendrecv",
+                     start_time,
+                     sendcount,
+                     sendtype,
+                     dest,
+                     sendtag);
 }
 
 void icetCommGather(const void *sendbuf,
@@ -95,14 +147,16 @@ void icetCommGather(const void *sendbuf,
                     int root)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(sendcount);
     if (root != icetCommRank()) {
-        icetAddSent(sendcount, datatype);
+        icetAddSent(sendcount, datatype, root);
     }
 #ifdef DEBUG
     comm->Barrier(comm);
 #endif
     comm->Gather(comm, sendbuf, sendcount, datatype, recvbuf, root);
+    icetTraceMessage("gather", start_time, sendcount, datatype, root, 0);
 }
 
 void icetCommGatherv(const void *sendbuf,
@@ -114,6 +168,7 @@ void icetCommGatherv(const void *sendbuf,
                      int root)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     int *int_recvcounts;
     int *int_recvoffsets;
     icetCommCheckCount(sendcount);
@@ -136,7 +191,7 @@ void icetCommGatherv(const void *sendbuf,
             }
         }
     } else {
-        icetAddSent(sendcount, datatype);
+        icetAddSent(sendcount, datatype, root);
         int_recvcounts = NULL;
         int_recvoffsets = NULL;
     }
@@ -151,6 +206,7 @@ void icetCommGatherv(const void *sendbuf,
                   int_recvcounts,
                   int_recvoffsets,
                   root);
+    icetTraceMessage("gatherv", start_time, sendcount, datatype, root, 0);
 }
 
 void icetCommAllgather(const void *sendbuf,
@@ -159,9 +215,11 @@ void icetCommAllgather(const void *sendbuf,
                        void *recvbuf)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(sendcount);
-    icetAddSent(sendcount, datatype);
+    icetAddSent(sendcount, datatype, -1);
     comm->Allgather(comm, sendbuf, (int)sendcount, datatype, recvbuf);
+    icetTraceMessage("allgather", start_time, sendcount, datatype, -1, 0);
 }
 
 void icetCommAlltoall(const void *sendbuf,
@@ -170,9 +228,11 @@ void icetCommAlltoall(const void *sendbuf,
                       void *recvbuf)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     icetCommCheckCount(sendcount);
-    icetAddSent(sendcount, datatype);
+    icetAddSent(sendcount, datatype, -1);
     comm->Alltoall(comm, sendbuf, (int)sendcount, datatype, recvbuf);
+    icetTraceMessage("alltoall", start_time, sendcount, datatype, -1, 0);
 }
 
 IceTCommRequest icetCommIsend(const void *buf,
@@ -182,9 +242,13 @@ IceTCommRequest icetCommIsend(const void *buf,
                               int tag)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
+    IceTCommRequest request;
     icetCommCheckCount(count);
-    icetAddSent(count, datatype);
-    return comm->Isend(comm, buf, (int)count, datatype, dest, tag);
+    icetAddSent(count, datatype, dest);
+    request = comm->Isend(comm, buf, (int)count, datatype, dest, tag);
+    icetTraceMessage("isend", start_time, count, datatype, dest, tag);
+    return request;
 }
 
 IceTCommRequest icetCommIrecv(void *buf,
@@ -194,20 +258,31 @@ IceTCommRequest icetCommIrecv(void *buf,
                               int tag)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
+    IceTCommRequest request;
     icetCommCheckCount(count);
-    return comm->Irecv(comm, buf, (int)count, datatype, src, tag);
+    request = comm->Irecv(comm, buf, (int)count, datatype, src, tag);
+    icetTraceMessage("irecv", start_time, count, datatype, src, tag);
+    return request;
 }
 
 void icetCommWait(IceTCommRequest *request)
 {
     IceTCommunicator comm = icetGetCommunicator();
+    IceTDouble start_time = icetCommStartTime();
     comm->Wait(comm, request);
+    icetAddWaitTime(start_time);
+    icetTraceTimedComm("wait", start_time, -1, -1, 0);
 }
 
 int icetCommWaitany(int count, IceTCommRequest *array_of_requests)
 {
     IceTCommunicator comm = icetGetCommunicator();
-    return comm->Waitany(comm, count, array_of_requests);
+    IceTDouble start_time = icetCommStartTime();
+    int index = comm->Waitany(comm, count, array_of_requests);
+    icetAddWaitTime(start_time);
+    icetTraceTimedComm("waitany", start_time, -1, -1, 0);
+    return index;
 }
 
 void icetCommWaitall(int count, IceTCommRequest *array_of_requests)
@@ -56,25 +56,31 @@
 #ifdef REGION
 #ifdef OFFSET
 #error REGION and OFFSET are incompatible
-#else
-#define OFFSET (REGION_OFFSET_X + _input_width*(REGION_OFFSET_Y))
 #endif
+/* Regions may be read from pointer images whose buffers are not tightly
+ * packed, so pixels are found with byte steps rather than array indices. */
+#define STEP_BYTES(pointer, bytes) \
+    pointer = (const IceTVoid *)((const IceTByte *)(pointer) + (bytes))
 #endif
 
 {
     IceTEnum _color_format, _depth_format;
+    IceTSizeType _auxiliary_size;
     IceTSizeType _pixel_count;
     IceTEnum _composite_mode;
 #ifdef REGION
-    IceTSizeType _input_width = icetImageGetWidth(INPUT_IMAGE);
     IceTSizeType _region_width = REGION_WIDTH;
-    IceTSizeType _region_x_skip = _input_width - (REGION_WIDTH);
+    IceTSizeType _color_step, _color_row_skip;
+    IceTSizeType _depth_step, _depth_row_skip;
+    const IceTVoid *_color_region;
+    const IceTVoid *_depth_region;
 #endif
 
     icetGetEnumv(ICET_COMPOSITE_MODE, &_composite_mode);
 
     _color_format = icetImageGetColorFormat(INPUT_IMAGE);
     _depth_format = icetImageGetDepthFormat(INPUT_IMAGE);
+    _auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(OUTPUT_SPARSE_IMAGE);
 
 #ifdef PIXEL_COUNT
     _pixel_count = PIXEL_COUNT;
@@ -87,6 +93,8 @@
 #ifdef DEBUG
     if (   (icetSparseImageGetColorFormat(OUTPUT_SPARSE_IMAGE) != _color_format)
         || (icetSparseImageGetDepthFormat(OUTPUT_SPARSE_IMAGE) != _depth_format)
+        || (   (ICET_IMAGE_AUXILIARY_SIZE(INPUT_IMAGE) != 0)
+            && (ICET_IMAGE_AUXILIARY_SIZE(INPUT_IMAGE) != _auxiliary_size) )
            ) {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Format of input and output to compress do not match.");
@@ -115,10 +123,106 @@
 #endif /*REGION*/
 #endif /*DEBUG*/
 
+#ifdef REGION
+    _color_region = imageColorPixel(INPUT_IMAGE,
+                                    REGION_OFFSET_X,
+                                    REGION_OFFSET_Y,
+                                    &_color_step,
+                                    &_color_row_skip);
+    _color_row_skip -= _region_width*_color_step;
+    _depth_region = imageDepthPixel(INPUT_IMAGE,
+                                    REGION_OFFSET_X,
+                                    REGION_OFFSET_Y,
+                                    &_depth_step,
+                                    &_depth_row_skip);
+    _depth_row_skip -= _region_width*_depth_step;
+#endif
+
     if (_composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
-        if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+        if (   (_depth_format == ICET_IMAGE_DEPTH_FLOAT)
+            && (_auxiliary_size > 0) ) {
+          /* Use Z buffer for active pixel testing.  The auxiliary channels
+             are copied with the color and depth.  An input image without
+             them (such as one built on application pointers) gets zeros. */
+            IceTSizeType _color_size = colorPixelSize(_color_format);
+            IceTSizeType _auxiliary_step;
+            const IceTByte *_color;
+            const IceTFloat *_depth;
+            const IceTByte *_auxiliary;
+#ifdef REGION
+            IceTSizeType _auxiliary_row_skip;
+            IceTSizeType _region_count = 0;
+#endif
+            _auxiliary = icetImageGetAuxiliaryConstVoid(INPUT_IMAGE, NULL);
+            _auxiliary_step = (_auxiliary != NULL) ? _auxiliary_size : 0;
+#ifdef REGION
+            _color = _color_region;
+            _depth = _depth_region;
+            _auxiliary += _auxiliary_step*(  (REGION_OFFSET_Y)
+                                           * icetImageGetWidth(INPUT_IMAGE)
+                                           + (REGION_OFFSET_X) );
+            _auxiliary_row_skip
+                = _auxiliary_step
+                  *(icetImageGetWidth(INPUT_IMAGE) - _region_width);
+#else
+            _color = icetImageGetColorConstVoid(INPUT_IMAGE, NULL);
+            _depth = icetImageGetDepthcf(INPUT_IMAGE);
+#endif
+#ifdef OFFSET
+            _color += _color_size*(OFFSET);
+            _depth += OFFSET;
+            _auxiliary += _auxiliary_step*(OFFSET);
+#endif
+#define CT_COMPRESSED_IMAGE     OUTPUT_SPARSE_IMAGE
+#define CT_COLOR_FORMAT         _color_format
+#define CT_DEPTH_FORMAT         _depth_format
+#define CT_PIXEL_COUNT          _pixel_count
+#define CT_ACTIVE()             (_depth[0] < 1.0)
+#define CT_WRITE_PIXEL(dest)    if (_color_size > 0) {                  \
+                                    memcpy(dest, _color, _color_size);  \
+                                    dest += _color_size;                \
+                                }                                       \
+                                memcpy(dest, _depth, sizeof(IceTFloat));\
+                                dest += sizeof(IceTFloat);              \
+                                if (_auxiliary != NULL) {               \
+                                    memcpy(dest, _auxiliary,            \
+                                           _auxiliary_size);            \
+                                } else {                                \
+                                    memset(dest, 0, _auxiliary_size);   \
+                                }                                       \
+                                dest += _auxiliary_size;
+#ifdef REGION
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                STEP_BYTES(_depth, _depth_step);        \
+                                _auxiliary += _auxiliary_step;          \
+                                _region_count++;                        \
+                                if (_region_count >= _region_width) {   \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    STEP_BYTES(_depth, _depth_row_skip);\
+                                    _auxiliary += _auxiliary_row_skip;  \
+                                    _region_count = 0;                  \
+                                }
+#else
+#define CT_INCREMENT_PIXEL()    _color += _color_size;  _depth++;       \
+                                _auxiliary += _auxiliary_step;
+#endif
+#ifdef PADDING
+#define CT_PADDING
+#define CT_SPACE_BOTTOM         SPACE_BOTTOM
+#define CT_SPACE_TOP            SPACE_TOP
+#define CT_SPACE_LEFT           SPACE_LEFT
+#define CT_SPACE_RIGHT          SPACE_RIGHT
+#define CT_FULL_WIDTH           FULL_WIDTH
+#define CT_FULL_HEIGHT          FULL_HEIGHT
+#endif
+#include "compress_template_body.h"
+        } else if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
           /* Use Z buffer for active pixel testing. */
+#ifdef REGION
+            const IceTFloat *_depth = _depth_region;
+#else
             const IceTFloat *_depth = icetImageGetDepthcf(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
             _depth += OFFSET;
 #endif
@@ -128,8 +232,10 @@
                 IceTFloat *_d_out;
 #ifdef REGION
                 IceTSizeType _region_count = 0;
-#endif
+                _color = _color_region;
+#else
                 _color = icetImageGetColorcui(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
                 _color += OFFSET;
 #endif
@@ -145,11 +251,12 @@
                                 _d_out[0] = _depth[0];          \
                                 dest += sizeof(IceTFloat);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _color++;  _depth++;                    \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                STEP_BYTES(_depth, _depth_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _color += _region_x_skip;           \
-                                    _depth += _region_x_skip;           \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    STEP_BYTES(_depth, _depth_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -170,8 +277,10 @@
                 IceTFloat *_out;
 #ifdef REGION
                 IceTSizeType _region_count = 0;
-#endif
+                _color = _color_region;
+#else
                 _color = icetImageGetColorcf(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
                 _color += 4*(OFFSET);
 #endif
@@ -188,11 +297,12 @@
                                 _out[4] = _depth[0];            \
                                 dest += 5*sizeof(IceTFloat);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _color += 4;  _depth++;                 \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                STEP_BYTES(_depth, _depth_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _color += 4*_region_x_skip;         \
-                                    _depth += _region_x_skip;           \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    STEP_BYTES(_depth, _depth_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -213,8 +323,10 @@
                 IceTFloat *_out;
 #ifdef REGION
                 IceTSizeType _region_count = 0;
-#endif
+                _color = _color_region;
+#else
                 _color = icetImageGetColorcf(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
                 _color += 3*(OFFSET);
 #endif
@@ -230,11 +342,12 @@
                                 _out[3] = _depth[0];            \
                                 dest += 4*sizeof(IceTFloat);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _color += 3;  _depth++;                 \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                STEP_BYTES(_depth, _depth_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _color += 3*_region_x_skip;         \
-                                    _depth += _region_x_skip;           \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    STEP_BYTES(_depth, _depth_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -264,10 +377,10 @@
                                 _out[0] = _depth[0];            \
                                 dest += 1*sizeof(IceTFloat);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _depth++;                               \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_depth, _depth_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _depth += _region_x_skip;           \
+                                    STEP_BYTES(_depth, _depth_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -309,8 +422,10 @@
             IceTUInt *_out;
 #ifdef REGION
             IceTSizeType _region_count = 0;
-#endif
+            _color = _color_region;
+#else
             _color = icetImageGetColorcui(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
             _color += OFFSET;
 #endif
@@ -323,10 +438,10 @@
                                 _out[0] = _color[0];            \
                                 dest += sizeof(IceTUInt);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _color++;                               \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _color += _region_x_skip;           \
+                                    STEP_BYTES(_color, _color_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -347,8 +462,10 @@
             IceTFloat *_out;
 #ifdef REGION
             IceTSizeType _region_count = 0;
-#endif
+            _color = _color_region;
+#else
             _color = icetImageGetColorcf(INPUT_IMAGE);
+#endif
 #ifdef OFFSET
             _color += 4*(OFFSET);
 #endif
@@ -364,10 +481,10 @@
                                 _out[3] = _color[3];            \
                                 dest += 4*sizeof(IceTUInt);
 #ifdef REGION
-#define CT_INCREMENT_PIXEL()    _color += 4;                            \
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
                                 _region_count++;                        \
                                 if (_region_count >= _region_width) {   \
-                                    _color += 4*_region_x_skip;         \
+                                    STEP_BYTES(_color, _color_row_skip);\
                                     _region_count = 0;                  \
                                 }
 #else
@@ -407,6 +524,127 @@
                            "Encountered invalid color format 0x%X.",
                            _color_format);
         }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(_composite_mode)) {
+      /* Pixels holding the identity of the reduction are inactive. */
+        if (_depth_format != ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseWarning(ICET_INVALID_VALUE,
+                             "Z buffer ignored during reduction compress"
+                             " operation.  Output z buffer meaningless.");
+        }
+        if (_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            const IceTUInt *_color;
+            IceTUInt *_out;
+            IceTUInt _identity_word
+                = ICET_REDUCTION_IDENTITY_WORD(_composite_mode);
+#ifdef REGION
+            IceTSizeType _region_count = 0;
+            _color = _color_region;
+#else
+            _color = icetImageGetColorcui(INPUT_IMAGE);
+#endif
+#ifdef OFFSET
+            _color += OFFSET;
+#endif
+#define CT_COMPRESSED_IMAGE     OUTPUT_SPARSE_IMAGE
+#define CT_COLOR_FORMAT         _color_format
+#define CT_DEPTH_FORMAT         _depth_format
+#define CT_PIXEL_COUNT          _pixel_count
+#define CT_ACTIVE()             (_color[0] != _identity_word)
+#define CT_WRITE_PIXEL(dest)    _out = (IceTUInt *)dest;        \
+                                _out[0] = _color[0];            \
+                                dest += sizeof(IceTUInt);
+#ifdef REGION
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                _region_count++;                        \
+                                if (_region_count >= _region_width) {   \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    _region_count = 0;                  \
+                                }
+#else
+#define CT_INCREMENT_PIXEL()    _color++;
+#endif
+#ifdef PADDING
+#define CT_PADDING
+#define CT_SPACE_BOTTOM         SPACE_BOTTOM
+#define CT_SPACE_TOP            SPACE_TOP
+#define CT_SPACE_LEFT           SPACE_LEFT
+#define CT_SPACE_RIGHT          SPACE_RIGHT
+#define CT_FULL_WIDTH           FULL_WIDTH
+#define CT_FULL_HEIGHT          FULL_HEIGHT
+#endif
+#include "compress_template_body.h"
+        } else if (_color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            const IceTFloat *_color;
+            IceTFloat *_out;
+            IceTFloat _identity
+                = ICET_REDUCTION_IDENTITY_FLOAT(_composite_mode);
+#ifdef REGION
+            IceTSizeType _region_count = 0;
+            _color = _color_region;
+#else
+            _color = icetImageGetColorcf(INPUT_IMAGE);
+#endif
+#ifdef OFFSET
+            _color += 4*(OFFSET);
+#endif
+#define CT_COMPRESSED_IMAGE     OUTPUT_SPARSE_IMAGE
+#define CT_COLOR_FORMAT         _color_format
+#define CT_DEPTH_FORMAT         _depth_format
+#define CT_PIXEL_COUNT          _pixel_count
+#define CT_ACTIVE()             (   (_color[0] != _identity)        \
+                                 || (_color[1] != _identity)        \
+                                 || (_color[2] != _identity)        \
+                                 || (_color[3] != _identity) )
+#define CT_WRITE_PIXEL(dest)    _out = (IceTFloat *)dest;       \
+                                _out[0] = _color[0];            \
+                                _out[1] = _color[1];            \
+                                _out[2] = _color[2];            \
+                                _out[3] = _color[3];            \
+                                dest += 4*sizeof(IceTUInt);
+#ifdef REGION
+#define CT_INCREMENT_PIXEL()    STEP_BYTES(_color, _color_step);        \
+                                _region_count++;                        \
+                                if (_region_count >= _region_width) {   \
+                                    STEP_BYTES(_color, _color_row_skip);\
+                                    _region_count = 0;                  \
+                                }
+#else
+#define CT_INCREMENT_PIXEL()    _color += 4;
+#endif
+#ifdef PADDING
+#define CT_PADDING
+#define CT_SPACE_BOTTOM         SPACE_BOTTOM
+#define CT_SPACE_TOP            SPACE_TOP
+#define CT_SPACE_LEFT           SPACE_LEFT
+#define CT_SPACE_RIGHT          SPACE_RIGHT
+#define CT_FULL_WIDTH           FULL_WIDTH
+#define CT_FULL_HEIGHT          FULL_HEIGHT
+#endif
+#include "compress_template_body.h"
+        } else if (_color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+            IceTUInt *_out;
+            icetRaiseError(
+                ICET_INVALID_VALUE,
+                "Compressing image for reduction with no alpha channel.");
+            _out = ICET_IMAGE_DATA(OUTPUT_SPARSE_IMAGE);
+            INACTIVE_RUN_LENGTH(_out) = _pixel_count;
+            ACTIVE_RUN_LENGTH(_out) = 0;
+            _out++;
+            icetSparseImageSetActualSize(OUTPUT_SPARSE_IMAGE, _out);
+        } else if (_color_format == ICET_IMAGE_COLOR_NONE) {
+            IceTUInt *_out;
+            icetRaiseWarning(ICET_INVALID_OPERATION,
+                             "Compressing image with no data.");
+            _out = ICET_IMAGE_DATA(OUTPUT_SPARSE_IMAGE);
+            INACTIVE_RUN_LENGTH(_out) = _pixel_count;
+            ACTIVE_RUN_LENGTH(_out) = 0;
+            _out++;
+            icetSparseImageSetActualSize(OUTPUT_SPARSE_IMAGE, _out);
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format 0x%X.",
+                           _color_format);
+        }
     } else {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Encountered invalid composite mode 0x%X.",
@@ -435,6 +673,7 @@
 
 #ifdef REGION
 #undef REGION
+#undef STEP_BYTES
 #undef REGION_OFFSET_X
 #undef REGION_OFFSET_Y
 #undef REGION_WIDTH
@@ -25,7 +25,9 @@ struct IceTContextStruct {
     IceTCommunicator communicator;
 };
 
-static IceTContext icet_current_context = NULL;
+/* Each thread has its own current context, so different threads can work
+   with different contexts at the same time. */
+static ICET_THREAD_LOCAL IceTContext icet_current_context = NULL;
 
 IceTContext icetCreateContext(IceTCommunicator comm)
 {
@@ -34,6 +34,8 @@
  *                      values.
  *              BLEND_RGBA_FLOAT(src, dest) - same as above except src and dest
  *                      are IceTFloat arrays.
+ *              These are only used in the blend composite mode.  The
+ *              reduction modes (max, min, and add) apply their own operation.
  *	CORRECT_BACKGROUND - if defined, the output color will be blended
  *		with the true background color.  This should only be set
  *		if ICET_NEED_BACKGROUND_CORRECTION is true.
@@ -62,6 +64,7 @@
 
 {
     IceTEnum _color_format, _depth_format;
+    IceTSizeType _auxiliary_size;
     IceTSizeType _pixel_count;
     IceTEnum _composite_mode;
 
@@ -73,6 +76,7 @@
 
     _color_format = icetSparseImageGetColorFormat(INPUT_SPARSE_IMAGE);
     _depth_format = icetSparseImageGetDepthFormat(INPUT_SPARSE_IMAGE);
+    _auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(INPUT_SPARSE_IMAGE);
     _pixel_count = icetSparseImageGetNumPixels(INPUT_SPARSE_IMAGE);
 
     if (_color_format != icetImageGetColorFormat(OUTPUT_IMAGE)) {
@@ -83,6 +87,11 @@
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Input/output buffers have different depth formats.");
     }
+    if (_auxiliary_size != ICET_IMAGE_AUXILIARY_SIZE(OUTPUT_IMAGE)) {
+        icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                       "Input/output buffers have different auxiliary"
+                       " channels.");
+    }
 #ifdef PIXEL_COUNT
     if (_pixel_count  != PIXEL_COUNT) {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
@@ -102,7 +111,81 @@
 #endif
 
     if (_composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
-        if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+        if (   (_depth_format == ICET_IMAGE_DEPTH_FLOAT)
+            && (_auxiliary_size > 0) ) {
+          /* Use Z buffer for active pixel testing and compositing.  The
+             auxiliary channels go wherever the depth goes. */
+            IceTSizeType _color_size = colorPixelSize(_color_format);
+            IceTByte *_color;
+            IceTFloat *_depth;
+            IceTByte *_auxiliary;
+            const IceTByte *_c_in;
+            const IceTFloat *_d_in;
+            IceTFloat _background_color[4];
+            _color = icetImageGetColorVoid(OUTPUT_IMAGE, NULL);
+            _depth = icetImageGetDepthf(OUTPUT_IMAGE);
+            _auxiliary = icetImageGetAuxiliaryVoid(OUTPUT_IMAGE, NULL);
+#ifdef OFFSET
+            _color += _color_size*(OFFSET);
+            _depth += OFFSET;
+            _auxiliary += _auxiliary_size*(OFFSET);
+#endif
+            /* The background has the same bytes as a pixel's color. */
+            if (_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                icetGetIntegerv(ICET_BACKGROUND_COLOR_WORD,
+                                (IceTInt *)_background_color);
+            } else {
+                icetGetFloatv(ICET_BACKGROUND_COLOR, _background_color);
+            }
+#ifdef COMPOSITE
+#define COPY_PIXEL(src)                                                 \
+                                if (_d_in[0] < _depth[0]) {             \
+                                    memcpy(_color, _c_in, _color_size); \
+                                    _depth[0] = _d_in[0];               \
+                                    memcpy(_auxiliary, src,             \
+                                           _auxiliary_size);            \
+                                }
+#else
+#define COPY_PIXEL(src)                                                 \
+                                memcpy(_color, _c_in, _color_size);     \
+                                _depth[0] = _d_in[0];                   \
+                                memcpy(_auxiliary, src, _auxiliary_size);
+#endif
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (const IceTByte *)src;          \
+                                src += _color_size;                     \
+                                _d_in = (const IceTFloat *)src;         \
+                                src += sizeof(IceTFloat);               \
+                                COPY_PIXEL(src);                        \
+                                src += _auxiliary_size;                 \
+                                _color += _color_size;                  \
+                                _depth++;                               \
+                                _auxiliary += _auxiliary_size;
+#ifdef COMPOSITE
+#define DT_INCREMENT_INACTIVE_PIXELS(count)                             \
+                                _color += _color_size*count;            \
+                                _depth += count;                        \
+                                _auxiliary += _auxiliary_size*count;
+#else
+#define DT_INCREMENT_INACTIVE_PIXELS(count)                             \
+                                {                                       \
+                                    IceTSizeType __i;                   \
+                                    for (__i = 0; __i < count; __i++) { \
+                                        memcpy(_color,                  \
+                                               _background_color,       \
+                                               _color_size);            \
+                                        _color += _color_size;          \
+                                        *(_depth++) = 1.0f;             \
+                                    }                                   \
+                                    memset(_auxiliary,                  \
+                                           0,                           \
+                                           _auxiliary_size*count);      \
+                                    _auxiliary += _auxiliary_size*count;\
+                                }
+#endif
+#include "decompress_template_body.h"
+#undef COPY_PIXEL
+        } else if (_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
           /* Use Z buffer for active pixel testing and compositing. */
             IceTFloat *_depth = icetImageGetDepthf(OUTPUT_IMAGE);
 #ifdef OFFSET
@@ -442,6 +525,225 @@
             icetRaiseError(ICET_SANITY_CHECK_FAIL,
                            "Encountered invalid color format.");
         }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(_composite_mode)) {
+      /* Inactive pixels hold the identity of the reduction, so compositing
+       * skips them.  Each mode gets its own loop when compositing. */
+        if (_depth_format != ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseWarning(ICET_INVALID_VALUE,
+                             "Z buffer ignored during reduction composite"
+                             " operation.  Output z buffer meaningless.");
+        }
+        if (_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTUInt *_color;
+            const IceTUInt *_c_in;
+            _color = icetImageGetColorui(OUTPUT_IMAGE);
+#ifdef OFFSET
+            _color += OFFSET;
+#endif
+#ifdef COMPOSITE
+            if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                ICET_MAX_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += count;
+#include "decompress_template_body.h"
+            } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                ICET_MIN_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += count;
+#include "decompress_template_body.h"
+            } else {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                ICET_ADD_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += count;
+#include "decompress_template_body.h"
+            }
+#else /*COMPOSITE*/
+            {
+                IceTUInt _background_color;
+#define FILL_BACKGROUND(count)                                          \
+                                {                                       \
+                                    IceTSizeType __i;                   \
+                                    for (__i = 0; __i < count; __i++) { \
+                                        *(_color++) = _background_color;\
+                                    }                                   \
+                                }
+#ifdef CORRECT_BACKGROUND
+              /* The background is reduced into each active pixel.  Each
+               * mode gets its own loop. */
+                icetGetIntegerv(ICET_TRUE_BACKGROUND_COLOR_WORD,
+                                (IceTInt *)&_background_color);
+                if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                _color[0] = _background_color;          \
+                                ICET_MAX_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                _color[0] = _background_color;          \
+                                ICET_MIN_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                } else {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;                \
+                                src += sizeof(IceTUInt);                \
+                                _color[0] = _background_color;          \
+                                ICET_ADD_UBYTE(((IceTUByte*)_c_in),     \
+                                               ((IceTUByte*)_color));   \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                }
+#else
+                icetGetIntegerv(ICET_BACKGROUND_COLOR_WORD,
+                                (IceTInt *)&_background_color);
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTUInt *)src;        \
+                                src += sizeof(IceTUInt);        \
+                                _color[0] = _c_in[0];           \
+                                _color++;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+#endif
+#undef FILL_BACKGROUND
+            }
+#endif /*COMPOSITE*/
+        } else if (_color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            IceTFloat *_color;
+            const IceTFloat *_c_in;
+            _color = icetImageGetColorf(OUTPUT_IMAGE);
+#ifdef OFFSET
+            _color += 4*(OFFSET);
+#endif
+#ifdef COMPOSITE
+            if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;       \
+                                src += 4*sizeof(IceTFloat);     \
+                                ICET_MAX_FLOAT(_c_in, _color);  \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += 4*count;
+#include "decompress_template_body.h"
+            } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;       \
+                                src += 4*sizeof(IceTFloat);     \
+                                ICET_MIN_FLOAT(_c_in, _color);  \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += 4*count;
+#include "decompress_template_body.h"
+            } else {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;       \
+                                src += 4*sizeof(IceTFloat);     \
+                                ICET_ADD_FLOAT(_c_in, _color);  \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) _color += 4*count;
+#include "decompress_template_body.h"
+            }
+#else /*COMPOSITE*/
+            {
+                IceTFloat _background_color[4];
+#define FILL_BACKGROUND(count)                                          \
+                                {                                       \
+                                    IceTSizeType __i;                   \
+                                    for (__i = 0; __i < count; __i++) { \
+                                        _color[0] =_background_color[0];\
+                                        _color[1] =_background_color[1];\
+                                        _color[2] =_background_color[2];\
+                                        _color[3] =_background_color[3];\
+                                        _color += 4;                    \
+                                    }                                   \
+                                }
+#ifdef CORRECT_BACKGROUND
+              /* The background is reduced into each active pixel.  Each
+               * mode gets its own loop. */
+                icetGetFloatv(ICET_TRUE_BACKGROUND_COLOR, _background_color);
+                if (_composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;               \
+                                src += 4*sizeof(IceTFloat);             \
+                                _color[0] = _background_color[0];       \
+                                _color[1] = _background_color[1];       \
+                                _color[2] = _background_color[2];       \
+                                _color[3] = _background_color[3];       \
+                                ICET_MAX_FLOAT(_c_in, _color);          \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                } else if (_composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;               \
+                                src += 4*sizeof(IceTFloat);             \
+                                _color[0] = _background_color[0];       \
+                                _color[1] = _background_color[1];       \
+                                _color[2] = _background_color[2];       \
+                                _color[3] = _background_color[3];       \
+                                ICET_MIN_FLOAT(_c_in, _color);          \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                } else {
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;               \
+                                src += 4*sizeof(IceTFloat);             \
+                                _color[0] = _background_color[0];       \
+                                _color[1] = _background_color[1];       \
+                                _color[2] = _background_color[2];       \
+                                _color[3] = _background_color[3];       \
+                                ICET_ADD_FLOAT(_c_in, _color);          \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+                }
+#else
+                icetGetFloatv(ICET_BACKGROUND_COLOR, _background_color);
+#define DT_COMPRESSED_IMAGE     INPUT_SPARSE_IMAGE
+#define DT_READ_PIXEL(src)      _c_in = (IceTFloat *)src;       \
+                                src += 4*sizeof(IceTFloat);     \
+                                _color[0] = _c_in[0];           \
+                                _color[1] = _c_in[1];           \
+                                _color[2] = _c_in[2];           \
+                                _color[3] = _c_in[3];           \
+                                _color += 4;
+#define DT_INCREMENT_INACTIVE_PIXELS(count) FILL_BACKGROUND(count)
+#include "decompress_template_body.h"
+#endif
+#undef FILL_BACKGROUND
+            }
+#endif /*COMPOSITE*/
+        } else if (_color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Cannot use reduction composite without alpha"
+                           " channel.");
+        } else if (_color_format == ICET_IMAGE_COLOR_NONE) {
+            icetRaiseWarning(ICET_INVALID_OPERATION,
+                             "Decompressing image with no data.");
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format.");
+        }
     } else {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Encountered invalid composite mode.");
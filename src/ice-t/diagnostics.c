@@ -28,8 +28,9 @@
 
 #define MAX_MESSAGE_LEN 1024
 
-static IceTEnum currentError = ICET_NO_ERROR;
-static IceTEnum currentLevel;
+/* Like the current context, errors are kept separately for each thread. */
+static ICET_THREAD_LOCAL IceTEnum currentError = ICET_NO_ERROR;
+static ICET_THREAD_LOCAL IceTEnum currentLevel;
 
 void icetRaiseDiagnostic(IceTEnum type,
                          IceTBitField level,
@@ -39,9 +40,9 @@ void icetRaiseDiagnostic(IceTEnum type,
                          ...)
 {
 #define ICET_MESSAGE_SIZE 1024
-    static int raisingDiagnostic = 0;
+    static ICET_THREAD_LOCAL int raisingDiagnostic = 0;
     IceTBitField diagLevel;
-    static char full_message[ICET_MESSAGE_SIZE+1];
+    static ICET_THREAD_LOCAL char full_message[ICET_MESSAGE_SIZE+1];
     IceTSizeType offset;
     int rank;
     va_list format_args;
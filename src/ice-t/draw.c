@@ -78,7 +78,8 @@ const char *icetGetSingleImageStrategyName(void)
 void icetCompositeMode(IceTEnum mode)
 {
     if (    (mode != ICET_COMPOSITE_MODE_Z_BUFFER)
-         && (mode != ICET_COMPOSITE_MODE_BLEND) ) {
+         && (mode != ICET_COMPOSITE_MODE_BLEND)
+         && !ICET_COMPOSITE_MODE_IS_REDUCTION(mode) ) {
         icetRaiseError(ICET_INVALID_ENUM, "Invalid composite mode 0x%x.", mode);
         return;
     }
@@ -163,6 +164,17 @@ void icetDataReplicationGroupColor(IceTInt color)
     icetDataReplicationGroup(size, mygroup);
 }
 
+void icetTargetFrameTime(IceTDouble seconds)
+{
+    if (seconds < 0.0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Target frame time must not be negative.");
+        return;
+    }
+
+    icetStateSetDouble(ICET_TARGET_FRAME_TIME, seconds);
+}
+
 static void drawUseMatrices(const IceTDouble *projection_matrix,
                             const IceTDouble *modelview_matrix)
 {
@@ -205,18 +217,21 @@ static IceTFloat black[] = {0.0f, 0.0f, 0.0f, 0.0f};
 static void drawUseBackgroundColor(const IceTFloat *background_color)
 {
     IceTUInt background_color_word;
+    IceTEnum composite_mode
+        = (IceTEnum)(*(icetUnsafeStateGetInteger(ICET_COMPOSITE_MODE)));
     IceTBoolean use_color_blending
-        = (IceTBoolean)(   *(icetUnsafeStateGetInteger(ICET_COMPOSITE_MODE))
-                        == ICET_COMPOSITE_MODE_BLEND);
-
-    ((IceTUByte *)&background_color_word)[0]
-        = (IceTUByte)(255*background_color[0]);
-    ((IceTUByte *)&background_color_word)[1]
-        = (IceTUByte)(255*background_color[1]);
-    ((IceTUByte *)&background_color_word)[2]
-        = (IceTUByte)(255*background_color[2]);
-    ((IceTUByte *)&background_color_word)[3]
-        = (IceTUByte)(255*background_color[3]);
+        = (IceTBoolean)(composite_mode == ICET_COMPOSITE_MODE_BLEND);
+    int i;
+
+  /* Float colors may go outside of 0 to 1, so clamp them for the 8-bit
+   * word. */
+    for (i = 0; i < 4; i++) {
+        IceTFloat component = background_color[i];
+        if (component < 0.0f) { component = 0.0f; }
+        if (component > 1.0f) { component = 1.0f; }
+        ((IceTUByte *)&background_color_word)[i]
+            = (IceTUByte)(255*component);
+    }
 
     icetStateSetFloatv(ICET_TRUE_BACKGROUND_COLOR, 4, background_color);
     icetStateSetInteger(ICET_TRUE_BACKGROUND_COLOR_WORD, background_color_word);
@@ -235,6 +250,34 @@ static void drawUseBackgroundColor(const IceTFloat *background_color)
         } else {
             icetStateSetBoolean(ICET_NEED_BACKGROUND_CORRECTION, ICET_FALSE);
         }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(composite_mode)) {
+        IceTFloat identity[4];
+        IceTUInt identity_word = ICET_REDUCTION_IDENTITY_WORD(composite_mode);
+        IceTEnum color_format
+            = (IceTEnum)(*(icetUnsafeStateGetInteger(ICET_COLOR_FORMAT)));
+      /* Empty pixels hold the identity of the reduction so that they drop
+       * out of compositing.  There is no display-side way to apply the
+       * background for these modes, so it is always corrected at the end.
+       * The float identity of the minimum only applies to float images; the
+       * draw callback of 8-bit images gets the color of the identity word. */
+        for (i = 0; i < 4; i++) {
+            if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+                identity[i] = ICET_REDUCTION_IDENTITY_FLOAT(composite_mode);
+            } else {
+                identity[i]
+                    = ((IceTUByte *)&identity_word)[i]/255.0f;
+            }
+        }
+        icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, identity);
+        icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD, identity_word);
+        if (   (background_color[0] != identity[0])
+            || (background_color[1] != identity[1])
+            || (background_color[2] != identity[2])
+            || (background_color[3] != identity[3]) ) {
+            icetStateSetBoolean(ICET_NEED_BACKGROUND_CORRECTION, ICET_TRUE);
+        } else {
+            icetStateSetBoolean(ICET_NEED_BACKGROUND_CORRECTION, ICET_FALSE);
+        }
     } else {
         icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, background_color);
         icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD, background_color_word);
@@ -252,7 +295,7 @@ static void drawFindContainedViewport(IceTInt contained_viewport[4],
     IceTInt num_bounding_verts;
     int i;
 
-    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
 
     {
         IceTDouble projection_matrix[16];
@@ -417,7 +460,7 @@ static void drawDetermineContainedTiles(const IceTInt contained_viewport[4],
     IceTInt num_tiles;
     int i;
 
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
 
     *num_contained_p = 0;
@@ -529,7 +572,7 @@ static void drawAdjustContainedForDataReplication(IceTInt *contained_viewport,
             /* Record a new viewport covering only my portion of the tile. */
             if (tile_rendering >= 0) {
                 const IceTInt *tile_viewports
-                    = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+                    = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
                 const IceTInt *tv = tile_viewports + 4*tile_rendering;
                 int new_length = tv[2]/num_rendering_tile;
                 *num_contained_p = 1;
@@ -622,7 +665,7 @@ static void drawProjectBounds(void)
     if (num_bounding_verts < 1) {
         /* User never set bounding vertices. Assume image covers global
          * viewport. */
-        icetGetIntegerv(ICET_GLOBAL_VIEWPORT, contained_viewport);
+        icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, contained_viewport);
         znear = -1.0;
         zfar = 1.0;
     } else {
@@ -677,6 +720,7 @@ static void drawCollectTileInformation(void)
     IceTBoolean *all_contained_masks;
     IceTInt num_proc;
     IceTInt num_tiles;
+    const IceTBoolean *contained_mask;
 
     {
         IceTEnum strategy;
@@ -698,14 +742,11 @@ static void drawCollectTileInformation(void)
                                    num_tiles*num_proc);
 
     icetRaiseDebug("Gathering rendering information.");
-    {
-        const IceTBoolean *contained_mask;
 
-        contained_mask = icetUnsafeStateGetBoolean(ICET_CONTAINED_TILES_MASK);
+    contained_mask = icetUnsafeStateGetBoolean(ICET_CONTAINED_TILES_MASK);
 
-        icetCommAllgather(contained_mask, num_tiles, ICET_BYTE,
-                          all_contained_masks);
-    }
+    icetCommAllgather(contained_mask, num_tiles, ICET_BYTE,
+                      all_contained_masks);
 
     {
         IceTInt *contrib_counts;
@@ -748,7 +789,9 @@ static IceTImage drawInvokeStrategy(void)
     icetRaiseDebug("Calling strategy");
     icetStateSetBoolean(ICET_IS_DRAWING_FRAME, 1);
     icetGetEnumv(ICET_STRATEGY, &strategy);
+    icetTraceBegin("composite");
     image = icetInvokeStrategy(strategy);
+    icetTraceEnd("composite");
 
     icetStateSetBoolean(ICET_IS_DRAWING_FRAME, 0);
 
@@ -763,7 +806,8 @@ static IceTImage drawInvokeStrategy(void)
     }
     if (valid_tile >= 0) {
         const IceTInt *valid_tile_viewport
-            = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS) + 4*valid_tile;
+            = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS)
+              + 4*valid_tile;
         if (   (valid_tile_viewport[2] != icetImageGetWidth(image))
             || (valid_tile_viewport[3] != icetImageGetHeight(image)) ) {
             IceTInt valid_offset;
@@ -788,6 +832,364 @@ static IceTImage drawInvokeStrategy(void)
     return image;
 }
 
+/* The coarsest scale (in each dimension) used to meet a target frame time. */
+#define ICET_MAX_RENDER_SCALE 8
+
+#ifndef MAX
+#define MAX(x, y) ((x) >= (y) ? (x) : (y))
+#endif
+#ifndef MIN
+#define MIN(x, y) ((x) <= (y) ? (x) : (y))
+#endif
+
+static IceTBoolean drawMatrixUnchanged(IceTEnum pname,
+                                       const IceTDouble *matrix)
+{
+    IceTDouble identity[16];
+
+    if (icetStateGetNumEntries(pname) != 16) {
+        return ICET_FALSE;
+    }
+
+    if (matrix == NULL) {
+        /* drawUseMatrices replaces missing matrices with identities. */
+        icetMatrixIdentity(identity);
+        matrix = identity;
+    }
+
+    return (IceTBoolean)(memcmp(icetUnsafeStateGetDouble(pname),
+                                matrix,
+                                16*sizeof(IceTDouble)) == 0);
+}
+
+/* Picks the factor by which the tiles are shrunk for this frame.  The
+ * choice is based on the time taken by the previous frame and the scale it
+ * was rendered at.  When the matrices have not changed since the last
+ * frame, the camera is assumed to be at rest and full resolution is used.
+ * All processes must have the same ICET_TARGET_FRAME_TIME as this function
+ * may perform a collective operation. */
+static IceTInt drawChooseRenderScale(const IceTDouble *projection_matrix,
+                                     const IceTDouble *modelview_matrix)
+{
+    IceTDouble target_time;
+    IceTDouble last_time;
+    IceTInt last_scale;
+    IceTInt scale;
+
+    icetGetDoublev(ICET_TARGET_FRAME_TIME, &target_time);
+    if (   (target_time <= 0.0)
+        || icetUnsafeStateGetBoolean(ICET_PRE_RENDERED)[0]
+        || !icetIsEnabled(ICET_COLLECT_IMAGES) ) {
+        /* Either no target was given or the caller gave us full resolution
+         * images or expects full resolution pieces back. */
+        return 1;
+    }
+
+    icetGetDoublev(ICET_TOTAL_DRAW_TIME, &last_time);
+    icetGetIntegerv(ICET_RENDER_SCALE, &last_scale);
+
+    if (   (last_time <= 0.0)
+        || (   drawMatrixUnchanged(ICET_PROJECTION_MATRIX, projection_matrix)
+            && drawMatrixUnchanged(ICET_MODELVIEW_MATRIX, modelview_matrix))) {
+        scale = 1;
+    } else {
+        /* Assume the frame time is proportional to the number of pixels and
+         * pick the finest scale predicted to meet the target.  Ask for some
+         * slack before moving to a finer scale so that we do not flip flop
+         * between two resolutions. */
+        for (scale = 1; scale < ICET_MAX_RENDER_SCALE; scale *= 2) {
+            IceTDouble ratio = (IceTDouble)last_scale/scale;
+            IceTDouble predicted_time = last_time*ratio*ratio;
+            IceTDouble allowed_time
+                = (scale < last_scale) ? 0.8*target_time : target_time;
+            if (predicted_time <= allowed_time) break;
+        }
+    }
+
+    /* Every process must composite at the same scale.  Use the coarsest
+     * scale anyone asked for. */
+    {
+        IceTInt num_proc;
+        IceTInt *all_scales;
+        IceTInt proc;
+
+        icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+        all_scales = icetGetStateBuffer(ICET_RENDER_SCALE_BUF,
+                                        sizeof(IceTInt)*num_proc);
+        icetCommAllgather(&scale, 1, ICET_INT, all_scales);
+        for (proc = 0; proc < num_proc; proc++) {
+            scale = MAX(scale, all_scales[proc]);
+        }
+    }
+
+    return scale;
+}
+
+static IceTInt drawScaleCoordinate(IceTInt coordinate,
+                                   IceTInt scale,
+                                   IceTBoolean round_up)
+{
+    if (round_up) {
+        coordinate += scale - 1;
+    }
+    /* Integer division truncates toward zero.  Make it round down. */
+    if (coordinate < 0) {
+        return -((scale - 1 - coordinate)/scale);
+    } else {
+        return coordinate/scale;
+    }
+}
+
+static void drawScaleViewport(const IceTInt *full_viewport,
+                              IceTInt scale,
+                              IceTInt *scaled_viewport)
+{
+    IceTInt x_min = drawScaleCoordinate(full_viewport[0], scale, ICET_FALSE);
+    IceTInt y_min = drawScaleCoordinate(full_viewport[1], scale, ICET_FALSE);
+    IceTInt x_max = drawScaleCoordinate(full_viewport[0] + full_viewport[2],
+                                        scale, ICET_TRUE);
+    IceTInt y_max = drawScaleCoordinate(full_viewport[1] + full_viewport[3],
+                                        scale, ICET_TRUE);
+
+    scaled_viewport[0] = x_min;
+    scaled_viewport[1] = y_min;
+    scaled_viewport[2] = x_max - x_min;
+    scaled_viewport[3] = y_max - y_min;
+}
+
+/* Scales a tile viewport and, while the views of icetCompositeImages or
+ * icetDrawFrames are composited together, stacks it.  A stacked tile is
+ * num_stacked times as tall as the tile and holds the tile of view v in
+ * rows v*height through (v+1)*height - 1.  The stacked tiles are laid out
+ * on a global viewport num_stacked times as tall as the scaled one, which
+ * has its bottom at global_y. */
+static void drawScaleTileViewport(const IceTInt *full_viewport,
+                                  IceTInt scale,
+                                  IceTInt global_y,
+                                  IceTInt num_stacked,
+                                  IceTInt *scaled_viewport)
+{
+    drawScaleViewport(full_viewport, scale, scaled_viewport);
+    if (num_stacked > 0) {
+        scaled_viewport[1]
+            = global_y + num_stacked*(scaled_viewport[1] - global_y);
+        scaled_viewport[3] *= num_stacked;
+    }
+}
+
+static void drawSetScaledInteger(IceTEnum pname, IceTInt value)
+{
+    /* Only touch the state when it changes so that anything cached against
+       its modification time (such as the tile projections) stays valid. */
+    if (   (icetStateGetNumEntries(pname) != 1)
+        || (*icetUnsafeStateGetInteger(pname) != value) ) {
+        icetStateSetInteger(pname, value);
+    }
+}
+
+static IceTBoolean drawScaledTilesUnchanged(IceTInt num_tiles,
+                                            const IceTInt *tile_viewports,
+                                            IceTInt scale,
+                                            IceTInt global_y,
+                                            IceTInt num_stacked)
+{
+    const IceTInt *scaled_viewports;
+    IceTInt scaled_viewport[4];
+    IceTInt tile_idx;
+
+    if (icetStateGetNumEntries(ICET_SCALED_TILE_VIEWPORTS) != 4*num_tiles) {
+        return ICET_FALSE;
+    }
+
+    scaled_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
+    for (tile_idx = 0; tile_idx < num_tiles; tile_idx++) {
+        drawScaleTileViewport(tile_viewports + 4*tile_idx,
+                              scale,
+                              global_y,
+                              num_stacked,
+                              scaled_viewport);
+        if (memcmp(scaled_viewports + 4*tile_idx,
+                   scaled_viewport,
+                   4*sizeof(IceTInt)) != 0) {
+            return ICET_FALSE;
+        }
+    }
+    return ICET_TRUE;
+}
+
+/* Fills the ICET_SCALED_* state with the tile layout shrunk by the given
+ * scale.  Everything downstream (projections, bounds, strategies, the draw
+ * callback) reads the scaled layout and so naturally operates on the
+ * smaller images.  The layout given by the user is left alone.  When
+ * ICET_NUM_STACKED_VIEWS is positive, the tiles are also stacked (see
+ * drawScaleTileViewport). */
+static void drawUseScaledTiles(IceTInt scale)
+{
+    IceTInt num_stacked;
+    IceTInt num_tiles;
+    const IceTInt *tile_viewports;
+    IceTInt global_viewport[4];
+    IceTInt physical_width, physical_height;
+    IceTInt max_width, max_height;
+    IceTInt tile_idx;
+
+    icetGetIntegerv(ICET_NUM_STACKED_VIEWS, &num_stacked);
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+
+    drawScaleViewport(icetUnsafeStateGetInteger(ICET_GLOBAL_VIEWPORT),
+                      scale,
+                      global_viewport);
+    if (num_stacked > 0) {
+        global_viewport[3] *= num_stacked;
+    }
+    if (   (icetStateGetNumEntries(ICET_SCALED_GLOBAL_VIEWPORT) != 4)
+        || (memcmp(icetUnsafeStateGetInteger(ICET_SCALED_GLOBAL_VIEWPORT),
+                   global_viewport,
+                   4*sizeof(IceTInt)) != 0) ) {
+        icetStateSetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, 4, global_viewport);
+    }
+
+    if (!drawScaledTilesUnchanged(num_tiles,
+                                  tile_viewports,
+                                  scale,
+                                  global_viewport[1],
+                                  num_stacked)) {
+        IceTInt *scaled_viewports
+            = icetStateAllocateInteger(ICET_SCALED_TILE_VIEWPORTS,
+                                       4*num_tiles);
+        for (tile_idx = 0; tile_idx < num_tiles; tile_idx++) {
+            drawScaleTileViewport(tile_viewports + 4*tile_idx,
+                                  scale,
+                                  global_viewport[1],
+                                  num_stacked,
+                                  scaled_viewports + 4*tile_idx);
+        }
+    }
+
+    max_width = max_height = 0;
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
+    for (tile_idx = 0; tile_idx < num_tiles; tile_idx++) {
+        max_width = MAX(max_width, tile_viewports[4*tile_idx+2]);
+        max_height = MAX(max_height, tile_viewports[4*tile_idx+3]);
+    }
+    drawSetScaledInteger(ICET_SCALED_TILE_MAX_WIDTH, max_width);
+    drawSetScaledInteger(ICET_SCALED_TILE_MAX_HEIGHT, max_height);
+
+    /* Rounding can make a scaled tile one pixel larger than the scaled
+       physical size, so make sure the tiles still fit.  At full scale the
+       physical size is passed through as is. */
+    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &physical_width);
+    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &physical_height);
+    if (scale > 1) {
+        physical_width = MAX(drawScaleCoordinate(physical_width,
+                                                 scale,
+                                                 ICET_TRUE),
+                             max_width);
+        physical_height = MAX(drawScaleCoordinate(physical_height,
+                                                  scale,
+                                                  ICET_TRUE),
+                              max_height);
+    }
+    drawSetScaledInteger(ICET_SCALED_PHYSICAL_RENDER_WIDTH, physical_width);
+    drawSetScaledInteger(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, physical_height);
+}
+
+/* Blows up an image composited at a reduced scale to the full size of the
+ * tile by replicating pixels (nearest neighbor). */
+static IceTImage drawUpsampleImage(const IceTImage scaled_image,
+                                   const IceTInt *scaled_viewport,
+                                   const IceTInt *full_viewport,
+                                   IceTInt scale)
+{
+    IceTImage full_image;
+    const IceTByte *scaled_color;
+    const IceTByte *scaled_depth;
+    const IceTByte *scaled_auxiliary;
+    IceTByte *full_color;
+    IceTByte *full_depth;
+    IceTByte *full_auxiliary;
+    IceTSizeType color_size;
+    IceTSizeType depth_size;
+    IceTSizeType auxiliary_size;
+    IceTSizeType scaled_width;
+    IceTSizeType x, y;
+
+    icetTimingCollectBegin();
+
+    full_image = icetGetStateBufferImage(ICET_RENDER_SCALE_BUF,
+                                         full_viewport[2],
+                                         full_viewport[3]);
+
+    scaled_color = icetImageGetColorConstVoid(scaled_image, &color_size);
+    scaled_depth = icetImageGetDepthConstVoid(scaled_image, &depth_size);
+    full_color = icetImageGetColorVoid(full_image, NULL);
+    full_depth = icetImageGetDepthVoid(full_image, NULL);
+    scaled_auxiliary
+        = icetImageGetAuxiliaryConstVoid(scaled_image, &auxiliary_size);
+    full_auxiliary = icetImageGetAuxiliaryVoid(full_image, NULL);
+    scaled_width = icetImageGetWidth(scaled_image);
+
+    for (y = 0; y < full_viewport[3]; y++) {
+        IceTSizeType scaled_y
+            = drawScaleCoordinate(full_viewport[1] + (IceTInt)y,
+                                  scale,
+                                  ICET_FALSE)
+            - scaled_viewport[1];
+        for (x = 0; x < full_viewport[2]; x++) {
+            IceTSizeType scaled_x
+                = drawScaleCoordinate(full_viewport[0] + (IceTInt)x,
+                                      scale,
+                                      ICET_FALSE)
+                - scaled_viewport[0];
+            IceTSizeType src_pixel = scaled_y*scaled_width + scaled_x;
+            IceTSizeType dest_pixel = y*full_viewport[2] + x;
+            if (color_size > 0) {
+                memcpy(full_color + dest_pixel*color_size,
+                       scaled_color + src_pixel*color_size,
+                       color_size);
+            }
+            if (depth_size > 0) {
+                memcpy(full_depth + dest_pixel*depth_size,
+                       scaled_depth + src_pixel*depth_size,
+                       depth_size);
+            }
+            if (auxiliary_size > 0) {
+                memcpy(full_auxiliary + dest_pixel*auxiliary_size,
+                       scaled_auxiliary + src_pixel*auxiliary_size,
+                       auxiliary_size);
+            }
+        }
+    }
+
+    icetTimingCollectEnd();
+
+    return full_image;
+}
+
+/* Auxiliary channels are filled in by the draw callback.  Images handed to
+ * IceT already rendered have nowhere to hold them, so the two cannot be
+ * mixed.  Returns true if the input can be composited. */
+static IceTBoolean drawCheckAuxiliaryChannels(IceTBoolean pre_rendered)
+{
+    IceTInt auxiliary_size;
+    IceTEnum depth_format;
+
+    icetGetIntegerv(ICET_AUXILIARY_PIXEL_SIZE, &auxiliary_size);
+    icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+    if (   pre_rendered
+        && (auxiliary_size > 0)
+        && (depth_format != ICET_IMAGE_DEPTH_NONE) ) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Auxiliary channels can only be composited with"
+                       " images rendered in the draw callback.  Call"
+                       " icetSetAuxiliaryChannels(0, NULL, NULL) before"
+                       " compositing pre-rendered images.");
+        return ICET_FALSE;
+    }
+    return ICET_TRUE;
+}
+
 static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
                              const IceTDouble *modelview_matrix,
                              const IceTFloat *background_color)
@@ -798,6 +1200,8 @@ static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
     IceTDouble buf_read_time;
     IceTDouble compose_time;
     IceTDouble total_time;
+    IceTInt render_scale;
+    IceTInt num_stacked;
 
     {
         IceTBoolean isDrawing;
@@ -808,19 +1212,36 @@ static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
             return icetImageNull();
         }
     }
+    /* Stacked views were rendered (and checked) by drawDoFrames. */
+    icetGetIntegerv(ICET_NUM_STACKED_VIEWS, &num_stacked);
+    if (   (num_stacked == 0)
+        && !drawCheckAuxiliaryChannels(
+                *icetUnsafeStateGetBoolean(ICET_PRE_RENDERED)) ) {
+        return icetImageNull();
+    }
+
+    /* Must happen before the timing and matrices of the last frame are
+       replaced. */
+    render_scale = drawChooseRenderScale(projection_matrix, modelview_matrix);
+    icetStateSetInteger(ICET_RENDER_SCALE, render_scale);
 
     icetStateResetTiming();
     icetTimingDrawFrameBegin();
 
     drawUseMatrices(projection_matrix, modelview_matrix);
 
+    drawUseScaledTiles(render_scale);
+
     drawUseBackgroundColor(background_color);
 
     icetGetIntegerv(ICET_FRAME_COUNT, &frame_count);
     frame_count++;
     icetStateSetIntegerv(ICET_FRAME_COUNT, 1, &frame_count);
 
-    drawProjectBounds();
+    /* drawDoFrames sets the contained tiles of stacked views itself. */
+    if (num_stacked == 0) {
+        drawProjectBounds();
+    }
 
     drawCollectTileInformation();
 
@@ -830,7 +1251,7 @@ static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
 
         if (tile_displayed >= 0) {
             const IceTInt *tile_viewports
-                = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+                = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
             IceTInt num_pixels = (  tile_viewports[4*tile_displayed+2]
                                   * tile_viewports[4*tile_displayed+3] );
             icetStateSetInteger(ICET_VALID_PIXELS_TILE, tile_displayed);
@@ -843,8 +1264,29 @@ static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
         }
     }
 
+    icetCaptureFrameBegin();
+
     image = drawInvokeStrategy();
 
+    if (render_scale > 1) {
+        IceTInt display_tile;
+        icetGetIntegerv(ICET_VALID_PIXELS_TILE, &display_tile);
+        if ((display_tile >= 0) && !icetImageIsNull(image)) {
+            const IceTInt *scaled_viewport
+                = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS)
+                  + 4*display_tile;
+            const IceTInt *full_viewport
+                = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS)
+                  + 4*display_tile;
+            image = drawUpsampleImage(image,
+                                      scaled_viewport,
+                                      full_viewport,
+                                      render_scale);
+            icetStateSetInteger(ICET_VALID_PIXELS_NUM,
+                                full_viewport[2]*full_viewport[3]);
+        }
+    }
+
     /* Calculate times. */
     icetGetDoublev(ICET_RENDER_TIME, &render_time);
     icetGetDoublev(ICET_BUFFER_READ_TIME, &buf_read_time);
@@ -858,6 +1300,16 @@ static IceTImage drawDoFrame(const IceTDouble *projection_matrix,
 
     icetStateSetDouble(ICET_BUFFER_WRITE_TIME, 0.0);
 
+    /* Writing the capture record is not part of the frame, so it happens
+       after the frame time is taken. */
+    icetCaptureFrameEnd();
+
+    /* A render layer adds its own time after this returns, so it records
+       the frame itself once the times are final. */
+    if (!*icetUnsafeStateGetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME)) {
+        icetTimingRecordFrame();
+    }
+
     icetStateCheckMemory();
 
     return image;
@@ -870,24 +1322,21 @@ IceTImage icetDrawFrame(const IceTDouble *projection_matrix,
     icetRaiseDebug("In icetDrawFrame");
 
     icetStateSetBoolean(ICET_PRE_RENDERED, ICET_FALSE);
+    icetStateSetPointerv(ICET_RENDER_SPANS, 0, NULL);
 
     return drawDoFrame(projection_matrix, modelview_matrix, background_color);
 }
 
-IceTImage icetCompositeImage(const IceTVoid *color_buffer,
-                             const IceTVoid *depth_buffer,
-                             const IceTInt *valid_pixels_viewport,
-                             const IceTDouble *projection_matrix,
-                             const IceTDouble *modelview_matrix,
-                             const IceTFloat *background_color)
+static void drawUsePreRenderedImage(const IceTVoid *color_buffer,
+                                    const IceTVoid *depth_buffer,
+                                    const IceTInt *valid_pixels_viewport)
 {
     IceTInt global_viewport[4];
 
-    icetRaiseDebug("In icetCompositeImage");
-
     icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
 
     icetStateSetBoolean(ICET_PRE_RENDERED, ICET_TRUE);
+    icetStateSetPointerv(ICET_RENDER_SPANS, 0, NULL);
     icetGetStatePointerImage(ICET_RENDER_BUFFER,
                              global_viewport[2],
                              global_viewport[3],
@@ -898,6 +1347,652 @@ IceTImage icetCompositeImage(const IceTVoid *color_buffer,
     } else {
         icetStateSetIntegerv(ICET_RENDERED_VIEWPORT, 0, NULL);
     }
+}
+
+IceTImage icetCompositeImage(const IceTVoid *color_buffer,
+                             const IceTVoid *depth_buffer,
+                             const IceTInt *valid_pixels_viewport,
+                             const IceTDouble *projection_matrix,
+                             const IceTDouble *modelview_matrix,
+                             const IceTFloat *background_color)
+{
+    icetRaiseDebug("In icetCompositeImage");
+
+    drawUsePreRenderedImage(color_buffer, depth_buffer, valid_pixels_viewport);
+
+    return drawDoFrame(projection_matrix, modelview_matrix, background_color);
+}
+
+#define DRAW_VIEW_MATRIX(matrices, view) \
+    (((matrices) != NULL) ? (matrices) + 16*(view) : NULL)
+
+/* Sets up the input image of a view given to icetCompositeImages or
+   icetDrawFrames.  Views that are not pre_rendered are rendered with the
+   draw callback. */
+static void drawUseView(IceTInt view,
+                        IceTBoolean pre_rendered,
+                        const IceTVoid *const *color_buffers,
+                        const IceTVoid *const *depth_buffers,
+                        const IceTInt *valid_pixels_viewports)
+{
+    if (pre_rendered) {
+        drawUsePreRenderedImage(
+            (color_buffers != NULL) ? color_buffers[view] : NULL,
+            (depth_buffers != NULL) ? depth_buffers[view] : NULL,
+            (valid_pixels_viewports != NULL)
+                ? valid_pixels_viewports + 4*view : NULL);
+    } else {
+        icetStateSetBoolean(ICET_PRE_RENDERED, ICET_FALSE);
+        icetStateSetPointerv(ICET_RENDER_SPANS, 0, NULL);
+    }
+}
+
+/* Copies a region of the same size between two images unless it is
+   empty. */
+static void drawCopyRegion(const IceTImage in_image,
+                           IceTInt in_x, IceTInt in_y,
+                           IceTImage out_image,
+                           IceTInt out_x, IceTInt out_y,
+                           IceTInt width, IceTInt height)
+{
+    IceTInt in_viewport[4];
+    IceTInt out_viewport[4];
+
+    if ((width < 1) || (height < 1)) { return; }
+
+    in_viewport[0] = in_x;
+    in_viewport[1] = in_y;
+    in_viewport[2] = out_viewport[2] = width;
+    in_viewport[3] = out_viewport[3] = height;
+    out_viewport[0] = out_x;
+    out_viewport[1] = out_y;
+    icetImageCopyRegion(in_image, in_viewport, out_image, out_viewport);
+}
+
+/* Copies the pixels of a pre-rendered view that fall in a tile straight
+   into stack_region of the stacked image and clears the rest of the region
+   from clear_image.  This is what icetGetTileImage does for a pre-rendered
+   image without going through an intermediate tile image. */
+static void drawStackPreRenderedTile(const IceTInt *tile_viewport,
+                                     const IceTInt *stack_region,
+                                     const IceTImage clear_image,
+                                     IceTImage stack_image)
+{
+    IceTImage view_image = icetRetrieveStateImage(ICET_RENDER_BUFFER);
+    IceTInt screen_viewport[4];
+    IceTInt x_min, y_min, x_max, y_max;
+    IceTInt width = stack_region[2];
+    IceTInt height = stack_region[3];
+
+    icetIntersectViewports(tile_viewport,
+                           icetUnsafeStateGetInteger(ICET_CONTAINED_VIEWPORT),
+                           screen_viewport);
+    if ((screen_viewport[2] < 1) || (screen_viewport[3] < 1)) {
+        drawCopyRegion(clear_image, 0, 0,
+                       stack_image, stack_region[0], stack_region[1],
+                       width, height);
+        return;
+    }
+
+    /* The valid pixels relative to the tile. */
+    x_min = screen_viewport[0] - tile_viewport[0];
+    y_min = screen_viewport[1] - tile_viewport[1];
+    x_max = x_min + screen_viewport[2];
+    y_max = y_min + screen_viewport[3];
+
+    drawCopyRegion(view_image, screen_viewport[0], screen_viewport[1],
+                   stack_image, stack_region[0] + x_min,
+                   stack_region[1] + y_min,
+                   screen_viewport[2], screen_viewport[3]);
+
+    /* Clear below, above, left of, and right of the valid pixels. */
+    drawCopyRegion(clear_image, 0, 0,
+                   stack_image, stack_region[0], stack_region[1],
+                   width, y_min);
+    drawCopyRegion(clear_image, 0, 0,
+                   stack_image, stack_region[0], stack_region[1] + y_max,
+                   width, height - y_max);
+    drawCopyRegion(clear_image, 0, 0,
+                   stack_image, stack_region[0], stack_region[1] + y_min,
+                   x_min, y_max - y_min);
+    drawCopyRegion(clear_image, 0, 0,
+                   stack_image, stack_region[0] + x_max,
+                   stack_region[1] + y_min,
+                   width - x_max, y_max - y_min);
+}
+
+/* Finds where the tile of a view goes in the stacked image as laid out by
+   drawScaleTileViewport.  Like the pre-rendered image of icetCompositeImage,
+   the stacked image is indexed by global pixel coordinates. */
+static void drawStackRegion(const IceTInt *tile_viewport,
+                            IceTInt view,
+                            IceTInt num_views,
+                            IceTInt *stack_region)
+{
+    IceTInt global_y
+        = icetUnsafeStateGetInteger(ICET_SCALED_GLOBAL_VIEWPORT)[1];
+
+    stack_region[0] = tile_viewport[0];
+    stack_region[1] = (  global_y
+                       + num_views*(tile_viewport[1] - global_y)
+                       + view*tile_viewport[3] );
+    stack_region[2] = tile_viewport[2];
+    stack_region[3] = tile_viewport[3];
+}
+
+/* Renders (or copies) the tiles the view projects onto and places them in
+   the stacked image.  The tiles of the view that hold pixels are marked in
+   view_mask.  Pre-rendered views are cleared around their valid pixels from
+   tile_image, which must be clear.  Otherwise tile_image receives each
+   rendered tile. */
+static void drawStackView(IceTInt view,
+                          IceTInt num_views,
+                          IceTBoolean pre_rendered,
+                          IceTImage tile_image,
+                          IceTImage stack_image,
+                          IceTBoolean *view_mask,
+                          IceTDouble *znear,
+                          IceTDouble *zfar)
+{
+    const IceTBoolean *contained_mask;
+    const IceTInt *tile_viewports;
+    IceTInt num_tiles;
+    IceTDouble view_near, view_far;
+    IceTBoolean render_empty;
+    IceTInt tile;
+
+    drawProjectBounds();
+
+    icetGetDoublev(ICET_NEAR_DEPTH, &view_near);
+    icetGetDoublev(ICET_FAR_DEPTH, &view_far);
+    if ((view == 0) || (view_near < *znear)) { *znear = view_near; }
+    if ((view == 0) || (view_far > *zfar)) { *zfar = view_far; }
+
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
+    contained_mask = icetUnsafeStateGetBoolean(ICET_CONTAINED_TILES_MASK);
+    memcpy(view_mask, contained_mask, num_tiles*sizeof(IceTBoolean));
+    render_empty = (   !pre_rendered
+                    && icetIsEnabled(ICET_RENDER_EMPTY_IMAGES) );
+
+    /* Starts a new frame as far as reusing a rendered floating viewport is
+       concerned. */
+    icetStateSetBoolean(ICET_IS_DRAWING_FRAME, ICET_TRUE);
+    for (tile = 0; tile < num_tiles; tile++) {
+        const IceTInt *tile_viewport = tile_viewports + 4*tile;
+        IceTInt stack_region[4];
+
+        if (!view_mask[tile] && !render_empty) continue;
+
+        drawStackRegion(tile_viewport, view, num_views, stack_region);
+        if (pre_rendered) {
+            icetTimingBufferReadBegin();
+            drawStackPreRenderedTile(tile_viewport,
+                                     stack_region,
+                                     tile_image,
+                                     stack_image);
+            icetTimingBufferReadEnd();
+            continue;
+        }
+
+        icetGetTileImage(tile, tile_image);
+        if (!view_mask[tile]) continue;
+
+        icetTimingBufferReadBegin();
+        drawCopyRegion(tile_image, 0, 0,
+                       stack_image, stack_region[0], stack_region[1],
+                       stack_region[2], stack_region[3]);
+        icetTimingBufferReadEnd();
+    }
+    icetStateSetBoolean(ICET_IS_DRAWING_FRAME, ICET_FALSE);
+}
+
+/* Splits the image composited from the stacked views into the images of the
+   views, which are copied into ICET_VIEW_IMAGES.  When images are not
+   collected, each view gets the part of the valid pixels that falls in
+   it. */
+static void drawSplitStackedImage(const IceTImage stacked_image,
+                                  IceTInt num_views,
+                                  IceTByte *image_buffers,
+                                  IceTSizeType image_size,
+                                  IceTInt *valid_pixels,
+                                  IceTImage *images)
+{
+    IceTInt stacked_tile;
+    IceTInt stacked_offset;
+    IceTInt stacked_num;
+    IceTInt view;
+
+    icetGetIntegerv(ICET_VALID_PIXELS_TILE, &stacked_tile);
+    icetGetIntegerv(ICET_VALID_PIXELS_OFFSET, &stacked_offset);
+    icetGetIntegerv(ICET_VALID_PIXELS_NUM, &stacked_num);
+
+    for (view = 0; view < num_views; view++) {
+        IceTInt *view_valid = valid_pixels + 3*view;
+
+        view_valid[0] = -1;
+        view_valid[1] = 0;
+        view_valid[2] = 0;
+        images[view] = icetImageNull();
+
+        if ((stacked_tile >= 0) && !icetImageIsNull(stacked_image)) {
+            IceTSizeType width = icetImageGetWidth(stacked_image);
+            IceTSizeType height = icetImageGetHeight(stacked_image)/num_views;
+            IceTSizeType view_start = view*width*height;
+            IceTSizeType first = MAX(stacked_offset, view_start);
+            IceTSizeType last = MIN(stacked_offset + stacked_num,
+                                    view_start + width*height);
+            if (first < last) {
+                IceTImage view_image
+                    = icetImageAssignBuffer(image_buffers + view*image_size,
+                                            width,
+                                            height);
+                if (   icetImageGetDepthFormat(stacked_image)
+                    == ICET_IMAGE_DEPTH_NONE ) {
+                    icetImageAdjustForOutput(view_image);
+                }
+                icetImageCopyPixels(stacked_image, first,
+                                    view_image, first - view_start,
+                                    last - first);
+                view_valid[0] = stacked_tile;
+                view_valid[1] = (IceTInt)(first - view_start);
+                view_valid[2] = (IceTInt)(last - first);
+                images[view] = view_image;
+            }
+        }
+    }
+}
+
+/* The views are rendered (or copied) into one image in which the tiles of
+   all views are stacked on top of each other.  That image is composited as
+   a single pre-rendered frame, so every message of the strategy carries the
+   pixels of all views, and then split back into the views. */
+static void drawDoFrames(IceTInt num_views,
+                         IceTBoolean pre_rendered,
+                         const IceTVoid *const *color_buffers,
+                         const IceTVoid *const *depth_buffers,
+                         const IceTInt *valid_pixels_viewports,
+                         const IceTDouble *projection_matrices,
+                         const IceTDouble *modelview_matrices,
+                         const IceTFloat *background_color,
+                         IceTImage *images)
+{
+    IceTInt num_tiles;
+    IceTInt global_viewport[4];
+    IceTInt max_width, max_height;
+    IceTSizeType image_size;
+    IceTByte *image_buffers;
+    IceTInt *valid_pixels;
+    IceTBoolean *view_masks;
+    IceTBoolean *contained_mask;
+    IceTImage tile_image;
+    IceTImage stack_image;
+    IceTImage image;
+    IceTInt capture_encoding;
+    IceTBoolean layer_records_frame;
+    IceTInt frame_count;
+    IceTDouble znear, zfar;
+    IceTDouble start_time;
+    IceTDouble stack_render_time;
+    IceTDouble stack_buf_read_time;
+    IceTDouble render_time;
+    IceTDouble buf_read_time;
+    IceTDouble total_time;
+    IceTInt view;
+
+    if (num_views < 1) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Need at least one view to composite, got %d.",
+                       (int)num_views);
+        return;
+    }
+    if (images == NULL) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Need an array to return the images of the views.");
+        return;
+    }
+    {
+        IceTBoolean isDrawing;
+        icetGetBooleanv(ICET_IS_DRAWING_FRAME, &isDrawing);
+        if (isDrawing) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Recursive frame draw detected.");
+            return;
+        }
+    }
+    if (!pre_rendered) {
+        IceTVoid *value;
+        icetGetPointerv(ICET_DRAW_FUNCTION, &value);
+        if (value == NULL) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Drawing function not set.  Call icetDrawCallback.");
+            return;
+        }
+    }
+    if (!drawCheckAuxiliaryChannels(pre_rendered)) {
+        return;
+    }
+
+    start_time = icetWallTime();
+    icetStateResetTiming();
+
+    /* Views are always composited at full scale. */
+    icetStateSetInteger(ICET_NUM_STACKED_VIEWS, 0);
+    drawUseScaledTiles(1);
+    drawUseBackgroundColor(background_color);
+
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
+    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+    image_size = icetImageBufferSize(max_width, max_height);
+    image_buffers = icetGetStateBuffer(ICET_VIEW_IMAGES,
+                                       num_views*image_size);
+    valid_pixels = icetStateAllocateInteger(ICET_VIEW_VALID_PIXELS,
+                                            3*num_views);
+    view_masks = icetStateAllocateBoolean(ICET_VIEW_CONTAINED_MASKS,
+                                          num_views*num_tiles);
+
+    /* Every tile of every view in the stack is written below, so the stack
+       is not cleared. */
+    stack_image = icetGetStateBufferImage(ICET_VIEW_STACK_BUFFER,
+                                          global_viewport[2],
+                                          num_views*global_viewport[3]);
+
+    /* The image of the first view is not written until the views are
+       composited, so its buffer holds each tile on its way to the stack. */
+    tile_image = icetImageAssignBuffer(image_buffers, max_width, max_height);
+    if (pre_rendered) {
+        icetClearImage(tile_image);
+    }
+
+    /* Tiles are captured when the stacked frame is composited. */
+    icetGetIntegerv(ICET_CAPTURE_ENCODING, &capture_encoding);
+    icetStateSetInteger(ICET_CAPTURE_ENCODING, ICET_FALSE);
+
+    znear = -1.0;
+    zfar = 1.0;
+    for (view = 0; view < num_views; view++) {
+        icetStateSetInteger(ICET_VIEW_INDEX, view);
+        drawUseView(view,
+                    pre_rendered,
+                    color_buffers,
+                    depth_buffers,
+                    valid_pixels_viewports);
+        drawUseMatrices(DRAW_VIEW_MATRIX(projection_matrices, view),
+                        DRAW_VIEW_MATRIX(modelview_matrices, view));
+        drawStackView(view,
+                      num_views,
+                      pre_rendered,
+                      tile_image,
+                      stack_image,
+                      view_masks + view*num_tiles,
+                      &znear,
+                      &zfar);
+    }
+    icetStateSetInteger(ICET_VIEW_INDEX, -1);
+
+    /* Composite every tile any view projects onto.  Some strategies read
+       the other tiles as well, so clear the places of every view that does
+       not project onto a tile. */
+    contained_mask = icetGetStateBuffer(ICET_CONTAINED_MASK_BUF,
+                                        num_tiles*sizeof(IceTBoolean));
+    {
+        const IceTInt *tile_viewports
+            = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
+        IceTInt tile;
+
+        if (!pre_rendered) {
+            icetClearImage(tile_image);
+        }
+        for (tile = 0; tile < num_tiles; tile++) {
+            contained_mask[tile] = ICET_FALSE;
+            for (view = 0; view < num_views; view++) {
+                IceTInt stack_region[4];
+                if (view_masks[view*num_tiles + tile]) {
+                    contained_mask[tile] = ICET_TRUE;
+                    continue;
+                }
+                drawStackRegion(tile_viewports + 4*tile,
+                                view,
+                                num_views,
+                                stack_region);
+                drawCopyRegion(tile_image, 0, 0,
+                               stack_image, stack_region[0], stack_region[1],
+                               stack_region[2], stack_region[3]);
+            }
+        }
+    }
+
+    icetStateSetInteger(ICET_CAPTURE_ENCODING, capture_encoding);
+
+    icetGetDoublev(ICET_RENDER_TIME, &stack_render_time);
+    icetGetDoublev(ICET_BUFFER_READ_TIME, &stack_buf_read_time);
+
+    /* Composite the stack as a pre-rendered image. */
+    icetStateSetBoolean(ICET_PRE_RENDERED, ICET_TRUE);
+    icetStateSetPointerv(ICET_RENDER_SPANS, 0, NULL);
+    icetStateSetIntegerv(ICET_RENDERED_VIEWPORT, 0, NULL);
+    icetStateSetInteger(ICET_NUM_STACKED_VIEWS, num_views);
+    {
+        IceTInt *contained_list;
+        IceTInt num_contained;
+        IceTInt stacked_viewport[4];
+        IceTInt tile;
+
+        contained_list = icetGetStateBuffer(ICET_CONTAINED_LIST_BUF,
+                                            sizeof(IceTInt)*num_tiles);
+        num_contained = 0;
+        for (tile = 0; tile < num_tiles; tile++) {
+            if (contained_mask[tile]) {
+                contained_list[num_contained++] = tile;
+            }
+        }
+
+        stacked_viewport[0] = global_viewport[0];
+        stacked_viewport[1] = global_viewport[1];
+        stacked_viewport[2] = global_viewport[2];
+        stacked_viewport[3] = num_views*global_viewport[3];
+
+        icetStateSetIntegerv(ICET_CONTAINED_VIEWPORT, 4, stacked_viewport);
+        icetStateSetDoublev(ICET_NEAR_DEPTH, 1, &znear);
+        icetStateSetDoublev(ICET_FAR_DEPTH, 1, &zfar);
+        icetStateSetInteger(ICET_NUM_CONTAINED_TILES, num_contained);
+        icetStateSetIntegerv(ICET_CONTAINED_TILES_LIST, num_contained,
+                             contained_list);
+        icetStateSetBooleanv(ICET_CONTAINED_TILES_MASK, num_tiles,
+                             contained_mask);
+    }
+
+    /* The frame is recorded below once the rendering time is added. */
+    icetGetIntegerv(ICET_FRAME_COUNT, &frame_count);
+    layer_records_frame
+        = *icetUnsafeStateGetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_TRUE);
+    image = drawDoFrame(DRAW_VIEW_MATRIX(projection_matrices, 0),
+                        DRAW_VIEW_MATRIX(modelview_matrices, 0),
+                        background_color);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, layer_records_frame);
+
+    drawSplitStackedImage(image,
+                          num_views,
+                          image_buffers,
+                          image_size,
+                          valid_pixels,
+                          images);
+
+    /* Leave the valid pixels of the last view like a sequence of
+       icetDrawFrame calls would. */
+    icetStateSetInteger(ICET_VALID_PIXELS_TILE, valid_pixels[3*num_views-3]);
+    icetStateSetInteger(ICET_VALID_PIXELS_OFFSET, valid_pixels[3*num_views-2]);
+    icetStateSetInteger(ICET_VALID_PIXELS_NUM, valid_pixels[3*num_views-1]);
+
+    icetStateSetInteger(ICET_NUM_STACKED_VIEWS, 0);
+    drawUseScaledTiles(1);
+
+    /* Add the rendering of the views, which happened before drawDoFrame reset
+       the timings.  Like a single frame, whatever is not rendering or buffer
+       transfer counts as compositing. */
+    icetGetDoublev(ICET_RENDER_TIME, &render_time);
+    icetGetDoublev(ICET_BUFFER_READ_TIME, &buf_read_time);
+    render_time += stack_render_time;
+    buf_read_time += stack_buf_read_time;
+    total_time = icetWallTime() - start_time;
+    icetStateSetDouble(ICET_RENDER_TIME, render_time);
+    icetStateSetDouble(ICET_BUFFER_READ_TIME, buf_read_time);
+    icetStateSetDouble(ICET_TOTAL_DRAW_TIME, total_time);
+    icetStateSetDouble(ICET_COMPOSITE_TIME,
+                       total_time - render_time - buf_read_time);
+
+    if (   !layer_records_frame
+        && (*icetUnsafeStateGetInteger(ICET_FRAME_COUNT) != frame_count) ) {
+        icetTimingRecordFrame();
+    }
+}
+
+void icetDrawFrames(IceTInt num_views,
+                    const IceTDouble *projection_matrices,
+                    const IceTDouble *modelview_matrices,
+                    const IceTFloat *background_color,
+                    IceTImage *images)
+{
+    icetRaiseDebug("In icetDrawFrames");
+
+    drawDoFrames(num_views,
+                 ICET_FALSE,
+                 NULL,
+                 NULL,
+                 NULL,
+                 projection_matrices,
+                 modelview_matrices,
+                 background_color,
+                 images);
+}
+
+void icetCompositeImages(IceTInt num_views,
+                         const IceTVoid *const *color_buffers,
+                         const IceTVoid *const *depth_buffers,
+                         const IceTInt *valid_pixels_viewports,
+                         const IceTDouble *projection_matrices,
+                         const IceTDouble *modelview_matrices,
+                         const IceTFloat *background_color,
+                         IceTImage *images)
+{
+    icetRaiseDebug("In icetCompositeImages");
+
+    drawDoFrames(num_views,
+                 ICET_TRUE,
+                 color_buffers,
+                 depth_buffers,
+                 valid_pixels_viewports,
+                 projection_matrices,
+                 modelview_matrices,
+                 background_color,
+                 images);
+}
+
+IceTImage icetCompositeSparseImage(const IceTInt *row_span_starts,
+                                   const IceTInt *spans,
+                                   const IceTVoid *color_pixels,
+                                   const IceTVoid *depth_pixels,
+                                   const IceTDouble *projection_matrix,
+                                   const IceTDouble *modelview_matrix,
+                                   const IceTFloat *background_color)
+{
+    IceTInt global_viewport[4];
+    IceTInt valid_pixels_viewport[4];
+    IceTInt *pixel_offsets;
+    IceTInt min_x, max_x, min_y, max_y;
+    IceTInt y;
+    const IceTVoid *span_pointers[4];
+
+    icetRaiseDebug("In icetCompositeSparseImage");
+
+    if ((row_span_starts == NULL) || (spans == NULL)) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "icetCompositeSparseImage needs span lists.");
+        return icetImageNull();
+    }
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+
+    /* Find where the pixels of each row start in the packed pixel arrays and
+     * the smallest viewport containing all spans.  The spans are also checked
+     * here so that the compression of tiles can trust them. */
+    pixel_offsets = icetStateAllocateInteger(ICET_RENDER_SPAN_OFFSETS,
+                                             global_viewport[3] + 1);
+    pixel_offsets[0] = 0;
+    min_x = global_viewport[2];  max_x = 0;
+    min_y = global_viewport[3];  max_y = 0;
+    for (y = 0; y < global_viewport[3]; y++) {
+        IceTInt span;
+        IceTInt next_x = 0;
+        pixel_offsets[y+1] = pixel_offsets[y];
+        if (row_span_starts[y+1] < row_span_starts[y]) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Span list of row %d ends before it starts.",
+                           y);
+            return icetImageNull();
+        }
+        for (span = row_span_starts[y];
+             span < row_span_starts[y+1];
+             span++) {
+            IceTInt x = spans[2*span];
+            IceTInt length = spans[2*span + 1];
+            if ((x < next_x) || (length < 1)
+                || (x + length > global_viewport[2])) {
+                icetRaiseError(ICET_INVALID_VALUE,
+                               "Span %d of row %d is empty, overlaps the"
+                               " previous span, or leaves the viewport.",
+                               span - row_span_starts[y], y);
+                return icetImageNull();
+            }
+            next_x = x + length;
+            pixel_offsets[y+1] += length;
+            if (x < min_x) { min_x = x; }
+            if (next_x > max_x) { max_x = next_x; }
+            if (y < min_y) { min_y = y; }
+            max_y = y + 1;
+        }
+    }
+    if (pixel_offsets[global_viewport[3]] > 0) {
+        IceTEnum color_format, depth_format, composite_mode;
+        icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+        icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+        icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+        if (   (color_pixels == NULL)
+            && (color_format != ICET_IMAGE_COLOR_NONE) ) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "icetCompositeSparseImage needs color pixels.");
+            return icetImageNull();
+        }
+        if (   (depth_pixels == NULL)
+            && (depth_format != ICET_IMAGE_DEPTH_NONE)
+            && (composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) ) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "icetCompositeSparseImage needs depth pixels.");
+            return icetImageNull();
+        }
+    }
+
+    if (max_y > min_y) {
+        valid_pixels_viewport[0] = min_x;
+        valid_pixels_viewport[1] = min_y;
+        valid_pixels_viewport[2] = max_x - min_x;
+        valid_pixels_viewport[3] = max_y - min_y;
+    } else {
+        valid_pixels_viewport[0] = valid_pixels_viewport[1] = 0;
+        valid_pixels_viewport[2] = valid_pixels_viewport[3] = 0;
+    }
+
+    span_pointers[0] = row_span_starts;
+    span_pointers[1] = spans;
+    span_pointers[2] = color_pixels;
+    span_pointers[3] = depth_pixels;
+
+    icetStateSetBoolean(ICET_PRE_RENDERED, ICET_TRUE);
+    icetStateSetPointerv(ICET_RENDER_SPANS, 4, span_pointers);
+    icetStateSetIntegerv(ICET_RENDERED_VIEWPORT, 4, valid_pixels_viewport);
 
     return drawDoFrame(projection_matrix, modelview_matrix, background_color);
 }
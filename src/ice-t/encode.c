@@ -0,0 +1,840 @@
+/* -*- c -*- *******************************************************/
+/*
+ * Copyright (C) 2011 Sandia Corporation
+ * Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+ * the U.S. Government retains certain rights in this software.
+ *
+ * This source code is released under the New BSD License.
+ */
+
+/* Use 64-bit file offsets so that large images can be written. */
+#define _FILE_OFFSET_BITS 64
+
+#include <IceT.h>
+
+#include <IceTDevCommunication.h>
+#include <IceTDevDiagnostics.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include <IceTDevTiming.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#define ENCODED_FRAGMENT 26
+
+/* A partition of contiguous pixels in an IceT image maps to at most three
+   contiguous ranges in a top-down file: the tail of the top row, the full rows
+   in between, and the head of the bottom row. */
+#define ENCODE_MAX_FRAGMENTS 3
+
+/* Layout of the record each process shares about its encoded pixels. */
+#define ENCODE_INFO_TILE                0
+#define ENCODE_INFO_NUM_FRAGMENTS       1
+#define ENCODE_INFO_FRAGMENT_START(i)   (2 + 3*(i))
+#define ENCODE_INFO_FRAGMENT_PIXELS(i)  (3 + 3*(i))
+#define ENCODE_INFO_FRAGMENT_BYTES(i)   (4 + 3*(i))
+#define ENCODE_INFO_SIZE                (2 + 3*ENCODE_MAX_FRAGMENTS)
+
+#define QOI_HEADER_SIZE         14
+#define QOI_END_MARKER_SIZE     8
+
+#define QOI_OP_INDEX    0x00
+#define QOI_OP_DIFF     0x40
+#define QOI_OP_LUMA     0x80
+#define QOI_OP_RUN      0xC0
+#define QOI_OP_RGB      0xFE
+#define QOI_OP_RGBA     0xFF
+
+#define QOI_MAX_RUN     62
+
+#define QOI_COLOR_HASH(px) \
+    (((px)[0]*3 + (px)[1]*5 + (px)[2]*7 + (px)[3]*11) % 64)
+
+static void encodeGetPixel(const IceTVoid *colors,
+                           IceTEnum color_format,
+                           IceTSizeType index,
+                           IceTUByte *px)
+{
+    switch (color_format) {
+      case ICET_IMAGE_COLOR_RGBA_UBYTE:
+          memcpy(px, (const IceTUByte *)colors + 4*index, 4);
+          break;
+      case ICET_IMAGE_COLOR_RGBA_FLOAT:
+      case ICET_IMAGE_COLOR_RGB_FLOAT:
+          {
+              IceTInt num_channels
+                  = (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) ? 4 : 3;
+              const IceTFloat *in
+                  = (const IceTFloat *)colors + num_channels*index;
+              IceTInt c;
+              px[3] = 255;
+              for (c = 0; c < num_channels; c++) {
+                  IceTFloat value = in[c];
+                  if (value <= 0.0f) {
+                      px[c] = 0;
+                  } else if (value >= 1.0f) {
+                      px[c] = 255;
+                  } else {
+                      px[c] = (IceTUByte)(255.0f*value + 0.5f);
+                  }
+              }
+          }
+          break;
+      default:
+          px[0] = px[1] = px[2] = 0;
+          px[3] = 255;
+          break;
+    }
+}
+
+/* Encodes the pixels in the range [start, end) of a top-down traversal of the
+   image as QOI chunks.  The chunks are written such that they can be placed
+   after any other chunks in a QOI stream: the first pixel is written in full
+   and no index entry is referenced unless it was written by this fragment.
+   Returns the number of bytes written to out. */
+static IceTSizeType encodeQOIFragment(const IceTImage image,
+                                      IceTSizeType start,
+                                      IceTSizeType end,
+                                      IceTUByte *out)
+{
+    IceTEnum color_format = icetImageGetColorFormat(image);
+    const IceTVoid *colors = icetImageGetColorConstVoid(image, NULL);
+    IceTSizeType width = icetImageGetWidth(image);
+    IceTSizeType height = icetImageGetHeight(image);
+    IceTUByte index[64][4];
+    IceTBoolean index_valid[64];
+    IceTUByte prev[4];
+    IceTInt run;
+    IceTUByte *out_start = out;
+    IceTSizeType position;
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        index_valid[i] = ICET_FALSE;
+    }
+    run = 0;
+
+    for (position = start; position < end; position++) {
+        IceTSizeType y = height - 1 - position/width;
+        IceTSizeType x = position%width;
+        IceTUByte px[4];
+        int hash;
+
+        encodeGetPixel(colors, color_format, y*width + x, px);
+        hash = QOI_COLOR_HASH(px);
+
+        if (position == start) {
+            *(out++) = QOI_OP_RGBA;
+            *(out++) = px[0];
+            *(out++) = px[1];
+            *(out++) = px[2];
+            *(out++) = px[3];
+            memcpy(index[hash], px, 4);
+            index_valid[hash] = ICET_TRUE;
+            memcpy(prev, px, 4);
+            continue;
+        }
+
+        if (memcmp(px, prev, 4) == 0) {
+            run++;
+            if (run == QOI_MAX_RUN) {
+                *(out++) = (IceTUByte)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            *(out++) = (IceTUByte)(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        if (index_valid[hash] && (memcmp(index[hash], px, 4) == 0)) {
+            *(out++) = (IceTUByte)(QOI_OP_INDEX | hash);
+        } else {
+            memcpy(index[hash], px, 4);
+            index_valid[hash] = ICET_TRUE;
+
+            if (px[3] == prev[3]) {
+                int vr = (int)px[0] - (int)prev[0];
+                int vg = (int)px[1] - (int)prev[1];
+                int vb = (int)px[2] - (int)prev[2];
+                int vg_r = vr - vg;
+                int vg_b = vb - vg;
+
+                /* Differences wrap around as in the QOI specification. */
+                vr = ((vr + 128) & 0xFF) - 128;
+                vg = ((vg + 128) & 0xFF) - 128;
+                vb = ((vb + 128) & 0xFF) - 128;
+                vg_r = ((vg_r + 128) & 0xFF) - 128;
+                vg_b = ((vg_b + 128) & 0xFF) - 128;
+
+                if (   (vr > -3) && (vr < 2)
+                    && (vg > -3) && (vg < 2)
+                    && (vb > -3) && (vb < 2) ) {
+                    *(out++) = (IceTUByte)(  QOI_OP_DIFF | ((vr + 2) << 4)
+                                           | ((vg + 2) << 2) | (vb + 2) );
+                } else if (   (vg_r > -9) && (vg_r < 8)
+                           && (vg > -33) && (vg < 32)
+                           && (vg_b > -9) && (vg_b < 8) ) {
+                    *(out++) = (IceTUByte)(QOI_OP_LUMA | (vg + 32));
+                    *(out++) = (IceTUByte)(((vg_r + 8) << 4) | (vg_b + 8));
+                } else {
+                    *(out++) = QOI_OP_RGB;
+                    *(out++) = px[0];
+                    *(out++) = px[1];
+                    *(out++) = px[2];
+                }
+            } else {
+                *(out++) = QOI_OP_RGBA;
+                *(out++) = px[0];
+                *(out++) = px[1];
+                *(out++) = px[2];
+                *(out++) = px[3];
+            }
+        }
+
+        memcpy(prev, px, 4);
+    }
+
+    if (run > 0) {
+        *(out++) = (IceTUByte)(QOI_OP_RUN | (run - 1));
+    }
+
+    return (IceTSizeType)(out - out_start);
+}
+
+/* Finds the ranges of a top-down traversal of an image covered by the pixels
+   [offset, offset+num_pixels) of an IceT image, which is stored bottom-up.
+   Returns the number of ranges. */
+static IceTInt encodeFindFragments(IceTSizeType width,
+                                   IceTSizeType height,
+                                   IceTSizeType offset,
+                                   IceTSizeType num_pixels,
+                                   IceTSizeType *fragment_starts,
+                                   IceTSizeType *fragment_ends)
+{
+    IceTSizeType first_row;
+    IceTSizeType last_row;
+    IceTSizeType y;
+    IceTInt num_fragments;
+
+    if (num_pixels < 1) { return 0; }
+
+    first_row = offset/width;
+    last_row = (offset + num_pixels - 1)/width;
+
+    num_fragments = 0;
+    for (y = last_row; y >= first_row; y--) {
+        IceTSizeType row_start = (height - 1 - y)*width;
+        IceTSizeType x_begin = (y == first_row) ? offset%width : 0;
+        IceTSizeType x_end
+            = (y == last_row) ? (offset + num_pixels - 1)%width + 1 : width;
+
+        if (   (num_fragments > 0)
+            && (fragment_ends[num_fragments-1] == row_start + x_begin) ) {
+            fragment_ends[num_fragments-1] = row_start + x_end;
+        } else {
+            fragment_starts[num_fragments] = row_start + x_begin;
+            fragment_ends[num_fragments] = row_start + x_end;
+            num_fragments++;
+        }
+    }
+
+    return num_fragments;
+}
+
+typedef struct {
+    IceTInt start;
+    IceTInt bytes;
+    IceTInt proc;
+    IceTInt index;
+} encodeFragmentInfo;
+
+static int encodeCompareFragments(const void *a, const void *b)
+{
+    const encodeFragmentInfo *fa = (const encodeFragmentInfo *)a;
+    const encodeFragmentInfo *fb = (const encodeFragmentInfo *)b;
+    if (fa->start < fb->start) { return -1; }
+    if (fa->start > fb->start) { return 1; }
+    return 0;
+}
+
+static void encodeWriteBigEndian32(IceTUByte *out, IceTSizeType value)
+{
+    out[0] = (IceTUByte)((value >> 24) & 0xFF);
+    out[1] = (IceTUByte)((value >> 16) & 0xFF);
+    out[2] = (IceTUByte)((value >> 8) & 0xFF);
+    out[3] = (IceTUByte)(value & 0xFF);
+}
+
+const IceTVoid *icetGatherEncodedImage(const IceTImage image,
+                                       IceTEnum encoding,
+                                       IceTSizeType *encoded_size)
+{
+    IceTInt valid_tile;
+    IceTInt valid_offset;
+    IceTInt valid_num;
+    IceTInt display_tile;
+    IceTInt num_proc;
+    IceTInt rank;
+    IceTInt my_info[ENCODE_INFO_SIZE];
+    IceTInt *all_info;
+    IceTCommRequest *requests;
+    encodeFragmentInfo *fragments;
+    IceTInt num_fragments;
+    IceTCommRequest send_requests[ENCODE_MAX_FRAGMENTS];
+    IceTUByte *fragment_buffer;
+    IceTUByte *result;
+    IceTSizeType result_size;
+    IceTInt num_requests;
+    IceTInt proc;
+    IceTInt i;
+
+    *encoded_size = 0;
+
+    if (encoding != ICET_IMAGE_ENCODING_QOI) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid image encoding 0x%X.", encoding);
+        return NULL;
+    }
+
+    icetGetIntegerv(ICET_VALID_PIXELS_TILE, &valid_tile);
+    icetGetIntegerv(ICET_VALID_PIXELS_OFFSET, &valid_offset);
+    icetGetIntegerv(ICET_VALID_PIXELS_NUM, &valid_num);
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &display_tile);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    if (   (valid_tile >= 0)
+        && (   icetImageIsNull(image)
+            || (icetImageGetColorFormat(image) == ICET_IMAGE_COLOR_NONE) ) ) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Cannot encode an image with no color.");
+        valid_tile = -1;
+    }
+
+    /* Encode the pixels of the final image this process holds.  The encoded
+       fragments are placed back to back in fragment_buffer. */
+    my_info[ENCODE_INFO_TILE] = -1;
+    my_info[ENCODE_INFO_NUM_FRAGMENTS] = 0;
+    fragment_buffer = NULL;
+    if ((valid_tile >= 0) && (valid_num > 0)) {
+        IceTSizeType fragment_starts[ENCODE_MAX_FRAGMENTS];
+        IceTSizeType fragment_ends[ENCODE_MAX_FRAGMENTS];
+        IceTInt my_num_fragments;
+        IceTUByte *out;
+
+        icetTimingCompressBegin();
+
+        my_num_fragments = encodeFindFragments(icetImageGetWidth(image),
+                                               icetImageGetHeight(image),
+                                               valid_offset,
+                                               valid_num,
+                                               fragment_starts,
+                                               fragment_ends);
+        /* QOI never takes more than 5 bytes per pixel. */
+        fragment_buffer = icetGetStateBuffer(ICET_ENCODE_FRAGMENT_BUF,
+                                             5*valid_num);
+        out = fragment_buffer;
+
+        my_info[ENCODE_INFO_TILE] = valid_tile;
+        my_info[ENCODE_INFO_NUM_FRAGMENTS] = my_num_fragments;
+        for (i = 0; i < my_num_fragments; i++) {
+            IceTSizeType fragment_size = encodeQOIFragment(image,
+                                                           fragment_starts[i],
+                                                           fragment_ends[i],
+                                                           out);
+            my_info[ENCODE_INFO_FRAGMENT_START(i)] = fragment_starts[i];
+            my_info[ENCODE_INFO_FRAGMENT_PIXELS(i)]
+                = fragment_ends[i] - fragment_starts[i];
+            my_info[ENCODE_INFO_FRAGMENT_BYTES(i)] = fragment_size;
+            out += fragment_size;
+        }
+
+        icetTimingCompressEnd();
+    }
+
+    icetTimingCollectBegin();
+
+    /* Requests come first in the buffer to keep them aligned. */
+    requests = icetGetStateBuffer(ICET_ENCODE_INFO_BUF,
+                                  num_proc*ENCODE_MAX_FRAGMENTS
+                                    *(  sizeof(IceTCommRequest)
+                                      + sizeof(encodeFragmentInfo) )
+                                  + num_proc*ENCODE_INFO_SIZE*sizeof(IceTInt));
+    fragments = (encodeFragmentInfo *)(requests
+                                       + num_proc*ENCODE_MAX_FRAGMENTS);
+    all_info = (IceTInt *)(fragments + num_proc*ENCODE_MAX_FRAGMENTS);
+    icetCommAllgather(my_info, ENCODE_INFO_SIZE, ICET_INT, all_info);
+
+    /* Send my fragments to the process displaying the tile. */
+    for (i = 0; i < ENCODE_MAX_FRAGMENTS; i++) {
+        send_requests[i] = ICET_COMM_REQUEST_NULL;
+    }
+    if (my_info[ENCODE_INFO_TILE] >= 0) {
+        IceTInt dest = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES)
+                                                    [my_info[ENCODE_INFO_TILE]];
+        if (dest != rank) {
+            IceTUByte *out = fragment_buffer;
+            for (i = 0; i < my_info[ENCODE_INFO_NUM_FRAGMENTS]; i++) {
+                send_requests[i]
+                    = icetCommIsend(out,
+                                    my_info[ENCODE_INFO_FRAGMENT_BYTES(i)],
+                                    ICET_BYTE,
+                                    dest,
+                                    ENCODED_FRAGMENT + i);
+                out += my_info[ENCODE_INFO_FRAGMENT_BYTES(i)];
+            }
+        }
+    }
+
+    if (display_tile < 0) {
+        icetCommWaitall(ENCODE_MAX_FRAGMENTS, send_requests);
+        icetTimingCollectEnd();
+        return NULL;
+    }
+
+    /* Receive every fragment of the displayed tile directly into its place
+       in the stream.  Fragments are placed in order of their first pixel. */
+    {
+        const IceTInt *tile_viewport
+            = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS) + 4*display_tile;
+        IceTSizeType tile_pixels = tile_viewport[2]*tile_viewport[3];
+        IceTSizeType covered_pixels = 0;
+        IceTSizeType location;
+        const IceTUByte *local_fragment;
+
+        result_size = QOI_HEADER_SIZE + QOI_END_MARKER_SIZE;
+        num_fragments = 0;
+        for (proc = 0; proc < num_proc; proc++) {
+            const IceTInt *info = all_info + proc*ENCODE_INFO_SIZE;
+            if (info[ENCODE_INFO_TILE] != display_tile) { continue; }
+            for (i = 0; i < info[ENCODE_INFO_NUM_FRAGMENTS]; i++) {
+                encodeFragmentInfo *fragment = &fragments[num_fragments++];
+                fragment->start = info[ENCODE_INFO_FRAGMENT_START(i)];
+                fragment->bytes = info[ENCODE_INFO_FRAGMENT_BYTES(i)];
+                fragment->proc = proc;
+                fragment->index = i;
+                result_size += fragment->bytes;
+                covered_pixels += info[ENCODE_INFO_FRAGMENT_PIXELS(i)];
+            }
+        }
+        if (covered_pixels != tile_pixels) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Encoded pixels (%d) do not cover the displayed"
+                           " tile (%d pixels).",
+                           covered_pixels, tile_pixels);
+            icetCommWaitall(ENCODE_MAX_FRAGMENTS, send_requests);
+            icetTimingCollectEnd();
+            return NULL;
+        }
+        qsort(fragments,
+              num_fragments,
+              sizeof(encodeFragmentInfo),
+              encodeCompareFragments);
+
+        result = icetGetStateBuffer(ICET_ENCODE_RESULT_BUF, result_size);
+
+        memcpy(result, "qoif", 4);
+        encodeWriteBigEndian32(result + 4, tile_viewport[2]);
+        encodeWriteBigEndian32(result + 8, tile_viewport[3]);
+        result[12] = 4;
+        result[13] = 0;
+
+        /* Local fragments are in fragment_buffer in the same (sorted) order
+           in which they were generated. */
+        location = QOI_HEADER_SIZE;
+        local_fragment = fragment_buffer;
+        num_requests = 0;
+        for (i = 0; i < num_fragments; i++) {
+            encodeFragmentInfo *fragment = &fragments[i];
+            if (fragment->proc == rank) {
+                memcpy(result + location, local_fragment, fragment->bytes);
+                local_fragment += fragment->bytes;
+            } else {
+                requests[num_requests++]
+                    = icetCommIrecv(result + location,
+                                    fragment->bytes,
+                                    ICET_BYTE,
+                                    fragment->proc,
+                                    ENCODED_FRAGMENT + fragment->index);
+            }
+            location += fragment->bytes;
+        }
+
+        memset(result + location, 0, QOI_END_MARKER_SIZE - 1);
+        result[location + QOI_END_MARKER_SIZE - 1] = 0x01;
+
+        icetCommWaitall(num_requests, requests);
+    }
+
+    icetCommWaitall(ENCODE_MAX_FRAGMENTS, send_requests);
+
+    icetTimingCollectEnd();
+
+    *encoded_size = result_size;
+    return result;
+}
+
+/* Files are written with positioned writes so that every process can fill in
+   its own part of a shared file without any coordination. */
+#ifndef _WIN32
+typedef off_t encodeFileOffset;
+#else
+typedef __int64 encodeFileOffset;
+#endif
+
+static int encodeOpenFile(const char *filename)
+{
+#ifndef _WIN32
+    return open(filename, O_WRONLY | O_CREAT, 0666);
+#else
+    return _open(filename,
+                 _O_WRONLY | _O_CREAT | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+#endif
+}
+
+static void encodeCloseFile(int file)
+{
+#ifndef _WIN32
+    close(file);
+#else
+    _close(file);
+#endif
+}
+
+static IceTBoolean encodeWriteFile(int file,
+                                   const IceTVoid *data,
+                                   IceTSizeType size,
+                                   encodeFileOffset offset)
+{
+    const char *bytes = (const char *)data;
+    while (size > 0) {
+#ifndef _WIN32
+        ssize_t written = pwrite(file, bytes, (size_t)size, offset);
+#else
+        int written;
+        if (_lseeki64(file, offset, SEEK_SET) != offset) { return ICET_FALSE; }
+        written = _write(file, bytes, (unsigned int)size);
+#endif
+        if (written <= 0) { return ICET_FALSE; }
+        bytes += written;
+        size -= (IceTSizeType)written;
+        offset += written;
+    }
+    return ICET_TRUE;
+}
+
+static IceTBoolean encodeSetFileSize(int file, encodeFileOffset size)
+{
+#ifndef _WIN32
+    return (ftruncate(file, size) == 0);
+#else
+    return (_chsize_s(file, size) == 0);
+#endif
+}
+
+/* Replaces the first %d in filename with the tile index.  The returned string
+   is valid until the ICET_ENCODE_INFO_BUF buffer is used again. */
+static const char *encodeTileFileName(const char *filename, IceTInt tile)
+{
+    const char *tile_marker = strstr(filename, "%d");
+    char *result;
+    size_t prefix_length;
+
+    if (tile_marker == NULL) {
+        IceTInt num_tiles;
+        icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+        if (num_tiles > 1) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "File name %s needs a %%d to distinguish the"
+                           " images of the %d tiles.",
+                           filename, num_tiles);
+            return NULL;
+        }
+        return filename;
+    }
+
+    result = icetGetStateBuffer(ICET_ENCODE_INFO_BUF,
+                                (IceTSizeType)strlen(filename) + 16);
+    prefix_length = (size_t)(tile_marker - filename);
+    memcpy(result, filename, prefix_length);
+    sprintf(result + prefix_length, "%d%s", (int)tile, tile_marker + 2);
+    return result;
+}
+
+/* Fills header with the header of a color or depth file.  Returns the size of
+   the header, which is 0 for raw files. */
+static IceTSizeType encodeFileHeader(IceTEnum file_format,
+                                     IceTBoolean is_depth,
+                                     IceTSizeType width,
+                                     IceTSizeType height,
+                                     char *header)
+{
+    const IceTInt one = 1;
+    /* A negative scale in a PFM file marks little-endian values. */
+    const char *scale = (*((const IceTUByte *)&one) == 1) ? "-1.0" : "1.0";
+
+    if (file_format == ICET_IMAGE_FILE_RAW) {
+        header[0] = '\0';
+    } else if (is_depth) {
+        sprintf(header, "Pf\n%d %d\n%s\n", (int)width, (int)height, scale);
+    } else if (file_format == ICET_IMAGE_FILE_PPM) {
+        sprintf(header, "P6\n%d %d\n255\n", (int)width, (int)height);
+    } else {
+        sprintf(header, "PF\n%d %d\n%s\n", (int)width, (int)height, scale);
+    }
+    return (IceTSizeType)strlen(header);
+}
+
+static IceTSizeType encodeFilePixelSize(IceTEnum file_format,
+                                        IceTBoolean is_depth)
+{
+    IceTEnum color_format;
+
+    if (is_depth) { return sizeof(IceTFloat); }
+
+    switch (file_format) {
+      case ICET_IMAGE_FILE_PPM: return 3;
+      case ICET_IMAGE_FILE_PFM: return 3*sizeof(IceTFloat);
+      default: break;
+    }
+
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    switch (color_format) {
+      case ICET_IMAGE_COLOR_RGBA_UBYTE: return 4;
+      case ICET_IMAGE_COLOR_RGBA_FLOAT: return 4*sizeof(IceTFloat);
+      case ICET_IMAGE_COLOR_RGB_FLOAT:  return 3*sizeof(IceTFloat);
+      default: return 0;
+    }
+}
+
+/* Converts the pixels [start, end) of the file to the file's pixel format.
+   PPM files are stored top-down whereas all other files are stored bottom-up
+   like IceT images. */
+static void encodeFilePixels(const IceTImage image,
+                             IceTEnum file_format,
+                             IceTBoolean is_depth,
+                             IceTSizeType start,
+                             IceTSizeType end,
+                             IceTUByte *out)
+{
+    IceTEnum color_format = icetImageGetColorFormat(image);
+    IceTSizeType width = icetImageGetWidth(image);
+    IceTSizeType height = icetImageGetHeight(image);
+    IceTSizeType color_pixel_size;
+    const IceTUByte *colors
+        = icetImageGetColorConstVoid(image, &color_pixel_size);
+    const IceTFloat *depths = is_depth ? icetImageGetDepthcf(image) : NULL;
+    IceTSizeType location;
+
+    for (location = start; location < end; location++) {
+        IceTSizeType index = location;
+
+        if (is_depth) {
+            memcpy(out, depths + index, sizeof(IceTFloat));
+            out += sizeof(IceTFloat);
+        } else if (file_format == ICET_IMAGE_FILE_PPM) {
+            IceTUByte px[4];
+            index = (height - 1 - location/width)*width + location%width;
+            encodeGetPixel(colors, color_format, index, px);
+            memcpy(out, px, 3);
+            out += 3;
+        } else if (file_format == ICET_IMAGE_FILE_PFM) {
+            IceTFloat rgb[3];
+            IceTInt c;
+            if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                for (c = 0; c < 3; c++) {
+                    rgb[c] = colors[4*index + c]/255.0f;
+                }
+            } else {
+                memcpy(rgb, colors + color_pixel_size*index, sizeof(rgb));
+            }
+            memcpy(out, rgb, sizeof(rgb));
+            out += sizeof(rgb);
+        } else {
+            memcpy(out, colors + color_pixel_size*index, color_pixel_size);
+            out += color_pixel_size;
+        }
+    }
+}
+
+static void encodeWriteImagePlane(const IceTImage image,
+                                  IceTEnum file_format,
+                                  IceTBoolean is_depth,
+                                  const char *filename)
+{
+    const IceTInt *tile_viewports
+        = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    IceTSizeType pixel_size = encodeFilePixelSize(file_format, is_depth);
+    IceTInt valid_tile;
+    IceTInt valid_offset;
+    IceTInt valid_num;
+    IceTInt display_tile;
+    char header[64];
+
+    icetGetIntegerv(ICET_VALID_PIXELS_TILE, &valid_tile);
+    icetGetIntegerv(ICET_VALID_PIXELS_OFFSET, &valid_offset);
+    icetGetIntegerv(ICET_VALID_PIXELS_NUM, &valid_num);
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &display_tile);
+
+    /* The display process of each tile writes the header and makes sure the
+       file has the right size.  It never truncates the pixels other processes
+       write, so it does not matter who gets to the file first. */
+    if (display_tile >= 0) {
+        IceTSizeType width = tile_viewports[4*display_tile + 2];
+        IceTSizeType height = tile_viewports[4*display_tile + 3];
+        IceTSizeType header_size
+            = encodeFileHeader(file_format, is_depth, width, height, header);
+        const char *tile_filename = encodeTileFileName(filename, display_tile);
+        int file;
+
+        if (tile_filename == NULL) { return; }
+        file = encodeOpenFile(tile_filename);
+        if (file < 0) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Could not open %s for writing.", tile_filename);
+            return;
+        }
+        if (   !encodeWriteFile(file, header, header_size, 0)
+            || !encodeSetFileSize(file,
+                                  (encodeFileOffset)header_size
+                                  + (encodeFileOffset)width*height*pixel_size)){
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Could not write to %s.", tile_filename);
+        }
+        encodeCloseFile(file);
+    }
+
+    if ((valid_tile >= 0) && (valid_num > 0)) {
+        IceTSizeType width = icetImageGetWidth(image);
+        IceTSizeType height = icetImageGetHeight(image);
+        IceTSizeType header_size
+            = encodeFileHeader(file_format, is_depth, width, height, header);
+        IceTSizeType range_starts[ENCODE_MAX_FRAGMENTS];
+        IceTSizeType range_ends[ENCODE_MAX_FRAGMENTS];
+        IceTInt num_ranges;
+        const char *tile_filename;
+        IceTUByte *buffer;
+        int file;
+        IceTInt i;
+
+        if (file_format == ICET_IMAGE_FILE_PPM && !is_depth) {
+            num_ranges = encodeFindFragments(width,
+                                             height,
+                                             valid_offset,
+                                             valid_num,
+                                             range_starts,
+                                             range_ends);
+        } else {
+            num_ranges = 1;
+            range_starts[0] = valid_offset;
+            range_ends[0] = valid_offset + valid_num;
+        }
+
+        tile_filename = encodeTileFileName(filename, valid_tile);
+        if (tile_filename == NULL) { return; }
+        file = encodeOpenFile(tile_filename);
+        if (file < 0) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Could not open %s for writing.", tile_filename);
+            return;
+        }
+
+        buffer = icetGetStateBuffer(ICET_ENCODE_FRAGMENT_BUF,
+                                    valid_num*pixel_size);
+        for (i = 0; i < num_ranges; i++) {
+            encodeFilePixels(image,
+                             file_format,
+                             is_depth,
+                             range_starts[i],
+                             range_ends[i],
+                             buffer);
+            if (!encodeWriteFile(file,
+                                 buffer,
+                                 (range_ends[i] - range_starts[i])*pixel_size,
+                                 (encodeFileOffset)header_size
+                                 + (encodeFileOffset)range_starts[i]
+                                   *pixel_size)) {
+                icetRaiseError(ICET_INVALID_OPERATION,
+                               "Could not write to %s.", tile_filename);
+                break;
+            }
+        }
+        encodeCloseFile(file);
+    }
+}
+
+void icetWriteImageFile(const IceTImage image,
+                        IceTEnum file_format,
+                        const char *color_filename,
+                        const char *depth_filename)
+{
+    IceTInt valid_tile;
+    IceTBoolean has_image;
+
+    if (   (file_format != ICET_IMAGE_FILE_PPM)
+        && (file_format != ICET_IMAGE_FILE_PFM)
+        && (file_format != ICET_IMAGE_FILE_RAW) ) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid image file format 0x%X.", file_format);
+        return;
+    }
+
+    icetGetIntegerv(ICET_VALID_PIXELS_TILE, &valid_tile);
+    has_image = (valid_tile >= 0) && !icetImageIsNull(image);
+    if (valid_tile >= 0 && !has_image) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Got a null image with valid pixels to write.");
+        return;
+    }
+
+    icetTimingCollectBegin();
+
+    if (color_filename != NULL) {
+        IceTEnum color_format;
+        icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+        if (   (color_format == ICET_IMAGE_COLOR_NONE)
+            || (has_image
+                && (icetImageGetColorFormat(image) != color_format)) ) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Cannot write color of an image with no color.");
+        } else {
+            encodeWriteImagePlane(image, file_format, ICET_FALSE,
+                                  color_filename);
+        }
+    }
+
+    if (depth_filename != NULL) {
+        IceTEnum depth_format;
+        icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+        if (   (depth_format != ICET_IMAGE_DEPTH_FLOAT)
+            || (has_image
+                && (icetImageGetDepthFormat(image) != depth_format)) ) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Cannot write depth of an image with no depth.");
+        } else {
+            encodeWriteImagePlane(image, file_format, ICET_TRUE,
+                                  depth_filename);
+        }
+    }
+
+    /* Make sure the files are complete on every process when this returns
+       so that any of them may read the files back. */
+    icetCommBarrier();
+
+    icetTimingCollectEnd();
+}
@@ -15,6 +15,7 @@
 #include <IceTDevState.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevMatrix.h>
+#include <IceTDevPorting.h>
 #include <IceTDevTiming.h>
 
 #include <stdlib.h>
@@ -31,12 +32,30 @@
 #define ICET_IMAGE_HEIGHT_INDEX                 4
 #define ICET_IMAGE_MAX_NUM_PIXELS_INDEX         5
 #define ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX     6
-#define ICET_IMAGE_DATA_START_INDEX             7
+#define ICET_IMAGE_AUXILIARY_SIZE_INDEX         7
+#define ICET_IMAGE_DATA_START_INDEX             8
 
 #define ICET_IMAGE_HEADER(image)        ((IceTInt *)image.opaque_internals)
+#define ICET_IMAGE_AUXILIARY_SIZE(image) \
+    (ICET_IMAGE_HEADER(image)[ICET_IMAGE_AUXILIARY_SIZE_INDEX])
 #define ICET_IMAGE_DATA(image) \
     ((IceTVoid *)&(ICET_IMAGE_HEADER(image)[ICET_IMAGE_DATA_START_INDEX]))
 
+/* The data of a pointer image is the color and depth pointers followed by the
+   layout of each buffer.  The pointers refer to the lower left pixel.  The
+   layout gives the bytes from one pixel to the next in a row and the bytes
+   from one row to the next, which is negative for buffers stored top down. */
+#define ICET_IMAGE_POINTERS(image) \
+    ((const IceTVoid **)ICET_IMAGE_DATA(image))
+#define ICET_IMAGE_POINTERS_LAYOUT(image) \
+    ((IceTSizeType *)&(ICET_IMAGE_POINTERS(image)[2]))
+
+#define ICET_POINTERS_COLOR_PIXEL_STEP  0
+#define ICET_POINTERS_COLOR_ROW_STEP    1
+#define ICET_POINTERS_DEPTH_PIXEL_STEP  2
+#define ICET_POINTERS_DEPTH_ROW_STEP    3
+#define ICET_POINTERS_LAYOUT_SIZE       4
+
 typedef IceTUnsignedInt32 IceTRunLengthType;
 
 #define INACTIVE_RUN_LENGTH(rl) (((IceTRunLengthType *)(rl))[0])
@@ -100,6 +119,58 @@ static void ICET_TEST_SPARSE_IMAGE_HEADER(IceTSparseImage image)
 static IceTSizeType colorPixelSize(IceTEnum color_format);
 static IceTSizeType depthPixelSize(IceTEnum depth_format);
 
+/* Returns the size, in bytes, of the auxiliary channels of a single pixel in
+   new images of the given depth format.  The channels travel with the depth
+   of the pixel, so images without depth never have them. */
+static IceTSizeType auxiliaryPixelSize(IceTEnum depth_format);
+
+/* Returns the size, in bytes, of each active pixel stored in a sparse
+   image. */
+static IceTSizeType sparseImagePixelSize(const IceTSparseImage image);
+
+/* Versions of icetImageBufferSizeType and icetSparseImageBufferSizeType that
+   take the size of the auxiliary channels rather than using the current
+   ones. */
+static IceTSizeType imageBufferSize(IceTEnum color_format,
+                                    IceTEnum depth_format,
+                                    IceTSizeType auxiliary_size,
+                                    IceTSizeType width,
+                                    IceTSizeType height);
+static IceTSizeType sparseImageBufferSize(IceTEnum color_format,
+                                          IceTEnum depth_format,
+                                          IceTSizeType auxiliary_size,
+                                          IceTSizeType width,
+                                          IceTSizeType height);
+
+/* Given a buffer handed to a pointer image and the state variable holding the
+   layout set by icetInputBufferLayout, returns the location of the lower left
+   pixel and fills steps with the bytes to the next pixel and the next row. */
+static const IceTVoid *pointerImageLayout(const IceTVoid *buffer,
+                                          IceTEnum layout_pname,
+                                          IceTSizeType pixel_size,
+                                          IceTSizeType width,
+                                          IceTSizeType height,
+                                          IceTSizeType *steps);
+
+/* Returns true if the buffers of a pointer image are not tightly packed, in
+   which case they can only be read through imageColorPixel and
+   imageDepthPixel. */
+static IceTBoolean pointerImageIsStrided(const IceTImage image);
+
+/* Returns where the color or depth of pixel (x,y) is stored along with the
+   bytes to the next pixel in the row and to the next row.  These work for all
+   images, including pointer images with strided buffers. */
+static const IceTVoid *imageColorPixel(const IceTImage image,
+                                       IceTSizeType x,
+                                       IceTSizeType y,
+                                       IceTSizeType *pixel_step,
+                                       IceTSizeType *row_step);
+static const IceTVoid *imageDepthPixel(const IceTImage image,
+                                       IceTSizeType x,
+                                       IceTSizeType y,
+                                       IceTSizeType *pixel_step,
+                                       IceTSizeType *row_step);
+
 /* Given a sparse image and a pointer to the end of the data, fill in the entry
    for the actual buffer size. */
 static void icetSparseImageSetActualSize(IceTSparseImage image,
@@ -251,6 +322,29 @@ static IceTImage prerenderedTile(int tile,
                                  IceTInt *screen_viewport,
                                  IceTInt *target_viewport);
 
+/* Computes the viewports prerenderedTile returns without touching the
+   pre-rendered image. */
+static void prerenderedTileViewports(int tile,
+                                     IceTInt *screen_viewport,
+                                     IceTInt *target_viewport);
+
+/* Builds the compressed image of a tile directly from the span lists given
+   to icetCompositeSparseImage.  screen_viewport and target_viewport are as
+   returned from prerenderedTileViewports. */
+static IceTSparseImage prerenderedSparseTile(int tile,
+                                             const IceTInt *screen_viewport,
+                                             const IceTInt *target_viewport,
+                                             IceTSizeType tile_width,
+                                             IceTSizeType tile_height);
+
+/* Like prerenderedSparseTile except that the spans are written to a full
+   image.  The sparse tile buffer is left alone because strategies may still
+   hold a compressed tile in it. */
+static void prerenderedFullTile(int tile,
+                                const IceTInt *screen_viewport,
+                                const IceTInt *target_viewport,
+                                IceTImage image);
+
 /* Gets an image buffer attached to this context. */
 static IceTImage getRenderBuffer(void);
 
@@ -280,6 +374,19 @@ static IceTSizeType depthPixelSize(IceTEnum depth_format)
     }
 }
 
+static IceTSizeType auxiliaryPixelSize(IceTEnum depth_format)
+{
+    if (depth_format == ICET_IMAGE_DEPTH_NONE) { return 0; }
+    return *icetUnsafeStateGetInteger(ICET_AUXILIARY_PIXEL_SIZE);
+}
+
+static IceTSizeType sparseImagePixelSize(const IceTSparseImage image)
+{
+    return (  colorPixelSize(icetSparseImageGetColorFormat(image))
+            + depthPixelSize(icetSparseImageGetDepthFormat(image))
+            + ICET_IMAGE_AUXILIARY_SIZE(image) );
+}
+
 IceTSizeType icetImageBufferSize(IceTSizeType width, IceTSizeType height)
 {
     IceTEnum color_format, depth_format;
@@ -295,18 +402,34 @@ IceTSizeType icetImageBufferSizeType(IceTEnum color_format,
                                      IceTEnum depth_format,
                                      IceTSizeType width,
                                      IceTSizeType height)
+{
+    return imageBufferSize(color_format,
+                           depth_format,
+                           auxiliaryPixelSize(depth_format),
+                           width,
+                           height);
+}
+
+static IceTSizeType imageBufferSize(IceTEnum color_format,
+                                    IceTEnum depth_format,
+                                    IceTSizeType auxiliary_size,
+                                    IceTSizeType width,
+                                    IceTSizeType height)
 {
     IceTSizeType color_pixel_size = colorPixelSize(color_format);
     IceTSizeType depth_pixel_size = depthPixelSize(depth_format);
 
     return (  ICET_IMAGE_DATA_START_INDEX*sizeof(IceTUInt)
-            + width*height*(color_pixel_size + depth_pixel_size) );
+            + width*height*(  color_pixel_size
+                            + depth_pixel_size
+                            + auxiliary_size) );
 }
 
 IceTSizeType icetImagePointerBufferSize(void)
 {
     return (  ICET_IMAGE_DATA_START_INDEX*sizeof(IceTUInt)
-            + 2*(sizeof(const IceTVoid *)) );
+            + 2*(sizeof(const IceTVoid *))
+            + ICET_POINTERS_LAYOUT_SIZE*sizeof(IceTSizeType) );
 }
 
 IceTSizeType icetSparseImageBufferSize(IceTSizeType width, IceTSizeType height)
@@ -324,6 +447,19 @@ IceTSizeType icetSparseImageBufferSizeType(IceTEnum color_format,
                                            IceTEnum depth_format,
                                            IceTSizeType width,
                                            IceTSizeType height)
+{
+    return sparseImageBufferSize(color_format,
+                                 depth_format,
+                                 auxiliaryPixelSize(depth_format),
+                                 width,
+                                 height);
+}
+
+static IceTSizeType sparseImageBufferSize(IceTEnum color_format,
+                                          IceTEnum depth_format,
+                                          IceTSizeType auxiliary_size,
+                                          IceTSizeType width,
+                                          IceTSizeType height)
 {
     IceTSizeType size;
     IceTSizeType pixel_size;
@@ -331,7 +467,8 @@ IceTSizeType icetSparseImageBufferSizeType(IceTEnum color_format,
     /* A sparse image full of active pixels will be the same size as a full
        image plus a set of run lengths. */
     size = (  RUN_LENGTH_SIZE
-            + icetImageBufferSizeType(color_format,depth_format,width,height) );
+            + imageBufferSize(color_format, depth_format, auxiliary_size,
+                              width, height) );
 
     /* For most common image formats, this is as large as the sparse image may
        be.  When the size of the run length pair is no bigger than the size of a
@@ -344,7 +481,8 @@ IceTSizeType icetSparseImageBufferSizeType(IceTEnum color_format,
        could change the compress functions to not allow run lengths of size 1,
        but that could increase the time to compress and would definitely
        increase the complexity of the code. */
-    pixel_size = colorPixelSize(color_format) + depthPixelSize(depth_format);
+    pixel_size = (  colorPixelSize(color_format) + depthPixelSize(depth_format)
+                  + auxiliary_size );
     if (pixel_size < RUN_LENGTH_SIZE) {
         size += (RUN_LENGTH_SIZE - pixel_size)*((width*height+1)/2);
     }
@@ -428,6 +566,8 @@ IceTImage icetImageAssignBuffer(IceTVoid *buffer,
     header[ICET_IMAGE_WIDTH_INDEX]              = (IceTInt)width;
     header[ICET_IMAGE_HEIGHT_INDEX]             = (IceTInt)height;
     header[ICET_IMAGE_MAX_NUM_PIXELS_INDEX]     = (IceTInt)(width*height);
+    header[ICET_IMAGE_AUXILIARY_SIZE_INDEX]
+        = (IceTInt)auxiliaryPixelSize(depth_format);
     header[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX]
         = (IceTInt)icetImageBufferSizeType(color_format,
                                            depth_format,
@@ -454,6 +594,8 @@ IceTImage icetImagePointerAssignBuffer(IceTVoid *buffer,
         header[ICET_IMAGE_MAGIC_NUM_INDEX] = ICET_IMAGE_POINTERS_MAGIC_NUM;
         /* It is invalid to use this type of image as a single buffer. */
         header[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX] = -1;
+        /* The application only gives us color and depth buffers. */
+        header[ICET_IMAGE_AUXILIARY_SIZE_INDEX] = 0;
     }
 
     /* Check that the image buffers make sense. */
@@ -485,14 +627,136 @@ IceTImage icetImagePointerAssignBuffer(IceTVoid *buffer,
     }
 
     {
-        const IceTVoid **data = ICET_IMAGE_DATA(image);
-        data[0] = color_buffer;
-        data[1] = depth_buffer;
+        const IceTVoid **data = ICET_IMAGE_POINTERS(image);
+        IceTSizeType *layout = ICET_IMAGE_POINTERS_LAYOUT(image);
+        data[0] = pointerImageLayout(
+                    color_buffer,
+                    ICET_INPUT_COLOR_LAYOUT,
+                    colorPixelSize(icetImageGetColorFormat(image)),
+                    width,
+                    height,
+                    layout + ICET_POINTERS_COLOR_PIXEL_STEP);
+        data[1] = pointerImageLayout(
+                    depth_buffer,
+                    ICET_INPUT_DEPTH_LAYOUT,
+                    depthPixelSize(icetImageGetDepthFormat(image)),
+                    width,
+                    height,
+                    layout + ICET_POINTERS_DEPTH_PIXEL_STEP);
     }
 
     return image;
 }
 
+static const IceTVoid *pointerImageLayout(const IceTVoid *buffer,
+                                          IceTEnum layout_pname,
+                                          IceTSizeType pixel_size,
+                                          IceTSizeType width,
+                                          IceTSizeType height,
+                                          IceTSizeType *steps)
+{
+    const IceTInt *layout = icetUnsafeStateGetInteger(layout_pname);
+    IceTSizeType pixel_step;
+    IceTSizeType row_step;
+
+    if ((buffer == NULL) || (pixel_size == 0)) {
+        steps[0] = pixel_size;
+        steps[1] = width*pixel_size;
+        return buffer;
+    }
+
+    pixel_step = (layout[0] > 0) ? layout[0] : pixel_size;
+    row_step = (layout[1] > 0) ? layout[1] : width*pixel_step;
+    if ((pixel_step < pixel_size) || (row_step < width*pixel_step)) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Input buffer layout with pixel stride %d and row"
+                       " stride %d is too small for %d pixels of %d bytes.",
+                       (int)pixel_step, (int)row_step,
+                       (int)width, (int)pixel_size);
+        pixel_step = pixel_size;
+        row_step = width*pixel_size;
+    }
+
+    if ((layout[2] == ICET_ROWS_TOP_DOWN) && (height > 0)) {
+        /* Start at the last row in memory and walk backward. */
+        buffer = (const IceTByte *)buffer + (height-1)*row_step;
+        row_step = -row_step;
+    }
+
+    steps[0] = pixel_step;
+    steps[1] = row_step;
+    return buffer;
+}
+
+static IceTBoolean pointerImageIsStrided(const IceTImage image)
+{
+    const IceTSizeType *layout;
+    IceTSizeType width;
+    IceTSizeType color_size;
+    IceTSizeType depth_size;
+
+    if (   ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]
+        != ICET_IMAGE_POINTERS_MAGIC_NUM ) {
+        return ICET_FALSE;
+    }
+
+    layout = ICET_IMAGE_POINTERS_LAYOUT(image);
+    width = icetImageGetWidth(image);
+    color_size = colorPixelSize(icetImageGetColorFormat(image));
+    depth_size = depthPixelSize(icetImageGetDepthFormat(image));
+
+    return (   (layout[ICET_POINTERS_COLOR_PIXEL_STEP] != color_size)
+            || (layout[ICET_POINTERS_COLOR_ROW_STEP] != width*color_size)
+            || (layout[ICET_POINTERS_DEPTH_PIXEL_STEP] != depth_size)
+            || (layout[ICET_POINTERS_DEPTH_ROW_STEP] != width*depth_size) );
+}
+
+static const IceTVoid *imageColorPixel(const IceTImage image,
+                                       IceTSizeType x,
+                                       IceTSizeType y,
+                                       IceTSizeType *pixel_step,
+                                       IceTSizeType *row_step)
+{
+    const IceTByte *buffer;
+
+    if (   ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]
+        == ICET_IMAGE_POINTERS_MAGIC_NUM ) {
+        const IceTSizeType *layout = ICET_IMAGE_POINTERS_LAYOUT(image);
+        buffer = ICET_IMAGE_POINTERS(image)[0];
+        *pixel_step = layout[ICET_POINTERS_COLOR_PIXEL_STEP];
+        *row_step = layout[ICET_POINTERS_COLOR_ROW_STEP];
+    } else {
+        buffer = icetImageGetColorConstVoid(image, pixel_step);
+        *row_step = icetImageGetWidth(image)*(*pixel_step);
+    }
+
+    if (buffer == NULL) { return NULL; }
+    return buffer + y*(*row_step) + x*(*pixel_step);
+}
+
+static const IceTVoid *imageDepthPixel(const IceTImage image,
+                                       IceTSizeType x,
+                                       IceTSizeType y,
+                                       IceTSizeType *pixel_step,
+                                       IceTSizeType *row_step)
+{
+    const IceTByte *buffer;
+
+    if (   ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]
+        == ICET_IMAGE_POINTERS_MAGIC_NUM ) {
+        const IceTSizeType *layout = ICET_IMAGE_POINTERS_LAYOUT(image);
+        buffer = ICET_IMAGE_POINTERS(image)[1];
+        *pixel_step = layout[ICET_POINTERS_DEPTH_PIXEL_STEP];
+        *row_step = layout[ICET_POINTERS_DEPTH_ROW_STEP];
+    } else {
+        buffer = icetImageGetDepthConstVoid(image, pixel_step);
+        *row_step = icetImageGetWidth(image)*(*pixel_step);
+    }
+
+    if (buffer == NULL) { return NULL; }
+    return buffer + y*(*row_step) + x*(*pixel_step);
+}
+
 IceTImage icetImageNull(void)
 {
     IceTImage image;
@@ -565,6 +829,8 @@ IceTSparseImage icetSparseImageAssignBuffer(IceTVoid *buffer,
     header[ICET_IMAGE_HEIGHT_INDEX]             = (IceTInt)height;
     header[ICET_IMAGE_MAX_NUM_PIXELS_INDEX]     = (IceTInt)(width*height);
     header[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX] = 0;
+    header[ICET_IMAGE_AUXILIARY_SIZE_INDEX]
+        = (IceTInt)auxiliaryPixelSize(depth_format);
 
   /* Make sure the runlengths are valid. */
     icetClearSparseImage(image);
@@ -596,7 +862,10 @@ void icetImageAdjustForOutput(IceTImage image)
 
     ICET_TEST_IMAGE_HEADER(image);
 
-    if (icetIsEnabled(ICET_COMPOSITE_ONE_BUFFER)) {
+    /* The depth is kept when there are auxiliary channels because the
+       channels are stored with it. */
+    if (   icetIsEnabled(ICET_COMPOSITE_ONE_BUFFER)
+        && (ICET_IMAGE_AUXILIARY_SIZE(image) == 0) ) {
         color_format = icetImageGetColorFormat(image);
         if (color_format != ICET_IMAGE_COLOR_NONE) {
           /* Set to no depth information. */
@@ -624,6 +893,8 @@ void icetImageAdjustForInput(IceTImage image)
   /* Reset to the specified image format. */
     ICET_IMAGE_HEADER(image)[ICET_IMAGE_COLOR_FORMAT_INDEX] = color_format;
     ICET_IMAGE_HEADER(image)[ICET_IMAGE_DEPTH_FORMAT_INDEX] = depth_format;
+    ICET_IMAGE_AUXILIARY_SIZE(image)
+        = (IceTInt)auxiliaryPixelSize(depth_format);
 
   /* Reset the image size (changes actual buffer size). */
     icetImageSetDimensions(image,
@@ -729,10 +1000,11 @@ void icetImageSetDimensions(IceTImage image,
     if (   ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]
         == ICET_IMAGE_MAGIC_NUM) {
         ICET_IMAGE_HEADER(image)[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX]
-              = (IceTInt)icetImageBufferSizeType(icetImageGetColorFormat(image),
-                                                 icetImageGetDepthFormat(image),
-                                                 width,
-                                                 height);
+              = (IceTInt)imageBufferSize(icetImageGetColorFormat(image),
+                                         icetImageGetDepthFormat(image),
+                                         ICET_IMAGE_AUXILIARY_SIZE(image),
+                                         width,
+                                         height);
     }
 }
 
@@ -790,7 +1062,12 @@ const IceTVoid *icetImageGetColorConstVoid(const IceTImage image,
     case ICET_IMAGE_MAGIC_NUM:
         return ICET_IMAGE_DATA(image);
     case ICET_IMAGE_POINTERS_MAGIC_NUM:
-        return ((const IceTVoid **)ICET_IMAGE_DATA(image))[0];
+        if (pointerImageIsStrided(image)) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Images with strided buffers can only be read"
+                           " through region copies and compression.");
+        }
+        return ICET_IMAGE_POINTERS(image)[0];
     default:
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Detected invalid image header.");
@@ -900,7 +1177,12 @@ const IceTVoid *icetImageGetDepthConstVoid(const IceTImage image,
         return image_data_pointer + color_format_bytes;
     }
     case ICET_IMAGE_POINTERS_MAGIC_NUM:
-        return ((const IceTVoid **)ICET_IMAGE_DATA(image))[1];
+        if (pointerImageIsStrided(image)) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Images with strided buffers can only be read"
+                           " through region copies and compression.");
+        }
+        return ICET_IMAGE_POINTERS(image)[1];
     default:
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Detected invalid image header (magic_num = 0x%X).",
@@ -950,6 +1232,96 @@ IceTFloat *icetImageGetDepthf(IceTImage image)
     return icetImageGetDepthVoid(image, NULL);
 }
 
+const IceTVoid *icetImageGetAuxiliaryConstVoid(const IceTImage image,
+                                               IceTSizeType *pixel_size)
+{
+    IceTSizeType auxiliary_size;
+
+    if (icetImageIsNull(image)) {
+        if (pixel_size) { *pixel_size = 0; }
+        return NULL;
+    }
+
+    auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(image);
+    if (pixel_size) { *pixel_size = auxiliary_size; }
+    if (auxiliary_size == 0) { return NULL; }
+
+    switch (ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]) {
+    case ICET_IMAGE_MAGIC_NUM:
+    {
+        /* The auxiliary channels of all pixels follow the depth buffer. */
+        IceTSizeType buffer_bytes
+            = (  icetImageGetNumPixels(image)
+               * (  colorPixelSize(icetImageGetColorFormat(image))
+                  + depthPixelSize(icetImageGetDepthFormat(image)) ) );
+
+        /* Cast to IceTByte to ensure pointer arithmetic is correct. */
+        const IceTByte *image_data_pointer =
+                (const IceTByte*)ICET_IMAGE_DATA(image);
+
+        return image_data_pointer + buffer_bytes;
+    }
+    default:
+        icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                       "Detected invalid image header (magic_num = 0x%X).",
+                       ICET_IMAGE_HEADER(image)[ICET_IMAGE_MAGIC_NUM_INDEX]);
+        return NULL;
+    }
+}
+IceTVoid *icetImageGetAuxiliaryVoid(IceTImage image, IceTSizeType *pixel_size)
+{
+    /* This const cast is OK because we actually got the pointer from a
+       non-const image.  Images of pointers never have auxiliary channels. */
+    return (IceTVoid *)icetImageGetAuxiliaryConstVoid(image, pixel_size);
+}
+
+/* Returns the offset, in bytes, of the given auxiliary channel in the
+   auxiliary data of a pixel or -1 if there is no such channel. */
+static IceTSizeType auxiliaryChannelOffset(const IceTImage image,
+                                           IceTInt channel)
+{
+    IceTInt num_channels;
+
+    icetGetIntegerv(ICET_NUM_AUXILIARY_CHANNELS, &num_channels);
+    if ((channel < 0) || (channel >= num_channels)) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Invalid auxiliary channel %d.", channel);
+        return -1;
+    }
+    if (   ICET_IMAGE_AUXILIARY_SIZE(image)
+        != *icetUnsafeStateGetInteger(ICET_AUXILIARY_PIXEL_SIZE) ) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Image does not hold the current auxiliary channels.");
+        return -1;
+    }
+
+    return icetUnsafeStateGetInteger(ICET_AUXILIARY_CHANNEL_OFFSETS)[channel];
+}
+
+const IceTVoid *icetImageGetAuxiliaryc(const IceTImage image, IceTInt channel)
+{
+    const IceTByte *auxiliary_buffer;
+    IceTSizeType offset;
+
+    if (icetImageIsNull(image)) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Null image has no auxiliary channels.");
+        return NULL;
+    }
+
+    offset = auxiliaryChannelOffset(image, channel);
+    if (offset < 0) { return NULL; }
+
+    auxiliary_buffer = icetImageGetAuxiliaryConstVoid(image, NULL);
+    return auxiliary_buffer + offset;
+}
+IceTVoid *icetImageGetAuxiliary(IceTImage image, IceTInt channel)
+{
+    /* This const cast is OK because we actually got the pointer from a
+       non-const image. */
+    return (IceTVoid *)icetImageGetAuxiliaryc(image, channel);
+}
+
 void icetImageCopyColorub(const IceTImage image,
                           IceTUByte *color_buffer,
                           IceTEnum out_color_format)
@@ -1121,6 +1493,37 @@ void icetImageCopyDepthf(const IceTImage image,
     }
 }
 
+void icetImageCopyAuxiliary(const IceTImage image,
+                            IceTInt channel,
+                            IceTVoid *buffer)
+{
+    const IceTByte *in;
+    IceTByte *out = buffer;
+    IceTSizeType pixel_size;
+    IceTSizeType channel_size;
+    IceTSizeType num_pixels;
+    IceTSizeType i;
+
+    in = icetImageGetAuxiliaryc(image, channel);
+    if (in == NULL) { return; }
+
+    icetImageGetAuxiliaryConstVoid(image, &pixel_size);
+    {
+        IceTEnum type
+            = icetUnsafeStateGetInteger(ICET_AUXILIARY_CHANNEL_TYPES)[channel];
+        IceTInt count
+            = icetUnsafeStateGetInteger(ICET_AUXILIARY_CHANNEL_COUNTS)[channel];
+        channel_size = icetTypeWidth(type)*count;
+    }
+
+    num_pixels = icetImageGetNumPixels(image);
+    for (i = 0; i < num_pixels; i++) {
+        memcpy(out, in, channel_size);
+        in += pixel_size;
+        out += channel_size;
+    }
+}
+
 IceTBoolean icetImageEqual(const IceTImage image1, const IceTImage image2)
 {
     return image1.opaque_internals == image2.opaque_internals;
@@ -1135,7 +1538,9 @@ void icetImageCopyPixels(const IceTImage in_image, IceTSizeType in_offset,
     color_format = icetImageGetColorFormat(in_image);
     depth_format = icetImageGetDepthFormat(in_image);
     if (   (color_format != icetImageGetColorFormat(out_image))
-        || (depth_format != icetImageGetDepthFormat(out_image)) ) {
+        || (depth_format != icetImageGetDepthFormat(out_image))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+            != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
         icetRaiseError(ICET_INVALID_VALUE,
                        "Cannot copy pixels of images with different formats.");
         return;
@@ -1173,6 +1578,49 @@ void icetImageCopyPixels(const IceTImage in_image, IceTSizeType in_offset,
                in_depths + pixel_size*in_offset,
                pixel_size*num_pixels);
     }
+
+    if (ICET_IMAGE_AUXILIARY_SIZE(in_image) > 0) {
+        const IceTByte *in_auxiliary;  /* IceTByte for pointer arithmetic */
+        IceTByte *out_auxiliary;
+        IceTSizeType pixel_size;
+        in_auxiliary = icetImageGetAuxiliaryConstVoid(in_image, &pixel_size);
+        out_auxiliary = icetImageGetAuxiliaryVoid(out_image, NULL);
+        memcpy(out_auxiliary + pixel_size*out_offset,
+               in_auxiliary + pixel_size*in_offset,
+               pixel_size*num_pixels);
+    }
+}
+
+/* Copies a width by height block of pixels of pixel_size bytes into a packed
+   destination.  The source pixels may be spaced apart within and across
+   rows. */
+static void copyRegionRows(const IceTByte *src,
+                           IceTSizeType src_pixel_step,
+                           IceTSizeType src_row_step,
+                           IceTByte *dest,
+                           IceTSizeType pixel_size,
+                           IceTSizeType dest_row_step,
+                           IceTSizeType width,
+                           IceTSizeType height)
+{
+    IceTSizeType y;
+
+    for (y = 0; y < height; y++) {
+        if (src_pixel_step == pixel_size) {
+            memcpy(dest, src, width*pixel_size);
+        } else {
+            const IceTByte *src_pixel = src;
+            IceTByte *dest_pixel = dest;
+            IceTSizeType x;
+            for (x = 0; x < width; x++) {
+                memcpy(dest_pixel, src_pixel, pixel_size);
+                src_pixel += src_pixel_step;
+                dest_pixel += pixel_size;
+            }
+        }
+        src  += src_row_step;
+        dest += dest_row_step;
+    }
 }
 
 void icetImageCopyRegion(const IceTImage in_image,
@@ -1184,7 +1632,9 @@ void icetImageCopyRegion(const IceTImage in_image,
     IceTEnum depth_format = icetImageGetDepthFormat(in_image);
 
     if (    (color_format != icetImageGetColorFormat(out_image))
-         || (depth_format != icetImageGetDepthFormat(out_image)) ) {
+         || (depth_format != icetImageGetDepthFormat(out_image))
+         || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+             != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
         icetRaiseError(ICET_INVALID_VALUE,
                        "icetImageCopyRegion only supports copying images"
                        " of the same format.");
@@ -1200,46 +1650,67 @@ void icetImageCopyRegion(const IceTImage in_image,
 
     if (color_format != ICET_IMAGE_COLOR_NONE) {
         IceTSizeType pixel_size;
-        /* Use IceTByte for byte-based pointer arithmetic. */
-        const IceTByte *src = icetImageGetColorConstVoid(in_image, &pixel_size);
+        IceTSizeType src_pixel_step, src_row_step;
+        /* Use IceTByte for byte-based pointer arithmetic.  The source may be
+         * a pointer image with a strided layout, so let it tell us where its
+         * pixels are. */
+        const IceTByte *src = imageColorPixel(in_image,
+                                              in_viewport[0],
+                                              in_viewport[1],
+                                              &src_pixel_step,
+                                              &src_row_step);
         IceTByte *dest = icetImageGetColorVoid(out_image, &pixel_size);
-        IceTSizeType y;
 
-      /* Advance pointers up to vertical offset. */
-        src  += in_viewport[1]*icetImageGetWidth(in_image)*pixel_size;
+      /* Advance pointer to the offset of the region. */
         dest += out_viewport[1]*icetImageGetWidth(out_image)*pixel_size;
-
-      /* Advance pointers forward to horizontal offset. */
-        src  += in_viewport[0]*pixel_size;
         dest += out_viewport[0]*pixel_size;
 
-        for (y = 0; y < in_viewport[3]; y++) {
-            memcpy(dest, src, in_viewport[2]*pixel_size);
-            src  += icetImageGetWidth(in_image)*pixel_size;
-            dest += icetImageGetWidth(out_image)*pixel_size;
-        }
+        copyRegionRows(src, src_pixel_step, src_row_step,
+                       dest, pixel_size,
+                       icetImageGetWidth(out_image)*pixel_size,
+                       in_viewport[2], in_viewport[3]);
     }
 
     if (depth_format != ICET_IMAGE_DEPTH_NONE) {
         IceTSizeType pixel_size;
+        IceTSizeType src_pixel_step, src_row_step;
         /* Use IceTByte for byte-based pointer arithmetic. */
-        const IceTByte *src = icetImageGetDepthConstVoid(in_image, &pixel_size);
+        const IceTByte *src = imageDepthPixel(in_image,
+                                              in_viewport[0],
+                                              in_viewport[1],
+                                              &src_pixel_step,
+                                              &src_row_step);
         IceTByte *dest = icetImageGetDepthVoid(out_image, &pixel_size);
-        IceTSizeType y;
 
-      /* Advance pointers up to vertical offset. */
-        src  += in_viewport[1]*icetImageGetWidth(in_image)*pixel_size;
+      /* Advance pointer to the offset of the region. */
         dest += out_viewport[1]*icetImageGetWidth(out_image)*pixel_size;
+        dest += out_viewport[0]*pixel_size;
+
+        copyRegionRows(src, src_pixel_step, src_row_step,
+                       dest, pixel_size,
+                       icetImageGetWidth(out_image)*pixel_size,
+                       in_viewport[2], in_viewport[3]);
+    }
 
-      /* Advance pointers forward to horizontal offset. */
-        src  += in_viewport[0]*pixel_size;
+    if (ICET_IMAGE_AUXILIARY_SIZE(in_image) > 0) {
+        IceTSizeType pixel_size;
+        /* Use IceTByte for byte-based pointer arithmetic.  Only images with
+         * their own buffers have auxiliary channels, so they are packed. */
+        const IceTByte *src
+            = icetImageGetAuxiliaryConstVoid(in_image, &pixel_size);
+        IceTByte *dest = icetImageGetAuxiliaryVoid(out_image, NULL);
+
+      /* Advance pointers to the offsets of the regions. */
+        src += in_viewport[1]*icetImageGetWidth(in_image)*pixel_size;
+        src += in_viewport[0]*pixel_size;
+        dest += out_viewport[1]*icetImageGetWidth(out_image)*pixel_size;
         dest += out_viewport[0]*pixel_size;
 
-        for (y = 0; y < in_viewport[3]; y++) {
-            memcpy(dest, src, in_viewport[2]*pixel_size);
-            src  += icetImageGetWidth(in_image)*pixel_size;
-            dest += icetImageGetWidth(out_image)*pixel_size;
-        }
+        copyRegionRows(src, pixel_size,
+                       icetImageGetWidth(in_image)*pixel_size,
+                       dest, pixel_size,
+                       icetImageGetWidth(out_image)*pixel_size,
+                       in_viewport[2], in_viewport[3]);
     }
 }
 
@@ -1393,6 +1864,31 @@ void icetImageClearAroundRegion(IceTImage image, const IceTInt *region)
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Invalid depth format 0x%X.", depth_format);
     }
+
+    if (ICET_IMAGE_AUXILIARY_SIZE(image) > 0) {
+        /* Auxiliary channels of the background are all zero. */
+        IceTSizeType pixel_size;
+        IceTByte *auxiliary_buffer
+            = icetImageGetAuxiliaryVoid(image, &pixel_size);
+        IceTSizeType row_size = width*pixel_size;
+
+      /* Clear out bottom. */
+        memset(auxiliary_buffer, 0, region[1]*row_size);
+      /* Clear out left and right. */
+        if ((region[0] > 0) || (region[0]+region[2] < width)) {
+            for (y = region[1]; y < region[1]+region[3]; y++) {
+                IceTByte *row = auxiliary_buffer + y*row_size;
+                memset(row, 0, region[0]*pixel_size);
+                memset(row + (region[0]+region[2])*pixel_size,
+                       0,
+                       (width - region[0] - region[2])*pixel_size);
+            }
+        }
+      /* Clear out top. */
+        memset(auxiliary_buffer + (region[1]+region[3])*row_size,
+               0,
+               (height - region[1] - region[3])*row_size);
+    }
 }
 
 void icetImagePackageForSend(IceTImage image,
@@ -1411,10 +1907,11 @@ void icetImagePackageForSend(IceTImage image,
                  "Attempting to package an image that is not a single buffer.");
     }
 
-    if (*size != icetImageBufferSizeType(icetImageGetColorFormat(image),
-                                         icetImageGetDepthFormat(image),
-                                         icetImageGetWidth(image),
-                                         icetImageGetHeight(image))) {
+    if (*size != imageBufferSize(icetImageGetColorFormat(image),
+                                 icetImageGetDepthFormat(image),
+                                 ICET_IMAGE_AUXILIARY_SIZE(image),
+                                 icetImageGetWidth(image),
+                                 icetImageGetHeight(image))) {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Inconsistent buffer size detected.");
     }
@@ -1464,9 +1961,10 @@ IceTImage icetImageUnpackageFromReceive(IceTVoid *buffer)
     if (magic_number == ICET_IMAGE_MAGIC_NUM) {
         IceTSizeType buffer_size =
                 ICET_IMAGE_HEADER(image)[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX];
-        if (   icetImageBufferSizeType(color_format, depth_format,
-                                       icetImageGetWidth(image),
-                                       icetImageGetHeight(image))
+        if (   imageBufferSize(color_format, depth_format,
+                               ICET_IMAGE_AUXILIARY_SIZE(image),
+                               icetImageGetWidth(image),
+                               icetImageGetHeight(image))
             != buffer_size ) {
             icetRaiseError(ICET_INVALID_VALUE,
                            "Inconsistent sizes in image data.");
@@ -1550,9 +2048,10 @@ IceTSparseImage icetSparseImageUnpackageFromReceive(IceTVoid *buffer)
         return image;
     }
 
-    if (   icetSparseImageBufferSizeType(color_format, depth_format,
-                                         icetSparseImageGetWidth(image),
-                                         icetSparseImageGetHeight(image))
+    if (   sparseImageBufferSize(color_format, depth_format,
+                                 ICET_IMAGE_AUXILIARY_SIZE(image),
+                                 icetSparseImageGetWidth(image),
+                                 icetSparseImageGetHeight(image))
          < ICET_IMAGE_HEADER(image)[ICET_IMAGE_ACTUAL_BUFFER_SIZE_INDEX] ) {
         icetRaiseError(ICET_INVALID_VALUE, "Inconsistent sizes in image data.");
         image.opaque_internals = NULL;
@@ -1749,7 +2248,9 @@ void icetSparseImageCopyPixels(const IceTSparseImage in_image,
     color_format = icetSparseImageGetColorFormat(in_image);
     depth_format = icetSparseImageGetDepthFormat(in_image);
     if (   (color_format != icetSparseImageGetColorFormat(out_image))
-        || (depth_format != icetSparseImageGetDepthFormat(out_image)) ) {
+        || (depth_format != icetSparseImageGetDepthFormat(out_image))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+            != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
         icetRaiseError(ICET_INVALID_VALUE,
                        "Cannot copy pixels of images with different formats.");
         icetTimingCompressEnd();
@@ -1786,7 +2287,7 @@ void icetSparseImageCopyPixels(const IceTSparseImage in_image,
         return;
     }
 
-    pixel_size = colorPixelSize(color_format) + depthPixelSize(depth_format);
+    pixel_size = sparseImagePixelSize(in_image);
 
     in_data = ICET_IMAGE_DATA(in_image);
     start_inactive = start_active = 0;
@@ -1809,99 +2310,492 @@ void icetSparseImageCopyPixels(const IceTSparseImage in_image,
     icetTimingCompressEnd();
 }
 
-IceTSizeType icetSparseImageSplitPartitionNumPixels(
-                                                IceTSizeType input_num_pixels,
-                                                IceTInt num_partitions,
-                                                IceTInt eventual_num_partitions)
+IceTSizeType icetSparseImageOpacityMaskBufferSize(IceTSizeType num_pixels)
 {
-    IceTInt sub_partitions = eventual_num_partitions/num_partitions;
-
-#ifdef DEBUG
-    if (eventual_num_partitions%num_partitions != 0) {
-        icetRaiseError(ICET_INVALID_VALUE,
-                       "num_partitions not a factor"
-                       " of eventual_num_partitions.");
-    }
-#endif
-
-    return input_num_pixels/num_partitions + sub_partitions;
+    /* A new run pair starts only where a non-opaque pixel follows an opaque
+       one, so there can be no more than one pair for every two pixels plus the
+       leading pair. */
+    return (num_pixels/2 + 2)*RUN_LENGTH_SIZE;
 }
 
-static void icetSparseImageSplitChoosePartitions(
-                                                IceTInt num_partitions,
-                                                IceTInt eventual_num_partitions,
-                                                IceTSizeType size,
-                                                IceTSizeType first_offset,
-                                                IceTSizeType *offsets)
+IceTSizeType icetSparseImageGetOpacityMask(const IceTSparseImage image,
+                                           IceTVoid *mask_buffer)
 {
-    IceTSizeType remainder = size%eventual_num_partitions;
-    IceTInt sub_partitions = eventual_num_partitions/num_partitions;
-    IceTSizeType partition_lower_size
-        = (size/eventual_num_partitions)*sub_partitions;
-    IceTSizeType this_offset = first_offset;
-    IceTInt partition_idx;
+    IceTEnum color_format;
+    IceTSizeType pixel_size;
+    IceTSizeType pixels_left;
+    const IceTByte *in_data;
+    IceTByte *mask_data;
+    IceTVoid *last_mask_run;
 
-#ifdef DEBUG
-    if (eventual_num_partitions%num_partitions != 0) {
-        icetRaiseError(ICET_INVALID_VALUE,
-                       "num_partitions not a factor"
-                       " of eventual_num_partitions.");
-    }
-#endif
+    icetTimingCompressBegin();
 
-    for (partition_idx = 0; partition_idx < num_partitions; partition_idx++) {
-        offsets[partition_idx] = this_offset;
-        this_offset += partition_lower_size;
-        if (remainder > sub_partitions) {
-            this_offset += sub_partitions;
-            remainder -= sub_partitions;
-        } else {
-            this_offset += remainder;
-            remainder = 0;
+    color_format = icetSparseImageGetColorFormat(image);
+    pixel_size = sparseImagePixelSize(image);
+    pixels_left = icetSparseImageGetNumPixels(image);
+
+    in_data = ICET_IMAGE_DATA(image);
+    mask_data = mask_buffer;
+    last_mask_run = mask_data;
+    INACTIVE_RUN_LENGTH(last_mask_run) = 0;
+    ACTIVE_RUN_LENGTH(last_mask_run) = 0;
+    mask_data += RUN_LENGTH_SIZE;
+
+#define MASK_ADD_CLEAR(count)                                           \
+    if (ACTIVE_RUN_LENGTH(last_mask_run) > 0) {                         \
+        last_mask_run = mask_data;                                      \
+        INACTIVE_RUN_LENGTH(last_mask_run) = 0;                         \
+        ACTIVE_RUN_LENGTH(last_mask_run) = 0;                           \
+        mask_data += RUN_LENGTH_SIZE;                                   \
+    }                                                                   \
+    INACTIVE_RUN_LENGTH(last_mask_run) += (IceTRunLengthType)(count);
+
+    while (pixels_left > 0) {
+        IceTSizeType inactive = INACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType active = ACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType i;
+
+        in_data += RUN_LENGTH_SIZE;
+        pixels_left -= inactive + active;
+        if (pixels_left < 0) {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Corrupt sparse image: run lengths exceed size.");
+            break;
+        }
+
+        if (inactive > 0) {
+            MASK_ADD_CLEAR(inactive);
+        }
+
+        for (i = 0; i < active; i++) {
+            IceTBoolean opaque;
+            if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                opaque = (((const IceTUByte *)in_data)[3] == 255);
+            } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+                opaque = (((const IceTFloat *)in_data)[3] >= 1.0f);
+            } else {
+                opaque = ICET_FALSE;
+            }
+
+            if (opaque) {
+                ACTIVE_RUN_LENGTH(last_mask_run)++;
+            } else {
+                MASK_ADD_CLEAR(1);
+            }
+            in_data += pixel_size;
         }
     }
+
+#undef MASK_ADD_CLEAR
+
+    icetTimingCompressEnd();
+
+    return (IceTSizeType)(mask_data - (IceTByte *)mask_buffer);
 }
 
-void icetSparseImageSplit(const IceTSparseImage in_image,
-                          IceTSizeType in_image_offset,
-                          IceTInt num_partitions,
-                          IceTInt eventual_num_partitions,
-                          IceTSparseImage *out_images,
-                          IceTSizeType *offsets)
+void icetSparseImageCullOpaque(const IceTSparseImage in_image,
+                               const IceTVoid *mask_buffer,
+                               IceTSparseImage out_image)
 {
-    IceTSizeType total_num_pixels;
-
     IceTEnum color_format;
     IceTEnum depth_format;
     IceTSizeType pixel_size;
-
-    const IceTVoid *in_data;
-    IceTSizeType start_inactive;
-    IceTSizeType start_active;
-
-    IceTInt partition;
+    IceTSizeType pixels_left;
+    const IceTByte *in_data;
+    const IceTByte *mask_data;
+    IceTSizeType mask_clear;
+    IceTSizeType mask_opaque;
+    IceTByte *out_data;
+    IceTVoid *last_out_run;
 
     icetTimingCompressBegin();
 
-    if (num_partitions < 2) {
+    color_format = icetSparseImageGetColorFormat(in_image);
+    depth_format = icetSparseImageGetDepthFormat(in_image);
+    if (   (color_format != icetSparseImageGetColorFormat(out_image))
+        || (depth_format != icetSparseImageGetDepthFormat(out_image))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+            != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
         icetRaiseError(ICET_INVALID_VALUE,
-                       "It does not make sense to call icetSparseImageSplit"
-                       " with less than 2 partitions.");
+                       "Cannot cull pixels of images with different formats.");
         icetTimingCompressEnd();
         return;
     }
+    pixel_size = sparseImagePixelSize(in_image);
+    pixels_left = icetSparseImageGetNumPixels(in_image);
 
-    total_num_pixels = icetSparseImageGetNumPixels(in_image);
-
-    color_format = icetSparseImageGetColorFormat(in_image);
-    depth_format = icetSparseImageGetDepthFormat(in_image);
-    pixel_size = colorPixelSize(color_format) + depthPixelSize(depth_format);
+    icetSparseImageSetDimensions(out_image,
+                                 icetSparseImageGetWidth(in_image),
+                                 icetSparseImageGetHeight(in_image));
 
     in_data = ICET_IMAGE_DATA(in_image);
-    start_inactive = start_active = 0;
+    mask_data = mask_buffer;
+    mask_clear = mask_opaque = 0;
+    out_data = ICET_IMAGE_DATA(out_image);
+    last_out_run = out_data;
+    INACTIVE_RUN_LENGTH(last_out_run) = 0;
+    ACTIVE_RUN_LENGTH(last_out_run) = 0;
+    out_data += RUN_LENGTH_SIZE;
+
+#define MASK_NEXT_RUN()                                                 \
+    while ((mask_clear == 0) && (mask_opaque == 0)) {                   \
+        mask_clear = INACTIVE_RUN_LENGTH(mask_data);                    \
+        mask_opaque = ACTIVE_RUN_LENGTH(mask_data);                     \
+        mask_data += RUN_LENGTH_SIZE;                                   \
+    }
+#define OUT_ADD_INACTIVE(count)                                         \
+    if (ACTIVE_RUN_LENGTH(last_out_run) > 0) {                          \
+        last_out_run = out_data;                                        \
+        INACTIVE_RUN_LENGTH(last_out_run) = 0;                          \
+        ACTIVE_RUN_LENGTH(last_out_run) = 0;                            \
+        out_data += RUN_LENGTH_SIZE;                                    \
+    }                                                                   \
+    INACTIVE_RUN_LENGTH(last_out_run) += (IceTRunLengthType)(count);
 
-    icetSparseImageSplitChoosePartitions(num_partitions,
-                                         eventual_num_partitions,
+    while (pixels_left > 0) {
+        IceTSizeType inactive = INACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType active = ACTIVE_RUN_LENGTH(in_data);
+
+        in_data += RUN_LENGTH_SIZE;
+        pixels_left -= inactive + active;
+        if (pixels_left < 0) {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Corrupt sparse image: run lengths exceed size.");
+            break;
+        }
+
+        /* Inactive pixels stay inactive.  Just advance the mask past them. */
+        if (inactive > 0) {
+            OUT_ADD_INACTIVE(inactive);
+        }
+        while (inactive > 0) {
+            IceTSizeType count;
+            MASK_NEXT_RUN();
+            if (mask_clear > 0) {
+                count = MIN(inactive, mask_clear);
+                mask_clear -= count;
+            } else {
+                count = MIN(inactive, mask_opaque);
+                mask_opaque -= count;
+            }
+            inactive -= count;
+        }
+
+        /* Active pixels are copied unless they are hidden behind an opaque
+           pixel, in which case they become inactive. */
+        while (active > 0) {
+            IceTSizeType count;
+            MASK_NEXT_RUN();
+            if (mask_clear > 0) {
+                count = MIN(active, mask_clear);
+                memcpy(out_data, in_data, count*pixel_size);
+                out_data += count*pixel_size;
+                ACTIVE_RUN_LENGTH(last_out_run) += (IceTRunLengthType)count;
+                mask_clear -= count;
+            } else {
+                count = MIN(active, mask_opaque);
+                OUT_ADD_INACTIVE(count);
+                mask_opaque -= count;
+            }
+            in_data += count*pixel_size;
+            active -= count;
+        }
+    }
+
+#undef MASK_NEXT_RUN
+#undef OUT_ADD_INACTIVE
+
+    icetSparseImageSetActualSize(out_image, out_data);
+
+    icetTimingCompressEnd();
+}
+
+IceTSizeType icetSparseImageNumDepthBlocks(const IceTSparseImage image,
+                                           IceTSizeType block_size)
+{
+    IceTSizeType width = icetSparseImageGetWidth(image);
+    IceTSizeType height = icetSparseImageGetHeight(image);
+
+    return (  ((width + block_size - 1)/block_size)
+            * ((height + block_size - 1)/block_size) );
+}
+
+void icetSparseImageGetBlockMaxDepth(const IceTSparseImage image,
+                                     IceTSizeType block_size,
+                                     IceTFloat *block_depths)
+{
+    IceTEnum color_format;
+    IceTEnum depth_format;
+    IceTSizeType color_size;
+    IceTSizeType pixel_size;
+    IceTSizeType width;
+    IceTSizeType blocks_wide;
+    IceTSizeType num_blocks;
+    IceTSizeType num_pixels;
+    IceTSizeType pixel;
+    IceTSizeType i;
+    const IceTByte *in_data;
+
+    color_format = icetSparseImageGetColorFormat(image);
+    depth_format = icetSparseImageGetDepthFormat(image);
+    if (depth_format != ICET_IMAGE_DEPTH_FLOAT) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Depth format is 0x%X, need ICET_IMAGE_DEPTH_FLOAT.",
+                       depth_format);
+        return;
+    }
+
+    icetTimingCompressBegin();
+
+    color_size = colorPixelSize(color_format);
+    pixel_size = sparseImagePixelSize(image);
+    width = icetSparseImageGetWidth(image);
+    blocks_wide = (width + block_size - 1)/block_size;
+    num_blocks = icetSparseImageNumDepthBlocks(image, block_size);
+    num_pixels = icetSparseImageGetNumPixels(image);
+
+    for (i = 0; i < num_blocks; i++) {
+        block_depths[i] = 0.0f;
+    }
+
+    in_data = ICET_IMAGE_DATA(image);
+    pixel = 0;
+    while (pixel < num_pixels) {
+        IceTSizeType inactive = INACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType active = ACTIVE_RUN_LENGTH(in_data);
+
+        in_data += RUN_LENGTH_SIZE;
+        if (pixel + inactive + active > num_pixels) {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Corrupt sparse image: run lengths exceed size.");
+            break;
+        }
+
+        /* Inactive pixels are cleared to the far plane.  Mark each block they
+           touch one row segment at a time. */
+        while (inactive > 0) {
+            IceTSizeType x = pixel%width;
+            IceTSizeType count = MIN(inactive,
+                                     MIN(block_size - x%block_size, width - x));
+            block_depths[(pixel/width/block_size)*blocks_wide + x/block_size]
+                = 1.0f;
+            pixel += count;
+            inactive -= count;
+        }
+
+        for (i = 0; i < active; i++) {
+            IceTSizeType block = (  (pixel/width/block_size)*blocks_wide
+                                  + (pixel%width)/block_size );
+            IceTFloat depth = *((const IceTFloat *)(in_data + color_size));
+            if (block_depths[block] < depth) {
+                block_depths[block] = depth;
+            }
+            in_data += pixel_size;
+            pixel++;
+        }
+    }
+
+    icetTimingCompressEnd();
+}
+
+void icetSparseImageCullDepthBlocks(const IceTSparseImage in_image,
+                                    IceTSizeType block_size,
+                                    const IceTFloat *block_depths,
+                                    IceTSparseImage out_image)
+{
+    IceTEnum color_format;
+    IceTEnum depth_format;
+    IceTSizeType color_size;
+    IceTSizeType pixel_size;
+    IceTSizeType width;
+    IceTSizeType blocks_wide;
+    IceTSizeType num_pixels;
+    IceTSizeType pixel;
+    const IceTByte *in_data;
+    IceTByte *out_data;
+    IceTVoid *last_out_run;
+
+    color_format = icetSparseImageGetColorFormat(in_image);
+    depth_format = icetSparseImageGetDepthFormat(in_image);
+    if (   (color_format != icetSparseImageGetColorFormat(out_image))
+        || (depth_format != icetSparseImageGetDepthFormat(out_image))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+            != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Cannot cull pixels of images with different formats.");
+        return;
+    }
+    if (depth_format != ICET_IMAGE_DEPTH_FLOAT) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Depth format is 0x%X, need ICET_IMAGE_DEPTH_FLOAT.",
+                       depth_format);
+        return;
+    }
+
+    icetTimingCompressBegin();
+
+    color_size = colorPixelSize(color_format);
+    pixel_size = sparseImagePixelSize(in_image);
+    width = icetSparseImageGetWidth(in_image);
+    blocks_wide = (width + block_size - 1)/block_size;
+    num_pixels = icetSparseImageGetNumPixels(in_image);
+
+    icetSparseImageSetDimensions(out_image,
+                                 width,
+                                 icetSparseImageGetHeight(in_image));
+
+    in_data = ICET_IMAGE_DATA(in_image);
+    out_data = ICET_IMAGE_DATA(out_image);
+    last_out_run = out_data;
+    INACTIVE_RUN_LENGTH(last_out_run) = 0;
+    ACTIVE_RUN_LENGTH(last_out_run) = 0;
+    out_data += RUN_LENGTH_SIZE;
+
+#define OUT_ADD_INACTIVE(count)                                         \
+    if (ACTIVE_RUN_LENGTH(last_out_run) > 0) {                          \
+        last_out_run = out_data;                                        \
+        INACTIVE_RUN_LENGTH(last_out_run) = 0;                          \
+        ACTIVE_RUN_LENGTH(last_out_run) = 0;                            \
+        out_data += RUN_LENGTH_SIZE;                                    \
+    }                                                                   \
+    INACTIVE_RUN_LENGTH(last_out_run) += (IceTRunLengthType)(count);
+
+    pixel = 0;
+    while (pixel < num_pixels) {
+        IceTSizeType inactive = INACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType active = ACTIVE_RUN_LENGTH(in_data);
+        IceTSizeType i;
+
+        in_data += RUN_LENGTH_SIZE;
+        if (pixel + inactive + active > num_pixels) {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Corrupt sparse image: run lengths exceed size.");
+            break;
+        }
+
+        if (inactive > 0) {
+            OUT_ADD_INACTIVE(inactive);
+            pixel += inactive;
+        }
+
+        /* An active pixel behind the farthest pixel some process has in the
+           same block can never be visible, so make it inactive. */
+        for (i = 0; i < active; i++) {
+            IceTSizeType block = (  (pixel/width/block_size)*blocks_wide
+                                  + (pixel%width)/block_size );
+            IceTFloat depth = *((const IceTFloat *)(in_data + color_size));
+            if (depth > block_depths[block]) {
+                OUT_ADD_INACTIVE(1);
+            } else {
+                memcpy(out_data, in_data, pixel_size);
+                out_data += pixel_size;
+                ACTIVE_RUN_LENGTH(last_out_run)++;
+            }
+            in_data += pixel_size;
+            pixel++;
+        }
+    }
+
+#undef OUT_ADD_INACTIVE
+
+    icetSparseImageSetActualSize(out_image, out_data);
+
+    icetTimingCompressEnd();
+}
+
+IceTSizeType icetSparseImageSplitPartitionNumPixels(
+                                                IceTSizeType input_num_pixels,
+                                                IceTInt num_partitions,
+                                                IceTInt eventual_num_partitions)
+{
+    IceTInt sub_partitions = eventual_num_partitions/num_partitions;
+
+#ifdef DEBUG
+    if (eventual_num_partitions%num_partitions != 0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "num_partitions not a factor"
+                       " of eventual_num_partitions.");
+    }
+#endif
+
+    return input_num_pixels/num_partitions + sub_partitions;
+}
+
+static void icetSparseImageSplitChoosePartitions(
+                                                IceTInt num_partitions,
+                                                IceTInt eventual_num_partitions,
+                                                IceTSizeType size,
+                                                IceTSizeType first_offset,
+                                                IceTSizeType *offsets)
+{
+    IceTSizeType remainder = size%eventual_num_partitions;
+    IceTInt sub_partitions = eventual_num_partitions/num_partitions;
+    IceTSizeType partition_lower_size
+        = (size/eventual_num_partitions)*sub_partitions;
+    IceTSizeType this_offset = first_offset;
+    IceTInt partition_idx;
+
+#ifdef DEBUG
+    if (eventual_num_partitions%num_partitions != 0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "num_partitions not a factor"
+                       " of eventual_num_partitions.");
+    }
+#endif
+
+    for (partition_idx = 0; partition_idx < num_partitions; partition_idx++) {
+        offsets[partition_idx] = this_offset;
+        this_offset += partition_lower_size;
+        if (remainder > sub_partitions) {
+            this_offset += sub_partitions;
+            remainder -= sub_partitions;
+        } else {
+            this_offset += remainder;
+            remainder = 0;
+        }
+    }
+}
+
+void icetSparseImageSplit(const IceTSparseImage in_image,
+                          IceTSizeType in_image_offset,
+                          IceTInt num_partitions,
+                          IceTInt eventual_num_partitions,
+                          IceTSparseImage *out_images,
+                          IceTSizeType *offsets)
+{
+    IceTSizeType total_num_pixels;
+
+    IceTEnum color_format;
+    IceTEnum depth_format;
+    IceTSizeType pixel_size;
+
+    const IceTVoid *in_data;
+    IceTSizeType start_inactive;
+    IceTSizeType start_active;
+
+    IceTInt partition;
+
+    icetTimingCompressBegin();
+
+    if (num_partitions < 2) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "It does not make sense to call icetSparseImageSplit"
+                       " with less than 2 partitions.");
+        icetTimingCompressEnd();
+        return;
+    }
+
+    total_num_pixels = icetSparseImageGetNumPixels(in_image);
+
+    color_format = icetSparseImageGetColorFormat(in_image);
+    depth_format = icetSparseImageGetDepthFormat(in_image);
+    pixel_size = sparseImagePixelSize(in_image);
+
+    in_data = ICET_IMAGE_DATA(in_image);
+    start_inactive = start_active = 0;
+
+    icetSparseImageSplitChoosePartitions(num_partitions,
+                                         eventual_num_partitions,
                                          total_num_pixels,
                                          in_image_offset,
                                          offsets);
@@ -1911,7 +2805,9 @@ void icetSparseImageSplit(const IceTSparseImage in_image,
         IceTSizeType partition_num_pixels;
 
         if (   (color_format != icetSparseImageGetColorFormat(out_image))
-            || (depth_format != icetSparseImageGetDepthFormat(out_image)) ) {
+            || (depth_format != icetSparseImageGetDepthFormat(out_image))
+            || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+                != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
             icetRaiseError(ICET_INVALID_VALUE,
                            "Cannot copy pixels of images with different"
                            " formats.");
@@ -1988,7 +2884,9 @@ void icetSparseImageInterlace(const IceTSparseImage in_image,
     }
 
     if (   (color_format != icetSparseImageGetColorFormat(out_image))
-        || (depth_format != icetSparseImageGetDepthFormat(out_image)) ) {
+        || (depth_format != icetSparseImageGetDepthFormat(out_image))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(in_image)
+            != ICET_IMAGE_AUXILIARY_SIZE(out_image) ) ) {
         icetRaiseError(ICET_INVALID_VALUE,
                        "Cannot copy pixels of images with different formats.");
         return;
@@ -1996,7 +2894,7 @@ void icetSparseImageInterlace(const IceTSparseImage in_image,
 
     icetTimingInterlaceBegin();
 
-    pixel_size = colorPixelSize(color_format) + depthPixelSize(depth_format);
+    pixel_size = sparseImagePixelSize(in_image);
 
     {
         IceTByte *buffer = icetGetStateBuffer(
@@ -2212,6 +3110,117 @@ void icetSetDepthFormat(IceTEnum depth_format)
     }
 }
 
+void icetSetAuxiliaryChannels(IceTInt num_channels,
+                              const IceTEnum *types,
+                              const IceTInt *counts)
+{
+    IceTBoolean isDrawing;
+    IceTInt *offsets;
+    IceTInt pixel_size;
+    IceTInt channel;
+
+    icetGetBooleanv(ICET_IS_DRAWING_FRAME, &isDrawing);
+    if (isDrawing) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Attempted to change the auxiliary channels while"
+                       " drawing. This probably means that you called"
+                       " icetSetAuxiliaryChannels in a drawing callback. You"
+                       " cannot do that. Call this function before starting"
+                       " the draw operation.");
+        return;
+    }
+
+    if (num_channels < 0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Invalid number of auxiliary channels: %d.",
+                       num_channels);
+        return;
+    }
+
+    for (channel = 0; channel < num_channels; channel++) {
+        if (   (types[channel] != ICET_BYTE)
+            && (types[channel] != ICET_SHORT)
+            && (types[channel] != ICET_INT)
+            && (types[channel] != ICET_FLOAT) ) {
+            icetRaiseError(ICET_INVALID_ENUM,
+                           "Invalid type 0x%X for auxiliary channel %d.",
+                           types[channel], channel);
+            return;
+        }
+        if (counts[channel] < 1) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Auxiliary channel %d needs at least one value.",
+                           channel);
+            return;
+        }
+    }
+
+    /* The channels are interleaved in the order given.  The pixel is padded
+     * to a whole number of words so that the pixels after it (and the depth
+     * of the next pixel of a sparse image) stay aligned. */
+    offsets = icetStateAllocateInteger(ICET_AUXILIARY_CHANNEL_OFFSETS,
+                                       num_channels);
+    pixel_size = 0;
+    for (channel = 0; channel < num_channels; channel++) {
+        offsets[channel] = pixel_size;
+        pixel_size += icetTypeWidth(types[channel])*counts[channel];
+    }
+    pixel_size = (  (pixel_size + (IceTInt)sizeof(IceTFloat) - 1)
+                  / (IceTInt)sizeof(IceTFloat) ) * (IceTInt)sizeof(IceTFloat);
+
+    icetStateSetInteger(ICET_NUM_AUXILIARY_CHANNELS, num_channels);
+    icetStateSetIntegerv(ICET_AUXILIARY_CHANNEL_TYPES,
+                         num_channels,
+                         (const IceTInt *)types);
+    icetStateSetIntegerv(ICET_AUXILIARY_CHANNEL_COUNTS, num_channels, counts);
+    icetStateSetInteger(ICET_AUXILIARY_PIXEL_SIZE, pixel_size);
+}
+
+void icetInputBufferLayout(IceTEnum buffer,
+                           IceTSizeType pixel_stride,
+                           IceTSizeType row_stride,
+                           IceTEnum row_order)
+{
+    IceTInt layout[3];
+
+    if ((pixel_stride < 0) || (row_stride < 0)) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Input buffer strides cannot be negative.");
+        return;
+    }
+    if (   (pixel_stride%sizeof(IceTFloat) != 0)
+        || (row_stride%sizeof(IceTFloat) != 0) ) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Input buffer strides must be a multiple of %d bytes"
+                       " to keep pixel values aligned.",
+                       (int)sizeof(IceTFloat));
+        return;
+    }
+    if (   (row_order != ICET_ROWS_BOTTOM_UP)
+        && (row_order != ICET_ROWS_TOP_DOWN) ) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid row order 0x%X.", row_order);
+        return;
+    }
+
+    layout[0] = pixel_stride;
+    layout[1] = row_stride;
+    layout[2] = (IceTInt)row_order;
+
+    switch (buffer) {
+      case ICET_INPUT_COLOR_BUFFER:
+          icetStateSetIntegerv(ICET_INPUT_COLOR_LAYOUT, 3, layout);
+          break;
+      case ICET_INPUT_DEPTH_BUFFER:
+          icetStateSetIntegerv(ICET_INPUT_DEPTH_LAYOUT, 3, layout);
+          break;
+      default:
+          icetRaiseError(ICET_INVALID_ENUM,
+                         "Invalid input buffer 0x%X.", buffer);
+          break;
+    }
+}
+
 void icetGetTileImage(IceTInt tile, IceTImage image)
 {
     IceTInt screen_viewport[4], target_viewport[4];
@@ -2219,11 +3228,17 @@ void icetGetTileImage(IceTInt tile, IceTImage image)
     IceTSizeType width, height;
     IceTImage rendered_image;
 
-    viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     width = viewports[4*tile+2];
     height = viewports[4*tile+3];
     icetImageSetDimensions(image, width, height);
 
+    if (icetStateGetNumEntries(ICET_RENDER_SPANS) == 4) {
+        prerenderedTileViewports(tile, screen_viewport, target_viewport);
+        prerenderedFullTile(tile, screen_viewport, target_viewport, image);
+        return;
+    }
+
     rendered_image =
             generateTile(tile, screen_viewport, target_viewport, image);
 
@@ -2276,10 +3291,18 @@ IceTSparseImage icetGetCompressedTileImage(IceTInt tile)
     const IceTInt *viewports;
     IceTSizeType width, height;
 
-    viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     width = viewports[4*tile+2];
     height = viewports[4*tile+3];
 
+    if (icetStateGetNumEntries(ICET_RENDER_SPANS) == 4) {
+        /* The application gave spans of active pixels, which can be packed
+           into the tile without ever forming a full image. */
+        prerenderedTileViewports(tile, screen_viewport, target_viewport);
+        return prerenderedSparseTile(
+                    tile, screen_viewport, target_viewport, width, height);
+    }
+
     raw_image = generateTile(tile, screen_viewport, target_viewport,
                              icetImageNull());
 
@@ -2469,7 +3492,9 @@ void icetComposite(IceTImage destBuffer, const IceTImage srcBuffer,
     depth_format = icetImageGetDepthFormat(destBuffer);
 
     if (   (color_format != icetImageGetColorFormat(srcBuffer))
-        || (depth_format != icetImageGetDepthFormat(srcBuffer)) ) {
+        || (depth_format != icetImageGetDepthFormat(srcBuffer))
+        || (   ICET_IMAGE_AUXILIARY_SIZE(srcBuffer)
+            != ICET_IMAGE_AUXILIARY_SIZE(destBuffer) ) ) {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Source and destination types don't match.");
         return;
@@ -2483,8 +3508,31 @@ void icetComposite(IceTImage destBuffer, const IceTImage srcBuffer,
         if (depth_format == ICET_IMAGE_DEPTH_FLOAT) {
             const IceTFloat *srcDepthBuffer = icetImageGetDepthf(srcBuffer);
             IceTFloat *destDepthBuffer = icetImageGetDepthf(destBuffer);
-
-            if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTSizeType auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(destBuffer);
+
+            if (auxiliary_size > 0) {
+                /* Auxiliary channels are copied with the winning depth. */
+                IceTSizeType color_size;
+                const IceTByte *srcColorBuffer
+                    = icetImageGetColorConstVoid(srcBuffer, &color_size);
+                IceTByte *destColorBuffer
+                    = icetImageGetColorVoid(destBuffer, NULL);
+                const IceTByte *srcAuxiliaryBuffer
+                    = icetImageGetAuxiliaryConstVoid(srcBuffer, NULL);
+                IceTByte *destAuxiliaryBuffer
+                    = icetImageGetAuxiliaryVoid(destBuffer, NULL);
+                for (i = 0; i < pixels; i++) {
+                    if (srcDepthBuffer[i] < destDepthBuffer[i]) {
+                        destDepthBuffer[i] = srcDepthBuffer[i];
+                        memcpy(destColorBuffer + color_size*i,
+                               srcColorBuffer + color_size*i,
+                               color_size);
+                        memcpy(destAuxiliaryBuffer + auxiliary_size*i,
+                               srcAuxiliaryBuffer + auxiliary_size*i,
+                               auxiliary_size);
+                    }
+                }
+            } else if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
                 const IceTUInt *srcColorBuffer=icetImageGetColorui(srcBuffer);
                 IceTUInt *destColorBuffer = icetImageGetColorui(destBuffer);
                 for (i = 0; i < pixels; i++) {
@@ -2590,6 +3638,63 @@ void icetComposite(IceTImage destBuffer, const IceTImage srcBuffer,
             icetRaiseError(ICET_SANITY_CHECK_FAIL,
                            "Encountered invalid color format.");
         }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(composite_mode)) {
+      /* The order of the images does not matter, so srcOnTop is ignored.
+       * Each mode gets its own loop so that the compiler can vectorize it. */
+        if (depth_format != ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseWarning(ICET_INVALID_VALUE,
+                             "Z buffer ignored during reduction composite"
+                             " operation.  Output z buffer meaningless.");
+        }
+        if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            const IceTUByte *srcColorBuffer = icetImageGetColorcub(srcBuffer);
+            IceTUByte *destColorBuffer = icetImageGetColorub(destBuffer);
+            if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+                for (i = 0; i < pixels; i++) {
+                    ICET_MAX_UBYTE(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+                for (i = 0; i < pixels; i++) {
+                    ICET_MIN_UBYTE(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            } else {
+                for (i = 0; i < pixels; i++) {
+                    ICET_ADD_UBYTE(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            const IceTFloat *srcColorBuffer = icetImageGetColorcf(srcBuffer);
+            IceTFloat *destColorBuffer = icetImageGetColorf(destBuffer);
+            if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+                for (i = 0; i < pixels; i++) {
+                    ICET_MAX_FLOAT(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+                for (i = 0; i < pixels; i++) {
+                    ICET_MIN_FLOAT(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            } else {
+                for (i = 0; i < pixels; i++) {
+                    ICET_ADD_FLOAT(srcColorBuffer + i*4,
+                                   destColorBuffer + i*4);
+                }
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Cannot use reduction composite without alpha"
+                           " channel.");
+        } else if (color_format == ICET_IMAGE_COLOR_NONE) {
+            icetRaiseWarning(ICET_INVALID_OPERATION,
+                             "Compositing image with no data.");
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format.");
+        }
     } else {
         icetRaiseError(ICET_SANITY_CHECK_FAIL,
                        "Encountered invalid composite mode.");
@@ -2642,6 +3747,316 @@ void icetCompressedSubComposite(IceTImage destBuffer,
     icetTimingBlendEnd();
 }
 
+/* The most images composited in one pass by icetCompressedCompositeMany.
+   Limits the walker state kept on the stack. */
+#define ICET_COMPOSITE_MANY_MAX 16
+
+static void icetCompressedCompositeManyPass(IceTImage destBuffer,
+                                            const IceTSparseImage *srcBuffers,
+                                            IceTInt numSrc,
+                                            int srcOnTop)
+{
+    IceTEnum color_format = icetImageGetColorFormat(destBuffer);
+    IceTEnum depth_format = icetImageGetDepthFormat(destBuffer);
+    IceTSizeType num_pixels = icetImageGetNumPixels(destBuffer);
+    IceTSizeType auxiliary_size = ICET_IMAGE_AUXILIARY_SIZE(destBuffer);
+    IceTEnum composite_mode;
+
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+
+    if (composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
+        IceTFloat *depth;
+        if (depth_format != ICET_IMAGE_DEPTH_FLOAT) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Cannot use Z buffer compositing operation with no"
+                           " Z buffer.");
+            return;
+        }
+        depth = icetImageGetDepthf(destBuffer);
+        if (auxiliary_size > 0) {
+            /* Auxiliary channels are copied with the winning depth. */
+            IceTSizeType color_size = colorPixelSize(color_format);
+            IceTByte *color = icetImageGetColorVoid(destBuffer, NULL);
+            IceTByte *auxiliary = icetImageGetAuxiliaryVoid(destBuffer, NULL);
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (color_size+sizeof(IceTFloat)+auxiliary_size)
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_d_in                                  \
+                    = (const IceTFloat *)(src + color_size);            \
+                if (_d_in[0] < depth[pixel]) {                          \
+                    memcpy(color + color_size*(pixel), src, color_size);\
+                    depth[pixel] = _d_in[0];                            \
+                    memcpy(auxiliary + auxiliary_size*(pixel),          \
+                           _d_in + 1,                                   \
+                           auxiliary_size);                             \
+                }                                                       \
+            }
+#include "cm_composite_template_body.h"
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTUInt *color = icetImageGetColorui(destBuffer);
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt) + sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_d_in                                  \
+                    = (const IceTFloat *)(src + sizeof(IceTUInt));      \
+                if (_d_in[0] < depth[pixel]) {                          \
+                    color[pixel] = ((const IceTUInt *)src)[0];          \
+                    depth[pixel] = _d_in[0];                            \
+                }                                                       \
+            }
+#include "cm_composite_template_body.h"
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            IceTFloat *color = icetImageGetColorf(destBuffer);
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (5*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_c_in = (const IceTFloat *)src;        \
+                if (_c_in[4] < depth[pixel]) {                          \
+                    IceTFloat *_c_out = color + 4*(pixel);              \
+                    _c_out[0] = _c_in[0];                               \
+                    _c_out[1] = _c_in[1];                               \
+                    _c_out[2] = _c_in[2];                               \
+                    _c_out[3] = _c_in[3];                               \
+                    depth[pixel] = _c_in[4];                            \
+                }                                                       \
+            }
+#include "cm_composite_template_body.h"
+        } else if (color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+            IceTFloat *color = icetImageGetColorf(destBuffer);
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_c_in = (const IceTFloat *)src;        \
+                if (_c_in[3] < depth[pixel]) {                          \
+                    IceTFloat *_c_out = color + 3*(pixel);              \
+                    _c_out[0] = _c_in[0];                               \
+                    _c_out[1] = _c_in[1];                               \
+                    _c_out[2] = _c_in[2];                               \
+                    depth[pixel] = _c_in[3];                            \
+                }                                                       \
+            }
+#include "cm_composite_template_body.h"
+        } else if (color_format == ICET_IMAGE_COLOR_NONE) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_d_in = (const IceTFloat *)src;        \
+                if (_d_in[0] < depth[pixel]) {                          \
+                    depth[pixel] = _d_in[0];                            \
+                }                                                       \
+            }
+#include "cm_composite_template_body.h"
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format 0x%X.",
+                           color_format);
+        }
+    } else if (composite_mode == ICET_COMPOSITE_MODE_BLEND) {
+        if (depth_format != ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseWarning(ICET_INVALID_VALUE,
+                             "Z buffer ignored during blend composite"
+                             " operation.  Output z buffer meaningless.");
+        }
+        if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTUByte *color = icetImageGetColorub(destBuffer);
+            if (srcOnTop) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_OVER_UBYTE(((const IceTUByte *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_UNDER_UBYTE(((const IceTUByte *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            IceTFloat *color = icetImageGetColorf(destBuffer);
+            if (srcOnTop) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_OVER_FLOAT(((const IceTFloat *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_UNDER_FLOAT(((const IceTFloat *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+          /* No alpha to blend with, so the pixels are just copied. */
+            IceTFloat *color = icetImageGetColorf(destBuffer);
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (3*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            {                                                           \
+                const IceTFloat *_c_in = (const IceTFloat *)src;        \
+                IceTFloat *_c_out = color + 3*(pixel);                  \
+                _c_out[0] = _c_in[0];                                   \
+                _c_out[1] = _c_in[1];                                   \
+                _c_out[2] = _c_in[2];                                   \
+            }
+#include "cm_composite_template_body.h"
+        } else if (color_format == ICET_IMAGE_COLOR_NONE) {
+            icetRaiseWarning(ICET_INVALID_OPERATION,
+                             "Decompressing image with no data.");
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format.");
+        }
+    } else if (ICET_COMPOSITE_MODE_IS_REDUCTION(composite_mode)) {
+        if (depth_format != ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseWarning(ICET_INVALID_VALUE,
+                             "Z buffer ignored during reduction composite"
+                             " operation.  Output z buffer meaningless.");
+        }
+        if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTUByte *color = icetImageGetColorub(destBuffer);
+            if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_MAX_UBYTE(((const IceTUByte *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_MIN_UBYTE(((const IceTUByte *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (sizeof(IceTUInt))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_ADD_UBYTE(((const IceTUByte *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            IceTFloat *color = icetImageGetColorf(destBuffer);
+            if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_MAX_FLOAT(((const IceTFloat *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_MIN_FLOAT(((const IceTFloat *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            } else {
+#define CM_COMPRESSED_IMAGES    srcBuffers
+#define CM_NUM_IMAGES           numSrc
+#define CM_NUM_PIXELS           num_pixels
+#define CM_PIXEL_SIZE           (4*sizeof(IceTFloat))
+#define CM_COMPOSITE(src, pixel)                                        \
+            ICET_ADD_FLOAT(((const IceTFloat *)src), (color + 4*(pixel)))
+#include "cm_composite_template_body.h"
+            }
+        } else if (color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Cannot use reduction composite without alpha"
+                           " channel.");
+        } else if (color_format == ICET_IMAGE_COLOR_NONE) {
+            icetRaiseWarning(ICET_INVALID_OPERATION,
+                             "Decompressing image with no data.");
+        } else {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Encountered invalid color format.");
+        }
+    } else {
+        icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                       "Encountered invalid composite mode.");
+    }
+}
+
+void icetCompressedCompositeMany(IceTImage destBuffer,
+                                 const IceTSparseImage *srcBuffers,
+                                 IceTInt numSrc,
+                                 int srcOnTop)
+{
+    IceTInt src;
+
+    for (src = 0; src < numSrc; src++) {
+        if (    icetImageGetNumPixels(destBuffer)
+             != icetSparseImageGetNumPixels(srcBuffers[src]) ) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Size of input and output buffers do not agree "
+                           "(%d != %d).",
+                           icetImageGetNumPixels(destBuffer),
+                           icetSparseImageGetNumPixels(srcBuffers[src]));
+            return;
+        }
+        if (   (   icetSparseImageGetColorFormat(srcBuffers[src])
+                != icetImageGetColorFormat(destBuffer) )
+            || (   icetSparseImageGetDepthFormat(srcBuffers[src])
+                != icetImageGetDepthFormat(destBuffer) )
+            || (   ICET_IMAGE_AUXILIARY_SIZE(srcBuffers[src])
+                != ICET_IMAGE_AUXILIARY_SIZE(destBuffer) ) ) {
+            icetRaiseError(ICET_SANITY_CHECK_FAIL,
+                           "Input/output buffers have different formats.");
+            return;
+        }
+    }
+
+    if (numSrc == 1) {
+        icetCompressedComposite(destBuffer, srcBuffers[0], srcOnTop);
+        return;
+    }
+
+    icetTimingBlendBegin();
+
+    for (src = 0; src < numSrc; src += ICET_COMPOSITE_MANY_MAX) {
+        icetCompressedCompositeManyPass(
+                                   destBuffer,
+                                   srcBuffers + src,
+                                   MIN(numSrc - src, ICET_COMPOSITE_MANY_MAX),
+                                   srcOnTop);
+    }
+
+    icetTimingBlendEnd();
+}
+
 void icetCompressedCompressedComposite(const IceTSparseImage front_buffer,
                                        const IceTSparseImage back_buffer,
                                        IceTSparseImage dest_buffer)
@@ -2669,12 +4084,14 @@ void icetImageCorrectBackground(IceTImage image)
     IceTBoolean need_correction;
     IceTSizeType num_pixels;
     IceTEnum color_format;
+    IceTEnum composite_mode;
 
     icetGetBooleanv(ICET_NEED_BACKGROUND_CORRECTION, &need_correction);
     if (!need_correction) { return; }
 
     num_pixels = icetImageGetNumPixels(image);
     color_format = icetImageGetColorFormat(image);
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
 
     icetTimingBlendBegin();
 
@@ -2688,9 +4105,26 @@ void icetImageCorrectBackground(IceTImage image)
                         &background_color_word);
         bc = (IceTUByte *)(&background_color_word);
 
-        for (p = 0; p < num_pixels; p++) {
-            ICET_UNDER_UBYTE(bc, color);
-            color += 4;
+        if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_MAX_UBYTE(bc, color);
+                color += 4;
+            }
+        } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_MIN_UBYTE(bc, color);
+                color += 4;
+            }
+        } else if (composite_mode == ICET_COMPOSITE_MODE_ADD) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_ADD_UBYTE(bc, color);
+                color += 4;
+            }
+        } else {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_UNDER_UBYTE(bc, color);
+                color += 4;
+            }
         }
     } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
         IceTFloat *color = icetImageGetColorf(image);
@@ -2699,9 +4133,26 @@ void icetImageCorrectBackground(IceTImage image)
 
         icetGetFloatv(ICET_TRUE_BACKGROUND_COLOR, background_color);
 
-        for (p = 0; p < num_pixels; p++) {
-            ICET_UNDER_FLOAT(background_color, color);
-            color += 4;
+        if (composite_mode == ICET_COMPOSITE_MODE_MAX) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_MAX_FLOAT(background_color, color);
+                color += 4;
+            }
+        } else if (composite_mode == ICET_COMPOSITE_MODE_MIN) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_MIN_FLOAT(background_color, color);
+                color += 4;
+            }
+        } else if (composite_mode == ICET_COMPOSITE_MODE_ADD) {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_ADD_FLOAT(background_color, color);
+                color += 4;
+            }
+        } else {
+            for (p = 0; p < num_pixels; p++) {
+                ICET_UNDER_FLOAT(background_color, color);
+                color += 4;
+            }
         }
     } else if (color_format == ICET_IMAGE_COLOR_RGB_FLOAT) {
       /* Nothing to fix. */
@@ -2743,12 +4194,15 @@ static IceTImage generateTile(int tile,
                               IceTImage tile_buffer)
 {
     IceTBoolean use_prerender;
+    IceTImage image;
     icetGetBooleanv(ICET_PRE_RENDERED, &use_prerender);
     if (use_prerender) {
-        return prerenderedTile(tile, screen_viewport, target_viewport);
+        image = prerenderedTile(tile, screen_viewport, target_viewport);
     } else {
-        return renderTile(tile, screen_viewport, target_viewport, tile_buffer);
+        image = renderTile(tile, screen_viewport, target_viewport, tile_buffer);
     }
+    icetCaptureTile(tile, image, screen_viewport, target_viewport);
+    return image;
 }
 
 static IceTImage renderTile(int tile,
@@ -2771,12 +4225,13 @@ static IceTImage renderTile(int tile,
 
     icetRaiseDebug("Rendering tile %d", tile);
     contained_viewport = icetUnsafeStateGetInteger(ICET_CONTAINED_VIEWPORT);
-    tile_viewport = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS) + 4*tile;
+    tile_viewport
+        = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS) + 4*tile;
     contained_mask = icetUnsafeStateGetBoolean(ICET_CONTAINED_TILES_MASK);
     use_floating_viewport = icetIsEnabled(ICET_FLOATING_VIEWPORT);
 
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &physical_width);
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &physical_height);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &physical_width);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &physical_height);
 
     icetRaiseDebug("contained viewport: %d %d %d %d",
                    (int)contained_viewport[0], (int)contained_viewport[1],
@@ -2984,13 +4439,29 @@ static IceTImage renderTile(int tile,
 static IceTImage prerenderedTile(int tile,
                                  IceTInt *screen_viewport,
                                  IceTInt *target_viewport)
+{
+    prerenderedTileViewports(tile, screen_viewport, target_viewport);
+
+    /* The views of icetCompositeImages and icetDrawFrames are stacked into
+       one image that is composited as a single frame. */
+    if (*icetUnsafeStateGetInteger(ICET_NUM_STACKED_VIEWS) > 0) {
+        return icetRetrieveStateImage(ICET_VIEW_STACK_BUFFER);
+    }
+
+    return icetRetrieveStateImage(ICET_RENDER_BUFFER);
+}
+
+static void prerenderedTileViewports(int tile,
+                                     IceTInt *screen_viewport,
+                                     IceTInt *target_viewport)
 {
     const IceTInt *contained_viewport;
     const IceTInt *tile_viewport;
 
     icetRaiseDebug("Getting viewport for tile %d in prerendered image", tile);
     contained_viewport = icetUnsafeStateGetInteger(ICET_CONTAINED_VIEWPORT);
-    tile_viewport = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS) + 4*tile;
+    tile_viewport
+        = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS) + 4*tile;
 
     /* The screen viewport is the intersection of the tile viewport with the
      * contained viewport. */
@@ -3003,8 +4474,216 @@ static IceTImage prerenderedTile(int tile,
     target_viewport[1] = screen_viewport[1] - tile_viewport[1];
     target_viewport[2] = screen_viewport[2];
     target_viewport[3] = screen_viewport[3];
+}
 
-    return icetRetrieveStateImage(ICET_RENDER_BUFFER);
+static IceTSparseImage prerenderedSparseTile(int tile,
+                                             const IceTInt *screen_viewport,
+                                             const IceTInt *target_viewport,
+                                             IceTSizeType tile_width,
+                                             IceTSizeType tile_height)
+{
+    const IceTVoid **span_pointers;
+    const IceTInt *row_span_starts;
+    const IceTInt *spans;
+    const IceTByte *color_pixels;
+    const IceTByte *depth_pixels;
+    const IceTInt *pixel_offsets;
+    IceTEnum color_format, depth_format;
+    IceTEnum composite_mode;
+    IceTSizeType color_size, depth_size;
+    IceTSparseImage sparse_image;
+    IceTByte *dest;
+    IceTSizeType inactive;
+    IceTInt y;
+
+    sparse_image = icetGetStateBufferSparseImage(ICET_SPARSE_TILE_BUFFER,
+                                                 tile_width, tile_height);
+    if ((target_viewport[2] < 1) || (target_viewport[3] < 1)) {
+        icetClearSparseImage(sparse_image);
+        return sparse_image;
+    }
+
+    span_pointers = icetUnsafeStateGetPointer(ICET_RENDER_SPANS);
+    row_span_starts = span_pointers[0];
+    spans = span_pointers[1];
+    color_pixels = span_pointers[2];
+    depth_pixels = span_pointers[3];
+    pixel_offsets = icetUnsafeStateGetInteger(ICET_RENDER_SPAN_OFFSETS);
+
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+    color_size = colorPixelSize(color_format);
+    if (composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
+        if (depth_format == ICET_IMAGE_DEPTH_NONE) {
+            icetRaiseError(ICET_INVALID_OPERATION,
+                           "Cannot use Z buffer compression with no"
+                           " Z buffer.");
+            icetClearSparseImage(sparse_image);
+            return sparse_image;
+        }
+        depth_size = depthPixelSize(depth_format);
+    } else {
+        /* Like icetCompressImage, blending keeps only colors. */
+        depth_size = 0;
+    }
+
+    icetTimingCompressBegin();
+
+    dest = ICET_IMAGE_DATA(sparse_image);
+    inactive = target_viewport[1]*tile_width;
+    for (y = 0; y < screen_viewport[3]; y++) {
+        IceTInt row = screen_viewport[1] + y;
+        IceTInt x_begin = screen_viewport[0];
+        IceTInt x_end = screen_viewport[0] + screen_viewport[2];
+        IceTInt to_tile_x = target_viewport[0] - screen_viewport[0];
+        IceTSizeType pixel = pixel_offsets[row];
+        IceTSizeType tile_x = 0;
+        IceTInt span;
+
+        for (span = row_span_starts[row];
+             span < row_span_starts[row+1];
+             span++) {
+            IceTInt span_x = spans[2*span];
+            IceTInt span_length = spans[2*span + 1];
+            IceTInt clip_begin = MAX(span_x, x_begin);
+            IceTInt clip_end = MIN(span_x + span_length, x_end);
+
+            if (clip_begin < clip_end) {
+                IceTSizeType count = clip_end - clip_begin;
+                IceTSizeType first = pixel + (clip_begin - span_x);
+
+                inactive += clip_begin + to_tile_x - tile_x;
+                INACTIVE_RUN_LENGTH(dest) = (IceTRunLengthType)inactive;
+                ACTIVE_RUN_LENGTH(dest) = (IceTRunLengthType)count;
+                dest += RUN_LENGTH_SIZE;
+
+                if (depth_size == 0) {
+                    /* Blending keeps colors only, so pixels are contiguous. */
+                    memcpy(dest,
+                           color_pixels + first*color_size,
+                           count*color_size);
+                    dest += count*color_size;
+                } else {
+                    /* Sparse pixels interleave color and depth. */
+                    IceTSizeType p;
+                    for (p = first; p < first + count; p++) {
+                        if (color_size > 0) {
+                            memcpy(dest,
+                                   color_pixels + p*color_size,
+                                   color_size);
+                            dest += color_size;
+                        }
+                        memcpy(dest, depth_pixels + p*depth_size, depth_size);
+                        dest += depth_size;
+                    }
+                }
+
+                tile_x = clip_end + to_tile_x;
+                inactive = 0;
+            }
+            pixel += span_length;
+        }
+
+        inactive += tile_width - tile_x;
+    }
+    inactive += (  tile_height - target_viewport[1] - target_viewport[3])
+                * tile_width;
+    if (inactive > 0) {
+        INACTIVE_RUN_LENGTH(dest) = (IceTRunLengthType)inactive;
+        ACTIVE_RUN_LENGTH(dest) = 0;
+        dest += RUN_LENGTH_SIZE;
+    }
+
+    icetSparseImageSetActualSize(sparse_image, dest);
+
+    icetTimingCompressEnd();
+
+    if (*icetUnsafeStateGetInteger(ICET_CAPTURE_ENCODING) != ICET_FALSE) {
+        /* Frame capture records full images, so make one. */
+        IceTImage tile_image = icetGetStateBufferImage(ICET_RENDER_BUFFER,
+                                                       tile_width,
+                                                       tile_height);
+        icetDecompressImage(sparse_image, tile_image);
+        icetCaptureTile(tile, tile_image, target_viewport, target_viewport);
+    }
+
+    return sparse_image;
+}
+
+static void prerenderedFullTile(int tile,
+                                const IceTInt *screen_viewport,
+                                const IceTInt *target_viewport,
+                                IceTImage image)
+{
+    const IceTVoid **span_pointers;
+    const IceTInt *row_span_starts;
+    const IceTInt *spans;
+    const IceTByte *color_pixels;
+    const IceTByte *depth_pixels;
+    const IceTInt *pixel_offsets;
+    IceTSizeType color_size, depth_size;
+    IceTByte *colors;
+    IceTByte *depths;
+    IceTSizeType width;
+    IceTInt y;
+
+    icetTimingBufferReadBegin();
+
+    icetClearImage(image);
+
+    span_pointers = icetUnsafeStateGetPointer(ICET_RENDER_SPANS);
+    row_span_starts = span_pointers[0];
+    spans = span_pointers[1];
+    color_pixels = span_pointers[2];
+    depth_pixels = span_pointers[3];
+    pixel_offsets = icetUnsafeStateGetInteger(ICET_RENDER_SPAN_OFFSETS);
+
+    width = icetImageGetWidth(image);
+    colors = icetImageGetColorVoid(image, &color_size);
+    depths = icetImageGetDepthVoid(image, &depth_size);
+    if (depth_pixels == NULL) { depth_size = 0; }
+
+    for (y = 0; y < screen_viewport[3]; y++) {
+        IceTInt row = screen_viewport[1] + y;
+        IceTInt x_begin = screen_viewport[0];
+        IceTInt x_end = screen_viewport[0] + screen_viewport[2];
+        IceTInt to_tile_x = target_viewport[0] - screen_viewport[0];
+        IceTSizeType row_start = (target_viewport[1] + y)*width;
+        IceTSizeType pixel = pixel_offsets[row];
+        IceTInt span;
+
+        for (span = row_span_starts[row];
+             span < row_span_starts[row+1];
+             span++) {
+            IceTInt span_x = spans[2*span];
+            IceTInt span_length = spans[2*span + 1];
+            IceTInt clip_begin = MAX(span_x, x_begin);
+            IceTInt clip_end = MIN(span_x + span_length, x_end);
+
+            if (clip_begin < clip_end) {
+                IceTSizeType count = clip_end - clip_begin;
+                IceTSizeType first = pixel + (clip_begin - span_x);
+                IceTSizeType dest = row_start + clip_begin + to_tile_x;
+
+                if (color_size > 0) {
+                    memcpy(colors + dest*color_size,
+                           color_pixels + first*color_size,
+                           count*color_size);
+                }
+                if (depth_size > 0) {
+                    memcpy(depths + dest*depth_size,
+                           depth_pixels + first*depth_size,
+                           count*depth_size);
+                }
+            }
+            pixel += span_length;
+        }
+    }
+
+    icetTimingBufferReadEnd();
+
+    icetCaptureTile(tile, image, target_viewport, target_viewport);
 }
 
 static IceTImage getRenderBuffer(void)
@@ -3022,8 +4701,8 @@ static IceTImage getRenderBuffer(void)
     } else {
         IceTInt dim[2];
 
-        icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &dim[0]);
-        icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &dim[1]);
+        icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &dim[0]);
+        icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &dim[1]);
 
         /* Create a new image object. */
         return icetGetStateBufferImage(ICET_RENDER_BUFFER, dim[0], dim[1]);
@@ -26,37 +26,50 @@
 #include <winbase.h>
 #endif
 
+/* Times are measured from the first call to icetWallTime by any thread.  The
+   first caller claims the right to record the start, and threads racing with
+   it wait until it is recorded.  The start is kept in a single word that is
+   never 0 once set, so a thread sees either nothing or the whole value. */
+static volatile IceTUnsignedInt64 wall_time_start_claimed = 0;
+static volatile IceTUnsignedInt64 wall_time_start = 0;
+
+static IceTUnsignedInt64 icetWallTimeStart(IceTUnsignedInt64 now)
+{
+    if (wall_time_start == 0) {
+        if (icetFetchAndIncrement(&wall_time_start_claimed) == 0) {
+            wall_time_start = now;
+        } else {
+            while (wall_time_start == 0) {
+                /* Wait for the claiming thread to record the start. */
+            }
+        }
+    }
+    return wall_time_start;
+}
+
 #ifndef _WIN32
 double icetWallTime(void)
 {
-    static struct timeval start = { 0, 0 };
     struct timeval now;
-    struct timeval *tp;
+    IceTUnsignedInt64 start_sec;
+
+    gettimeofday(&now, NULL);
 
   /* Make the first call to icetWallTime happen at second 0.  This should
      allow for more significant bits in the microseconds. */
-    if (start.tv_sec == 0) {
-        tp = &start;
-    } else {
-        tp = &now;
-    }
-
-    gettimeofday(tp, NULL);
+    start_sec = icetWallTimeStart((IceTUnsignedInt64)now.tv_sec);
 
-    return (tp->tv_sec - start.tv_sec) + 0.000001*(double)tp->tv_usec;
+    return (double)((IceTUnsignedInt64)now.tv_sec - start_sec)
+        + 0.000001*(double)now.tv_usec;
 }
 #else /*_WIN32*/
 double icetWallTime(void)
 {
-    static DWORD start = 0;
+    DWORD now = GetTickCount();
+    /* The tick count is stored offset by one so that it is never 0. */
+    DWORD start = (DWORD)(icetWallTimeStart((IceTUnsignedInt64)now + 1) - 1);
 
-    if (start == 0) {
-        start = GetTickCount();
-        return 0.0;
-    } else {
-        DWORD now = GetTickCount();
-        return 0.001*(now-start);
-    }
+    return 0.001*(DWORD)(now-start);
 }
 #endif /*_WIN32*/
 
@@ -148,3 +161,15 @@ ICET_EXPORT IceTSizeType icetSnprintf(char *buffer, IceTSizeType size,
 
     return num_written;
 }
+
+IceTUnsignedInt64 icetFetchAndIncrement(volatile IceTUnsignedInt64 *counter)
+{
+#if defined(ICET_HAVE_SYNC_FETCH_AND_ADD)
+    return __sync_fetch_and_add(counter, 1);
+#elif defined(_WIN32)
+    return (IceTUnsignedInt64)InterlockedIncrement64(
+                                          (LONGLONG volatile *)counter) - 1;
+#else
+    return (*counter)++;
+#endif
+}
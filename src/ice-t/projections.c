@@ -49,11 +49,11 @@ void icetProjectTile(IceTInt tile, IceTDouble *mat_out)
         return;
     }
 
-    viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     tile_width = viewports[tile*4+2];
     tile_height = viewports[tile*4+3];
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_WIDTH, &renderable_width);
-    icetGetIntegerv(ICET_PHYSICAL_RENDER_HEIGHT, &renderable_height);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_WIDTH, &renderable_width);
+    icetGetIntegerv(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, &renderable_height);
     tile_projections = icetUnsafeStateGetDouble(ICET_TILE_PROJECTIONS);
 
     tile_proj = tile_projections + 16*tile;
@@ -89,7 +89,7 @@ void icetGetViewportProject(IceTInt x, IceTInt y, IceTSizeType width,
 /*     IceTDouble viewport_transform[16]; */
 /*     IceTDouble tile_transform[16]; */
 
-    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, global_viewport);
 
 /*     viewport_transform[ 0] = 0.5*global_viewport[2]; */
 /*     viewport_transform[ 1] = 0.0; */
@@ -163,7 +163,7 @@ static void update_tile_projections(void)
     IceTDouble *tile_projections;
     IceTInt tile_idx;
 
-    if (  icetStateGetTime(ICET_TILE_VIEWPORTS)
+    if (  icetStateGetTime(ICET_SCALED_TILE_VIEWPORTS)
         < icetStateGetTime(ICET_TILE_PROJECTIONS) ) {
         /* Projections already up to date. */
         return;
@@ -172,7 +172,7 @@ static void update_tile_projections(void)
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
     tile_projections = icetStateAllocateDouble(ICET_TILE_PROJECTIONS,
                                                num_tiles*16);
-    viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
 
     for (tile_idx = 0; tile_idx < num_tiles; tile_idx++) {
         icetGetViewportProject(viewports[tile_idx*4+0], viewports[tile_idx*4+1],
@@ -25,6 +25,8 @@
 #define ICET_STATE_CHECK_MEM
 #endif
 
+#define ICET_COLLECT_FAN_IN_DEFAULT     8
+
 struct IceTStateValue {
     IceTEnum type;
     IceTSizeType num_entries;
@@ -137,6 +139,11 @@ void icetStateSetDefaults(void)
     icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD, 0);
     icetStateSetInteger(ICET_COLOR_FORMAT, ICET_IMAGE_COLOR_RGBA_UBYTE);
     icetStateSetInteger(ICET_DEPTH_FORMAT, ICET_IMAGE_DEPTH_FLOAT);
+    icetStateSetInteger(ICET_NUM_AUXILIARY_CHANNELS, 0);
+    icetStateSetIntegerv(ICET_AUXILIARY_CHANNEL_TYPES, 0, NULL);
+    icetStateSetIntegerv(ICET_AUXILIARY_CHANNEL_COUNTS, 0, NULL);
+    icetStateSetIntegerv(ICET_AUXILIARY_CHANNEL_OFFSETS, 0, NULL);
+    icetStateSetInteger(ICET_AUXILIARY_PIXEL_SIZE, 0);
 
     icetResetTiles();
     icetStateSetIntegerv(ICET_DISPLAY_NODES, 0, NULL);
@@ -188,9 +195,40 @@ void icetStateSetDefaults(void)
         icetStateSetInteger(ICET_MAX_IMAGE_SPLIT, ICET_MAX_IMAGE_SPLIT_DEFAULT);
     }
 
+    if (icetGetEnv("ICET_COLLECT_FAN_IN", env_buffer, ENV_BUFFER_LEN)) {
+        IceTInt collect_fan_in = atoi(env_buffer);
+        if (collect_fan_in > 1) {
+            icetStateSetInteger(ICET_COLLECT_FAN_IN, collect_fan_in);
+        } else {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Environment variable ICET_COLLECT_FAN_IN must be"
+                           " set to an integer greater than 1.");
+            icetStateSetInteger(ICET_COLLECT_FAN_IN,
+                                ICET_COLLECT_FAN_IN_DEFAULT);
+        }
+    } else {
+        icetStateSetInteger(ICET_COLLECT_FAN_IN, ICET_COLLECT_FAN_IN_DEFAULT);
+    }
+
+    icetStateSetDouble(ICET_TARGET_FRAME_TIME, 0.0);
+    icetStateSetInteger(ICET_TRACE_FRAMES, 0);
+    icetStateSetInteger(ICET_FRAME_STATISTICS_WINDOW, 0);
+    icetStateSetDoublev(ICET_FRAME_HISTORY, 0, NULL);
+    icetStateSetInteger(ICET_FRAME_HISTORY_COUNT, 0);
+    icetStateSetInteger(ICET_CAPTURE_ENCODING, ICET_FALSE);
+    {
+        IceTInt packed_layout[3];
+        packed_layout[0] = 0;
+        packed_layout[1] = 0;
+        packed_layout[2] = ICET_ROWS_BOTTOM_UP;
+        icetStateSetIntegerv(ICET_INPUT_COLOR_LAYOUT, 3, packed_layout);
+        icetStateSetIntegerv(ICET_INPUT_DEPTH_LAYOUT, 3, packed_layout);
+    }
+
     icetStateSetPointer(ICET_DRAW_FUNCTION, NULL);
     icetStateSetPointer(ICET_RENDER_LAYER_DESTRUCTOR, NULL);
     icetStateSetBoolean(ICET_RENDER_LAYER_HOLDS_BUFFER, ICET_FALSE);
+    icetStateSetBoolean(ICET_RENDER_LAYER_RECORDS_FRAME, ICET_FALSE);
 
     icetEnable(ICET_FLOATING_VIEWPORT);
     icetDisable(ICET_ORDERED_COMPOSITE);
@@ -199,6 +237,10 @@ void icetStateSetDefaults(void)
     icetEnable(ICET_INTERLACE_IMAGES);
     icetEnable(ICET_COLLECT_IMAGES);
     icetDisable(ICET_RENDER_EMPTY_IMAGES);
+    icetDisable(ICET_OPACITY_CULLING);
+    icetDisable(ICET_OCCLUSION_CULLING);
+    icetDisable(ICET_PIPELINE_TILES);
+    icetDisable(ICET_BALANCE_TILES);
 
     icetStateSetBoolean(ICET_IS_DRAWING_FRAME, ICET_FALSE);
 
@@ -206,6 +248,20 @@ void icetStateSetDefaults(void)
     icetStateSetInteger(ICET_VALID_PIXELS_OFFSET, 0);
     icetStateSetInteger(ICET_VALID_PIXELS_NUM, 0);
 
+    icetStateSetInteger(ICET_RENDER_SCALE, 1);
+    icetStateSetInteger(ICET_VIEW_INDEX, -1);
+    icetStateSetInteger(ICET_NUM_STACKED_VIEWS, 0);
+
+    {
+        IceTInt empty_viewport[4] = { 0, 0, 0, 0 };
+        icetStateSetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, 4, empty_viewport);
+    }
+    icetStateSetIntegerv(ICET_SCALED_TILE_VIEWPORTS, 0, NULL);
+    icetStateSetInteger(ICET_SCALED_TILE_MAX_WIDTH, 0);
+    icetStateSetInteger(ICET_SCALED_TILE_MAX_HEIGHT, 0);
+    icetStateSetInteger(ICET_SCALED_PHYSICAL_RENDER_WIDTH, 0);
+    icetStateSetInteger(ICET_SCALED_PHYSICAL_RENDER_HEIGHT, 0);
+
     icetStateResetTiming();
 }
 
@@ -695,9 +751,11 @@ IceTVoid *icetGetStateBuffer(IceTEnum pname, IceTSizeType num_bytes)
 
 IceTTimeStamp icetGetTimeStamp(void)
 {
-    static IceTTimeStamp current_time = 0;
+    static volatile IceTTimeStamp current_time = 0;
 
-    return current_time++;
+    /* All threads share the counter so that the time stamps of a context
+       keep increasing when it moves to another thread. */
+    return icetFetchAndIncrement(&current_time);
 }
 
 void icetStateDump(void)
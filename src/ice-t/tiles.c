@@ -30,6 +30,12 @@ void icetResetTiles(void)
     icetStateSetInteger(ICET_TILE_MAX_WIDTH, 0);
     icetStateSetInteger(ICET_TILE_MAX_HEIGHT, 0);
 
+    /* Loads measured for the old tiles mean nothing for the new ones. */
+    icetStateSetDoublev(ICET_TILE_LOADS, 0, NULL);
+    iarray[0] = -1;  iarray[1] = 0;
+    icetStateSetIntegerv(ICET_TILE_LOAD_SAMPLE, 2, iarray);
+    icetStateSetIntegerv(ICET_TILE_PROCESS_COUNTS, 0, NULL);
+
     icetPhysicalRenderSize(0, 0);
 }
 
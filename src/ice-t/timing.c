@@ -9,11 +9,13 @@
 
 #include <IceTDevTiming.h>
 
+#include <IceTDevCommunication.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevState.h>
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef ICET_USE_MPE
 #include <mpe_log.h>
@@ -28,6 +30,39 @@ static void icetEventEnd(IceTEnum pname);
 
 #endif
 
+/* The number of events held in memory before they are written to the trace
+   file.  If a frame generates more events than this, the buffer is simply
+   written out early. */
+#define ICET_TRACE_BUFFER_EVENTS 4096
+
+typedef struct IceTTraceEventStruct {
+    IceTDouble time;
+    IceTDouble duration;
+    const char *name;
+    IceTSizeType bytes;
+    IceTInt peer;
+    IceTInt tag;
+    char phase;
+} IceTTraceEvent;
+
+typedef struct IceTTraceBufferStruct {
+    IceTInt num_events;
+    IceTInt num_frames;
+    IceTBoolean file_started;
+    IceTTraceEvent events[ICET_TRACE_BUFFER_EVENTS];
+} IceTTraceBuffer;
+
+static IceTTraceBuffer *icetTraceGetBuffer(void);
+static void icetTraceRecord(const char *name,
+                            char phase,
+                            IceTDouble time,
+                            IceTDouble duration,
+                            IceTSizeType bytes,
+                            IceTInt peer,
+                            IceTInt tag);
+static void icetTraceFlush(IceTTraceBuffer *buffer, IceTBoolean finish);
+static void icetTimingUpdateCommunication(void);
+
 void icetStateResetTiming(void)
 {
     icetStateSetDouble(ICET_RENDER_TIME, 0.0);
@@ -44,6 +79,28 @@ void icetStateResetTiming(void)
     icetStateSetInteger(ICET_SUBFUNC_TIME_ID, 0);
 
     icetStateSetInteger(ICET_BYTES_SENT, 0);
+
+    icetStateSetInteger(ICET_NUM_ROUNDS, 0);
+    icetStateSetBoolean(ICET_ROUND_ACTIVE, ICET_FALSE);
+    icetStateAllocateDouble(ICET_ROUND_STATISTICS,
+                            ICET_MAX_ROUNDS*ICET_ROUND_STATISTICS_SIZE);
+    icetStateSetInteger(ICET_NUM_ROUND_PARTNERS, 0);
+    icetStateAllocateDouble(ICET_ROUND_PARTNER_STATISTICS,
+                            ICET_MAX_ROUND_PARTNERS
+                            *ICET_ROUND_PARTNER_STATISTICS_SIZE);
+    icetTimingUpdateCommunication();
+}
+
+/* The communication wrappers only read the clock while a round is recording
+   statistics or a trace is being written.  Caching that in a single state
+   variable keeps the check cheap for every message. */
+static void icetTimingUpdateCommunication(void)
+{
+    icetStateSetBoolean(
+        ICET_COMM_TIMING_ACTIVE,
+        (IceTBoolean)(   icetUnsafeStateGetBoolean(ICET_ROUND_ACTIVE)[0]
+                      || (icetUnsafeStateGetInteger(ICET_TRACE_FRAMES)[0]
+                          > 0) ));
 }
 
 static void icetTimingBegin(IceTEnum start_pname,
@@ -52,9 +109,9 @@ static void icetTimingBegin(IceTEnum start_pname,
                             const char *name)
 {
     icetRaiseDebug("Beginning %s", name);
-    (void)name;
 
     icetEventBegin(result_pname);
+    icetTraceBegin(name);
 
     {
         IceTInt current_id;
@@ -79,9 +136,9 @@ static void icetTimingEnd(IceTEnum start_pname,
                           const char *name)
 {
     icetRaiseDebug("Ending %s", name);
-    (void)name;
 
     icetEventEnd(result_pname);
+    icetTraceEnd(name);
 
     {
         IceTInt current_id;
@@ -99,10 +156,14 @@ static void icetTimingEnd(IceTEnum start_pname,
     {
         IceTDouble start_time;
         IceTDouble old_time;
+        IceTDouble elapsed_time;
         icetGetDoublev(start_pname, &start_time);
         icetGetDoublev(result_pname, &old_time);
-        icetStateSetDouble(result_pname,
-                           old_time + (icetWallTime() - start_time));
+        elapsed_time = icetWallTime() - start_time;
+        icetStateSetDouble(result_pname, old_time + elapsed_time);
+        if (result_pname == ICET_BLEND_TIME) {
+            icetTimingRoundAccumulate(ICET_ROUND_BLEND_TIME, elapsed_time);
+        }
     }
 }
 
@@ -221,10 +282,594 @@ void icetTimingDrawFrameBegin(void)
 }
 void icetTimingDrawFrameEnd(void)
 {
+    IceTTraceBuffer *buffer;
+
     icetTimingEnd(ICET_DRAW_START_TIME,
                   ICET_DRAW_TIME_ID,
                   ICET_TOTAL_DRAW_TIME,
                   "draw frame");
+
+    buffer = icetTraceGetBuffer();
+    if (buffer != NULL) {
+        IceTInt flush_frames;
+        icetGetIntegerv(ICET_TRACE_FRAMES, &flush_frames);
+        buffer->num_frames++;
+        if (buffer->num_frames >= flush_frames) {
+            icetTraceFlush(buffer, ICET_FALSE);
+            buffer->num_frames = 0;
+        }
+    }
+}
+
+void icetTimingRoundBegin(IceTInt k)
+{
+    IceTInt num_rounds;
+    IceTDouble *round;
+
+    icetGetIntegerv(ICET_NUM_ROUNDS, &num_rounds);
+    if (num_rounds >= ICET_MAX_ROUNDS) {
+        icetStateSetBoolean(ICET_ROUND_ACTIVE, ICET_FALSE);
+        icetTimingUpdateCommunication();
+        return;
+    }
+
+    round = (IceTDouble *)icetUnsafeStateGetDouble(ICET_ROUND_STATISTICS)
+        + num_rounds*ICET_ROUND_STATISTICS_SIZE;
+    round[ICET_ROUND_K] = k;
+    round[ICET_ROUND_BYTES_SENT] = 0.0;
+    round[ICET_ROUND_BYTES_RECEIVED] = 0.0;
+    round[ICET_ROUND_WAIT_TIME] = 0.0;
+    round[ICET_ROUND_BLEND_TIME] = 0.0;
+
+    icetStateSetInteger(ICET_NUM_ROUNDS, num_rounds + 1);
+    icetStateSetBoolean(ICET_ROUND_ACTIVE, ICET_TRUE);
+    icetTimingUpdateCommunication();
+}
+
+void icetTimingRoundEnd(void)
+{
+    icetStateSetBoolean(ICET_ROUND_ACTIVE, ICET_FALSE);
+    icetTimingUpdateCommunication();
+}
+
+void icetTimingRoundAccumulate(IceTInt statistic, IceTDouble value)
+{
+    IceTInt num_rounds;
+    IceTDouble *round;
+
+    if (!icetUnsafeStateGetBoolean(ICET_ROUND_ACTIVE)[0]) { return; }
+
+    num_rounds = icetUnsafeStateGetInteger(ICET_NUM_ROUNDS)[0];
+    round = (IceTDouble *)icetUnsafeStateGetDouble(ICET_ROUND_STATISTICS)
+        + (num_rounds - 1)*ICET_ROUND_STATISTICS_SIZE;
+    round[statistic] += value;
+}
+
+/* Adds bytes to the entry of the given partner in the current round,
+   starting a new entry the first time the partner is seen in the round. */
+static void icetTimingRoundAccumulatePartner(IceTInt partner,
+                                             IceTInt statistic,
+                                             IceTDouble bytes)
+{
+    IceTDouble round;
+    IceTInt num_partners;
+    IceTDouble *partners;
+    IceTDouble *entry;
+    IceTInt i;
+
+    round = (IceTDouble)(icetUnsafeStateGetInteger(ICET_NUM_ROUNDS)[0] - 1);
+    num_partners = icetUnsafeStateGetInteger(ICET_NUM_ROUND_PARTNERS)[0];
+    partners = (IceTDouble *)icetUnsafeStateGetDouble(
+                                                ICET_ROUND_PARTNER_STATISTICS);
+
+    /* The entries of the current round are at the end of the list. */
+    for (i = num_partners - 1; i >= 0; i--) {
+        entry = partners + i*ICET_ROUND_PARTNER_STATISTICS_SIZE;
+        if (entry[ICET_ROUND_PARTNER_ROUND] != round) { break; }
+        if (entry[ICET_ROUND_PARTNER_RANK] == partner) {
+            entry[statistic] += bytes;
+            return;
+        }
+    }
+
+    if (num_partners >= ICET_MAX_ROUND_PARTNERS) { return; }
+
+    entry = partners + num_partners*ICET_ROUND_PARTNER_STATISTICS_SIZE;
+    entry[ICET_ROUND_PARTNER_ROUND] = round;
+    entry[ICET_ROUND_PARTNER_RANK] = partner;
+    entry[ICET_ROUND_PARTNER_BYTES_SENT] = 0.0;
+    entry[ICET_ROUND_PARTNER_BYTES_RECEIVED] = 0.0;
+    entry[statistic] = bytes;
+    icetStateSetInteger(ICET_NUM_ROUND_PARTNERS, num_partners + 1);
+}
+
+void icetTimingRoundSent(IceTInt partner, IceTSizeType bytes)
+{
+    if (!icetUnsafeStateGetBoolean(ICET_ROUND_ACTIVE)[0]) { return; }
+
+    icetTimingRoundAccumulate(ICET_ROUND_BYTES_SENT, (IceTDouble)bytes);
+    if (partner >= 0) {
+        icetTimingRoundAccumulatePartner(partner,
+                                         ICET_ROUND_PARTNER_BYTES_SENT,
+                                         (IceTDouble)bytes);
+    }
+}
+
+void icetTimingRoundReceived(IceTInt partner, IceTSizeType bytes)
+{
+    if (!icetUnsafeStateGetBoolean(ICET_ROUND_ACTIVE)[0]) { return; }
+
+    icetTimingRoundAccumulate(ICET_ROUND_BYTES_RECEIVED, (IceTDouble)bytes);
+    if (partner >= 0) {
+        icetTimingRoundAccumulatePartner(partner,
+                                         ICET_ROUND_PARTNER_BYTES_RECEIVED,
+                                         (IceTDouble)bytes);
+    }
+}
+
+IceTInt icetGetRoundStatistics(IceTEnum summary, IceTDouble *statistics)
+{
+    const IceTDouble *local_statistics
+        = icetUnsafeStateGetDouble(ICET_ROUND_STATISTICS);
+    IceTInt num_rounds;
+    IceTInt max_rounds;
+    IceTInt num_proc;
+    IceTInt *all_num_rounds;
+    IceTDouble *send_statistics;
+    IceTDouble *all_statistics;
+    IceTInt proc;
+    IceTInt i;
+
+    icetGetIntegerv(ICET_NUM_ROUNDS, &num_rounds);
+
+    if (summary == ICET_ROUND_SUMMARY_LOCAL) {
+        if (statistics != NULL) {
+            memcpy(statistics,
+                   local_statistics,
+                   num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+        }
+        return num_rounds;
+    }
+
+    if (   (summary != ICET_ROUND_SUMMARY_MIN)
+        && (summary != ICET_ROUND_SUMMARY_MAX)
+        && (summary != ICET_ROUND_SUMMARY_MEAN) ) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid round statistics summary 0x%X.", summary);
+        return 0;
+    }
+
+    /* The summaries are collective.  This is not called while drawing, so
+       plain allocations are used rather than state buffers that the frame
+       may be holding on to. */
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    all_num_rounds = malloc(num_proc*sizeof(IceTInt));
+    icetCommAllgather(&num_rounds, 1, ICET_INT, all_num_rounds);
+    max_rounds = 0;
+    for (proc = 0; proc < num_proc; proc++) {
+        if (all_num_rounds[proc] > max_rounds) {
+            max_rounds = all_num_rounds[proc];
+        }
+    }
+
+    if ((statistics == NULL) || (max_rounds == 0)) {
+        free(all_num_rounds);
+        return max_rounds;
+    }
+
+    send_statistics
+        = malloc(max_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    all_statistics = malloc(num_proc*max_rounds*ICET_ROUND_STATISTICS_SIZE
+                            *sizeof(IceTDouble));
+    memset(send_statistics,
+           0,
+           max_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    memcpy(send_statistics,
+           local_statistics,
+           num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    icetCommAllgather(send_statistics,
+                      max_rounds*ICET_ROUND_STATISTICS_SIZE,
+                      ICET_DOUBLE,
+                      all_statistics);
+
+    /* Only processes that took part in a round contribute to its summary. */
+    for (i = 0; i < max_rounds*ICET_ROUND_STATISTICS_SIZE; i++) {
+        IceTInt round = i/ICET_ROUND_STATISTICS_SIZE;
+        IceTInt num_contributing = 0;
+        IceTDouble result = 0.0;
+        for (proc = 0; proc < num_proc; proc++) {
+            IceTDouble value;
+            if (all_num_rounds[proc] <= round) { continue; }
+            value = all_statistics[proc*max_rounds*ICET_ROUND_STATISTICS_SIZE
+                                   + i];
+            if (num_contributing == 0) {
+                result = value;
+            } else if (summary == ICET_ROUND_SUMMARY_MIN) {
+                if (value < result) { result = value; }
+            } else if (summary == ICET_ROUND_SUMMARY_MAX) {
+                if (value > result) { result = value; }
+            } else {
+                result += value;
+            }
+            num_contributing++;
+        }
+        if ((summary == ICET_ROUND_SUMMARY_MEAN) && (num_contributing > 0)) {
+            result /= num_contributing;
+        }
+        statistics[i] = result;
+    }
+
+    free(all_num_rounds);
+    free(send_statistics);
+    free(all_statistics);
+
+    return max_rounds;
+}
+
+IceTInt icetGetRoundPartnerStatistics(IceTDouble *statistics)
+{
+    IceTInt num_partners;
+
+    icetGetIntegerv(ICET_NUM_ROUND_PARTNERS, &num_partners);
+    if (statistics != NULL) {
+        memcpy(statistics,
+               icetUnsafeStateGetDouble(ICET_ROUND_PARTNER_STATISTICS),
+               num_partners*ICET_ROUND_PARTNER_STATISTICS_SIZE
+               *sizeof(IceTDouble));
+    }
+    return num_partners;
+}
+
+/* The timing state variables recorded for each frame, indexed by the
+   ICET_FRAME_PHASE_* values. */
+static const IceTEnum icetFramePhaseTimes[ICET_FRAME_NUM_PHASES] = {
+    ICET_RENDER_TIME,
+    ICET_BUFFER_READ_TIME,
+    ICET_BUFFER_WRITE_TIME,
+    ICET_COMPRESS_TIME,
+    ICET_INTERLACE_TIME,
+    ICET_BLEND_TIME,
+    ICET_COMPOSITE_TIME,
+    ICET_COLLECT_TIME,
+    ICET_TOTAL_DRAW_TIME
+};
+
+void icetFrameStatisticsWindow(IceTInt num_frames)
+{
+    if (num_frames < 0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Frame statistics window must not be negative.");
+        return;
+    }
+
+    icetStateSetInteger(ICET_FRAME_STATISTICS_WINDOW, num_frames);
+    icetStateAllocateDouble(ICET_FRAME_HISTORY,
+                            num_frames*ICET_FRAME_NUM_PHASES);
+    icetStateSetInteger(ICET_FRAME_HISTORY_COUNT, 0);
+}
+
+void icetTimingRecordFrame(void)
+{
+    IceTInt window;
+    IceTInt count;
+    IceTDouble *frame;
+    IceTInt phase;
+
+    icetGetIntegerv(ICET_FRAME_STATISTICS_WINDOW, &window);
+    if (window < 1) { return; }
+
+    /* The history is a ring of the last window frames. */
+    icetGetIntegerv(ICET_FRAME_HISTORY_COUNT, &count);
+    frame = (IceTDouble *)icetUnsafeStateGetDouble(ICET_FRAME_HISTORY)
+        + (count%window)*ICET_FRAME_NUM_PHASES;
+    for (phase = 0; phase < ICET_FRAME_NUM_PHASES; phase++) {
+        icetGetDoublev(icetFramePhaseTimes[phase], &frame[phase]);
+    }
+    icetStateSetInteger(ICET_FRAME_HISTORY_COUNT, count + 1);
+}
+
+static int icetCompareDoubles(const void *a, const void *b)
+{
+    IceTDouble value_a = *((const IceTDouble *)a);
+    IceTDouble value_b = *((const IceTDouble *)b);
+    if (value_a < value_b) { return -1; }
+    if (value_a > value_b) { return 1; }
+    return 0;
+}
+
+/* Returns the nearest-rank percentile of sorted values. */
+static IceTDouble icetPercentile(const IceTDouble *sorted_values,
+                                 IceTInt num_values,
+                                 IceTInt percent)
+{
+    IceTInt rank = (percent*num_values + 99)/100;
+    if (rank < 1) { rank = 1; }
+    return sorted_values[rank - 1];
+}
+
+IceTInt icetGetFrameStatistics(IceTEnum summary, IceTDouble *statistics)
+{
+    const IceTDouble *history;
+    IceTDouble *phase_samples;
+    IceTInt window;
+    IceTInt count;
+    IceTInt num_frames;
+    IceTInt rank;
+    IceTInt phase;
+    IceTInt frame;
+
+    if (   (summary != ICET_FRAME_SUMMARY_LOCAL)
+        && (summary != ICET_FRAME_SUMMARY_SLOWEST) ) {
+        icetRaiseError(ICET_INVALID_ENUM,
+                       "Invalid frame statistics summary 0x%X.", summary);
+        return 0;
+    }
+
+    icetGetIntegerv(ICET_FRAME_STATISTICS_WINDOW, &window);
+    icetGetIntegerv(ICET_FRAME_HISTORY_COUNT, &count);
+    icetGetIntegerv(ICET_RANK, &rank);
+    num_frames = (count < window) ? count : window;
+    history = icetUnsafeStateGetDouble(ICET_FRAME_HISTORY);
+    if (statistics == NULL) { return num_frames; }
+
+    phase_samples = malloc((num_frames > 0 ? num_frames : 1)
+                           *sizeof(IceTDouble));
+    for (phase = 0; phase < ICET_FRAME_NUM_PHASES; phase++) {
+        IceTDouble *phase_statistics
+            = statistics + phase*ICET_FRAME_STATISTICS_SIZE;
+        IceTDouble sum = 0.0;
+
+        for (frame = 0; frame < num_frames; frame++) {
+            phase_samples[frame]
+                = history[frame*ICET_FRAME_NUM_PHASES + phase];
+            sum += phase_samples[frame];
+        }
+        qsort(phase_samples, num_frames, sizeof(IceTDouble),
+              icetCompareDoubles);
+
+        if (num_frames > 0) {
+            phase_statistics[ICET_FRAME_STATISTIC_P50]
+                = icetPercentile(phase_samples, num_frames, 50);
+            phase_statistics[ICET_FRAME_STATISTIC_P95]
+                = icetPercentile(phase_samples, num_frames, 95);
+            phase_statistics[ICET_FRAME_STATISTIC_P99]
+                = icetPercentile(phase_samples, num_frames, 99);
+            phase_statistics[ICET_FRAME_STATISTIC_MAX]
+                = phase_samples[num_frames - 1];
+            phase_statistics[ICET_FRAME_STATISTIC_MEAN] = sum/num_frames;
+        } else {
+            phase_statistics[ICET_FRAME_STATISTIC_P50] = 0.0;
+            phase_statistics[ICET_FRAME_STATISTIC_P95] = 0.0;
+            phase_statistics[ICET_FRAME_STATISTIC_P99] = 0.0;
+            phase_statistics[ICET_FRAME_STATISTIC_MAX] = 0.0;
+            phase_statistics[ICET_FRAME_STATISTIC_MEAN] = 0.0;
+        }
+        phase_statistics[ICET_FRAME_STATISTIC_RANK] = rank;
+    }
+    free(phase_samples);
+
+    if (summary == ICET_FRAME_SUMMARY_SLOWEST) {
+        IceTInt num_proc;
+        IceTDouble *all_statistics;
+        IceTInt proc;
+        IceTInt i;
+
+        icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+        all_statistics = malloc(num_proc
+                                *ICET_FRAME_NUM_PHASES
+                                *ICET_FRAME_STATISTICS_SIZE
+                                *sizeof(IceTDouble));
+        icetCommAllgather(statistics,
+                          ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE,
+                          ICET_DOUBLE,
+                          all_statistics);
+
+        /* Each statistic becomes the worst over all processes.  The rank is
+           the process with the worst mean.  Start from process 0 and only
+           move to a later process on a strictly worse mean so that ties go
+           to the lowest rank and all processes report the same one. */
+        memcpy(statistics,
+               all_statistics,
+               ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE
+               *sizeof(IceTDouble));
+        for (proc = 1; proc < num_proc; proc++) {
+            const IceTDouble *proc_statistics = all_statistics
+                + proc*ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE;
+            for (phase = 0; phase < ICET_FRAME_NUM_PHASES; phase++) {
+                IceTDouble *phase_statistics
+                    = statistics + phase*ICET_FRAME_STATISTICS_SIZE;
+                const IceTDouble *proc_phase_statistics
+                    = proc_statistics + phase*ICET_FRAME_STATISTICS_SIZE;
+                if (   proc_phase_statistics[ICET_FRAME_STATISTIC_MEAN]
+                     > phase_statistics[ICET_FRAME_STATISTIC_MEAN] ) {
+                    phase_statistics[ICET_FRAME_STATISTIC_RANK] = proc;
+                }
+                for (i = 0; i < ICET_FRAME_STATISTIC_RANK; i++) {
+                    if (proc_phase_statistics[i] > phase_statistics[i]) {
+                        phase_statistics[i] = proc_phase_statistics[i];
+                    }
+                }
+            }
+        }
+
+        free(all_statistics);
+    }
+
+    return num_frames;
+}
+
+void icetTraceFile(const char *filename, IceTInt flush_frames)
+{
+    IceTTraceBuffer *buffer;
+    const char *rank_marker;
+    char *rank_filename;
+    IceTInt rank;
+    IceTInt num_proc;
+
+    if (flush_frames < 0) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Number of frames between trace flushes must not be"
+                       " negative.");
+        return;
+    }
+
+    /* Finish any trace in progress. */
+    buffer = icetTraceGetBuffer();
+    if (buffer != NULL) {
+        icetTraceFlush(buffer, ICET_TRUE);
+    }
+    icetStateSetInteger(ICET_TRACE_FRAMES, 0);
+    icetTimingUpdateCommunication();
+    icetGetStateBuffer(ICET_TRACE_BUF, 0);
+    icetGetStateBuffer(ICET_TRACE_FILE_BUF, 0);
+
+    if ((filename == NULL) || (flush_frames == 0)) { return; }
+
+    /* Each process writes its own file.  The first %d in the file name is
+       replaced with the rank. */
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    rank_marker = strstr(filename, "%d");
+    rank_filename = icetGetStateBuffer(ICET_TRACE_FILE_BUF,
+                                       (IceTSizeType)strlen(filename) + 16);
+    if (rank_marker != NULL) {
+        size_t prefix_length = (size_t)(rank_marker - filename);
+        memcpy(rank_filename, filename, prefix_length);
+        sprintf(rank_filename + prefix_length,
+                "%d%s", (int)rank, rank_marker + 2);
+    } else if (num_proc > 1) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Trace file name %s needs a %%d to distinguish the"
+                       " files of the %d processes.",
+                       filename, num_proc);
+        icetGetStateBuffer(ICET_TRACE_FILE_BUF, 0);
+        return;
+    } else {
+        strcpy(rank_filename, filename);
+    }
+
+    buffer = icetGetStateBuffer(ICET_TRACE_BUF, sizeof(IceTTraceBuffer));
+    buffer->num_events = 0;
+    buffer->num_frames = 0;
+    buffer->file_started = ICET_FALSE;
+    icetStateSetInteger(ICET_TRACE_FRAMES, flush_frames);
+    icetTimingUpdateCommunication();
+}
+
+void icetTraceBegin(const char *name)
+{
+    icetTraceRecord(name, 'B', icetWallTime(), 0.0, -1, -1, -1);
+}
+
+void icetTraceEnd(const char *name)
+{
+    icetTraceRecord(name, 'E', icetWallTime(), 0.0, -1, -1, -1);
+}
+
+void icetTraceComm(const char *name,
+                   IceTDouble start_time,
+                   IceTSizeType bytes,
+                   IceTInt peer,
+                   IceTInt tag)
+{
+    if (icetTraceGetBuffer() == NULL) { return; }
+    icetTraceRecord(name,
+                    'X',
+                    start_time,
+                    icetWallTime() - start_time,
+                    bytes,
+                    peer,
+                    tag);
+}
+
+static IceTTraceBuffer *icetTraceGetBuffer(void)
+{
+    if (icetUnsafeStateGetInteger(ICET_TRACE_FRAMES)[0] < 1) { return NULL; }
+    return (IceTTraceBuffer *)icetUnsafeStateGetBuffer(ICET_TRACE_BUF);
+}
+
+static void icetTraceRecord(const char *name,
+                            char phase,
+                            IceTDouble time,
+                            IceTDouble duration,
+                            IceTSizeType bytes,
+                            IceTInt peer,
+                            IceTInt tag)
+{
+    IceTTraceBuffer *buffer = icetTraceGetBuffer();
+    IceTTraceEvent *event;
+
+    if (buffer == NULL) { return; }
+
+    if (buffer->num_events >= ICET_TRACE_BUFFER_EVENTS) {
+        icetTraceFlush(buffer, ICET_FALSE);
+    }
+
+    event = &buffer->events[buffer->num_events++];
+    event->time = time;
+    event->duration = duration;
+    event->name = name;
+    event->bytes = bytes;
+    event->peer = peer;
+    event->tag = tag;
+    event->phase = phase;
+}
+
+/* Appends the buffered events to the trace file in the Chrome trace event
+   (JSON array) format.  The closing bracket is only written when finish is
+   true, but trace viewers accept files without it. */
+static void icetTraceFlush(IceTTraceBuffer *buffer, IceTBoolean finish)
+{
+    const char *filename
+        = (const char *)icetUnsafeStateGetBuffer(ICET_TRACE_FILE_BUF);
+    IceTInt rank;
+    FILE *file;
+    IceTInt i;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    file = fopen(filename, buffer->file_started ? "a" : "w");
+    if (file == NULL) {
+        icetRaiseError(ICET_INVALID_OPERATION,
+                       "Could not open trace file %s.", filename);
+        buffer->num_events = 0;
+        return;
+    }
+
+    if (!buffer->file_started) {
+        fprintf(file,
+                "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"tid\":0,\"args\":{\"name\":\"rank %d\"}}",
+                (int)rank, (int)rank);
+        buffer->file_started = ICET_TRUE;
+    }
+
+    for (i = 0; i < buffer->num_events; i++) {
+        const IceTTraceEvent *event = &buffer->events[i];
+        /* Chrome traces are in microseconds. */
+        fprintf(file,
+                ",\n{\"name\":\"%s\",\"cat\":\"icet\",\"ph\":\"%c\","
+                "\"ts\":%.3f,\"pid\":%d,\"tid\":0",
+                event->name, event->phase, 1.0e6*event->time, (int)rank);
+        if (event->phase == 'X') {
+            fprintf(file, ",\"dur\":%.3f", 1.0e6*event->duration);
+        }
+        if (event->peer >= 0) {
+            fprintf(file,
+                    ",\"args\":{\"bytes\":%ld,\"peer\":%d,\"tag\":%d}",
+                    (long)event->bytes, (int)event->peer, (int)event->tag);
+        } else if (event->bytes >= 0) {
+            fprintf(file, ",\"args\":{\"bytes\":%ld}", (long)event->bytes);
+        }
+        fprintf(file, "}");
+    }
+    buffer->num_events = 0;
+
+    if (finish) {
+        fprintf(file, "\n]\n");
+    }
+
+    fclose(file);
 }
 
 #ifdef ICET_USE_MPE
@@ -238,7 +883,7 @@ typedef struct IceTEventInfoStruct {
 
 static const IceTEventInfo *icetEventFind(IceTEnum pname)
 {
-    static IceTEventInfo *events = NULL;
+    static ICET_THREAD_LOCAL IceTEventInfo *events = NULL;
 
     if (events == NULL) {
         IceTEventInfo *new_event;
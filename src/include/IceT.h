@@ -180,6 +180,9 @@ typedef struct { IceTVoid *opaque_internals; } IceTImage;
 
 ICET_EXPORT void icetSetColorFormat(IceTEnum color_format);
 ICET_EXPORT void icetSetDepthFormat(IceTEnum depth_format);
+ICET_EXPORT void icetSetAuxiliaryChannels(IceTInt num_channels,
+                                          const IceTEnum *types,
+                                          const IceTInt *counts);
 
 ICET_EXPORT IceTImage icetImageNull(void);
 ICET_EXPORT IceTBoolean icetImageIsNull(const IceTImage image);
@@ -196,6 +199,9 @@ ICET_EXPORT const IceTUByte *icetImageGetColorcub(const IceTImage image);
 ICET_EXPORT const IceTUInt *icetImageGetColorcui(const IceTImage image);
 ICET_EXPORT const IceTFloat *icetImageGetColorcf(const IceTImage image);
 ICET_EXPORT const IceTFloat *icetImageGetDepthcf(const IceTImage image);
+ICET_EXPORT IceTVoid *icetImageGetAuxiliary(IceTImage image, IceTInt channel);
+ICET_EXPORT const IceTVoid *icetImageGetAuxiliaryc(const IceTImage image,
+                                                   IceTInt channel);
 ICET_EXPORT void icetImageCopyColorub(const IceTImage image,
                                       IceTUByte *color_buffer,
                                       IceTEnum color_format);
@@ -205,12 +211,16 @@ ICET_EXPORT void icetImageCopyColorf(const IceTImage image,
 ICET_EXPORT void icetImageCopyDepthf(const IceTImage image,
                                      IceTFloat *depth_buffer,
                                      IceTEnum depth_format);
+ICET_EXPORT void icetImageCopyAuxiliary(const IceTImage image,
+                                        IceTInt channel,
+                                        IceTVoid *buffer);
 
 #define ICET_STRATEGY_DIRECT            (IceTEnum)0x6001
 #define ICET_STRATEGY_SEQUENTIAL        (IceTEnum)0x6002
 #define ICET_STRATEGY_SPLIT             (IceTEnum)0x6003
 #define ICET_STRATEGY_REDUCE            (IceTEnum)0x6004
 #define ICET_STRATEGY_VTREE             (IceTEnum)0x6005
+#define ICET_STRATEGY_HYBRID            (IceTEnum)0x6006
 
 ICET_EXPORT void icetStrategy(IceTEnum strategy);
 
@@ -229,6 +239,9 @@ ICET_EXPORT const char *icetGetSingleImageStrategyName(void);
 
 #define ICET_COMPOSITE_MODE_Z_BUFFER    (IceTEnum)0x0301
 #define ICET_COMPOSITE_MODE_BLEND       (IceTEnum)0x0302
+#define ICET_COMPOSITE_MODE_MAX         (IceTEnum)0x0303
+#define ICET_COMPOSITE_MODE_MIN         (IceTEnum)0x0304
+#define ICET_COMPOSITE_MODE_ADD         (IceTEnum)0x0305
 ICET_EXPORT void icetCompositeMode(IceTEnum mode);
 
 ICET_EXPORT void icetCompositeOrder(const IceTInt *process_ranks);
@@ -237,6 +250,8 @@ ICET_EXPORT void icetDataReplicationGroup(IceTInt size,
                                           const IceTInt *processes);
 ICET_EXPORT void icetDataReplicationGroupColor(IceTInt color);
 
+ICET_EXPORT void icetTargetFrameTime(IceTDouble seconds);
+
 typedef void (*IceTDrawCallbackType)(const IceTDouble *projection_matrix,
                                      const IceTDouble *modelview_matrix,
                                      const IceTFloat *background_color,
@@ -256,6 +271,74 @@ ICET_EXPORT IceTImage icetCompositeImage(const IceTVoid *color_buffer,
                                          const IceTDouble *modelview_matrix,
                                          const IceTFloat *background_color);
 
+ICET_EXPORT void icetDrawFrames(IceTInt num_views,
+                                const IceTDouble *projection_matrices,
+                                const IceTDouble *modelview_matrices,
+                                const IceTFloat *background_color,
+                                IceTImage *images);
+
+ICET_EXPORT void icetCompositeImages(IceTInt num_views,
+                                     const IceTVoid *const *color_buffers,
+                                     const IceTVoid *const *depth_buffers,
+                                     const IceTInt *valid_pixels_viewports,
+                                     const IceTDouble *projection_matrices,
+                                     const IceTDouble *modelview_matrices,
+                                     const IceTFloat *background_color,
+                                     IceTImage *images);
+
+ICET_EXPORT IceTImage icetCompositeSparseImage(
+                                         const IceTInt *row_span_starts,
+                                         const IceTInt *spans,
+                                         const IceTVoid *color_pixels,
+                                         const IceTVoid *depth_pixels,
+                                         const IceTDouble *projection_matrix,
+                                         const IceTDouble *modelview_matrix,
+                                         const IceTFloat *background_color);
+
+#define ICET_INPUT_COLOR_BUFFER         (IceTEnum)0xE501
+#define ICET_INPUT_DEPTH_BUFFER         (IceTEnum)0xE502
+
+#define ICET_ROWS_BOTTOM_UP             (IceTEnum)0xE511
+#define ICET_ROWS_TOP_DOWN              (IceTEnum)0xE512
+
+ICET_EXPORT void icetInputBufferLayout(IceTEnum buffer,
+                                       IceTSizeType pixel_stride,
+                                       IceTSizeType row_stride,
+                                       IceTEnum row_order);
+
+#define ICET_IMAGE_ENCODING_QOI         (IceTEnum)0xE001
+
+ICET_EXPORT const IceTVoid *icetGatherEncodedImage(const IceTImage image,
+                                                   IceTEnum encoding,
+                                                   IceTSizeType *encoded_size);
+
+#define ICET_IMAGE_FILE_PPM             (IceTEnum)0xE101
+#define ICET_IMAGE_FILE_PFM             (IceTEnum)0xE102
+#define ICET_IMAGE_FILE_RAW             (IceTEnum)0xE103
+
+ICET_EXPORT void icetWriteImageFile(const IceTImage image,
+                                    IceTEnum file_format,
+                                    const char *color_filename,
+                                    const char *depth_filename);
+
+#define ICET_CAPTURE_RAW                (IceTEnum)0xE401
+#define ICET_CAPTURE_SPARSE             (IceTEnum)0xE402
+
+#define ICET_CAPTURE_INFO_RANK          0
+#define ICET_CAPTURE_INFO_NUM_PROCESSES 1
+#define ICET_CAPTURE_INFO_FRAME         2
+#define ICET_CAPTURE_INFO_ORDER         3
+#define ICET_CAPTURE_INFO_SIZE          4
+
+ICET_EXPORT void icetCaptureFrames(const char *filename, IceTEnum encoding);
+ICET_EXPORT IceTImage icetLoadCapturedFrame(const char *filename,
+                                            IceTInt frame,
+                                            IceTInt *valid_pixels_viewport,
+                                            IceTDouble *projection_matrix,
+                                            IceTDouble *modelview_matrix,
+                                            IceTFloat *background_color,
+                                            IceTInt *info);
+
 #define ICET_DIAG_OFF           (IceTEnum)0x0000
 #define ICET_DIAG_ERRORS        (IceTEnum)0x0001
 #define ICET_DIAG_WARNINGS      (IceTEnum)0x0003
@@ -266,6 +349,57 @@ ICET_EXPORT IceTImage icetCompositeImage(const IceTVoid *color_buffer,
 
 ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 
+ICET_EXPORT void icetTraceFile(const char *filename, IceTInt flush_frames);
+
+#define ICET_ROUND_K                    0
+#define ICET_ROUND_BYTES_SENT           1
+#define ICET_ROUND_BYTES_RECEIVED       2
+#define ICET_ROUND_WAIT_TIME            3
+#define ICET_ROUND_BLEND_TIME           4
+#define ICET_ROUND_STATISTICS_SIZE      5
+
+#define ICET_ROUND_SUMMARY_LOCAL        (IceTEnum)0xE201
+#define ICET_ROUND_SUMMARY_MIN          (IceTEnum)0xE202
+#define ICET_ROUND_SUMMARY_MAX          (IceTEnum)0xE203
+#define ICET_ROUND_SUMMARY_MEAN         (IceTEnum)0xE204
+
+ICET_EXPORT IceTInt icetGetRoundStatistics(IceTEnum summary,
+                                           IceTDouble *statistics);
+
+#define ICET_ROUND_PARTNER_ROUND            0
+#define ICET_ROUND_PARTNER_RANK             1
+#define ICET_ROUND_PARTNER_BYTES_SENT       2
+#define ICET_ROUND_PARTNER_BYTES_RECEIVED   3
+#define ICET_ROUND_PARTNER_STATISTICS_SIZE  4
+
+ICET_EXPORT IceTInt icetGetRoundPartnerStatistics(IceTDouble *statistics);
+
+#define ICET_FRAME_PHASE_RENDER         0
+#define ICET_FRAME_PHASE_BUFFER_READ    1
+#define ICET_FRAME_PHASE_BUFFER_WRITE   2
+#define ICET_FRAME_PHASE_COMPRESS       3
+#define ICET_FRAME_PHASE_INTERLACE      4
+#define ICET_FRAME_PHASE_BLEND          5
+#define ICET_FRAME_PHASE_COMPOSITE      6
+#define ICET_FRAME_PHASE_COLLECT        7
+#define ICET_FRAME_PHASE_TOTAL_DRAW     8
+#define ICET_FRAME_NUM_PHASES           9
+
+#define ICET_FRAME_STATISTIC_P50        0
+#define ICET_FRAME_STATISTIC_P95        1
+#define ICET_FRAME_STATISTIC_P99        2
+#define ICET_FRAME_STATISTIC_MAX        3
+#define ICET_FRAME_STATISTIC_MEAN       4
+#define ICET_FRAME_STATISTIC_RANK       5
+#define ICET_FRAME_STATISTICS_SIZE      6
+
+#define ICET_FRAME_SUMMARY_LOCAL        (IceTEnum)0xE301
+#define ICET_FRAME_SUMMARY_SLOWEST      (IceTEnum)0xE302
+
+ICET_EXPORT void icetFrameStatisticsWindow(IceTInt num_frames);
+ICET_EXPORT IceTInt icetGetFrameStatistics(IceTEnum summary,
+                                           IceTDouble *statistics);
+
 
 #define ICET_STATE_ENGINE_START (IceTEnum)0x00000000
 
@@ -279,6 +413,11 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 #define ICET_PHYSICAL_RENDER_HEIGHT (ICET_STATE_ENGINE_START| (IceTEnum)0x0008)
 #define ICET_COLOR_FORMAT       (ICET_STATE_ENGINE_START | (IceTEnum)0x0009)
 #define ICET_DEPTH_FORMAT       (ICET_STATE_ENGINE_START | (IceTEnum)0x000A)
+#define ICET_NUM_AUXILIARY_CHANNELS (ICET_STATE_ENGINE_START|(IceTEnum)0x000B)
+#define ICET_AUXILIARY_CHANNEL_TYPES (ICET_STATE_ENGINE_START|(IceTEnum)0x000C)
+#define ICET_AUXILIARY_CHANNEL_COUNTS (ICET_STATE_ENGINE_START|(IceTEnum)0x000D)
+#define ICET_AUXILIARY_CHANNEL_OFFSETS (ICET_STATE_ENGINE_START|(IceTEnum)0x000E)
+#define ICET_AUXILIARY_PIXEL_SIZE (ICET_STATE_ENGINE_START | (IceTEnum)0x000F)
 
 #define ICET_NUM_TILES          (ICET_STATE_ENGINE_START | (IceTEnum)0x0010)
 #define ICET_TILE_VIEWPORTS     (ICET_STATE_ENGINE_START | (IceTEnum)0x0011)
@@ -302,12 +441,26 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 
 #define ICET_MAGIC_K            (ICET_STATE_ENGINE_START | (IceTEnum)0x0040)
 #define ICET_MAX_IMAGE_SPLIT    (ICET_STATE_ENGINE_START | (IceTEnum)0x0041)
+#define ICET_TARGET_FRAME_TIME  (ICET_STATE_ENGINE_START | (IceTEnum)0x0042)
+#define ICET_TRACE_FRAMES       (ICET_STATE_ENGINE_START | (IceTEnum)0x0043)
+#define ICET_FRAME_STATISTICS_WINDOW (ICET_STATE_ENGINE_START | (IceTEnum)0x0044)
+#define ICET_FRAME_HISTORY      (ICET_STATE_ENGINE_START | (IceTEnum)0x0045)
+#define ICET_FRAME_HISTORY_COUNT (ICET_STATE_ENGINE_START | (IceTEnum)0x0046)
+#define ICET_CAPTURE_ENCODING   (ICET_STATE_ENGINE_START | (IceTEnum)0x0047)
+#define ICET_CAPTURE_FILE_NAME  (ICET_STATE_ENGINE_START | (IceTEnum)0x0048)
+#define ICET_INPUT_COLOR_LAYOUT (ICET_STATE_ENGINE_START | (IceTEnum)0x0049)
+#define ICET_INPUT_DEPTH_LAYOUT (ICET_STATE_ENGINE_START | (IceTEnum)0x004A)
+#define ICET_COLLECT_FAN_IN     (ICET_STATE_ENGINE_START | (IceTEnum)0x004B)
+#define ICET_TILE_LOADS         (ICET_STATE_ENGINE_START | (IceTEnum)0x004C)
+#define ICET_TILE_LOAD_SAMPLE   (ICET_STATE_ENGINE_START | (IceTEnum)0x004D)
+#define ICET_TILE_PROCESS_COUNTS (ICET_STATE_ENGINE_START | (IceTEnum)0x004E)
 
 #define ICET_DRAW_FUNCTION      (ICET_STATE_ENGINE_START | (IceTEnum)0x0060)
 #define ICET_RENDER_LAYER_DESTRUCTOR (ICET_STATE_ENGINE_START|(IceTEnum)0x0061)
 #define ICET_RENDER_LAYER_HOLDS_BUFFER (ICET_STATE_ENGINE_START|(IceTEnum)0x0062)
 #define ICET_GET_RENDERED_BUFFER_IMAGE (ICET_STATE_ENGINE_START|(IceTEnum)0x0063)
 #define ICET_GET_COMPRESSED_RENDERED_BUFFER_IMAGE (ICET_STATE_ENGINE_START|(IceTEnum)0x0064)
+#define ICET_RENDER_LAYER_RECORDS_FRAME (ICET_STATE_ENGINE_START|(IceTEnum)0x0065)
 
 #define ICET_STATE_FRAME_START  (IceTEnum)0x00000080
 
@@ -336,6 +489,22 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 #define ICET_PRE_RENDERED       (ICET_STATE_FRAME_START | (IceTEnum)0x0022)
 #define ICET_TILE_PROJECTIONS   (ICET_STATE_FRAME_START | (IceTEnum)0x0023)
 #define ICET_SPARSE_TILE_BUFFER (ICET_STATE_FRAME_START | (IceTEnum)0x0024)
+#define ICET_RENDER_SCALE       (ICET_STATE_FRAME_START | (IceTEnum)0x0025)
+#define ICET_RENDER_SPANS       (ICET_STATE_FRAME_START | (IceTEnum)0x0026)
+#define ICET_RENDER_SPAN_OFFSETS (ICET_STATE_FRAME_START | (IceTEnum)0x0027)
+#define ICET_VIEW_INDEX         (ICET_STATE_FRAME_START | (IceTEnum)0x0028)
+#define ICET_VIEW_CONTAINED_MASKS (ICET_STATE_FRAME_START | (IceTEnum)0x0029)
+#define ICET_VIEW_IMAGES        (ICET_STATE_FRAME_START | (IceTEnum)0x002A)
+#define ICET_VIEW_VALID_PIXELS  (ICET_STATE_FRAME_START | (IceTEnum)0x002B)
+#define ICET_VIEW_STACK_BUFFER  (ICET_STATE_FRAME_START | (IceTEnum)0x002C)
+#define ICET_NUM_STACKED_VIEWS  (ICET_STATE_FRAME_START | (IceTEnum)0x002D)
+
+#define ICET_SCALED_GLOBAL_VIEWPORT (ICET_STATE_FRAME_START | (IceTEnum)0x0030)
+#define ICET_SCALED_TILE_VIEWPORTS (ICET_STATE_FRAME_START | (IceTEnum)0x0031)
+#define ICET_SCALED_TILE_MAX_WIDTH (ICET_STATE_FRAME_START | (IceTEnum)0x0032)
+#define ICET_SCALED_TILE_MAX_HEIGHT (ICET_STATE_FRAME_START | (IceTEnum)0x0033)
+#define ICET_SCALED_PHYSICAL_RENDER_WIDTH (ICET_STATE_FRAME_START | (IceTEnum)0x0034)
+#define ICET_SCALED_PHYSICAL_RENDER_HEIGHT (ICET_STATE_FRAME_START | (IceTEnum)0x0035)
 
 #define ICET_STATE_TIMING_START (IceTEnum)0x000000C0
 
@@ -350,11 +519,17 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 #define ICET_COLLECT_TIME       (ICET_STATE_TIMING_START | (IceTEnum)0x0008)
 #define ICET_TOTAL_DRAW_TIME    (ICET_STATE_TIMING_START | (IceTEnum)0x0009)
 #define ICET_BYTES_SENT         (ICET_STATE_TIMING_START | (IceTEnum)0x000A)
+#define ICET_NUM_ROUNDS         (ICET_STATE_TIMING_START | (IceTEnum)0x000B)
+#define ICET_ROUND_STATISTICS   (ICET_STATE_TIMING_START | (IceTEnum)0x000C)
+#define ICET_NUM_ROUND_PARTNERS (ICET_STATE_TIMING_START | (IceTEnum)0x000D)
+#define ICET_ROUND_PARTNER_STATISTICS (ICET_STATE_TIMING_START | (IceTEnum)0x000E)
 
 #define ICET_DRAW_START_TIME    (ICET_STATE_TIMING_START | (IceTEnum)0x0010)
 #define ICET_DRAW_TIME_ID       (ICET_STATE_TIMING_START | (IceTEnum)0x0011)
 #define ICET_SUBFUNC_START_TIME (ICET_STATE_TIMING_START | (IceTEnum)0x0012)
 #define ICET_SUBFUNC_TIME_ID    (ICET_STATE_TIMING_START | (IceTEnum)0x0013)
+#define ICET_ROUND_ACTIVE       (ICET_STATE_TIMING_START | (IceTEnum)0x0014)
+#define ICET_COMM_TIMING_ACTIVE (ICET_STATE_TIMING_START | (IceTEnum)0x0015)
 
 #define ICET_RENDER_LAYER_ID    (IceTEnum)0x000000FF
 
@@ -372,6 +547,10 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 #define ICET_INTERLACE_IMAGES   (ICET_STATE_ENABLE_START | (IceTEnum)0x0005)
 #define ICET_COLLECT_IMAGES     (ICET_STATE_ENABLE_START | (IceTEnum)0x0006)
 #define ICET_RENDER_EMPTY_IMAGES (ICET_STATE_ENABLE_START | (IceTEnum)0x0007)
+#define ICET_OPACITY_CULLING    (ICET_STATE_ENABLE_START | (IceTEnum)0x0008)
+#define ICET_OCCLUSION_CULLING  (ICET_STATE_ENABLE_START | (IceTEnum)0x0009)
+#define ICET_PIPELINE_TILES     (ICET_STATE_ENABLE_START | (IceTEnum)0x000A)
+#define ICET_BALANCE_TILES      (ICET_STATE_ENABLE_START | (IceTEnum)0x000B)
 
 /* This set of enable state variables are reserved for the rendering layer. */
 #define ICET_RENDER_LAYER_ENABLE_START (ICET_STATE_ENABLE_START | (IceTEnum)0x0030)
@@ -393,6 +572,13 @@ ICET_EXPORT void icetDiagnostics(IceTBitField mask);
 #define ICET_STRATEGY_COMMON_BUF_0 (ICET_CORE_BUFFER_START | (IceTEnum)0x0006)
 #define ICET_STRATEGY_COMMON_BUF_1 (ICET_CORE_BUFFER_START | (IceTEnum)0x0007)
 #define ICET_STRATEGY_COMMON_BUF_2 (ICET_CORE_BUFFER_START | (IceTEnum)0x0008)
+#define ICET_RENDER_SCALE_BUF   (ICET_CORE_BUFFER_START | (IceTEnum)0x0009)
+#define ICET_ENCODE_FRAGMENT_BUF (ICET_CORE_BUFFER_START | (IceTEnum)0x000A)
+#define ICET_ENCODE_INFO_BUF    (ICET_CORE_BUFFER_START | (IceTEnum)0x000B)
+#define ICET_ENCODE_RESULT_BUF  (ICET_CORE_BUFFER_START | (IceTEnum)0x000C)
+#define ICET_TRACE_FILE_BUF     (ICET_CORE_BUFFER_START | (IceTEnum)0x000D)
+#define ICET_TRACE_BUF          (ICET_CORE_BUFFER_START | (IceTEnum)0x000E)
+#define ICET_CAPTURE_BUF        (ICET_CORE_BUFFER_START | (IceTEnum)0x000F)
 
 #define ICET_RENDER_LAYER_BUFFER_START (ICET_STATE_BUFFER_START | (IceTEnum)0x0010)
 #define ICET_RENDER_LAYER_BUFFER_END   (ICET_STATE_BUFFER_START | (IceTEnum)0x0020)
@@ -13,6 +13,8 @@
 #include <IceT.h>
 #include <IceTDevState.h>
 
+#include <float.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -62,6 +64,11 @@ ICET_EXPORT IceTVoid *icetImageGetDepthVoid(IceTImage image,
 ICET_EXPORT const IceTVoid *icetImageGetDepthConstVoid(
                                                       const IceTImage image,
                                                       IceTSizeType *pixel_size);
+ICET_EXPORT IceTVoid *icetImageGetAuxiliaryVoid(IceTImage image,
+                                                IceTSizeType *pixel_size);
+ICET_EXPORT const IceTVoid *icetImageGetAuxiliaryConstVoid(
+                                                      const IceTImage image,
+                                                      IceTSizeType *pixel_size);
 ICET_EXPORT IceTBoolean icetImageEqual(const IceTImage image1,
                                        const IceTImage image2);
 ICET_EXPORT void icetImageCopyPixels(const IceTImage in_image,
@@ -121,6 +128,27 @@ ICET_EXPORT void icetSparseImageCopyPixels(const IceTSparseImage in_image,
                                            IceTSizeType num_pixels,
                                            IceTSparseImage out_image);
 
+ICET_EXPORT IceTSizeType icetSparseImageOpacityMaskBufferSize(
+                                                      IceTSizeType num_pixels);
+ICET_EXPORT IceTSizeType icetSparseImageGetOpacityMask(
+                                                   const IceTSparseImage image,
+                                                   IceTVoid *mask_buffer);
+ICET_EXPORT void icetSparseImageCullOpaque(const IceTSparseImage in_image,
+                                           const IceTVoid *mask_buffer,
+                                           IceTSparseImage out_image);
+
+ICET_EXPORT IceTSizeType icetSparseImageNumDepthBlocks(
+                                                   const IceTSparseImage image,
+                                                   IceTSizeType block_size);
+ICET_EXPORT void icetSparseImageGetBlockMaxDepth(const IceTSparseImage image,
+                                                 IceTSizeType block_size,
+                                                 IceTFloat *block_depths);
+ICET_EXPORT void icetSparseImageCullDepthBlocks(
+                                                const IceTSparseImage in_image,
+                                                IceTSizeType block_size,
+                                                const IceTFloat *block_depths,
+                                                IceTSparseImage out_image);
+
 ICET_EXPORT void icetSparseImageSplit(const IceTSparseImage in_image,
                                       IceTSizeType in_image_offset,
                                       IceTInt num_partitions,
@@ -147,6 +175,15 @@ ICET_EXPORT void icetClearSparseImage(IceTSparseImage image);
 
 ICET_EXPORT void icetGetTileImage(IceTInt tile, IceTImage image);
 
+/* Frame capture (see icetCaptureFrames) copies each rendered tile into a
+   global image and writes it when the frame is finished. */
+ICET_EXPORT void icetCaptureFrameBegin(void);
+ICET_EXPORT void icetCaptureTile(IceTInt tile,
+                                 const IceTImage tile_image,
+                                 const IceTInt *screen_viewport,
+                                 const IceTInt *target_viewport);
+ICET_EXPORT void icetCaptureFrameEnd(void);
+
 typedef void (*IceTGetRenderedBufferImage)(IceTImage target_image,
                                            IceTInt *rendered_viewport,
                                            IceTInt *target_viewport);
@@ -203,6 +240,15 @@ ICET_EXPORT void icetCompressedSubComposite(IceTImage destBuffer,
                                             const IceTSparseImage srcBuffer,
                                             int srcOnTop);
 
+/* Composites several compressed images into destBuffer in a single pass.
+   The result is the same as calling icetCompressedComposite with each of
+   the numSrc images in srcBuffers in turn, but each pixel of destBuffer is
+   read and written once rather than once per image. */
+ICET_EXPORT void icetCompressedCompositeMany(IceTImage destBuffer,
+                                             const IceTSparseImage *srcBuffers,
+                                             IceTInt numSrc,
+                                             int srcOnTop);
+
 ICET_EXPORT void icetCompressedCompressedComposite(
                                              const IceTSparseImage front_buffer,
                                              const IceTSparseImage back_buffer,
@@ -235,6 +281,73 @@ ICET_EXPORT void icetClearImageTrueBackground(IceTImage image);
 #define ICET_OVER_FLOAT(src, dest)  ICET_BLEND_FLOAT(src, dest, dest)
 #define ICET_UNDER_FLOAT(src, dest) ICET_BLEND_FLOAT(dest, src, dest)
 
+/* The max, min, and add composite modes reduce each color component on its
+   own.  They are commutative and use neither depth nor compositing order. */
+#define ICET_COMPOSITE_MODE_IS_REDUCTION(mode)                          \
+    (   ((mode) == ICET_COMPOSITE_MODE_MAX)                             \
+     || ((mode) == ICET_COMPOSITE_MODE_MIN)                             \
+     || ((mode) == ICET_COMPOSITE_MODE_ADD) )
+
+/* The value of each color component that leaves a reduction unchanged.
+   Pixels holding it are empty.  Float colors are not limited to 1, so the
+   float identity of the minimum is the largest float. */
+#define ICET_REDUCTION_IDENTITY_FLOAT(mode)                             \
+    (((mode) == ICET_COMPOSITE_MODE_MIN) ? FLT_MAX : 0.0f)
+#define ICET_REDUCTION_IDENTITY_WORD(mode)                              \
+    (((mode) == ICET_COMPOSITE_MODE_MIN) ? (IceTUInt)0xFFFFFFFF : 0)
+
+#define ICET_MAX_UBYTE(src, dest)                                       \
+{                                                                       \
+    (dest)[0] = ((src)[0] > (dest)[0]) ? (src)[0] : (dest)[0];          \
+    (dest)[1] = ((src)[1] > (dest)[1]) ? (src)[1] : (dest)[1];          \
+    (dest)[2] = ((src)[2] > (dest)[2]) ? (src)[2] : (dest)[2];          \
+    (dest)[3] = ((src)[3] > (dest)[3]) ? (src)[3] : (dest)[3];          \
+}
+
+#define ICET_MIN_UBYTE(src, dest)                                       \
+{                                                                       \
+    (dest)[0] = ((src)[0] < (dest)[0]) ? (src)[0] : (dest)[0];          \
+    (dest)[1] = ((src)[1] < (dest)[1]) ? (src)[1] : (dest)[1];          \
+    (dest)[2] = ((src)[2] < (dest)[2]) ? (src)[2] : (dest)[2];          \
+    (dest)[3] = ((src)[3] < (dest)[3]) ? (src)[3] : (dest)[3];          \
+}
+
+#define ICET_ADD_UBYTE_COMPONENT(src, dest)                             \
+    (dest) = (IceTUByte)(((IceTUInt)(src) + (dest) > 255)               \
+                         ? 255 : (src) + (dest))
+
+#define ICET_ADD_UBYTE(src, dest)                                       \
+{                                                                       \
+    ICET_ADD_UBYTE_COMPONENT((src)[0], (dest)[0]);                      \
+    ICET_ADD_UBYTE_COMPONENT((src)[1], (dest)[1]);                      \
+    ICET_ADD_UBYTE_COMPONENT((src)[2], (dest)[2]);                      \
+    ICET_ADD_UBYTE_COMPONENT((src)[3], (dest)[3]);                      \
+}
+
+#define ICET_MAX_FLOAT(src, dest)                                       \
+{                                                                       \
+    (dest)[0] = ((src)[0] > (dest)[0]) ? (src)[0] : (dest)[0];          \
+    (dest)[1] = ((src)[1] > (dest)[1]) ? (src)[1] : (dest)[1];          \
+    (dest)[2] = ((src)[2] > (dest)[2]) ? (src)[2] : (dest)[2];          \
+    (dest)[3] = ((src)[3] > (dest)[3]) ? (src)[3] : (dest)[3];          \
+}
+
+#define ICET_MIN_FLOAT(src, dest)                                       \
+{                                                                       \
+    (dest)[0] = ((src)[0] < (dest)[0]) ? (src)[0] : (dest)[0];          \
+    (dest)[1] = ((src)[1] < (dest)[1]) ? (src)[1] : (dest)[1];          \
+    (dest)[2] = ((src)[2] < (dest)[2]) ? (src)[2] : (dest)[2];          \
+    (dest)[3] = ((src)[3] < (dest)[3]) ? (src)[3] : (dest)[3];          \
+}
+
+#define ICET_ADD_FLOAT(src, dest)                                       \
+{                                                                       \
+    (dest)[0] += (src)[0];                                              \
+    (dest)[1] += (src)[1];                                              \
+    (dest)[2] += (src)[2];                                              \
+    (dest)[3] += (src)[3];                                              \
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,11 @@ ICET_EXPORT void icetPutEnv(const char *name, const char *value);
 ICET_EXPORT IceTSizeType icetSnprintf(char *buffer, IceTSizeType size,
                                       const char *format, ...);
 
+/* Increments the counter and returns its previous value.  The increment is
+   atomic where the platform provides it. */
+ICET_EXPORT IceTUnsignedInt64 icetFetchAndIncrement(
+                                         volatile IceTUnsignedInt64 *counter);
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,6 +44,44 @@ ICET_EXPORT void icetTimingCollectEnd(void);
 ICET_EXPORT void icetTimingDrawFrameBegin(void);
 ICET_EXPORT void icetTimingDrawFrameEnd(void);
 
+/* Adds the timings of the frame just drawn to the history used by
+   icetGetFrameStatistics. */
+ICET_EXPORT void icetTimingRecordFrame(void);
+
+/* Single image strategies bracket each round of communication with these.
+   While a round is active, bytes sent, time blocked in communication and
+   blend time are added to the round's entry in ICET_ROUND_STATISTICS.
+   Rounds beyond ICET_MAX_ROUNDS in a frame are not recorded.
+
+   icetTimingRoundSent and icetTimingRoundReceived add bytes exchanged with a
+   partner to the round total and to the partner's entry in
+   ICET_ROUND_PARTNER_STATISTICS.  The communication layer records sends.
+   Strategies record the size of each sparse image they receive in a round.
+   Give a partner of -1 for collective operations; they only count toward
+   the total.  Partner entries beyond ICET_MAX_ROUND_PARTNERS in a frame are
+   not recorded. */
+#define ICET_MAX_ROUNDS 256
+#define ICET_MAX_ROUND_PARTNERS (8*ICET_MAX_ROUNDS)
+ICET_EXPORT void icetTimingRoundBegin(IceTInt k);
+ICET_EXPORT void icetTimingRoundEnd(void);
+ICET_EXPORT void icetTimingRoundAccumulate(IceTInt statistic,
+                                          IceTDouble value);
+ICET_EXPORT void icetTimingRoundSent(IceTInt partner, IceTSizeType bytes);
+ICET_EXPORT void icetTimingRoundReceived(IceTInt partner, IceTSizeType bytes);
+
+/* Record events in the trace file set with icetTraceFile.  The name must be a
+   string that stays valid until the trace is written (such as a literal).
+   icetTraceComm records an event that started at start_time and ends now.
+   Set peer to -1 for operations that do not have a single peer and bytes to
+   -1 for operations that do not move data. */
+ICET_EXPORT void icetTraceBegin(const char *name);
+ICET_EXPORT void icetTraceEnd(const char *name);
+ICET_EXPORT void icetTraceComm(const char *name,
+                               IceTDouble start_time,
+                               IceTSizeType bytes,
+                               IceTInt peer,
+                               IceTInt tag);
+
 #ifdef __cplusplus
 }
 #endif
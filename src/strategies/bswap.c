@@ -12,6 +12,7 @@
 #include <IceTDevCommunication.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevImage.h>
+#include <IceTDevTiming.h>
 
 #include <string.h>
 
@@ -428,6 +429,8 @@ static void bswapComposePow2(const IceTInt *compose_group,
             IceTVoid *in_image_buffer;
             IceTSparseImage in_image;
 
+            icetTimingRoundBegin(2);
+
             icetSparseImagePackageForSend(send_image,
                                           &package_buffer,
                                           &package_size);
@@ -449,6 +452,9 @@ static void bswapComposePow2(const IceTInt *compose_group,
 
             in_image
                 = icetSparseImageUnpackageFromReceive(in_image_buffer);
+            icetTimingRoundReceived(
+                              compose_group[pair],
+                              icetSparseImageGetCompressedBufferSize(in_image));
 
             if (inOnTop) {
                 icetCompressedCompressedComposite(in_image,
@@ -467,6 +473,8 @@ static void bswapComposePow2(const IceTInt *compose_group,
                 image_data = available_image;
                 available_image = old_image_data;
             }
+
+            icetTimingRoundEnd();
         }
     }
 
@@ -683,12 +691,17 @@ void icetBswapFoldingCompose(const IceTInt *compose_group,
                 IceTSparseImage in_image;
                 IceTSparseImage old_working_image;
 
+                icetTimingRoundBegin(2);
+
                 icetCommRecv(in_image_buffer,
                              incoming_size,
                              ICET_BYTE,
                              compose_group[whole_group_index+1],
                              BSWAP_FOLD);
                 in_image = icetSparseImageUnpackageFromReceive(in_image_buffer);
+                icetTimingRoundReceived(
+                              compose_group[whole_group_index+1],
+                              icetSparseImageGetCompressedBufferSize(in_image));
 
                 icetCompressedCompressedComposite(working_image,
                                                   in_image,
@@ -696,11 +709,15 @@ void icetBswapFoldingCompose(const IceTInt *compose_group,
                 old_working_image = working_image;
                 working_image = available_image;
                 available_image = old_working_image;
+
+                icetTimingRoundEnd();
             } else if (group_rank == whole_group_index + 1) {
                 /* I need to send my image to get folded then drop out. */
                 IceTVoid *package_buffer;
                 IceTSizeType package_size;
 
+                icetTimingRoundBegin(2);
+
                 icetSparseImagePackageForSend(working_image,
                                               &package_buffer, &package_size);
 
@@ -710,6 +727,8 @@ void icetBswapFoldingCompose(const IceTInt *compose_group,
                              compose_group[whole_group_index],
                              BSWAP_FOLD);
 
+                icetTimingRoundEnd();
+
                 *result_image = icetSparseImageNull();
                 *piece_offset = 0;
                 return;
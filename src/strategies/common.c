@@ -19,12 +19,46 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef MIN
+#define MIN(x, y)       ((x) < (y) ? (x) : (y))
+#endif
+#ifndef MAX
+#define MAX(x, y)       ((x) < (y) ? (y) : (x))
+#endif
+
 #define FULL_IMAGE_DATA 20
 
 #define LARGE_MESSAGE 23
 
-static IceTImage rtfi_image;
-static IceTBoolean rtfi_first;
+#define DEPTH_BLOCK_REDUCE 24
+#define DEPTH_BLOCK_BROADCAST 25
+
+#define TREE_COLLECT_SIZE 30
+#define TREE_COLLECT_DATA 31
+
+/* The most incoming images icetRenderTransferFullImages holds before
+   compositing them together. */
+#define RTFI_MAX_BATCH 16
+
+/* The state of the callbacks of the transfers below is kept per thread so
+   that contexts on different threads can composite at the same time. */
+static ICET_THREAD_LOCAL IceTImage rtfi_image;
+static ICET_THREAD_LOCAL IceTBoolean rtfi_first;
+static ICET_THREAD_LOCAL IceTBoolean rtfi_ordered;
+static ICET_THREAD_LOCAL IceTByte *rtfi_in_buffers;
+static ICET_THREAD_LOCAL IceTSizeType rtfi_in_buffer_stride;
+static ICET_THREAD_LOCAL IceTInt rtfi_num_in_buffers;
+static ICET_THREAD_LOCAL IceTInt rtfi_recv_buffer;
+static ICET_THREAD_LOCAL IceTSparseImage rtfi_batch[RTFI_MAX_BATCH];
+static ICET_THREAD_LOCAL IceTInt rtfi_batch_count;
+static ICET_THREAD_LOCAL IceTBoolean rtfi_batch_on_top;
+/* Incoming buffers are padded so that each one starts aligned. */
+static IceTSizeType rtfi_inBufferStride(void) {
+    IceTInt width, height;
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &height);
+    return (icetSparseImageBufferSize(width, height) + 7) & ~(IceTSizeType)7;
+}
 static IceTVoid *rtfi_generateDataFunc(IceTInt id, IceTInt dest,
                                        IceTSizeType *size) {
     IceTInt rank;
@@ -45,7 +79,29 @@ static IceTVoid *rtfi_generateDataFunc(IceTInt id, IceTInt dest,
     icetSparseImagePackageForSend(outSparseImage, &outBuffer, size);
     return outBuffer;
 }
-static void rtfi_handleDataFunc(void *inSparseImageBuffer, IceTInt src) {
+static void rtfi_compositeBatch(void) {
+    IceTInt first = 0;
+
+    if (rtfi_batch_count < 1) return;
+
+    if (rtfi_first) {
+        icetDecompressImage(rtfi_batch[0], rtfi_image);
+        rtfi_first = ICET_FALSE;
+        first = 1;
+    }
+    if (first < rtfi_batch_count) {
+        icetCompressedCompositeMany(rtfi_image,
+                                    rtfi_batch + first,
+                                    rtfi_batch_count - first,
+                                    rtfi_batch_on_top);
+    }
+    rtfi_batch_count = 0;
+}
+static IceTVoid *rtfi_handleDataFunc(void *inSparseImageBuffer,
+                                     IceTInt src) {
+    IceTSparseImage inSparseImage;
+    IceTBoolean on_top;
+
     if (inSparseImageBuffer == NULL) {
       /* Superfluous call from send to self. */
         if (!rtfi_first) {
@@ -53,24 +109,45 @@ static void rtfi_handleDataFunc(void *inSparseImageBuffer, IceTInt src) {
                            "Unexpected callback order"
                            " in icetRenderTransferFullImages.");
         }
+        rtfi_first = ICET_FALSE;
+        return NULL;
+    }
+
+    inSparseImage = icetSparseImageUnpackageFromReceive(inSparseImageBuffer);
+    if (rtfi_ordered) {
+        IceTInt rank;
+        const IceTInt *process_orders;
+        icetGetIntegerv(ICET_RANK, &rank);
+        process_orders = icetUnsafeStateGetInteger(ICET_PROCESS_ORDERS);
+        on_top = (process_orders[src] < process_orders[rank]);
     } else {
-        IceTSparseImage inSparseImage
-            = icetSparseImageUnpackageFromReceive(inSparseImageBuffer);
-        if (rtfi_first) {
-            icetDecompressImage(inSparseImage, rtfi_image);
-        } else {
-            IceTInt rank;
-            const IceTInt *process_orders;
-            icetGetIntegerv(ICET_RANK, &rank);
-            process_orders = icetUnsafeStateGetInteger(ICET_PROCESS_ORDERS);
-            icetCompressedComposite(rtfi_image, inSparseImage,
-                                    process_orders[src] < process_orders[rank]);
-        }
+        on_top = ICET_TRUE;
     }
-    rtfi_first = ICET_FALSE;
+
+  /* Ordered images come in moving away from this process, first in front
+     of it and then behind it.  A batch holds images from one side only so
+     that they can be composited in the order received. */
+    if ((rtfi_batch_count > 0) && (on_top != rtfi_batch_on_top)) {
+        rtfi_compositeBatch();
+    }
+    rtfi_batch[rtfi_batch_count++] = inSparseImage;
+    rtfi_batch_on_top = on_top;
+    if (rtfi_batch_count >= rtfi_num_in_buffers) {
+        rtfi_compositeBatch();
+    }
+
+  /* The batch holds the buffers received into most recently, so the next
+     one around is free. */
+    rtfi_recv_buffer = (rtfi_recv_buffer + 1)%rtfi_num_in_buffers;
+    return rtfi_in_buffers + rtfi_recv_buffer*rtfi_in_buffer_stride;
+}
+IceTSizeType icetRenderTransferFullImagesBufferSize(IceTInt numInBuffers)
+{
+    return MAX(1, MIN(numInBuffers, RTFI_MAX_BATCH))*rtfi_inBufferStride();
 }
 void icetRenderTransferFullImages(IceTImage image,
-                                  IceTVoid *inSparseImageBuffer,
+                                  IceTVoid *inSparseImageBuffers,
+                                  IceTInt numInBuffers,
                                   IceTInt *tile_image_dest)
 {
     IceTInt num_sending;
@@ -81,15 +158,21 @@ void icetRenderTransferFullImages(IceTImage image,
 
     IceTInt i;
 
-    rtfi_image = image;
-    rtfi_first = ICET_TRUE;
-
     icetGetIntegerv(ICET_NUM_CONTAINED_TILES, &num_sending);
     tile_list = icetUnsafeStateGetInteger(ICET_CONTAINED_TILES_LIST);
-    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &width);
-    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &height);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &height);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
 
+    rtfi_image = image;
+    rtfi_first = ICET_TRUE;
+    rtfi_ordered = icetIsEnabled(ICET_ORDERED_COMPOSITE);
+    rtfi_in_buffers = inSparseImageBuffers;
+    rtfi_in_buffer_stride = rtfi_inBufferStride();
+    rtfi_num_in_buffers = MAX(1, MIN(numInBuffers, RTFI_MAX_BATCH));
+    rtfi_recv_buffer = 0;
+    rtfi_batch_count = 0;
+
     imageDestinations = malloc(num_tiles * sizeof(IceTInt));
 
   /* Make each element imageDestinations point to the processor to send the
@@ -99,17 +182,19 @@ void icetRenderTransferFullImages(IceTImage image,
     }
 
     icetSendRecvLargeMessages(num_sending, imageDestinations,
-                              icetIsEnabled(ICET_ORDERED_COMPOSITE),
+                              rtfi_ordered,
                               rtfi_generateDataFunc, rtfi_handleDataFunc,
-                              inSparseImageBuffer,
+                              inSparseImageBuffers,
                               icetSparseImageBufferSize(width, height));
 
+    rtfi_compositeBatch();
+
     free(imageDestinations);
 }
 
-static IceTSparseImage rtsi_workingImage;
-static IceTSparseImage rtsi_availableImage;
-static IceTBoolean rtsi_first;
+static ICET_THREAD_LOCAL IceTSparseImage rtsi_workingImage;
+static ICET_THREAD_LOCAL IceTSparseImage rtsi_availableImage;
+static ICET_THREAD_LOCAL IceTBoolean rtsi_first;
 static IceTVoid *rtsi_generateDataFunc(IceTInt id, IceTInt dest,
                                        IceTSizeType *size) {
     const IceTInt *tile_list
@@ -122,7 +207,8 @@ static IceTVoid *rtsi_generateDataFunc(IceTInt id, IceTInt dest,
     icetSparseImagePackageForSend(outSparseImage, &outBuffer, size);
     return outBuffer;
 }
-static void rtsi_handleDataFunc(void *inSparseImageBuffer, IceTInt src) {
+static IceTVoid *rtsi_handleDataFunc(void *inSparseImageBuffer,
+                                     IceTInt src) {
     IceTSparseImage inSparseImage
         = icetSparseImageUnpackageFromReceive(inSparseImageBuffer);
     if (rtsi_first) {
@@ -154,6 +240,7 @@ static void rtsi_handleDataFunc(void *inSparseImageBuffer, IceTInt src) {
         rtsi_availableImage = old_workingImage;
     }
     rtsi_first = ICET_FALSE;
+    return inSparseImageBuffer;
 }
 IceTSparseImage icetRenderTransferSparseImages(IceTSparseImage compositeImage1,
                                                IceTSparseImage compositeImage2,
@@ -174,8 +261,8 @@ IceTSparseImage icetRenderTransferSparseImages(IceTSparseImage compositeImage1,
 
     icetGetIntegerv(ICET_NUM_CONTAINED_TILES, &num_sending);
     tile_list = icetUnsafeStateGetInteger(ICET_CONTAINED_TILES_LIST);
-    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &width);
-    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &height);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &height);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
 
     imageDestinations = malloc(num_tiles * sizeof(IceTInt));
@@ -468,7 +555,7 @@ static void icetDoSendRecvLarge(const IceTInt *sendIds,
         IceTVoid *data;
         icetRaiseDebug("Sending to self.");
         data = (*generateDataFunc)(sendIds[rank], rank, &data_size);
-        (*handleDataFunc)(data, rank);
+        (void)(*handleDataFunc)(data, rank);
     }
 
     /* We have to create a communication pattern that is guaranteed not to
@@ -532,9 +619,9 @@ static void icetDoSendRecvLarge(const IceTInt *sendIds,
                 if (messagesInOrder) {
                     src_rank = composite_order[recv_order_idx];
                 } else {
-                    src_rank = recv_iter_state;
+                    src_rank = recv_order_idx;
                 }
-                (*handleDataFunc)(incomingBuffer, src_rank);
+                incomingBuffer = (*handleDataFunc)(incomingBuffer, src_rank);
             }
         }
     }
@@ -568,6 +655,128 @@ void icetSendRecvLargeMessages(IceTInt numMessagesSending,
                         bufferSize);
 }
 
+#define ICET_OCCLUSION_CULL_DEPTH_BUF   ICET_STRATEGY_COMMON_BUF_0
+#define ICET_OCCLUSION_CULL_IMAGE_BUF   ICET_STRATEGY_COMMON_BUF_2
+
+#define ICET_OCCLUSION_CULL_BLOCK_SIZE  16
+
+static IceTBoolean icetSingleImageUseOcclusionCulling(IceTInt group_size)
+{
+    IceTEnum composite_mode;
+    IceTEnum depth_format;
+
+    if (group_size < 2) { return ICET_FALSE; }
+    if (!icetIsEnabled(ICET_OCCLUSION_CULLING)) { return ICET_FALSE; }
+
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+    if (composite_mode != ICET_COMPOSITE_MODE_Z_BUFFER) { return ICET_FALSE; }
+
+    icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+    return (depth_format == ICET_IMAGE_DEPTH_FLOAT);
+}
+
+/* Finds the minimum over the compose group of each entry in block_depths.  A
+   binomial tree reduces the values to the first process in the group, and the
+   same tree in reverse broadcasts the result back out. */
+static void icetSingleImageReduceBlockDepths(const IceTInt *compose_group,
+                                             IceTInt group_size,
+                                             IceTInt group_rank,
+                                             IceTFloat *block_depths,
+                                             IceTFloat *incoming_depths,
+                                             IceTSizeType num_blocks)
+{
+    IceTInt parent_mask;
+    IceTInt mask;
+    IceTSizeType i;
+
+    parent_mask = 0;
+    for (mask = 1; mask < group_size; mask <<= 1) {
+        if (group_rank & mask) {
+            icetCommSend(block_depths,
+                         num_blocks,
+                         ICET_FLOAT,
+                         compose_group[group_rank - mask],
+                         DEPTH_BLOCK_REDUCE);
+            parent_mask = mask;
+            break;
+        }
+        if (group_rank + mask < group_size) {
+            icetCommRecv(incoming_depths,
+                         num_blocks,
+                         ICET_FLOAT,
+                         compose_group[group_rank + mask],
+                         DEPTH_BLOCK_REDUCE);
+            for (i = 0; i < num_blocks; i++) {
+                block_depths[i] = MIN(block_depths[i], incoming_depths[i]);
+            }
+        }
+    }
+
+    if (parent_mask != 0) {
+        icetCommRecv(block_depths,
+                     num_blocks,
+                     ICET_FLOAT,
+                     compose_group[group_rank - parent_mask],
+                     DEPTH_BLOCK_BROADCAST);
+        mask = parent_mask >> 1;
+    } else {
+        /* Root of the tree. Mask is one past the last child. */
+        mask >>= 1;
+    }
+    for ( ; mask > 0; mask >>= 1) {
+        if (group_rank + mask < group_size) {
+            icetCommSend(block_depths,
+                         num_blocks,
+                         ICET_FLOAT,
+                         compose_group[group_rank + mask],
+                         DEPTH_BLOCK_BROADCAST);
+        }
+    }
+}
+
+/* Removes pixels from input_image that are certainly hidden.  Every process in
+   the group finds the farthest depth it has in each block of pixels.  The
+   nearest of these is a depth behind which nothing in the block can be
+   visible. */
+static void icetSingleImageCullOccluded(const IceTInt *compose_group,
+                                        IceTInt group_size,
+                                        IceTSparseImage input_image)
+{
+    IceTInt group_rank;
+    IceTSizeType num_blocks;
+    IceTFloat *block_depths;
+    IceTSparseImage culled_image;
+
+    group_rank = icetFindMyRankInGroup(compose_group, group_size);
+    num_blocks = icetSparseImageNumDepthBlocks(input_image,
+                                               ICET_OCCLUSION_CULL_BLOCK_SIZE);
+    block_depths = icetGetStateBuffer(ICET_OCCLUSION_CULL_DEPTH_BUF,
+                                      2*num_blocks*sizeof(IceTFloat));
+
+    icetSparseImageGetBlockMaxDepth(input_image,
+                                    ICET_OCCLUSION_CULL_BLOCK_SIZE,
+                                    block_depths);
+    icetSingleImageReduceBlockDepths(compose_group,
+                                     group_size,
+                                     group_rank,
+                                     block_depths,
+                                     block_depths + num_blocks,
+                                     num_blocks);
+
+    culled_image = icetGetStateBufferSparseImage(
+                                     ICET_OCCLUSION_CULL_IMAGE_BUF,
+                                     icetSparseImageGetWidth(input_image),
+                                     icetSparseImageGetHeight(input_image));
+    icetSparseImageCullDepthBlocks(input_image,
+                                   ICET_OCCLUSION_CULL_BLOCK_SIZE,
+                                   block_depths,
+                                   culled_image);
+    icetSparseImageCopyPixels(culled_image,
+                              0,
+                              icetSparseImageGetNumPixels(culled_image),
+                              input_image);
+}
+
 void icetSingleImageCompose(const IceTInt *compose_group,
                             IceTInt group_size,
                             IceTInt image_dest,
@@ -577,6 +786,10 @@ void icetSingleImageCompose(const IceTInt *compose_group,
 {
     IceTEnum strategy;
 
+    if (icetSingleImageUseOcclusionCulling(group_size)) {
+        icetSingleImageCullOccluded(compose_group, group_size, input_image);
+    }
+
     icetGetEnumv(ICET_SINGLE_IMAGE_STRATEGY, &strategy);
     icetInvokeSingleImageStrategy(strategy,
                                   compose_group,
@@ -587,8 +800,295 @@ void icetSingleImageCompose(const IceTInt *compose_group,
                                   piece_offset);
 }
 
+#define ICET_OPACITY_CULL_MASK_BUF      ICET_STRATEGY_COMMON_BUF_0
+#define ICET_OPACITY_CULL_REQUEST_BUF   ICET_STRATEGY_COMMON_BUF_1
+#define ICET_OPACITY_CULL_IMAGE_BUF     ICET_STRATEGY_COMMON_BUF_2
+
+IceTBoolean icetSingleImageUseOpacityCulling(void)
+{
+    IceTEnum composite_mode;
+    IceTEnum color_format;
+
+    if (!icetIsEnabled(ICET_OPACITY_CULLING)) { return ICET_FALSE; }
+    if (!icetIsEnabled(ICET_ORDERED_COMPOSITE)) { return ICET_FALSE; }
+
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+    if (composite_mode != ICET_COMPOSITE_MODE_BLEND) { return ICET_FALSE; }
+
+    /* We can only tell if a pixel is opaque if it has an alpha channel. */
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    return (   (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE)
+            || (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) );
+}
+
+void icetSingleImageCullOccludedPieces(const IceTInt *compose_group,
+                                       IceTInt first_partner,
+                                       IceTInt partner_step,
+                                       IceTInt num_partners,
+                                       IceTInt my_partner_index,
+                                       IceTSparseImage *pieces,
+                                       IceTInt num_pieces,
+                                       IceTInt tag)
+{
+    IceTInt num_front_pieces = MIN(my_partner_index, num_pieces);
+    IceTBoolean sending_mask = (my_partner_index < num_pieces);
+    IceTSizeType max_piece_pixels;
+    IceTSizeType mask_slot_size;
+    IceTByte *mask_pool;
+    IceTCommRequest *requests;
+    IceTCommRequest *send_requests;
+    IceTCommRequest *receive_requests;
+    IceTInt i;
+
+    max_piece_pixels = 0;
+    for (i = 0; i < num_pieces; i++) {
+        max_piece_pixels = MAX(max_piece_pixels,
+                               icetSparseImageGetNumPixels(pieces[i]));
+    }
+    mask_slot_size = icetSparseImageOpacityMaskBufferSize(max_piece_pixels);
+
+    /* The first slot holds the mask for the piece this process collects.  The
+       rest hold masks for the pieces collected by processes in front. */
+    mask_pool = icetGetStateBuffer(ICET_OPACITY_CULL_MASK_BUF,
+                                   mask_slot_size*(num_front_pieces + 1));
+    requests = icetGetStateBuffer(ICET_OPACITY_CULL_REQUEST_BUF,
+                                  sizeof(IceTCommRequest)
+                                  *(num_partners + num_front_pieces));
+    send_requests = requests;
+    receive_requests = requests + num_partners;
+
+    for (i = 0; i < num_front_pieces; i++) {
+        receive_requests[i] =
+            icetCommIrecv(mask_pool + (i + 1)*mask_slot_size,
+                          mask_slot_size,
+                          ICET_BYTE,
+                          compose_group[first_partner + i*partner_step],
+                          tag);
+    }
+
+    /* Everyone behind this process in the composite order receives the
+       opacity of the piece collected here. */
+    for (i = 0; i < num_partners; i++) {
+        send_requests[i] = ICET_COMM_REQUEST_NULL;
+    }
+    if (sending_mask) {
+        IceTSizeType mask_size
+            = icetSparseImageGetOpacityMask(pieces[my_partner_index],
+                                            mask_pool);
+        for (i = my_partner_index + 1; i < num_partners; i++) {
+            send_requests[i] =
+                icetCommIsend(mask_pool,
+                              mask_size,
+                              ICET_BYTE,
+                              compose_group[first_partner + i*partner_step],
+                              tag);
+        }
+    }
+
+    if (num_front_pieces > 0) {
+        IceTSparseImage culled_image
+            = icetGetStateBufferSparseImage(ICET_OPACITY_CULL_IMAGE_BUF,
+                                            max_piece_pixels, 1);
+
+        icetCommWaitall(num_front_pieces, receive_requests);
+        for (i = 0; i < num_front_pieces; i++) {
+            icetSparseImageCullOpaque(pieces[i],
+                                      mask_pool + (i + 1)*mask_slot_size,
+                                      culled_image);
+            icetSparseImageCopyPixels(culled_image,
+                                      0,
+                                      icetSparseImageGetNumPixels(culled_image),
+                                      pieces[i]);
+        }
+    }
+
+    icetCommWaitall(num_partners, send_requests);
+}
+
 #define ICET_IMAGE_COLLECT_OFFSET_BUF ICET_STRATEGY_COMMON_BUF_0
 #define ICET_IMAGE_COLLECT_SIZE_BUF ICET_STRATEGY_COMMON_BUF_1
+#define ICET_IMAGE_COLLECT_TREE_BUF ICET_STRATEGY_COMMON_BUF_0
+#define ICET_IMAGE_COLLECT_CHILD_SIZE_BUF ICET_STRATEGY_COMMON_BUF_1
+#define ICET_IMAGE_COLLECT_REQUEST_BUF ICET_STRATEGY_COMMON_BUF_2
+
+/* Partitions at least this big are gathered directly.  Messages this large
+   are bandwidth bound, so incast costs little, and forwarding them through a
+   tree would only add hops. */
+#define TREE_COLLECT_MAX_PARTITION_BYTES ((IceTSizeType)(256*1024))
+
+/* Each record in a tree collect message is a header of two IceTSizeType
+   values (the piece offset and the number of bytes that follow) and a
+   packaged sparse image padded to keep the next header aligned. */
+#define TREE_COLLECT_HEADER_SIZE ((IceTSizeType)(2*sizeof(IceTSizeType)))
+#define TREE_COLLECT_PAD(size) (((size) + 7) & ~(IceTSizeType)7)
+
+/* The choice of collect algorithm must be the same on all processes, so base
+   it only on state shared by all of them. */
+static IceTBoolean collectUseTree(IceTInt numproc)
+{
+    IceTInt fan_in;
+    IceTInt max_width;
+    IceTInt max_height;
+    IceTSizeType partition_bytes;
+
+    icetGetIntegerv(ICET_COLLECT_FAN_IN, &fan_in);
+    if (numproc <= fan_in) {
+        /* The display process receives no more messages than it would from
+           its children in a tree. */
+        return ICET_FALSE;
+    }
+
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
+    partition_bytes = icetImageBufferSize(max_width, max_height)/numproc;
+
+    return (partition_bytes < TREE_COLLECT_MAX_PARTITION_BYTES);
+}
+
+/* Collects image pieces up a k-ary tree rooted at dest.  Each process
+   appends the compressed pieces of its subtree to its own and sends them to
+   its parent as a single message, so no process receives from more than
+   ICET_COLLECT_FAN_IN others.  The pieces are never decompressed until they
+   reach dest, which writes each straight into result_image at its offset. */
+static void icetSingleImageTreeCollect(const IceTSparseImage input_image,
+                                       IceTInt dest,
+                                       IceTSizeType piece_offset,
+                                       IceTImage result_image)
+{
+    IceTInt rank;
+    IceTInt numproc;
+    IceTInt fan_in;
+    IceTInt tree_rank;
+    IceTInt first_child;
+    IceTInt num_children;
+    IceTInt child;
+    IceTSizeType *child_sizes;
+    IceTCommRequest *requests;
+    IceTSizeType piece_size;
+    IceTSizeType own_size;
+    IceTSizeType message_size;
+    IceTByte *message;
+    IceTByte *data;
+
+    rank = icetCommRank();
+    numproc = icetCommSize();
+    icetGetIntegerv(ICET_COLLECT_FAN_IN, &fan_in);
+
+    /* Number processes so that dest is the root of the tree. */
+    tree_rank = (rank - dest + numproc)%numproc;
+    first_child = tree_rank*fan_in + 1;
+    if (first_child < numproc) {
+        num_children = MIN(fan_in, numproc - first_child);
+    } else {
+        num_children = 0;
+    }
+
+    piece_size = icetSparseImageGetNumPixels(input_image);
+    if ((rank == dest) && (piece_size > 0)) {
+        icetDecompressSubImageCorrectBackground(input_image,
+                                                piece_offset,
+                                                result_image);
+    }
+
+    child_sizes = icetGetStateBuffer(ICET_IMAGE_COLLECT_CHILD_SIZE_BUF,
+                                     sizeof(IceTSizeType)*(fan_in + 1));
+    requests = icetGetStateBuffer(ICET_IMAGE_COLLECT_REQUEST_BUF,
+                                  sizeof(IceTCommRequest)*fan_in);
+
+    icetTimingCollectBegin();
+
+    for (child = 0; child < num_children; child++) {
+        IceTInt child_rank = (first_child + child + dest)%numproc;
+        requests[child] = icetCommIrecv(&child_sizes[child],
+                                        1,
+                                        ICET_SIZE_TYPE,
+                                        child_rank,
+                                        TREE_COLLECT_SIZE);
+    }
+
+    if ((rank != dest) && (piece_size > 0)) {
+        own_size = icetSparseImageGetCompressedBufferSize(input_image);
+        own_size = TREE_COLLECT_HEADER_SIZE + TREE_COLLECT_PAD(own_size);
+    } else {
+        own_size = 0;
+    }
+
+    icetCommWaitall(num_children, requests);
+
+    message_size = own_size;
+    for (child = 0; child < num_children; child++) {
+        message_size += child_sizes[child];
+    }
+    message = icetGetStateBuffer(ICET_IMAGE_COLLECT_TREE_BUF,
+                                 MAX(message_size, 1));
+
+    /* Put the local piece first. */
+    data = message;
+    if (own_size > 0) {
+        IceTVoid *package;
+        IceTSizeType package_size;
+
+        icetSparseImagePackageForSend(input_image, &package, &package_size);
+        ((IceTSizeType *)data)[0] = piece_offset;
+        ((IceTSizeType *)data)[1] = own_size - TREE_COLLECT_HEADER_SIZE;
+        memcpy(data + TREE_COLLECT_HEADER_SIZE, package, package_size);
+        data += own_size;
+    }
+
+    /* Records from children follow with no gaps. */
+    for (child = 0; child < num_children; child++) {
+        IceTInt child_rank = (first_child + child + dest)%numproc;
+        if (child_sizes[child] > 0) {
+            requests[child] = icetCommIrecv(data,
+                                            child_sizes[child],
+                                            ICET_BYTE,
+                                            child_rank,
+                                            TREE_COLLECT_DATA);
+        } else {
+            requests[child] = ICET_COMM_REQUEST_NULL;
+        }
+        data += child_sizes[child];
+    }
+    icetCommWaitall(num_children, requests);
+    message_size = (IceTSizeType)(data - message);
+
+    if (rank != dest) {
+        IceTInt parent_rank = ((tree_rank - 1)/fan_in + dest)%numproc;
+        icetCommSend(&message_size,
+                     1,
+                     ICET_SIZE_TYPE,
+                     parent_rank,
+                     TREE_COLLECT_SIZE);
+        if (message_size > 0) {
+            icetCommSend(message,
+                         message_size,
+                         ICET_BYTE,
+                         parent_rank,
+                         TREE_COLLECT_DATA);
+        }
+    }
+
+    icetTimingCollectEnd();
+
+    if (rank == dest) {
+        /* Unpack every piece straight into the result.  The pieces have the
+           full format of the composite, so the result is adjusted for output
+           only once they are all in. */
+        data = message;
+        while (data < message + message_size) {
+            IceTSizeType record_offset = ((IceTSizeType *)data)[0];
+            IceTSizeType record_size = ((IceTSizeType *)data)[1];
+            IceTSparseImage record_image
+                = icetSparseImageUnpackageFromReceive(
+                                              data + TREE_COLLECT_HEADER_SIZE);
+            icetDecompressSubImageCorrectBackground(record_image,
+                                                    record_offset,
+                                                    result_image);
+            data += TREE_COLLECT_HEADER_SIZE + record_size;
+        }
+        icetImageAdjustForOutput(result_image);
+    }
+}
 
 void icetSingleImageCollect(const IceTSparseImage input_image,
                             IceTInt dest,
@@ -606,6 +1106,7 @@ void icetSingleImageCollect(const IceTSparseImage input_image,
     IceTEnum depth_format;
     IceTSizeType color_size = 1;
     IceTSizeType depth_size = 1;
+    IceTSizeType auxiliary_size;
 
 #define DUMMY_BUFFER_SIZE       ((IceTSizeType)(16*sizeof(IceTInt)))
     IceTByte dummy_buffer[DUMMY_BUFFER_SIZE];
@@ -613,6 +1114,14 @@ void icetSingleImageCollect(const IceTSparseImage input_image,
     rank = icetCommRank();
     numproc = icetCommSize();
 
+    if (collectUseTree(numproc)) {
+        icetSingleImageTreeCollect(input_image,
+                                   dest,
+                                   piece_offset,
+                                   result_image);
+        return;
+    }
+
     /* Collect partitions held by each process. */
     piece_size = icetSparseImageGetNumPixels(input_image);
     if (rank == dest) {
@@ -645,6 +1154,10 @@ void icetSingleImageCollect(const IceTSparseImage input_image,
             data = icetImageGetDepthVoid(result_image, &size);
             memset(data, 0xCD, icetImageGetNumPixels(result_image)*size);
         }
+        data = icetImageGetAuxiliaryVoid(result_image, &size);
+        if (data != NULL) {
+            memset(data, 0xCD, icetImageGetNumPixels(result_image)*size);
+        }
     }
 #endif
 
@@ -745,5 +1258,38 @@ void icetSingleImageCollect(const IceTSparseImage input_image,
         }
     }
 
+    if (icetImageGetAuxiliaryVoid(result_image, &auxiliary_size) != NULL) {
+        /* Use IceTByte for byte-based pointer arithmetic. */
+        IceTByte *auxiliary_buffer
+          = icetImageGetAuxiliaryVoid(result_image, NULL);
+        int proc;
+
+        if (rank == dest) {
+            /* Auxiliary channels only come with depth, so sizes and offsets
+               are currently in depth pixels. */
+            for (proc = 0; proc < numproc; proc++) {
+                offsets[proc] /= depth_size;
+                offsets[proc] *= auxiliary_size;
+                sizes[proc] /= depth_size;
+                sizes[proc] *= auxiliary_size;
+            }
+            icetCommGatherv(ICET_IN_PLACE_COLLECT,
+                            sizes[rank],
+                            ICET_BYTE,
+                            auxiliary_buffer,
+                            sizes,
+                            offsets,
+                            dest);
+        } else {
+            icetCommGatherv(auxiliary_buffer + piece_offset * auxiliary_size,
+                            piece_size * auxiliary_size,
+                            ICET_BYTE,
+                            NULL,
+                            NULL,
+                            NULL,
+                            dest);
+        }
+    }
+
     icetTimingCollectEnd();
 }
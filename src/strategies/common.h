@@ -24,18 +24,23 @@
    image - An image big enough to hold color and/or depth values
         that is ICET_MAX_PIXELS big.  The results will be put in this
         image.
-   inSparseImageBuffer - A buffer big enough to hold sparse color and
-        depth information for an image that is ICET_MAX_PIXELS big.
-        The size can be determined with the icetSparseImageBufferSize
-        function in image.h.
+   inSparseImageBuffers - A buffer big enough to hold numInBuffers sparse
+        images that are ICET_MAX_PIXELS big.  The size can be determined
+        with icetRenderTransferFullImagesBufferSize.
+   numInBuffers - The number of incoming images to hold at once.  Incoming
+        images are composited into image in batches of this many, which
+        touches each pixel of image once per batch rather than once per
+        image.
    tile_image_dest - if tile t is in ICET_CONTAINED_TILES, then the
         rendered image for tile t is sent to tile_image_dest[t].
 
    This function fills the image object with the composited image send to this
    process. The contents are undefined if nothing sent to this process. */
 void icetRenderTransferFullImages(IceTImage image,
-                                  IceTVoid *inSparseImageBuffer,
+                                  IceTVoid *inSparseImageBuffers,
+                                  IceTInt numInBuffers,
                                   IceTInt *tile_image_dest);
+IceTSizeType icetRenderTransferFullImagesBufferSize(IceTInt numInBuffers);
 
 /* icetRenderTransferSparseImages
 
@@ -104,14 +109,15 @@ IceTSparseImage icetRenderTransferSparseImages(IceTSparseImage compositeImage1,
         sent it.  The function is expected to return a buffer to use for
         the next message receive.  If the callback is finished with the
         buffer it was given, it is perfectly acceptable to return it again
-        for reuse.
+        for reuse.  The value returned for a message sent to self is
+        ignored.
    incomingBuffer - A buffer to use for the first incoming message.
    bufferSize - The maximum size of a message.
    
 */
 typedef IceTVoid *(*IceTGenerateData)(IceTInt id, IceTInt dest,
                                       IceTSizeType *size);
-typedef void (*IceTHandleData)(void *buffer, IceTInt src);
+typedef IceTVoid *(*IceTHandleData)(void *buffer, IceTInt src);
 void icetSendRecvLargeMessages(IceTInt numMessagesSending,
                                const IceTInt *messageDestinations,
                                IceTBoolean messagesInOrder,
@@ -160,6 +166,46 @@ void icetSingleImageCompose(const IceTInt *compose_group,
                             IceTSparseImage *result_image,
                             IceTSizeType *piece_offset);
 
+/* icetSingleImageUseOpacityCulling
+
+   Returns true if ICET_OPACITY_CULLING is enabled and the current state
+   allows it to be applied.  That is, ordered compositing is on, the composite
+   mode is ICET_COMPOSITE_MODE_BLEND, and the color format has an alpha
+   channel.  A single image strategy should only call
+   icetSingleImageCullOccludedPieces when this returns true. */
+IceTBoolean icetSingleImageUseOpacityCulling(void);
+
+/* icetSingleImageCullOccludedPieces
+
+   Used by ordered single image strategies that split an image into pieces
+   and send piece i to partner i.  Partners are ordered front to back.  Each
+   process that collects a piece sends an opacity mask of its own piece to
+   all the partners behind it.  Those partners then remove from the pieces
+   they are about to send any pixels that are hidden behind opaque pixels.
+   This must be called by all partners after splitting the image and before
+   sending any of the pieces.
+
+   compose_group - A mapping of group ranks to process ranks.
+   first_partner - The index in compose_group of partner 0.
+   partner_step - The distance in compose_group between consecutive partners.
+   num_partners - The number of processes exchanging pieces.
+   my_partner_index - The partner index of this process.
+   pieces - The image pieces this process is about to send.  Piece i goes to
+        partner i.  The pieces are culled in place.
+   num_pieces - The number of pieces.  This may be fewer than num_partners,
+        in which case the partners at the end collect no piece.
+   tag - A message tag for this exchange.  It should be distinct from the tags
+        used to send the image pieces.
+*/
+void icetSingleImageCullOccludedPieces(const IceTInt *compose_group,
+                                       IceTInt first_partner,
+                                       IceTInt partner_step,
+                                       IceTInt num_partners,
+                                       IceTInt my_partner_index,
+                                       IceTSparseImage *pieces,
+                                       IceTInt num_pieces,
+                                       IceTInt tag);
+
 /* icetSingleImageCollect
 
    Collects image partitions distributed amongst processes.  The intension is to
@@ -167,7 +213,9 @@ void icetSingleImageCompose(const IceTInt *compose_group,
    image composition.  Unlike icetSingleImageCompose, however, this function
    must be called on all processes, not just those in a group.  Processes that
    have no piece of the image should pass 0 for piece_offset and a null or other
-   zero-size image for input_image.
+   zero-size image for input_image.  When many processes hold small pieces,
+   the pieces travel compressed up a tree in which no process receives from
+   more than ICET_COLLECT_FAN_IN others.
 
    input_image - Contains the composited image partition returned from
         icetSingleImageCompose.
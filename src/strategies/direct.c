@@ -19,11 +19,15 @@
 #define DIRECT_IN_SPARSE_IMAGE_BUFFER   ICET_STRATEGY_BUFFER_1
 #define DIRECT_TILE_IMAGE_DEST_BUFFER   ICET_STRATEGY_BUFFER_2
 
+/* The most incoming images the display node composites in one pass.  Each
+   needs a buffer big enough for a full sparse tile. */
+#define DIRECT_COMPOSITE_BATCH_SIZE 4
+
 IceTImage icetDirectCompose(void)
 {
     IceTImage image;
-    IceTVoid *inSparseImageBuffer;
-    IceTSizeType sparseImageSize;
+    IceTVoid *inSparseImageBuffers;
+    IceTInt num_in_buffers;
     const IceTInt *contrib_counts;
     const IceTInt *display_nodes;
     IceTInt max_width, max_height;
@@ -34,19 +38,10 @@ IceTImage icetDirectCompose(void)
     IceTInt *tile_image_dest;
     icetRaiseDebug("In Direct Compose");
 
-    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
-    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
 
-    sparseImageSize = icetSparseImageBufferSize(max_width, max_height);
-
-    image               = icetGetStateBufferImage(DIRECT_IMAGE_BUFFER,
-                                                  max_width, max_height);
-    inSparseImageBuffer = icetGetStateBuffer(DIRECT_IN_SPARSE_IMAGE_BUFFER,
-                                             sparseImageSize);
-    tile_image_dest     = icetGetStateBuffer(DIRECT_TILE_IMAGE_DEST_BUFFER,
-                                             num_tiles*sizeof(IceTInt));
-
     icetGetIntegerv(ICET_TILE_DISPLAYED, &display_tile);
     if (display_tile >= 0) {
         contrib_counts = icetUnsafeStateGetInteger(ICET_TILE_CONTRIB_COUNTS);
@@ -55,13 +50,32 @@ IceTImage icetDirectCompose(void)
         num_contributors = 0;
     }
 
+  /* Only processes displaying a tile receive images, and there is no point
+     in holding more images than can come in. */
+    if (num_contributors < DIRECT_COMPOSITE_BATCH_SIZE) {
+        num_in_buffers = (num_contributors > 1) ? num_contributors : 1;
+    } else {
+        num_in_buffers = DIRECT_COMPOSITE_BATCH_SIZE;
+    }
+
+    image                = icetGetStateBufferImage(DIRECT_IMAGE_BUFFER,
+                                                   max_width, max_height);
+    inSparseImageBuffers = icetGetStateBuffer(
+                          DIRECT_IN_SPARSE_IMAGE_BUFFER,
+                          icetRenderTransferFullImagesBufferSize(num_in_buffers));
+    tile_image_dest      = icetGetStateBuffer(DIRECT_TILE_IMAGE_DEST_BUFFER,
+                                              num_tiles*sizeof(IceTInt));
+
     display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
     for (tile = 0; tile < num_tiles; tile++) {
         tile_image_dest[tile] = display_nodes[tile];
     }
 
     icetRaiseDebug("Rendering and transferring images.");
-    icetRenderTransferFullImages(image, inSparseImageBuffer, tile_image_dest);
+    icetRenderTransferFullImages(image,
+                                 inSparseImageBuffers,
+                                 num_in_buffers,
+                                 tile_image_dest);
 
     if (display_tile >= 0) {
         if (num_contributors > 0) {
@@ -69,7 +83,7 @@ IceTImage icetDirectCompose(void)
         } else {
             /* Must be displaying a blank tile. */
             const IceTInt *tile_viewports
-                = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+                = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
             const IceTInt *display_tile_viewport
                 = tile_viewports + 4*display_tile;
             IceTInt display_tile_width = display_tile_viewport[2];
@@ -29,11 +29,15 @@
 #include <IceTDevCommunication.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevImage.h>
+#include <IceTDevTiming.h>
+
+#include "common.h"
 
 /* #define RADIXK_USE_TELESCOPE */
 
 #define RADIXK_SWAP_IMAGE_TAG_START     2200
 #define RADIXK_TELESCOPE_IMAGE_TAG      2300
+#define RADIXK_OPACITY_MASK_TAG_START   2400
 
 #define RADIXK_RECEIVE_BUFFER                   ICET_SI_STRATEGY_BUFFER_0
 #define RADIXK_SEND_BUFFER                      ICET_SI_STRATEGY_BUFFER_1
@@ -550,6 +554,8 @@ static IceTCommRequest *radixkPostSends(radixkPartnerInfo *partners,
                                         const radixkRoundInfo *round_info,
                                         IceTInt current_round,
                                         IceTInt remaining_partitions,
+                                        const IceTInt *compose_group,
+                                        IceTInt group_rank,
                                         IceTSizeType start_offset,
                                         const IceTSparseImage image)
 {
@@ -579,6 +585,22 @@ static IceTCommRequest *radixkPostSends(radixkPartnerInfo *partners,
                              image_pieces,
                              piece_offsets);
 
+        /* Partners are in composite order, so drop any pixels hidden behind
+           opaque pixels collected by partners in front before sending. */
+        if (icetSingleImageUseOpacityCulling()) {
+            const IceTInt step = round_info->step;
+            const IceTInt group_step = step*round_info->k;
+            icetSingleImageCullOccludedPieces(
+                        compose_group,
+                        group_rank%step + (group_rank/group_step)*group_step,
+                        step,
+                        round_info->k,
+                        round_info->partition_index,
+                        image_pieces,
+                        round_info->k,
+                        RADIXK_OPACITY_MASK_TAG_START + current_round);
+        }
+
         /* The pivot for loop arranges the sends to happen in an order such that
            those to be composited first in their destinations will be sent
            first.  This serves little purpose other than to try to stagger the
@@ -773,6 +795,9 @@ static void radixkCompositeIncomingImages(radixkPartnerInfo *partners,
         receiver->compositeLevel = 0;
         receiver->receiveImage
             = icetSparseImageUnpackageFromReceive(receiver->receiveBuffer);
+        icetTimingRoundReceived(
+            receiver->rank,
+            icetSparseImageGetCompressedBufferSize(receiver->receiveImage));
         if (   (icetSparseImageGetWidth(receiver->receiveImage) != width)
             || (icetSparseImageGetHeight(receiver->receiveImage) != height) ) {
             icetRaiseError(ICET_SANITY_CHECK_FAIL,
@@ -842,6 +867,8 @@ static void icetRadixkBasicCompose(const radixkInfo *info,
         IceTCommRequest *receive_requests;
         IceTCommRequest *send_requests;
 
+        icetTimingRoundBegin(round_info->k);
+
         receive_requests = radixkPostReceives(partners,
                                               round_info,
                                               current_round,
@@ -852,6 +879,8 @@ static void icetRadixkBasicCompose(const radixkInfo *info,
                                         round_info,
                                         current_round,
                                         remaining_partitions,
+                                        compose_group,
+                                        group_rank,
                                         my_offset,
                                         working_image);
 
@@ -866,6 +895,8 @@ static void icetRadixkBasicCompose(const radixkInfo *info,
             icetCommWait(&send_requests[0]);
         }
 
+        icetTimingRoundEnd();
+
         my_offset = partners[round_info->partition_index].offset;
         if (round_info->split) {
             remaining_partitions /= round_info->k;
@@ -32,8 +32,12 @@
 #include <IceTDevCommunication.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevImage.h>
+#include <IceTDevTiming.h>
+
+#include "common.h"
 
 #define RADIXKR_SWAP_IMAGE_TAG_START     2200
+#define RADIXKR_OPACITY_MASK_TAG_START   2400
 
 #define RADIXKR_RECEIVE_BUFFER                   ICET_SI_STRATEGY_BUFFER_0
 #define RADIXKR_SEND_BUFFER                      ICET_SI_STRATEGY_BUFFER_1
@@ -541,6 +545,7 @@ static IceTCommRequest *radixkrPostSends(radixkrPartnerGroupInfo p_group,
                                          const radixkrRoundInfo *round_info,
                                          IceTInt current_round,
                                          IceTInt remaining_partitions,
+                                         const IceTInt *compose_group,
                                          IceTSizeType start_offset,
                                          const IceTSparseImage image)
 {
@@ -573,6 +578,20 @@ static IceTCommRequest *radixkrPostSends(radixkrPartnerGroupInfo p_group,
                              image_pieces,
                              piece_offsets);
 
+        /* Partners are in composite order, so drop any pixels hidden behind
+           opaque pixels collected by partners in front before sending. */
+        if (icetSingleImageUseOpacityCulling()) {
+            icetSingleImageCullOccludedPieces(
+                        compose_group,
+                        round_info->first_rank,
+                        round_info->step,
+                        p_group.num_partners,
+                        round_info->partition_index,
+                        image_pieces,
+                        round_info->split_factor,
+                        RADIXKR_OPACITY_MASK_TAG_START + current_round);
+        }
+
         /* The pivot for loop arranges the sends to happen in an order such that
            those to be composited first in their destinations will be sent
            first.  This serves little purpose other than to try to stagger the
@@ -773,6 +792,9 @@ static void radixkrCompositeIncomingImages(radixkrPartnerGroupInfo p_group,
         receiver->compositeLevel = 0;
         receiver->receiveImage
             = icetSparseImageUnpackageFromReceive(receiver->receiveBuffer);
+        icetTimingRoundReceived(
+            receiver->rank,
+            icetSparseImageGetCompressedBufferSize(receiver->receiveImage));
         if (   (icetSparseImageGetWidth(receiver->receiveImage) != width)
             || (icetSparseImageGetHeight(receiver->receiveImage) != height) ) {
             icetRaiseError(ICET_SANITY_CHECK_FAIL,
@@ -876,6 +898,8 @@ void icetRadixkrCompose(const IceTInt *compose_group,
         IceTCommRequest *receive_requests;
         IceTCommRequest *send_requests;
 
+        icetTimingRoundBegin(p_group.num_partners);
+
         receive_requests = radixkrPostReceives(p_group,
                                                round_info,
                                                current_round,
@@ -886,6 +910,7 @@ void icetRadixkrCompose(const IceTInt *compose_group,
                                          round_info,
                                          current_round,
                                          remaining_partitions,
+                                         compose_group,
                                          my_offset,
                                          working_image);
 
@@ -896,6 +921,8 @@ void icetRadixkrCompose(const IceTInt *compose_group,
 
         icetCommWaitall(round_info->split_factor, send_requests);
 
+        icetTimingRoundEnd();
+
         my_offset = p_group.partners[round_info->partition_index].offset;
         if (round_info->has_image) {
             remaining_partitions /= round_info->split_factor;
@@ -9,6 +9,7 @@
 
 #include <IceT.h>
 
+#include <IceTDevCommunication.h>
 #include <IceTDevImage.h>
 #include <IceTDevState.h>
 #include <IceTDevDiagnostics.h>
@@ -26,23 +27,66 @@
 #define REDUCE_COMPOSITE_IMAGE_BUFFER_1         ICET_STRATEGY_BUFFER_2
 #define REDUCE_COMPOSITE_IMAGE_BUFFER_2         ICET_STRATEGY_BUFFER_3
 
+#define REDUCE_LOAD_SAMPLES_BUFFER              ICET_STRATEGY_BUFFER_4
 #define REDUCE_NUM_PROC_FOR_TILE_BUFFER         ICET_STRATEGY_BUFFER_5
 #define REDUCE_NODE_ASSIGNMENT_BUFFER           ICET_STRATEGY_BUFFER_6
 #define REDUCE_TILE_PROC_GROUPS_BUFFER          ICET_STRATEGY_BUFFER_7
 #define REDUCE_GROUP_SIZES_BUFFER               ICET_STRATEGY_BUFFER_8
 #define REDUCE_TILE_IMAGE_DEST_BUFFER           ICET_STRATEGY_BUFFER_9
 #define REDUCE_CONTRIBUTORS_BUFFER              ICET_STRATEGY_BUFFER_10
-
-static IceTInt reduceDelegate(IceTInt **tile_image_destp,
+#define REDUCE_TILE_WEIGHTS_BUFFER              ICET_STRATEGY_BUFFER_11
+
+/* Weight given to the newest load measurement when smoothing tile loads
+   over frames. */
+#define REDUCE_LOAD_SMOOTHING                   0.5
+/* A new assignment of processes to tiles must lower the heaviest load per
+   process by at least this fraction to replace the previous assignment. */
+#define REDUCE_BALANCE_HYSTERESIS               0.1
+/* The hybrid strategy composites tiles with at most this many images by
+   sending the images directly to the display process. */
+#define HYBRID_DIRECT_MAX_CONTRIBUTORS          2
+
+/* True if the tile is composited by direct send to its display process. */
+#define REDUCE_TILE_IS_DIRECT(tile)                                     \
+    (   (contrib_counts[(tile)] > 0)                                    \
+     && (contrib_counts[(tile)] <= direct_max_contributors))
+
+static IceTImage reduceCompose(IceTInt direct_max_contributors);
+
+static IceTInt reduceDelegate(IceTInt direct_max_contributors,
+                              IceTInt **tile_image_destp,
                               IceTInt **compose_groupp, IceTInt *group_sizep,
                               IceTInt *group_image_destp);
 
+static void reduceTileWeights(IceTDouble *weights);
+static void reduceKeepPreviousAllocation(IceTInt direct_max_contributors,
+                                         const IceTDouble *weights,
+                                         IceTInt *num_proc_for_tile);
+
 static IceTImage reduceCollect(const IceTSparseImage composited_image,
                                IceTInt compose_tile,
                                IceTInt piece_offset);
 
 
 IceTImage icetReduceCompose(void)
+{
+    icetRaiseDebug("In reduceCompose");
+    return reduceCompose(0);
+}
+
+/* The hybrid strategy picks how to composite each tile.  Tiles with only one
+   or two images are sent straight to their display processes, which is what
+   the direct strategy does, and get no other processes.  The rest of the
+   processes are divided among the remaining tiles, and each of those tiles is
+   composited with the single image strategy over its group.  All groups are
+   disjoint, so the tiles are composited concurrently. */
+IceTImage icetHybridCompose(void)
+{
+    icetRaiseDebug("In hybridCompose");
+    return reduceCompose(HYBRID_DIRECT_MAX_CONTRIBUTORS);
+}
+
+static IceTImage reduceCompose(IceTInt direct_max_contributors)
 {
     IceTSparseImage rendered_image;
     IceTSparseImage composited_image;
@@ -53,10 +97,9 @@ IceTImage icetReduceCompose(void)
     IceTInt compose_tile;
     IceTSizeType piece_offset;
 
-    icetRaiseDebug("In reduceCompose");
-
     /* Figure out who is compositing what tiles. */
-    compose_tile = reduceDelegate(&tile_image_dest,
+    compose_tile = reduceDelegate(direct_max_contributors,
+                                  &tile_image_dest,
                                   &compose_group, &group_size,
                                   &group_image_dest);
 
@@ -70,8 +113,8 @@ IceTImage icetReduceCompose(void)
         IceTSparseImage composite_image1;
         IceTSparseImage composite_image2;
 
-        icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
-        icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+        icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+        icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
 
         sparse_image_size = icetSparseImageBufferSize(max_width, max_height);
         inImageBuffer  = icetGetStateBuffer(REDUCE_IN_IMAGE_BUFFER,
@@ -89,6 +132,17 @@ IceTImage icetReduceCompose(void)
                                                         tile_image_dest);
     }
 
+    if (icetIsEnabled(ICET_BALANCE_TILES)) {
+        /* The size of the sparse image this process composites stands in for
+           its share of the work on the tile.  It is shared with the other
+           processes when delegating the next frame. */
+        IceTInt sample[2];
+        sample[0] = compose_tile;
+        sample[1] = (compose_tile >= 0)
+            ? icetSparseImageGetCompressedBufferSize(rendered_image) : 0;
+        icetStateSetIntegerv(ICET_TILE_LOAD_SAMPLE, 2, sample);
+    }
+
     if (compose_tile >= 0) {
         icetSingleImageCompose(compose_group,
                                group_size,
@@ -110,7 +164,7 @@ IceTImage icetReduceCompose(void)
     } else {
         IceTSizeType piece_size = icetSparseImageGetNumPixels(composited_image);
         const IceTInt *tile_viewports
-            = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+            = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
         IceTSizeType tile_width = tile_viewports[compose_tile + 2];
         IceTSizeType tile_height = tile_viewports[compose_tile + 3];
         if (piece_size > 0) {
@@ -133,7 +187,8 @@ IceTImage icetReduceCompose(void)
     return result_image;
 }
 
-static IceTInt reduceDelegate(IceTInt **tile_image_destp,
+static IceTInt reduceDelegate(IceTInt direct_max_contributors,
+                              IceTInt **tile_image_destp,
                               IceTInt **compose_groupp,
                               IceTInt *group_sizep,
                               IceTInt *group_image_destp)
@@ -141,6 +196,8 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
     const IceTBoolean *all_contained_tiles_masks;
     const IceTInt *contrib_counts;
     IceTInt total_image_count;
+    IceTDouble total_weight;
+    IceTInt num_shared_processes;
 
     IceTInt num_tiles;
     IceTInt num_processes;
@@ -148,6 +205,7 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
     const IceTInt *tile_display_nodes;
     const IceTInt *composite_order;
 
+    IceTDouble *tile_weights;
     IceTInt *num_proc_for_tile;
     IceTInt *node_assignment;
     IceTInt *tile_proc_groups;
@@ -196,12 +254,43 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
                                            num_tiles * sizeof(IceTInt));
     contributors      = icetGetStateBuffer(REDUCE_CONTRIBUTORS_BUFFER,
                                            num_processes * sizeof(IceTInt));
+    tile_weights      = icetGetStateBuffer(REDUCE_TILE_WEIGHTS_BUFFER,
+                                           num_tiles * sizeof(IceTDouble));
+
+  /* Processes are allocated to tiles in proportion to their weights, which
+     are the image counts unless tiles are balanced by measured loads. */
+    if (icetIsEnabled(ICET_BALANCE_TILES)) {
+        reduceTileWeights(tile_weights);
+    } else {
+        for (tile = 0; tile < num_tiles; tile++) {
+            tile_weights[tile] = contrib_counts[tile];
+        }
+    }
+  /* Tiles composited by direct send get only their display process.  The
+     other tiles share the rest of the processes. */
+    total_weight = 0.0;
+    num_shared_processes = num_processes;
+    for (tile = 0; tile < num_tiles; tile++) {
+        if (REDUCE_TILE_IS_DIRECT(tile)) {
+            num_shared_processes--;
+        } else {
+            total_weight += tile_weights[tile];
+        }
+    }
 
   /* Decide the minimum amount of processes that should be added to each
      tile. */
     pcount = 0;
     for (tile = 0; tile < num_tiles; tile++) {
-        IceTInt allocate = (contrib_counts[tile]*num_processes)/total_image_count;
+        IceTInt allocate;
+        if (REDUCE_TILE_IS_DIRECT(tile)) {
+            allocate = 1;
+        } else if (total_weight > 0.0) {
+            allocate = (IceTInt)(  (tile_weights[tile]*num_shared_processes)
+                                 / total_weight);
+        } else {
+            allocate = 0;
+        }
       /* Make sure at least one process is assigned to tiles that have at
          least one image. */
         if ((allocate < 1) && (contrib_counts[tile] > 0)) allocate = 1;
@@ -219,17 +308,20 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
     while (num_processes > pcount) {
       /* Find the tile with the largest image to process ratio that
          can still have a process added to it. */
-        IceTInt max = 0;
-        for (tile = 1; tile < num_tiles; tile++) {
-            if (   (num_proc_for_tile[tile] < contrib_counts[tile])
-                && (   (num_proc_for_tile[max] == contrib_counts[max])
-                    || (  (float)contrib_counts[max]/num_proc_for_tile[max]
-                        < (float)contrib_counts[tile]/num_proc_for_tile[tile])))
+        IceTInt max = -1;
+        for (tile = 0; tile < num_tiles; tile++) {
+            if (   (num_proc_for_tile[tile] >= contrib_counts[tile])
+                || REDUCE_TILE_IS_DIRECT(tile) ) {
+                continue;
+            }
+            if (   (max < 0)
+                || (  tile_weights[max]/num_proc_for_tile[max]
+                    < tile_weights[tile]/num_proc_for_tile[tile]))
             {
                 max = tile;
             }
         }
-        if (num_proc_for_tile[max] < contrib_counts[max]) {
+        if (max >= 0) {
             num_proc_for_tile[max]++;
             pcount++;
         } else {
@@ -246,8 +338,8 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
         for (tile = 1; tile < num_tiles; tile++) {
             if (   (num_proc_for_tile[tile] > 1)
                 && (   (num_proc_for_tile[min] < 2)
-                    || (  (float)contrib_counts[min]/num_proc_for_tile[min]
-                        > (float)contrib_counts[tile]/num_proc_for_tile[tile])))
+                    || (  tile_weights[min]/num_proc_for_tile[min]
+                        > tile_weights[tile]/num_proc_for_tile[tile])))
             {
                 min = tile;
             }
@@ -256,6 +348,12 @@ static IceTInt reduceDelegate(IceTInt **tile_image_destp,
         pcount--;
     }
 
+    if (icetIsEnabled(ICET_BALANCE_TILES)) {
+        reduceKeepPreviousAllocation(direct_max_contributors,
+                                     tile_weights,
+                                     num_proc_for_tile);
+    }
+
   /* Clear out arrays. */
     memset(group_sizes, 0, num_tiles*sizeof(IceTInt));
     for (node = 0; node < num_processes; node++) {
@@ -455,6 +553,156 @@ group_sizes[(tile)]++;
     return node_assignment[rank];
 }
 
+/* Computes the weight of each tile from the loads measured in previous
+   frames.  Every process gathers the same samples and smooths them the same
+   way, so all processes agree on the weights. */
+static void reduceTileWeights(IceTDouble *weights)
+{
+    const IceTInt *contrib_counts;
+    IceTInt num_tiles;
+    IceTInt num_processes;
+    IceTInt *samples;
+    IceTDouble *loads;
+    IceTBoolean have_history;
+    IceTDouble total_load;
+    IceTInt total_count;
+    IceTInt tile;
+    IceTInt proc;
+
+    contrib_counts = icetUnsafeStateGetInteger(ICET_TILE_CONTRIB_COUNTS);
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_processes);
+
+    samples = icetGetStateBuffer(REDUCE_LOAD_SAMPLES_BUFFER,
+                                 2*num_processes*sizeof(IceTInt));
+    icetCommAllgather(icetUnsafeStateGetInteger(ICET_TILE_LOAD_SAMPLE),
+                      2,
+                      ICET_INT,
+                      samples);
+    {
+        /* Each sample counts once, even if balancing stops for a while. */
+        IceTInt no_sample[2];
+        no_sample[0] = -1;
+        no_sample[1] = 0;
+        icetStateSetIntegerv(ICET_TILE_LOAD_SAMPLE, 2, no_sample);
+    }
+
+    /* Use weights to hold the newest load of each tile. */
+    for (tile = 0; tile < num_tiles; tile++) {
+        weights[tile] = 0.0;
+    }
+    for (proc = 0; proc < num_processes; proc++) {
+        IceTInt sample_tile = samples[2*proc];
+        if ((sample_tile >= 0) && (sample_tile < num_tiles)) {
+            weights[sample_tile] += samples[2*proc + 1];
+        }
+    }
+
+    /* Allocating an array of the same size keeps its contents. */
+    have_history = (icetStateGetNumEntries(ICET_TILE_LOADS) == num_tiles);
+    loads = icetStateAllocateDouble(ICET_TILE_LOADS, num_tiles);
+    if (!have_history) {
+        for (tile = 0; tile < num_tiles; tile++) {
+            loads[tile] = 0.0;
+        }
+    }
+    for (tile = 0; tile < num_tiles; tile++) {
+        if (weights[tile] <= 0.0) {
+            /* Not composited last frame.  Keep what was known before. */
+        } else if (loads[tile] <= 0.0) {
+            loads[tile] = weights[tile];
+        } else {
+            loads[tile] = (  REDUCE_LOAD_SMOOTHING*weights[tile]
+                           + (1.0 - REDUCE_LOAD_SMOOTHING)*loads[tile]);
+        }
+    }
+
+    /* Tiles without a measured load are estimated by their image counts and
+       the average load of an image in the measured tiles. */
+    total_load = 0.0;
+    total_count = 0;
+    for (tile = 0; tile < num_tiles; tile++) {
+        if ((loads[tile] > 0.0) && (contrib_counts[tile] > 0)) {
+            total_load += loads[tile];
+            total_count += contrib_counts[tile];
+        }
+    }
+    for (tile = 0; tile < num_tiles; tile++) {
+        if (contrib_counts[tile] < 1) {
+            weights[tile] = 0.0;
+        } else if (total_count < 1) {
+            weights[tile] = contrib_counts[tile];
+        } else if (loads[tile] > 0.0) {
+            weights[tile] = loads[tile];
+        } else {
+            weights[tile] = contrib_counts[tile]*total_load/total_count;
+        }
+    }
+}
+
+/* Reverts num_proc_for_tile to the allocation of the previous frame unless
+   the new allocation is noticeably better balanced.  This keeps small
+   changes in measured loads from moving processes between tiles every
+   frame.  The allocation used is recorded for the next frame. */
+static void reduceKeepPreviousAllocation(IceTInt direct_max_contributors,
+                                         const IceTDouble *weights,
+                                         IceTInt *num_proc_for_tile)
+{
+    const IceTInt *contrib_counts;
+    const IceTInt *previous;
+    IceTInt num_tiles;
+    IceTInt new_count;
+    IceTInt previous_count;
+    IceTDouble new_max_load;
+    IceTDouble previous_max_load;
+    IceTBoolean previous_valid;
+    IceTInt tile;
+
+    contrib_counts = icetUnsafeStateGetInteger(ICET_TILE_CONTRIB_COUNTS);
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+
+    previous_valid
+        = (icetStateGetNumEntries(ICET_TILE_PROCESS_COUNTS) == num_tiles);
+    previous = icetUnsafeStateGetInteger(ICET_TILE_PROCESS_COUNTS);
+    new_count = 0;
+    previous_count = 0;
+    new_max_load = 0.0;
+    previous_max_load = 0.0;
+    for (tile = 0; (tile < num_tiles) && previous_valid; tile++) {
+        if (contrib_counts[tile] > 0) {
+            /* The previous allocation must still fit the images. */
+            if (   (previous[tile] < 1)
+                || (previous[tile] > contrib_counts[tile])
+                || (REDUCE_TILE_IS_DIRECT(tile) && (previous[tile] != 1)) ) {
+                previous_valid = ICET_FALSE;
+                break;
+            }
+            if (weights[tile]/previous[tile] > previous_max_load) {
+                previous_max_load = weights[tile]/previous[tile];
+            }
+            if (weights[tile]/num_proc_for_tile[tile] > new_max_load) {
+                new_max_load = weights[tile]/num_proc_for_tile[tile];
+            }
+        } else if (previous[tile] != 0) {
+            previous_valid = ICET_FALSE;
+            break;
+        }
+        new_count += num_proc_for_tile[tile];
+        previous_count += previous[tile];
+    }
+
+    if (   previous_valid
+        && (new_count == previous_count)
+        && (  new_max_load
+            > (1.0 - REDUCE_BALANCE_HYSTERESIS)*previous_max_load) ) {
+        memcpy(num_proc_for_tile, previous, num_tiles*sizeof(IceTInt));
+    } else {
+        icetStateSetIntegerv(ICET_TILE_PROCESS_COUNTS,
+                             num_tiles,
+                             num_proc_for_tile);
+    }
+}
+
 IceTImage reduceCollect(const IceTSparseImage composited_image,
                         IceTInt compose_tile,
                         IceTInt piece_offset)
@@ -468,7 +716,7 @@ IceTImage reduceCollect(const IceTSparseImage composited_image,
 
     icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     tile_display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
 
     /* Run collect function for all tiles with data.  Unlike compose where
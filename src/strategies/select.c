@@ -20,6 +20,7 @@ extern IceTImage icetSequentialCompose(void);
 extern IceTImage icetSplitCompose(void);
 extern IceTImage icetReduceCompose(void);
 extern IceTImage icetVtreeCompose(void);
+extern IceTImage icetHybridCompose(void);
 
 /* Declaration of single image strategy compose functions. */
 extern void icetAutomaticCompose(const IceTInt *compose_group,
@@ -69,6 +70,7 @@ IceTBoolean icetStrategyValid(IceTEnum strategy)
       case ICET_STRATEGY_SPLIT:
       case ICET_STRATEGY_REDUCE:
       case ICET_STRATEGY_VTREE:
+      case ICET_STRATEGY_HYBRID:
           return ICET_TRUE;
       default:
           return ICET_FALSE;
@@ -83,6 +85,7 @@ const char *icetStrategyNameFromEnum(IceTEnum strategy)
       case ICET_STRATEGY_SPLIT:         return "Split";
       case ICET_STRATEGY_REDUCE:        return "Reduce";
       case ICET_STRATEGY_VTREE:         return "Virtual Tree";
+      case ICET_STRATEGY_HYBRID:        return "Hybrid";
       case ICET_STRATEGY_UNDEFINED:
           icetRaiseError(ICET_INVALID_ENUM,
                          "Strategy not defined. "
@@ -103,6 +106,7 @@ IceTBoolean icetStrategySupportsOrdering(IceTEnum strategy)
       case ICET_STRATEGY_SPLIT:         return ICET_FALSE;
       case ICET_STRATEGY_REDUCE:        return ICET_TRUE;
       case ICET_STRATEGY_VTREE:         return ICET_FALSE;
+      case ICET_STRATEGY_HYBRID:        return ICET_TRUE;
       case ICET_STRATEGY_UNDEFINED:
           icetRaiseError(ICET_INVALID_ENUM,
                          "Strategy not defined. "
@@ -125,6 +129,7 @@ IceTImage icetInvokeStrategy(IceTEnum strategy)
       case ICET_STRATEGY_SPLIT:         return icetSplitCompose();
       case ICET_STRATEGY_REDUCE:        return icetReduceCompose();
       case ICET_STRATEGY_VTREE:         return icetVtreeCompose();
+      case ICET_STRATEGY_HYBRID:        return icetHybridCompose();
       case ICET_STRATEGY_UNDEFINED:
           icetRaiseError(ICET_INVALID_ENUM,
                          "Strategy not defined. "
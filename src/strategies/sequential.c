@@ -9,15 +9,284 @@
 
 #include <IceT.h>
 
+#include <IceTDevCommunication.h>
 #include <IceTDevImage.h>
 #include <IceTDevState.h>
 #include <IceTDevDiagnostics.h>
+#include <IceTDevTiming.h>
 #include "common.h"
 
 #define SEQUENTIAL_IMAGE_BUFFER                 ICET_STRATEGY_BUFFER_0
 #define SEQUENTIAL_FINAL_IMAGE_BUFFER           ICET_STRATEGY_BUFFER_1
 #define SEQUENTIAL_INTERMEDIATE_IMAGE_BUFFER    ICET_STRATEGY_BUFFER_2
 #define SEQUENTIAL_COMPOSE_GROUP_BUFFER         ICET_STRATEGY_BUFFER_3
+#define SEQUENTIAL_COLLECT_INFO_BUFFER          ICET_STRATEGY_BUFFER_4
+#define SEQUENTIAL_RECEIVE_REQUEST_BUFFER       ICET_STRATEGY_BUFFER_5
+#define SEQUENTIAL_PIECE_BUFFER_0               ICET_STRATEGY_BUFFER_6
+
+/* Number of tiles whose collection may be in flight at once when
+   ICET_PIPELINE_TILES is enabled.  Each needs its own piece buffer. */
+#define SEQUENTIAL_PIPELINE_DEPTH               3
+
+/* Number of buffers (color, depth, and auxiliary channels) sent separately
+   when collecting a piece. */
+#define SEQUENTIAL_COLLECT_MESSAGES             3
+
+/* Collection messages of the tiles in flight at the same time get their own
+   tags so that their pieces never match each other.  A process never has
+   more than SEQUENTIAL_PIPELINE_DEPTH tiles in flight, so the tags wrap
+   around with the pipeline slot.  They run from SEQUENTIAL_COLLECT_TAG_START
+   up to (but not including) SEQUENTIAL_COLLECT_TAG_END, which gives 3100
+   through 3108 with the current depth and message count. */
+#define SEQUENTIAL_COLLECT_TAG_START            3100
+#define SEQUENTIAL_COLLECT_TAG_END                                      \
+    (  SEQUENTIAL_COLLECT_TAG_START                                     \
+     + SEQUENTIAL_COLLECT_MESSAGES*SEQUENTIAL_PIPELINE_DEPTH)
+#define SEQUENTIAL_COLLECT_TAG(tile, message)                           \
+    (  SEQUENTIAL_COLLECT_TAG_START                                     \
+     + SEQUENTIAL_COLLECT_MESSAGES*((tile)%SEQUENTIAL_PIPELINE_DEPTH)   \
+     + (message))
+#define SEQUENTIAL_COLOR_TAG(tile)      SEQUENTIAL_COLLECT_TAG(tile, 0)
+#define SEQUENTIAL_DEPTH_TAG(tile)      SEQUENTIAL_COLLECT_TAG(tile, 1)
+#define SEQUENTIAL_AUXILIARY_TAG(tile)  SEQUENTIAL_COLLECT_TAG(tile, 2)
+
+/* Starts sending the composited piece of a tile to its display node without
+   waiting for it to arrive.  The display node decompresses its own piece
+   into tile_image and posts receives for the other pieces straight into it.
+   Every other process decompresses its piece into piece_buffer and sends
+   from there, so that buffer must be left alone until send_requests
+   (SEQUENTIAL_COLLECT_MESSAGES entries) complete.  receive_requests holds
+   SEQUENTIAL_COLLECT_MESSAGES entries per process and is only used on the
+   display node. */
+static void sequentialStartCollect(IceTInt tile,
+                                   const IceTSparseImage piece,
+                                   IceTSizeType piece_offset,
+                                   IceTInt display_node,
+                                   IceTImage tile_image,
+                                   IceTEnum piece_buffer,
+                                   IceTCommRequest *send_requests,
+                                   IceTCommRequest *receive_requests)
+{
+    IceTInt rank = icetCommRank();
+    IceTInt num_proc = icetCommSize();
+    IceTSizeType piece_size = icetSparseImageGetNumPixels(piece);
+    IceTSizeType *offsets = NULL;
+    IceTSizeType *sizes = NULL;
+    IceTSizeType color_size, depth_size, auxiliary_size;
+    IceTByte *color_buffer = NULL;
+    IceTByte *depth_buffer = NULL;
+    IceTByte *auxiliary_buffer = NULL;
+    IceTInt message;
+
+    for (message = 0; message < SEQUENTIAL_COLLECT_MESSAGES; message++) {
+        send_requests[message] = ICET_COMM_REQUEST_NULL;
+    }
+
+    if (rank == display_node) {
+        IceTSizeType *info
+            = icetGetStateBuffer(SEQUENTIAL_COLLECT_INFO_BUFFER,
+                                 2*num_proc*sizeof(IceTSizeType));
+        offsets = info;
+        sizes = info + num_proc;
+    }
+    /* Like icetSingleImageCollect, tell the display node where each piece
+       goes.  The pixels themselves are not waited for. */
+    icetCommGather(&piece_offset, 1, ICET_SIZE_TYPE, offsets, display_node);
+    icetCommGather(&piece_size, 1, ICET_SIZE_TYPE, sizes, display_node);
+
+    if (rank == display_node) {
+        IceTInt proc;
+
+        if (piece_size > 0) {
+            icetDecompressSubImageCorrectBackground(piece,
+                                                    piece_offset,
+                                                    tile_image);
+        }
+        icetImageAdjustForOutput(tile_image);
+
+        icetTimingCollectBegin();
+        if (icetImageGetColorFormat(tile_image) != ICET_IMAGE_COLOR_NONE) {
+            color_buffer = icetImageGetColorVoid(tile_image, &color_size);
+        }
+        if (icetImageGetDepthFormat(tile_image) != ICET_IMAGE_DEPTH_NONE) {
+            depth_buffer = icetImageGetDepthVoid(tile_image, &depth_size);
+        }
+        auxiliary_buffer
+            = icetImageGetAuxiliaryVoid(tile_image, &auxiliary_size);
+        for (proc = 0; proc < num_proc; proc++) {
+            IceTCommRequest *proc_requests
+                = receive_requests + SEQUENTIAL_COLLECT_MESSAGES*proc;
+            for (message = 0; message < SEQUENTIAL_COLLECT_MESSAGES;
+                 message++) {
+                proc_requests[message] = ICET_COMM_REQUEST_NULL;
+            }
+            if ((proc == rank) || (sizes[proc] < 1)) { continue; }
+            if (color_buffer != NULL) {
+                proc_requests[0] = icetCommIrecv(
+                            color_buffer + offsets[proc]*color_size,
+                            sizes[proc]*color_size,
+                            ICET_BYTE,
+                            proc,
+                            SEQUENTIAL_COLOR_TAG(tile));
+            }
+            if (depth_buffer != NULL) {
+                proc_requests[1] = icetCommIrecv(
+                            depth_buffer + offsets[proc]*depth_size,
+                            sizes[proc]*depth_size,
+                            ICET_BYTE,
+                            proc,
+                            SEQUENTIAL_DEPTH_TAG(tile));
+            }
+            if (auxiliary_buffer != NULL) {
+                proc_requests[2] = icetCommIrecv(
+                            auxiliary_buffer + offsets[proc]*auxiliary_size,
+                            sizes[proc]*auxiliary_size,
+                            ICET_BYTE,
+                            proc,
+                            SEQUENTIAL_AUXILIARY_TAG(tile));
+            }
+        }
+        icetTimingCollectEnd();
+    } else if (piece_size > 0) {
+        IceTImage piece_image
+            = icetGetStateBufferImage(piece_buffer, piece_size, 1);
+        icetDecompressSubImageCorrectBackground(piece, 0, piece_image);
+        icetImageAdjustForOutput(piece_image);
+
+        icetTimingCollectBegin();
+        if (icetImageGetColorFormat(piece_image) != ICET_IMAGE_COLOR_NONE) {
+            color_buffer = icetImageGetColorVoid(piece_image, &color_size);
+            send_requests[0] = icetCommIsend(color_buffer,
+                                             piece_size*color_size,
+                                             ICET_BYTE,
+                                             display_node,
+                                             SEQUENTIAL_COLOR_TAG(tile));
+        }
+        if (icetImageGetDepthFormat(piece_image) != ICET_IMAGE_DEPTH_NONE) {
+            depth_buffer = icetImageGetDepthVoid(piece_image, &depth_size);
+            send_requests[1] = icetCommIsend(depth_buffer,
+                                             piece_size*depth_size,
+                                             ICET_BYTE,
+                                             display_node,
+                                             SEQUENTIAL_DEPTH_TAG(tile));
+        }
+        auxiliary_buffer
+            = icetImageGetAuxiliaryVoid(piece_image, &auxiliary_size);
+        if (auxiliary_buffer != NULL) {
+            send_requests[2] = icetCommIsend(auxiliary_buffer,
+                                             piece_size*auxiliary_size,
+                                             ICET_BYTE,
+                                             display_node,
+                                             SEQUENTIAL_AUXILIARY_TAG(tile));
+        }
+        icetTimingCollectEnd();
+    }
+}
+
+/* Composites every tile like icetSequentialCompose, but the collection of
+   each tile proceeds in the background while the following tiles are
+   rendered and composited.  Up to SEQUENTIAL_PIPELINE_DEPTH tiles are being
+   collected at once. */
+static IceTImage sequentialPipelinedCompose(const IceTInt *compose_group)
+{
+    IceTInt num_tiles;
+    IceTInt rank;
+    IceTInt num_proc;
+    const IceTInt *display_nodes;
+    const IceTInt *tile_viewports;
+    IceTBoolean ordered_composite;
+    IceTCommRequest send_requests[  SEQUENTIAL_COLLECT_MESSAGES
+                                  * SEQUENTIAL_PIPELINE_DEPTH];
+    IceTCommRequest *receive_requests;
+    IceTImage my_image;
+    IceTInt tile;
+    IceTInt slot;
+
+    icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
+    ordered_composite = icetIsEnabled(ICET_ORDERED_COMPOSITE);
+
+    receive_requests = icetGetStateBuffer(
+                                SEQUENTIAL_RECEIVE_REQUEST_BUFFER,
+                                  SEQUENTIAL_COLLECT_MESSAGES*num_proc
+                                * sizeof(IceTCommRequest));
+    for (slot = 0;
+         slot < SEQUENTIAL_COLLECT_MESSAGES*SEQUENTIAL_PIPELINE_DEPTH;
+         slot++) {
+        send_requests[slot] = ICET_COMM_REQUEST_NULL;
+    }
+
+    my_image = icetImageNull();
+
+    for (tile = 0; tile < num_tiles; tile++) {
+        IceTInt d_node = display_nodes[tile];
+        IceTInt image_dest;
+        IceTSparseImage rendered_image;
+        IceTSparseImage composited_image;
+        IceTSizeType piece_offset;
+        IceTImage tile_image;
+
+        slot = tile%SEQUENTIAL_PIPELINE_DEPTH;
+
+        if (ordered_composite) {
+            for (image_dest = 0; compose_group[image_dest] != d_node;
+                 image_dest++);
+        } else {
+            image_dest = d_node;
+        }
+
+        /* The piece buffer of this slot is about to be reused, so the tile
+           that last used it must be fully sent. */
+        icetTimingCollectBegin();
+        icetCommWaitall(SEQUENTIAL_COLLECT_MESSAGES,
+                        send_requests + SEQUENTIAL_COLLECT_MESSAGES*slot);
+        icetTimingCollectEnd();
+
+        rendered_image = icetGetCompressedTileImage(tile);
+        icetSingleImageCompose(compose_group,
+                               num_proc,
+                               image_dest,
+                               rendered_image,
+                               &composited_image,
+                               &piece_offset);
+
+        if (d_node == rank) {
+            tile_image = icetGetStateBufferImage(
+                                        SEQUENTIAL_FINAL_IMAGE_BUFFER,
+                                        tile_viewports[4*tile + 2],
+                                        tile_viewports[4*tile + 3]);
+            my_image = tile_image;
+        } else {
+            tile_image = icetImageNull();
+        }
+
+        sequentialStartCollect(tile,
+                               composited_image,
+                               piece_offset,
+                               d_node,
+                               tile_image,
+                               SEQUENTIAL_PIECE_BUFFER_0 + slot,
+                               send_requests
+                                   + SEQUENTIAL_COLLECT_MESSAGES*slot,
+                               receive_requests);
+    }
+
+    /* Drain the pipeline.  Each process displays at most one tile, so all
+       receives posted here are for my_image. */
+    icetTimingCollectBegin();
+    icetCommWaitall(SEQUENTIAL_COLLECT_MESSAGES*SEQUENTIAL_PIPELINE_DEPTH,
+                    send_requests);
+    if (!icetImageIsNull(my_image)) {
+        icetCommWaitall(SEQUENTIAL_COLLECT_MESSAGES*num_proc,
+                        receive_requests);
+    }
+    icetTimingCollectEnd();
+
+    return my_image;
+}
 
 IceTImage icetSequentialCompose(void)
 {
@@ -36,7 +305,7 @@ IceTImage icetSequentialCompose(void)
     icetGetIntegerv(ICET_RANK, &rank);
     icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
     display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     ordered_composite = icetIsEnabled(ICET_ORDERED_COMPOSITE);
     image_collect = icetIsEnabled(ICET_COLLECT_IMAGES);
 
@@ -60,6 +329,10 @@ IceTImage icetSequentialCompose(void)
 	}
     }
 
+    if (icetIsEnabled(ICET_PIPELINE_TILES) && (num_tiles > 1)) {
+        return sequentialPipelinedCompose(compose_group);
+    }
+
   /* Render and compose every tile. */
     for (i = 0; i < num_tiles; i++) {
 	int d_node = display_nodes[i];
@@ -29,6 +29,7 @@
 #define IMAGE_DATA        50
 #define COLOR_DATA        51
 #define DEPTH_DATA        52
+#define AUXILIARY_DATA    53
 
 #define MIN(x,y) ((x) <= (y) ? (x) : (y))
 #define FRAG_SIZE(total_pixels, num_pieces) \
@@ -45,11 +46,12 @@ static void icetCollectImage(IceTImage imageFragment,
     IceTSizeType my_fragment_size;
     IceTEnum color_format;
     IceTEnum depth_format;
+    IceTSizeType auxiliary_size;
     IceTSizeType pixel_size;
-    IceTCommRequest requests[2];
+    IceTCommRequest requests[3];
 
     icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
 
   /* Fragment might be truncated.  Adjust my_fragment_size appropriately. */
@@ -59,6 +61,7 @@ static void icetCollectImage(IceTImage imageFragment,
     icetImageAdjustForOutput(imageFragment);
     color_format = icetImageGetColorFormat(imageFragment);
     depth_format = icetImageGetDepthFormat(imageFragment);
+    icetImageGetAuxiliaryConstVoid(imageFragment, &auxiliary_size);
 
     icetImageCorrectBackground(imageFragment);
 
@@ -82,6 +85,15 @@ static void icetCollectImage(IceTImage imageFragment,
                                     display_nodes[my_tile],
                                     DEPTH_DATA);
     }
+    if (auxiliary_size > 0) {
+        IceTVoid *outgoing_data = icetImageGetAuxiliaryVoid(imageFragment,
+                                                            NULL);
+        requests[2] = icetCommIsend(outgoing_data,
+                                    auxiliary_size*my_fragment_size,
+                                    ICET_BYTE,
+                                    display_nodes[my_tile],
+                                    AUXILIARY_DATA);
+    }
 
   /* If I am displaying a tile, receive image data. */
     if (tile_displayed >= 0) {
@@ -123,6 +135,19 @@ static void icetCollectImage(IceTImage imageFragment,
                     db += pixel_size*displayed_fragment_size;
                 }
             }
+            if (auxiliary_size > 0) {
+              /* Use IceTByte for byte-based pointer arithmetic. */
+                IceTByte *ab = icetImageGetAuxiliaryVoid(fullImage, NULL);
+                IceTInt node;
+                for (node = tile_groups[tile_displayed];
+                     node < tile_groups[tile_displayed+1]; node++) {
+                    icetRaiseDebug("Getting final auxiliary fragment from %d",
+                                   node);
+                    icetCommRecv(ab, auxiliary_size*displayed_fragment_size,
+                                 ICET_BYTE, node, AUXILIARY_DATA);
+                    ab += auxiliary_size*displayed_fragment_size;
+                }
+            }
         } else {
             icetClearImageTrueBackground(fullImage);
         }
@@ -134,6 +159,9 @@ static void icetCollectImage(IceTImage imageFragment,
     if (depth_format != ICET_IMAGE_DEPTH_NONE) {
         icetCommWait(&requests[1]);
     }
+    if (auxiliary_size > 0) {
+        icetCommWait(&requests[2]);
+    }
 
     icetTimingCollectEnd();
 }
@@ -181,12 +209,12 @@ IceTImage icetSplitCompose(void)
     icetGetIntegerv(ICET_RANK, &rank);
     icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
-    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
-    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
     tile_contribs = icetUnsafeStateGetInteger(ICET_TILE_CONTRIB_COUNTS);
     icetGetIntegerv(ICET_TOTAL_IMAGE_COUNT, &total_image_count);
     icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     icetGetIntegerv(ICET_NUM_CONTAINED_TILES, &num_contained_tiles);
     contained_tiles_list = icetUnsafeStateGetInteger(ICET_CONTAINED_TILES_LIST);
     all_contained_tiles_masks
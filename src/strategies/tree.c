@@ -12,6 +12,7 @@
 #include <IceTDevCommunication.h>
 #include <IceTDevDiagnostics.h>
 #include <IceTDevImage.h>
+#include <IceTDevTiming.h>
 
 #define TREE_IN_SPARSE_IMAGE_BUFFER     ICET_SI_STRATEGY_BUFFER_0
 #define TREE_SPARSE_IMAGE_BUFFER        ICET_SI_STRATEGY_BUFFER_1
@@ -85,6 +86,9 @@ static void RecursiveTreeCompose(const IceTInt *compose_group,
         }
     }
 
+    /* Each level of the tree is one round of communication. */
+    icetTimingRoundBegin(2);
+
     if (current_image == SEND_IMAGE) {
       /* Hasta la vista, baby. */
         IceTVoid *package_buffer;
@@ -109,6 +113,9 @@ static void RecursiveTreeCompose(const IceTInt *compose_group,
                      compose_group[pair_proc], TREE_IMAGE_DATA);
         inSparseImage
             = icetSparseImageUnpackageFromReceive(inSparseImageBuffer);
+        icetTimingRoundReceived(
+                         compose_group[pair_proc],
+                         icetSparseImageGetCompressedBufferSize(inSparseImage));
         if (group_rank < pair_proc) {
             icetCompressedCompressedComposite(*imageData,
                                               inSparseImage,
@@ -126,6 +133,8 @@ static void RecursiveTreeCompose(const IceTInt *compose_group,
             *imageBuffer = oldImage;
         }
     }
+
+    icetTimingRoundEnd();
 }
 
 void icetTreeCompose(const IceTInt *compose_group,
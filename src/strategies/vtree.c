@@ -22,6 +22,10 @@
 #define VTREE_OUT_SPARSE_IMAGE_BUFFER   ICET_STRATEGY_BUFFER_2
 #define VTREE_INFO_BUFFER               ICET_STRATEGY_BUFFER_3
 #define VTREE_ALL_CONTAINED_TMASKS_BUFFER ICET_STRATEGY_BUFFER_4
+#define VTREE_SCHEDULE_KEY_BUFFER       ICET_STRATEGY_BUFFER_5
+#define VTREE_SCHEDULE_STEPS_BUFFER     ICET_STRATEGY_BUFFER_6
+#define VTREE_SCRATCH_BUFFER            ICET_STRATEGY_BUFFER_7
+#define VTREE_TILE_INDEX_BUFFER         ICET_STRATEGY_BUFFER_8
 
 #define VTREE_IMAGE_DATA 40
 
@@ -35,18 +39,65 @@ struct node_info {
     int recv_src;
 };
 
+/* Buckets of the processes (as positions in the sorted info array) that
+   contain or hold each tile, rebuilt every round.  A process that can no
+   longer send a tile stays unable to for the rest of the round, so the next
+   arrays, which point at the last entry of each bucket that may still send,
+   only ever move down. */
+struct tile_index {
+    int *contained_start;
+    int *contained;
+    int *contained_next;
+    int *held_start;
+    int *held;
+    int *held_next;
+    int *position;
+};
+
+/* The transfers of the local process in one round. */
+struct vtree_step {
+    IceTInt tile_sending;
+    IceTInt send_dest;
+    IceTInt tile_receiving;
+    IceTInt recv_src;
+    IceTInt render_received;    /* Render tile_receiving before receiving. */
+    IceTInt tile_held;          /* Tile held once the step is done. */
+};
+
+/* A schedule depends only on the tiles each process contains and on the
+   display nodes.  These follow this header in VTREE_SCHEDULE_KEY_BUFFER so
+   that the schedule can be reused while they stay the same.  The time
+   stamps catch other strategies using the buffers in the meantime. */
+struct vtree_schedule_key {
+    IceTTimeStamp key_time;
+    IceTTimeStamp steps_time;
+    IceTInt num_proc;
+    IceTInt num_tiles;
+    IceTInt num_steps;
+    IceTInt render_displayed;   /* Render the displayed tile at the end. */
+};
+
+static IceTBoolean schedule_reusable(IceTInt num_proc, IceTInt num_tiles,
+                                     const IceTInt *display_nodes,
+                                     const IceTBoolean *all_contained_tmasks);
+static void build_schedule(IceTInt rank, IceTInt num_proc, IceTInt num_tiles,
+                           const IceTInt *display_nodes,
+                           IceTInt tile_displayed,
+                           IceTBoolean *all_contained_tmasks);
 static void sort_by_contained(struct node_info *info, int size);
-static int find_sender(struct node_info *info, int num_proc,
+static void build_tile_index(const struct node_info *info, int num_proc,
+                             int num_tiles,
+                             const IceTBoolean *all_contained_tmasks,
+                             struct tile_index *index);
+static int find_sender(struct node_info *info, struct tile_index *index,
                        int recv_node, int tile,
                        int display_node,
                        int num_tiles, IceTBoolean *all_contained_tmasks);
-static int find_receiver(struct node_info *info, int num_proc,
+static int find_receiver(struct node_info *info, struct tile_index *index,
                          int send_node, int tile,
                          int display_node,
                          int num_tiles, IceTBoolean *all_contained_tmasks);
-static void do_send_receive(const struct node_info *my_info, int tile_held,
-                            IceTInt num_tiles,
-                            IceTBoolean *all_contained_tmasks,
+static void do_send_receive(const struct vtree_step *step, int tile_held,
                             IceTImage image,
                             IceTVoid *inSparseImageBuffer,
                             IceTSizeType inSparseImageBufferSize,
@@ -65,10 +116,9 @@ IceTImage icetVtreeCompose(void)
     IceTVoid *inSparseImageBuffer;
     IceTSparseImage outSparseImage;
     IceTSizeType sparseImageSize;
-    struct node_info *info;
-    struct node_info *my_info;
-    int tile, node;
-    int tiles_transfered;
+    const struct vtree_schedule_key *key;
+    const struct vtree_step *steps;
+    int step;
     int tile_held = -1;
 
     icetRaiseDebug("In vtreeCompose");
@@ -77,10 +127,10 @@ IceTImage icetVtreeCompose(void)
     icetGetIntegerv(ICET_RANK, &rank);
     icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
     icetGetIntegerv(ICET_NUM_TILES, &num_tiles);
-    icetGetIntegerv(ICET_TILE_MAX_WIDTH, &max_width);
-    icetGetIntegerv(ICET_TILE_MAX_HEIGHT, &max_height);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_WIDTH, &max_width);
+    icetGetIntegerv(ICET_SCALED_TILE_MAX_HEIGHT, &max_height);
     display_nodes = icetUnsafeStateGetInteger(ICET_DISPLAY_NODES);
-    tile_viewports = icetUnsafeStateGetInteger(ICET_TILE_VIEWPORTS);
+    tile_viewports = icetUnsafeStateGetInteger(ICET_SCALED_TILE_VIEWPORTS);
     icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
 
   /* Allocate buffers. */
@@ -93,13 +143,207 @@ IceTImage icetVtreeCompose(void)
     outSparseImage       = icetGetStateBufferSparseImage(
                                                   VTREE_OUT_SPARSE_IMAGE_BUFFER,
                                                   max_width, max_height);
-    info                 = icetGetStateBuffer(VTREE_INFO_BUFFER,
-                                             sizeof(struct node_info)*num_proc);
     all_contained_tmasks = icetGetStateBuffer(VTREE_ALL_CONTAINED_TMASKS_BUFFER,
                                         sizeof(IceTBoolean)*num_proc*num_tiles);
 
     icetGetBooleanv(ICET_ALL_CONTAINED_TILES_MASKS, all_contained_tmasks);
-    
+
+    if (schedule_reusable(num_proc, num_tiles,
+                          display_nodes, all_contained_tmasks)) {
+        icetRaiseDebug("Reusing schedule of last frame.");
+    } else {
+        build_schedule(rank, num_proc, num_tiles,
+                       display_nodes, tile_displayed, all_contained_tmasks);
+    }
+    key = icetUnsafeStateGetBuffer(VTREE_SCHEDULE_KEY_BUFFER);
+    steps = icetUnsafeStateGetBuffer(VTREE_SCHEDULE_STEPS_BUFFER);
+
+  /* Rounds in which this process neither sends nor receives are left out
+     of the schedule. */
+    for (step = 0; step < key->num_steps; step++) {
+        do_send_receive(steps + step, tile_held,
+                        image, inSparseImageBuffer, sparseImageSize,
+                        outSparseImage);
+        tile_held = steps[step].tile_held;
+    }
+
+  /* Hacks for when "this" tile was not rendered. */
+    if ((tile_displayed >= 0) && (tile_displayed != tile_held)) {
+        if (   key->render_displayed
+            && ICET_COMPOSITE_MODE_IS_REDUCTION(
+                   *icetUnsafeStateGetInteger(ICET_COMPOSITE_MODE)) ) {
+          /* As below, but rendering over the true background would not reduce
+             the rendered pixels with it, so correct the background after. */
+            icetRaiseDebug("Rendering tile to display.");
+            icetGetTileImage(tile_displayed, image);
+            icetImageCorrectBackground(image);
+        } else if (key->render_displayed) {
+          /* Only "this" node draws "this" tile.  Because the image never needed
+              to be transferred, it was never rendered above.  Just render it
+              now.  We might save some time by rendering with the true
+              background color rather than correcting it later. */
+            IceTFloat true_background[4];
+            IceTInt true_background_word;
+            IceTFloat original_background[4];
+            IceTInt original_background_word;
+
+            icetGetFloatv(ICET_TRUE_BACKGROUND_COLOR, true_background);
+            icetGetIntegerv(ICET_TRUE_BACKGROUND_COLOR_WORD,
+                            &true_background_word);
+
+            icetGetFloatv(ICET_BACKGROUND_COLOR, original_background);
+            icetGetIntegerv(ICET_BACKGROUND_COLOR_WORD,
+                            &original_background_word);
+
+            icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, true_background);
+            icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD,
+                                true_background_word);
+
+            icetRaiseDebug("Rendering tile to display.");
+          /* This may uncessarily read a buffer if not outputing an input
+             buffer */
+            icetGetTileImage(tile_displayed, image);
+
+            icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, original_background);
+            icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD,
+                                original_background_word);
+        } else {
+          /* "This" tile is blank. */
+            const IceTInt *display_tile_viewport
+                = tile_viewports + 4*tile_displayed;
+            IceTInt display_tile_width = display_tile_viewport[2];
+            IceTInt display_tile_height = display_tile_viewport[3];
+
+            icetRaiseDebug("Returning blank image.");
+            icetImageSetDimensions(
+                                image, display_tile_width, display_tile_height);
+            icetClearImageTrueBackground(image);
+        }
+    } else if (tile_displayed >= 0) {
+        icetImageCorrectBackground(image);
+    }
+
+    return image;
+}
+
+static IceTBoolean schedule_reusable(IceTInt num_proc, IceTInt num_tiles,
+                                     const IceTInt *display_nodes,
+                                     const IceTBoolean *all_contained_tmasks)
+{
+    const struct vtree_schedule_key *key;
+    const IceTInt *key_display_nodes;
+    const IceTBoolean *key_tmasks;
+
+    if (   (icetStateGetType(VTREE_SCHEDULE_KEY_BUFFER) != ICET_VOID)
+        || (icetStateGetType(VTREE_SCHEDULE_STEPS_BUFFER) != ICET_VOID) ) {
+        return ICET_FALSE;
+    }
+
+    key = icetUnsafeStateGetBuffer(VTREE_SCHEDULE_KEY_BUFFER);
+    if (   (key->key_time != icetStateGetTime(VTREE_SCHEDULE_KEY_BUFFER))
+        || (key->steps_time != icetStateGetTime(VTREE_SCHEDULE_STEPS_BUFFER))
+        || (key->num_proc != num_proc)
+        || (key->num_tiles != num_tiles) ) {
+        return ICET_FALSE;
+    }
+
+    key_display_nodes = (const IceTInt *)(key + 1);
+    key_tmasks = (const IceTBoolean *)(key_display_nodes + num_tiles);
+    return (   (memcmp(key_display_nodes, display_nodes,
+                       num_tiles*sizeof(IceTInt)) == 0)
+            && (memcmp(key_tmasks, all_contained_tmasks,
+                       num_proc*num_tiles*sizeof(IceTBoolean)) == 0) );
+}
+
+/* Appends a copy of the local info to the schedule steps, growing the steps
+   buffer as needed. */
+static struct vtree_step *add_step(struct vtree_step *steps,
+                                   IceTInt *num_steps,
+                                   IceTInt *max_steps,
+                                   const struct node_info *my_info,
+                                   const IceTBoolean *all_contained_tmasks,
+                                   IceTInt num_tiles)
+{
+    struct vtree_step *step;
+
+    if (*num_steps >= *max_steps) {
+        IceTSizeType used_size = (*num_steps)*sizeof(struct vtree_step);
+        IceTVoid *scratch = icetGetStateBuffer(VTREE_SCRATCH_BUFFER,
+                                               used_size);
+        memcpy(scratch, steps, used_size);
+        *max_steps *= 2;
+        steps = icetGetStateBuffer(VTREE_SCHEDULE_STEPS_BUFFER,
+                                   (*max_steps)*sizeof(struct vtree_step));
+        memcpy(steps, scratch, used_size);
+    }
+
+    step = steps + *num_steps;
+    step->tile_sending = my_info->tile_sending;
+    step->send_dest = my_info->send_dest;
+    step->tile_receiving = my_info->tile_receiving;
+    step->recv_src = my_info->recv_src;
+    step->render_received
+        = (   (my_info->tile_receiving >= 0)
+           && all_contained_tmasks[my_info->rank*num_tiles
+                                   + my_info->tile_receiving] );
+    step->tile_held = my_info->tile_held;
+    (*num_steps)++;
+
+    return steps;
+}
+
+/* Plans every round of transfers and records the ones that involve the
+   local process.  Each process comes to the same plan, so no communication
+   is needed.  The masks are consumed as images get sent. */
+static void build_schedule(IceTInt rank, IceTInt num_proc, IceTInt num_tiles,
+                           const IceTInt *display_nodes,
+                           IceTInt tile_displayed,
+                           IceTBoolean *all_contained_tmasks)
+{
+    struct node_info *info;
+    struct node_info *my_info;
+    struct tile_index index;
+    struct vtree_schedule_key *key;
+    struct vtree_step *steps;
+    IceTInt num_steps;
+    IceTInt max_steps;
+    int tile, node;
+    int tiles_transfered;
+
+    /* Record the key before the masks are consumed. */
+    key = icetGetStateBuffer(VTREE_SCHEDULE_KEY_BUFFER,
+                               sizeof(struct vtree_schedule_key)
+                             + num_tiles*sizeof(IceTInt)
+                             + num_proc*num_tiles*sizeof(IceTBoolean));
+    key->num_proc = num_proc;
+    key->num_tiles = num_tiles;
+    memcpy(key + 1, display_nodes, num_tiles*sizeof(IceTInt));
+    memcpy((IceTInt *)(key + 1) + num_tiles,
+           all_contained_tmasks,
+           num_proc*num_tiles*sizeof(IceTBoolean));
+
+    max_steps = num_tiles + 2;
+    num_steps = 0;
+    steps = icetGetStateBuffer(VTREE_SCHEDULE_STEPS_BUFFER,
+                               max_steps*sizeof(struct vtree_step));
+
+    info = icetGetStateBuffer(VTREE_INFO_BUFFER,
+                              sizeof(struct node_info)*num_proc);
+    {
+        IceTInt *index_buffer
+            = icetGetStateBuffer(VTREE_TILE_INDEX_BUFFER,
+                                   (4*num_tiles + 2 + 2*num_proc
+                                    + num_proc*num_tiles)
+                                 * sizeof(IceTInt));
+        index.contained_start = index_buffer;
+        index.contained_next = index.contained_start + num_tiles + 1;
+        index.held_start = index.contained_next + num_tiles;
+        index.held_next = index.held_start + num_tiles + 1;
+        index.position = index.held_next + num_tiles;
+        index.held = index.position + num_proc;
+        index.contained = index.held + num_proc;
+    }
+
   /* Initialize info array. */
     for (node = 0; node < num_proc; node++) {
         info[node].rank = node;
@@ -115,7 +359,6 @@ IceTImage icetVtreeCompose(void)
 #define CONTAINS_TILE(nodei, tile)                                \
     (all_contained_tmasks[info[nodei].rank*num_tiles+(tile)])
 
-    tile_held = -1;
     do {
         int recv_node;
 
@@ -125,6 +368,8 @@ IceTImage icetVtreeCompose(void)
             info[node].tile_sending = -1;
             info[node].tile_receiving = -1;
         }
+        build_tile_index(info, num_proc, num_tiles,
+                         all_contained_tmasks, &index);
 
         for (recv_node = 0; recv_node < num_proc; recv_node++) {
             struct node_info *recv_info = info + recv_node;
@@ -134,7 +379,7 @@ IceTImage icetVtreeCompose(void)
             if (recv_info->tile_held >= 0) {
               /* This node is holding a tile.  It must either send or
                  receive this tile. */
-                if (find_sender(info, num_proc, recv_node, recv_info->tile_held,
+                if (find_sender(info, &index, recv_node, recv_info->tile_held,
                                 display_nodes[recv_info->tile_held],
                                 num_tiles, all_contained_tmasks)) {
                     tiles_transfered = 1;
@@ -145,7 +390,7 @@ IceTImage icetVtreeCompose(void)
                  can receive it? */
                 if (   (recv_info->tile_sending < 0)
                     && (recv_info->rank != display_nodes[recv_info->tile_held])
-                    && find_receiver(info, num_proc, recv_node,
+                    && find_receiver(info, &index, recv_node,
                                      recv_info->tile_held,
                                      display_nodes[recv_info->tile_held],
                                      num_tiles, all_contained_tmasks) ) {
@@ -161,7 +406,7 @@ IceTImage icetVtreeCompose(void)
                 if (   (   !CONTAINS_TILE(recv_node, tile)
                         && (display_nodes[tile] != recv_info->rank) )
                     || (recv_info->tile_sending == tile) ) continue;
-                if (find_sender(info, num_proc, recv_node, tile,
+                if (find_sender(info, &index, recv_node, tile,
                                 display_nodes[tile], num_tiles,
                                 all_contained_tmasks)) {
                     tiles_transfered = 1;
@@ -170,34 +415,18 @@ IceTImage icetVtreeCompose(void)
             }
         }
 
-      /* Now that we figured out who is sending to who, do the actual
-         send and receive. */
-        my_info = NULL;
-        for (node = 0; node < num_proc; node++) {
-            if (info[node].rank == rank) {
-                my_info = info + node;
-                break;
-            }
+        my_info = info + index.position[rank];
+        if ((my_info->tile_sending >= 0) || (my_info->tile_receiving >= 0)) {
+            steps = add_step(steps, &num_steps, &max_steps, my_info,
+                             all_contained_tmasks, num_tiles);
         }
 
-        do_send_receive(my_info, tile_held, num_tiles,
-                        all_contained_tmasks,
-                        image, inSparseImageBuffer, sparseImageSize,
-                        outSparseImage);
-
-        tile_held = my_info->tile_held;
-
     } while (tiles_transfered);
 
   /* It's possible that a composited image ended up on a processor that        */
   /* is not the display node for that image.  Do one last round of        */
   /* transfers to make sure all the tiles ended up in the right place.        */
-    for (node = 0; node < num_proc; node++) {
-        if (info[node].rank == rank) {
-            my_info = info + node;
-            break;
-        }
-    }
+    my_info = info + index.position[rank];
     my_info->tile_receiving = -1;
     my_info->tile_sending = -1;
     if ((my_info->tile_held >= 0) && (my_info->tile_held != tile_displayed)) {
@@ -217,88 +446,77 @@ IceTImage icetVtreeCompose(void)
             }
         }
     }
-    do_send_receive(my_info, tile_held,
-                    num_tiles, all_contained_tmasks,
-                    image, inSparseImageBuffer, sparseImageSize,
-                    outSparseImage);
-    tile_held = my_info->tile_held;
-
-  /* Hacks for when "this" tile was not rendered. */
-    if ((tile_displayed >= 0) && (tile_displayed != tile_held)) {
-        if (all_contained_tmasks[rank*num_tiles + tile_displayed]) {
-          /* Only "this" node draws "this" tile.  Because the image never needed
-              to be transferred, it was never rendered above.  Just render it
-              now.  We might save some time by rendering with the true
-              background color rather than correcting it later. */
-            IceTFloat true_background[4];
-            IceTInt true_background_word;
-            IceTFloat original_background[4];
-            IceTInt original_background_word;
-
-            icetGetFloatv(ICET_TRUE_BACKGROUND_COLOR, true_background);
-            icetGetIntegerv(ICET_TRUE_BACKGROUND_COLOR_WORD,
-                            &true_background_word);
-
-            icetGetFloatv(ICET_BACKGROUND_COLOR, original_background);
-            icetGetIntegerv(ICET_BACKGROUND_COLOR_WORD,
-                            &original_background_word);
-
-            icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, true_background);
-            icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD,
-                                true_background_word);
+    if ((my_info->tile_sending >= 0) || (my_info->tile_receiving >= 0)) {
+        steps = add_step(steps, &num_steps, &max_steps, my_info,
+                         all_contained_tmasks, num_tiles);
+    }
 
-            icetRaiseDebug("Rendering tile to display.");
-          /* This may uncessarily read a buffer if not outputing an input
-             buffer */
-            icetGetTileImage(tile_displayed, image);
+    /* The steps buffer may have moved, so get the key again. */
+    key = (struct vtree_schedule_key *)
+        icetUnsafeStateGetBuffer(VTREE_SCHEDULE_KEY_BUFFER);
+    key->num_steps = num_steps;
+    key->render_displayed
+        = (   (tile_displayed >= 0)
+           && all_contained_tmasks[rank*num_tiles + tile_displayed] );
+    key->key_time = icetStateGetTime(VTREE_SCHEDULE_KEY_BUFFER);
+    key->steps_time = icetStateGetTime(VTREE_SCHEDULE_STEPS_BUFFER);
+}
 
-            icetStateSetFloatv(ICET_BACKGROUND_COLOR, 4, original_background);
-            icetStateSetInteger(ICET_BACKGROUND_COLOR_WORD,
-                                original_background_word);
-        } else {
-          /* "This" tile is blank. */
-            const IceTInt *display_tile_viewport
-                = tile_viewports + 4*tile_displayed;
-            IceTInt display_tile_width = display_tile_viewport[2];
-            IceTInt display_tile_height = display_tile_viewport[3];
+/* Picks the last process in a bucket that can send tile to recv_node. */
+static int next_sender(struct node_info *info, const int *bucket,
+                       int bucket_start, int *bucket_next,
+                       int recv_node, int tile, int display_node,
+                       int num_tiles, const IceTBoolean *all_contained_tmasks,
+                       IceTBoolean must_hold)
+{
+    int entry;
+
+#define CAN_SEND(send_node)                                             \
+    (   (info[send_node].tile_sending < 0)                              \
+     && CONTAINS_TILE(send_node, tile)                                  \
+     && (info[send_node].tile_receiving != tile)                        \
+     && (info[send_node].rank != display_node)                          \
+     && (!must_hold || (info[send_node].tile_held == tile)) )
+
+    /* Drop processes that cannot send this tile for the rest of the
+       round. */
+    while ((*bucket_next >= bucket_start) && !CAN_SEND(bucket[*bucket_next])) {
+        (*bucket_next)--;
+    }
 
-            icetRaiseDebug("Returning blank image.");
-            icetImageSetDimensions(
-                                image, display_tile_width, display_tile_height);
-            icetClearImageTrueBackground(image);
+    /* recv_node cannot send to itself, but it may send this tile to some
+       other node later in the round, so it stays in the bucket. */
+    for (entry = *bucket_next; entry >= bucket_start; entry--) {
+        if ((bucket[entry] != recv_node) && CAN_SEND(bucket[entry])) {
+            return bucket[entry];
         }
-    } else if (tile_displayed >= 0) {
-        icetImageCorrectBackground(image);
     }
 
-    return image;
+#undef CAN_SEND
+
+    return -1;
 }
 
-static int find_sender(struct node_info *info, int num_proc,
+static int find_sender(struct node_info *info, struct tile_index *index,
                        int recv_node, int tile,
                        int display_node, int num_tiles,
                        IceTBoolean *all_contained_tmasks)
 {
-    int send_node;
-    int sender = -1;
-
-    for (send_node = num_proc-1; send_node >= 0; send_node--) {
-        if (   (info[send_node].tile_sending >= 0)
-            || !CONTAINS_TILE(send_node, tile)
-            || (info[send_node].tile_receiving == tile)
-            || (info[send_node].rank == display_node)
-            || (send_node == recv_node) ) {
-            continue;
-        }
-        if (info[send_node].tile_held == tile) {
-          /* Favor sending held images. */
-            sender = send_node;
-            break;
-        } else if (sender < 0) {
-            sender = send_node;
-        }
+    int sender;
+
+  /* Favor sending held images. */
+    sender = next_sender(info, index->held, index->held_start[tile],
+                         &index->held_next[tile],
+                         recv_node, tile, display_node,
+                         num_tiles, all_contained_tmasks, ICET_TRUE);
+    if (sender < 0) {
+        sender = next_sender(info, index->contained,
+                             index->contained_start[tile],
+                             &index->contained_next[tile],
+                             recv_node, tile, display_node,
+                             num_tiles, all_contained_tmasks, ICET_FALSE);
     }
-    
+
     if (sender >= 0) {
         info[recv_node].tile_held = tile;
         info[recv_node].tile_receiving = tile;
@@ -313,61 +531,164 @@ static int find_sender(struct node_info *info, int num_proc,
         return 0;
     }
 }
- 
-static int find_receiver(struct node_info *info, int num_proc,
+
+static int find_receiver(struct node_info *info, struct tile_index *index,
                          int send_node, int tile,
                          int display_node, int num_tiles,
                          IceTBoolean *all_contained_tmasks)
 {
-    int recv_node;
-
-    for (recv_node = send_node+1; recv_node < num_proc; recv_node++) {
-        if (   (info[recv_node].tile_receiving < 0)
-            && (   (info[recv_node].tile_held < 0)
-                || (info[recv_node].tile_held == tile) )
-            && (   CONTAINS_TILE(recv_node, tile)
-                || (info[recv_node].rank == display_node) ) ) {
-            info[recv_node].tile_held = tile;
-            info[recv_node].tile_receiving = tile;
-            info[recv_node].recv_src = info[send_node].rank;
-            info[send_node].tile_sending = tile;
-            info[send_node].send_dest = info[recv_node].rank;
-            if (info[send_node].tile_held == tile) {
-                info[send_node].tile_held = -1;
-            }
-            info[send_node].num_contained--;
-            all_contained_tmasks[info[send_node].rank*num_tiles + tile] = 0;
-            return 1;
+    int recv_node = -1;
+    int low, high;
+    int display_position;
+
+#define CAN_RECEIVE(node)                                       \
+    (   (info[node].tile_receiving < 0)                         \
+     && (   (info[node].tile_held < 0)                          \
+         || (info[node].tile_held == tile) ) )
+
+  /* Find the first process after send_node that contains the tile.  The
+     bucket is sorted by position. */
+    low = index->contained_start[tile];
+    high = index->contained_start[tile+1];
+    while (low < high) {
+        int middle = (low + high)/2;
+        if (index->contained[middle] <= send_node) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
     }
+    for ( ; low < index->contained_start[tile+1]; low++) {
+        int node = index->contained[low];
+        if (CONTAINS_TILE(node, tile) && CAN_RECEIVE(node)) {
+            recv_node = node;
+            break;
+        }
+    }
+
+  /* The display node can also take the tile. */
+    display_position = index->position[display_node];
+    if (   (display_position > send_node)
+        && ((recv_node < 0) || (display_position < recv_node))
+        && CAN_RECEIVE(display_position) ) {
+        recv_node = display_position;
+    }
+
+#undef CAN_RECEIVE
+
+    if (recv_node >= 0) {
+        info[recv_node].tile_held = tile;
+        info[recv_node].tile_receiving = tile;
+        info[recv_node].recv_src = info[send_node].rank;
+        info[send_node].tile_sending = tile;
+        info[send_node].send_dest = info[recv_node].rank;
+        if (info[send_node].tile_held == tile) {
+            info[send_node].tile_held = -1;
+        }
+        info[send_node].num_contained--;
+        all_contained_tmasks[info[send_node].rank*num_tiles + tile] = 0;
+        return 1;
+    }
 
     return 0;
 }
 
-/* Yes, bubblesort is a slow way to sort, but I don't expect the keys to
-   change much between iterations and the list is not very long, so we
-   should be OK. */
+/* Stable counting sort on the number of images left.  The keys span at
+   most the number of tiles, so this is linear in the number of processes. */
 static void sort_by_contained(struct node_info *info, int size)
 {
-    int swap_happened;
+    struct node_info *sorted;
+    IceTInt *counts;
+    int min_key, max_key;
     int node;
+    int key;
 
-    do {
-        swap_happened = 0;
-        for (node = 0; node < size-1; node++) {
-            if (info[node].num_contained > info[node+1].num_contained) {
-                struct node_info tmp = info[node];
-                info[node] = info[node+1];
-                info[node+1] = tmp;
-                swap_happened = 1;
+    if (size < 2) return;
+
+    min_key = max_key = info[0].num_contained;
+    for (node = 1; node < size; node++) {
+        if (info[node].num_contained < min_key) {
+            min_key = info[node].num_contained;
+        }
+        if (info[node].num_contained > max_key) {
+            max_key = info[node].num_contained;
+        }
+    }
+
+    sorted = icetGetStateBuffer(VTREE_SCRATCH_BUFFER,
+                                  size*sizeof(struct node_info)
+                                + (max_key - min_key + 2)*sizeof(IceTInt));
+    counts = (IceTInt *)(sorted + size);
+
+    memset(counts, 0, (max_key - min_key + 2)*sizeof(IceTInt));
+    for (node = 0; node < size; node++) {
+        counts[info[node].num_contained - min_key + 1]++;
+    }
+    for (key = 1; key <= max_key - min_key + 1; key++) {
+        counts[key] += counts[key-1];
+    }
+    for (node = 0; node < size; node++) {
+        sorted[counts[info[node].num_contained - min_key]++] = info[node];
+    }
+
+    memcpy(info, sorted, size*sizeof(struct node_info));
+}
+
+static void build_tile_index(const struct node_info *info, int num_proc,
+                             int num_tiles,
+                             const IceTBoolean *all_contained_tmasks,
+                             struct tile_index *index)
+{
+    int node;
+    int tile;
+
+    for (tile = 0; tile <= num_tiles; tile++) {
+        index->contained_start[tile] = 0;
+        index->held_start[tile] = 0;
+    }
+
+    /* Count bucket sizes, offset by one to turn into starts below. */
+    for (node = 0; node < num_proc; node++) {
+        const IceTBoolean *tmask
+            = all_contained_tmasks + info[node].rank*num_tiles;
+        index->position[info[node].rank] = node;
+        for (tile = 0; tile < num_tiles; tile++) {
+            if (tmask[tile]) index->contained_start[tile+1]++;
+        }
+        if (info[node].tile_held >= 0) {
+            index->held_start[info[node].tile_held+1]++;
+        }
+    }
+    for (tile = 0; tile < num_tiles; tile++) {
+        index->contained_start[tile+1] += index->contained_start[tile];
+        index->held_start[tile+1] += index->held_start[tile];
+        index->contained_next[tile] = index->contained_start[tile];
+        index->held_next[tile] = index->held_start[tile];
+    }
+
+    /* Fill buckets in position order, using next as the fill pointer. */
+    for (node = 0; node < num_proc; node++) {
+        const IceTBoolean *tmask
+            = all_contained_tmasks + info[node].rank*num_tiles;
+        for (tile = 0; tile < num_tiles; tile++) {
+            if (tmask[tile]) {
+                index->contained[index->contained_next[tile]++] = node;
             }
         }
-    } while (swap_happened);
+        if (info[node].tile_held >= 0) {
+            tile = info[node].tile_held;
+            index->held[index->held_next[tile]++] = node;
+        }
+    }
+
+    /* Senders are searched from the end of each bucket. */
+    for (tile = 0; tile < num_tiles; tile++) {
+        index->contained_next[tile] = index->contained_start[tile+1] - 1;
+        index->held_next[tile] = index->held_start[tile+1] - 1;
+    }
 }
 
-static void do_send_receive(const struct node_info *my_info, int tile_held,
-                            IceTInt num_tiles,
-                            IceTBoolean *all_contained_tmasks,
+static void do_send_receive(const struct vtree_step *step, int tile_held,
                             IceTImage image,
                             IceTVoid *inSparseImageBuffer,
                             IceTSizeType inSparseImageBufferSize,
@@ -377,52 +698,49 @@ static void do_send_receive(const struct node_info *my_info, int tile_held,
     IceTVoid *package_buffer;
     IceTSizeType package_size;
 
-    if (my_info->tile_sending != -1) {
-        icetRaiseDebug("Sending tile %d to node %d.", my_info->tile_sending,
-                       my_info->send_dest);
-        if (tile_held == my_info->tile_sending) {
+    if (step->tile_sending != -1) {
+        icetRaiseDebug("Sending tile %d to node %d.", step->tile_sending,
+                       step->send_dest);
+        if (tile_held == step->tile_sending) {
             icetCompressImage(image, outSparseImage);
             icetSparseImagePackageForSend(outSparseImage,
                                           &package_buffer, &package_size);
             tile_held = -1;
         } else {
             IceTSparseImage tileImage =
-                    icetGetCompressedTileImage(my_info->tile_sending);
+                    icetGetCompressedTileImage(step->tile_sending);
             icetSparseImagePackageForSend(tileImage,
                                           &package_buffer, &package_size);
         }
     }
 
-    if (my_info->tile_receiving != -1) {
+    if (step->tile_receiving != -1) {
         icetRaiseDebug("Receiving tile %d from node %d.",
-                       my_info->tile_receiving, my_info->recv_src);
-        if (   (tile_held != my_info->tile_receiving)
-            && all_contained_tmasks[my_info->rank*num_tiles
-                                   +my_info->tile_receiving])
-        {
-            icetGetTileImage(my_info->tile_receiving, image);
-            tile_held = my_info->tile_receiving;
+                       step->tile_receiving, step->recv_src);
+        if ((tile_held != step->tile_receiving) && step->render_received) {
+            icetGetTileImage(step->tile_receiving, image);
+            tile_held = step->tile_receiving;
         }
 
-        if (my_info->tile_sending != -1) {
+        if (step->tile_sending != -1) {
             icetCommSendrecv(package_buffer, package_size, ICET_BYTE,
-                             my_info->send_dest, VTREE_IMAGE_DATA,
+                             step->send_dest, VTREE_IMAGE_DATA,
                              inSparseImageBuffer, inSparseImageBufferSize,
-                             ICET_BYTE, my_info->recv_src, VTREE_IMAGE_DATA);
+                             ICET_BYTE, step->recv_src, VTREE_IMAGE_DATA);
         } else {
             icetCommRecv(inSparseImageBuffer, inSparseImageBufferSize,
-                         ICET_BYTE, my_info->recv_src, VTREE_IMAGE_DATA);
+                         ICET_BYTE, step->recv_src, VTREE_IMAGE_DATA);
         }
         inSparseImage =icetSparseImageUnpackageFromReceive(inSparseImageBuffer);
 
-        if (tile_held == my_info->tile_receiving) {
+        if (tile_held == step->tile_receiving) {
             icetCompressedComposite(image, inSparseImage, 1);
         } else {
             icetDecompressImage(inSparseImage, image);
         }
 
-    } else if (my_info->tile_sending != -1) {
+    } else if (step->tile_sending != -1) {
         icetCommSend(package_buffer, package_size, ICET_BYTE,
-                     my_info->send_dest, VTREE_IMAGE_DATA);
+                     step->send_dest, VTREE_IMAGE_DATA);
     }
 }
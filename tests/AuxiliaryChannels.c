@@ -0,0 +1,342 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests compositing auxiliary per-pixel channels.  Each process renders an
+** object id, a normal, and a short tag along with the color and depth.  After
+** compositing with each strategy, the channels of every pixel must be those
+** of the process with the nearest depth.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHANNEL_ID      0
+#define CHANNEL_NORMAL  1
+#define CHANNEL_TAG     2
+#define NUM_CHANNELS    3
+
+static const IceTEnum g_channel_types[NUM_CHANNELS] = {
+    ICET_INT, ICET_FLOAT, ICET_SHORT
+};
+static const IceTInt g_channel_counts[NUM_CHANNELS] = { 1, 3, 1 };
+
+/* Returns the depth process rank renders at pixel (x,y) of a tile or 1 if the
+   pixel is empty.  Tiles are no bigger than the physical render size, so
+   each is rendered on its own with the tile in the corner of the image.
+   Depths differ between processes so that the winner does not depend on how
+   ties are broken. */
+static IceTFloat PixelDepth(IceTInt rank,
+                            IceTInt num_proc,
+                            IceTSizeType x,
+                            IceTSizeType y)
+{
+    IceTInt hash = (IceTInt)(x/3*7 + y/5*13 + rank*29);
+    if (hash%4 == 0) {
+        return 1.0f;
+    }
+    return (IceTFloat)((hash%251)*num_proc + rank)/(251.0f*num_proc);
+}
+
+static void PixelChannels(IceTInt rank,
+                          IceTSizeType x,
+                          IceTSizeType y,
+                          IceTInt *id,
+                          IceTFloat *normal,
+                          IceTShort *tag)
+{
+    *id = 1000*(rank + 1);
+    normal[0] = (IceTFloat)rank;
+    normal[1] = (IceTFloat)x;
+    normal[2] = (IceTFloat)y;
+    *tag = (IceTShort)(rank*7 + x%13);
+}
+
+static void AuxiliaryChannelsDraw(const IceTDouble *projection_matrix,
+                                  const IceTDouble *modelview_matrix,
+                                  const IceTFloat *background_color,
+                                  const IceTInt *readback_viewport,
+                                  IceTImage result)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt auxiliary_size;
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTByte *id_buffer;
+    IceTByte *normal_buffer;
+    IceTByte *tag_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_AUXILIARY_PIXEL_SIZE, &auxiliary_size);
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+    id_buffer = icetImageGetAuxiliary(result, CHANNEL_ID);
+    normal_buffer = icetImageGetAuxiliary(result, CHANNEL_NORMAL);
+    tag_buffer = icetImageGetAuxiliary(result, CHANNEL_TAG);
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTUByte *color = color_buffer + 4*pixel;
+            IceTInt id = 0;
+            IceTFloat normal[3] = { 0.0f, 0.0f, 0.0f };
+            IceTShort tag = 0;
+
+            depth_buffer[pixel] = PixelDepth(rank, num_proc, x, y);
+            if (depth_buffer[pixel] < 1.0f) {
+                color[0] = (IceTUByte)(40*rank);
+                color[1] = (IceTUByte)x;
+                color[2] = (IceTUByte)y;
+                color[3] = 255;
+                PixelChannels(rank, x, y, &id, normal, &tag);
+            } else {
+                color[0] = color[1] = color[2] = color[3] = 0;
+            }
+            memcpy(id_buffer + auxiliary_size*pixel, &id, sizeof(id));
+            memcpy(normal_buffer + auxiliary_size*pixel,
+                   normal,
+                   sizeof(normal));
+            memcpy(tag_buffer + auxiliary_size*pixel, &tag, sizeof(tag));
+        }
+    }
+}
+
+static int AuxiliaryChannelsCheckImage(const IceTImage image)
+{
+    IceTInt num_proc;
+    IceTInt auxiliary_size;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTInt *ids;
+    const IceTByte *normal_buffer;
+    const IceTByte *tag_buffer;
+    IceTSizeType x, y;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_AUXILIARY_PIXEL_SIZE, &auxiliary_size);
+
+    width = icetImageGetWidth(image);
+    height = icetImageGetHeight(image);
+    ids = malloc(width*height*sizeof(IceTInt));
+    icetImageCopyAuxiliary(image, CHANNEL_ID, ids);
+    normal_buffer = icetImageGetAuxiliaryc(image, CHANNEL_NORMAL);
+    tag_buffer = icetImageGetAuxiliaryc(image, CHANNEL_TAG);
+
+    for (y = 0; (y < height) && (result == TEST_PASSED); y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTInt expected_id = 0;
+            IceTFloat expected_normal[3] = { 0.0f, 0.0f, 0.0f };
+            IceTShort expected_tag = 0;
+            IceTFloat nearest = 1.0f;
+            IceTFloat normal[3];
+            IceTShort tag;
+            IceTInt proc;
+
+            for (proc = 0; proc < num_proc; proc++) {
+                IceTFloat depth = PixelDepth(proc, num_proc, x, y);
+                if (depth < nearest) {
+                    nearest = depth;
+                    PixelChannels(proc,
+                                  x,
+                                  y,
+                                  &expected_id,
+                                  expected_normal,
+                                  &expected_tag);
+                }
+            }
+
+            memcpy(normal,
+                   normal_buffer + auxiliary_size*pixel,
+                   sizeof(normal));
+            memcpy(&tag, tag_buffer + auxiliary_size*pixel, sizeof(tag));
+            if (   (ids[pixel] != expected_id)
+                || (normal[0] != expected_normal[0])
+                || (normal[1] != expected_normal[1])
+                || (normal[2] != expected_normal[2])
+                || (tag != expected_tag) ) {
+                printrank("**** Bad auxiliary channels at %d,%d ****\n",
+                          (int)x, (int)y);
+                printrank("Got      id %d normal %g %g %g tag %d\n",
+                          ids[pixel], normal[0], normal[1], normal[2],
+                          (int)tag);
+                printrank("Expected id %d normal %g %g %g tag %d\n",
+                          expected_id,
+                          expected_normal[0],
+                          expected_normal[1],
+                          expected_normal[2],
+                          (int)expected_tag);
+                result = TEST_FAILED;
+                break;
+            }
+        }
+    }
+
+    free(ids);
+    return result;
+}
+
+static int AuxiliaryChannelsTryFrame(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTImage image;
+    IceTInt tile_displayed;
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    image = icetDrawFrame(identity, identity, black);
+
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+    if (tile_displayed < 0) {
+        return TEST_PASSED;
+    }
+    if (icetImageGetDepthFormat(image) != ICET_IMAGE_DEPTH_FLOAT) {
+        printrank("**** Result image dropped the depth ****\n");
+        return TEST_FAILED;
+    }
+
+    return AuxiliaryChannelsCheckImage(image);
+}
+
+/* Pre-rendered images have no auxiliary channels, so compositing them must
+   fail while channels are set. */
+static int AuxiliaryChannelsTryPreRendered(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTBitField diag_level;
+    IceTUByte *colors;
+    IceTFloat *depths;
+    IceTImage image;
+    IceTEnum error;
+
+    colors = calloc(4*SCREEN_WIDTH*SCREEN_HEIGHT, sizeof(IceTUByte));
+    depths = calloc(SCREEN_WIDTH*SCREEN_HEIGHT, sizeof(IceTFloat));
+
+    icetGetIntegerv(ICET_DIAGNOSTIC_LEVEL, (IceTInt *)&diag_level);
+    /* Do not report the error raised on purpose. */
+    icetDiagnostics(ICET_DIAG_OFF);
+    icetGetError();
+    image = icetCompositeImage(colors, depths, NULL, NULL, NULL, black);
+    error = icetGetError();
+    icetDiagnostics(diag_level);
+
+    free(colors);
+    free(depths);
+
+    if (!icetImageIsNull(image) || (error != ICET_INVALID_OPERATION)) {
+        printrank("**** Composited pre-rendered image with auxiliary"
+                  " channels ****\n");
+        return TEST_FAILED;
+    }
+    return TEST_PASSED;
+}
+
+static int AuxiliaryChannelsRun(void)
+{
+    IceTInt num_proc;
+    int strategy_index;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetSetAuxiliaryChannels(NUM_CHANNELS, g_channel_types, g_channel_counts);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+
+    {
+        IceTInt auxiliary_size;
+        icetGetIntegerv(ICET_AUXILIARY_PIXEL_SIZE, &auxiliary_size);
+        /* int + 3 floats + short padded to a whole word. */
+        if (auxiliary_size != 20) {
+            printrank("**** Got auxiliary pixel size %d ****\n",
+                      auxiliary_size);
+            return TEST_FAILED;
+        }
+    }
+
+    icetDrawCallback(AuxiliaryChannelsDraw);
+
+    /* Use two tiles when possible so that multi-tile collection is used. */
+    icetResetTiles();
+    if (num_proc > 1) {
+        icetAddTile(0, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT, 0);
+        icetAddTile(SCREEN_WIDTH/2, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT, 1);
+    } else {
+        icetAddTile(0, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT, 0);
+    }
+
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        IceTEnum strategy = strategy_list[strategy_index];
+        int single_image_strategy_index;
+        int num_single_image_strategy;
+
+        icetStrategy(strategy);
+        if (strategy_uses_single_image_strategy(strategy)) {
+            num_single_image_strategy = SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+        } else {
+            num_single_image_strategy = 1;
+        }
+
+        for (single_image_strategy_index = 0;
+             single_image_strategy_index < num_single_image_strategy;
+             single_image_strategy_index++) {
+            icetSingleImageStrategy(
+                single_image_strategy_list[single_image_strategy_index]);
+            printstat("Trying strategy %s, single image strategy %s\n",
+                      icetGetStrategyName(),
+                      icetGetSingleImageStrategyName());
+            if (AuxiliaryChannelsTryFrame() != TEST_PASSED) {
+                result = TEST_FAILED;
+            }
+        }
+    }
+
+    printstat("Trying pre-rendered image\n");
+    if (AuxiliaryChannelsTryPreRendered() != TEST_PASSED) {
+        result = TEST_FAILED;
+    }
+
+    icetSetAuxiliaryChannels(0, NULL, NULL);
+
+    return result;
+}
+
+int AuxiliaryChannels(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(AuxiliaryChannelsRun);
+}
@@ -0,0 +1,212 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the ICET_BALANCE_TILES option of the reduce strategy.  Every process
+** renders to two tiles, but nearly all of the active pixels are in the
+** second tile.  With balancing on, more processes must be assigned to that
+** tile after the first frame, the assignment must stay put while the loads
+** stay the same, and the images must match those composited without
+** balancing.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TILE_WIDTH 80
+#define TILE_HEIGHT 60
+
+#define NUM_BALANCED_FRAMES 4
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+static IceTVoid *g_colors;
+static IceTFloat *g_depths;
+
+/* The first tile gets a single row of active pixels.  The second tile is
+   mostly active. */
+static void MakeImage(void)
+{
+    IceTInt width = 2*TILE_WIDTH;
+    IceTInt height = TILE_HEIGHT;
+    IceTInt rank;
+    IceTBoolean *active_mask;
+    IceTInt x, y;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    active_mask = malloc(width*height*sizeof(IceTBoolean));
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            if (x < TILE_WIDTH) {
+                active_mask[y*width + x] = (y == rank%height);
+            } else {
+                active_mask[y*width + x] = ((x + y + rank)%5 != 0);
+            }
+        }
+    }
+
+    make_test_image_from_mask(width,
+                              height,
+                              active_mask,
+                              g_background_color,
+                              &g_colors,
+                              &g_depths);
+    free(active_mask);
+}
+
+static void FreeImage(void)
+{
+    free(g_colors);
+    free(g_depths);
+}
+
+static IceTBoolean BalanceTilesTryStrategy(void)
+{
+    IceTByte *reference;
+    IceTSizeType reference_bytes;
+    IceTInt num_proc;
+    IceTInt frame;
+    IceTInt last_counts[2];
+    IceTBoolean success = ICET_TRUE;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetDisable(ICET_BALANCE_TILES);
+    reference = composite_and_copy(g_colors,
+                                   g_depths,
+                                   NULL,
+                                   g_background_color,
+                                   &reference_bytes);
+
+    icetEnable(ICET_BALANCE_TILES);
+    icetResetTiles();
+    icetAddTile(0, 0, TILE_WIDTH, TILE_HEIGHT, 0);
+    icetAddTile(TILE_WIDTH, 0, TILE_WIDTH, TILE_HEIGHT, 1);
+
+    last_counts[0] = last_counts[1] = 0;
+    for (frame = 0; frame < NUM_BALANCED_FRAMES; frame++) {
+        IceTByte *balanced;
+        IceTSizeType balanced_bytes;
+        IceTInt counts[2];
+
+        balanced = composite_and_copy(g_colors,
+                                      g_depths,
+                                      NULL,
+                                      g_background_color,
+                                      &balanced_bytes);
+        if (   (balanced_bytes != reference_bytes)
+            || (   (reference != NULL)
+                && (memcmp(reference, balanced, reference_bytes) != 0) ) ) {
+            printrank("***** Frame %d differs when balanced *****\n", frame);
+            success = ICET_FALSE;
+        }
+        free(balanced);
+
+        if (icetStateGetNumEntries(ICET_TILE_PROCESS_COUNTS) != 2) {
+            printrank("***** No process counts recorded *****\n");
+            success = ICET_FALSE;
+            break;
+        }
+        icetGetIntegerv(ICET_TILE_PROCESS_COUNTS, counts);
+        printstat("    Frame %d: %d and %d processes\n",
+                  frame, counts[0], counts[1]);
+
+        if (counts[0] + counts[1] != num_proc) {
+            printrank("***** Not all processes assigned *****\n");
+            success = ICET_FALSE;
+        }
+        if ((frame > 0) && (counts[1] <= counts[0])) {
+            printrank("***** Busy tile did not get more processes *****\n");
+            success = ICET_FALSE;
+        }
+        if (   (frame > 1)
+            && ((counts[0] != last_counts[0]) || (counts[1] != last_counts[1])))
+        {
+            printrank("***** Assignment changed with steady loads *****\n");
+            success = ICET_FALSE;
+        }
+        last_counts[0] = counts[0];
+        last_counts[1] = counts[1];
+    }
+
+    icetDisable(ICET_BALANCE_TILES);
+    free(reference);
+    return success;
+}
+
+static int BalanceTilesRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt si_index;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (num_proc < 3) {
+        printstat("Need at least 3 processes to shift between two tiles.\n");
+        return TEST_NOT_RUN;
+    }
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetStrategy(ICET_STRATEGY_REDUCE);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+
+    icetResetTiles();
+    icetAddTile(0, 0, TILE_WIDTH, TILE_HEIGHT, 0);
+    icetAddTile(TILE_WIDTH, 0, TILE_WIDTH, TILE_HEIGHT, 1);
+
+    MakeImage();
+    for (si_index = 0; si_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE; si_index++){
+        icetSingleImageStrategy(single_image_strategy_list[si_index]);
+        printstat("  Using %s single image strategy.\n",
+                  icetGetSingleImageStrategyName());
+        success &= BalanceTilesTryStrategy();
+    }
+    FreeImage();
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int BalanceTiles(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(BalanceTilesRun);
+}
@@ -0,0 +1,767 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test is a benchmark of the compositing alone.  Rather than render,
+** each process generates a synthetic image with a controllable number and
+** arrangement of active pixels and passes it to icetCompositeImage.  It needs
+** no graphics context, so it can measure many processes on a single machine.
+** With -views, each frame composites several views, either batched through
+** icetCompositeImages or with one icetCompositeImage call per view.
+** Timings are written as CSV or JSON records for regression tracking.
+*****************************************************************************/
+
+#include <IceTDevCommunication.h>
+#include <IceTDevPorting.h>
+#include <IceTDevState.h>
+#include "test_util.h"
+#include "test_codes.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi */
+#endif
+
+#define BENCHMARK_NUM_TIMES     6
+#define BENCHMARK_COMPOSITE     0
+#define BENCHMARK_COMPRESS      1
+#define BENCHMARK_BLEND         2
+#define BENCHMARK_COLLECT       3
+#define BENCHMARK_TOTAL         4
+#define BENCHMARK_BYTES_SENT    5
+
+static IceTSizeType g_width;
+static IceTSizeType g_height;
+static IceTInt g_num_tiles_x;
+static IceTInt g_num_tiles_y;
+static IceTInt g_num_frames;
+static IceTInt g_seed;
+static IceTFloat g_active_fraction;
+static IceTInt g_num_clusters;
+static IceTEnum g_color_format;
+static IceTEnum g_depth_format;
+static IceTEnum g_composite_mode;
+static IceTBoolean g_ordered;
+static IceTBoolean g_pipeline_tiles;
+static IceTEnum g_strategy;
+static IceTEnum g_single_image_strategy;
+static IceTBoolean g_sweep_strategies;
+static IceTInt g_max_magic_k;
+static IceTInt g_min_image_split;
+static IceTInt g_num_views;
+static IceTBoolean g_separate_views;
+static IceTBoolean g_json;
+static const char *g_output_filename;
+
+static FILE *g_output;
+
+static void usage(char *argv[])
+{
+    printstat("\nUSAGE: %s [testargs]\n", argv[0]);
+    printstat("\nWhere  testargs are:\n");
+    printstat("  -width <num>  Width of each tile (default %d).\n",
+              (int)SCREEN_WIDTH);
+    printstat("  -height <num> Height of each tile (default %d).\n",
+              (int)SCREEN_HEIGHT);
+    printstat("  -tilesx <num> Sets the number of tiles horizontal (default 1).\n");
+    printstat("  -tilesy <num> Sets the number of tiles vertical (default 1).\n");
+    printstat("  -frames <num> Sets the number of frames to composite (default 2).\n");
+    printstat("  -seed <num>   Use the given number as the random seed.\n");
+    printstat("  -active <fraction> Fraction of pixels each process covers\n"
+              "                (default 0.25).\n");
+    printstat("  -clusters <num> Number of disks the active pixels are gathered\n"
+              "                into.  0 scatters them uniformly (default 1).\n");
+    printstat("  -color-ubyte  Composite RGBA 8-bit colors (default).\n");
+    printstat("  -color-float  Composite RGBA float colors.\n");
+    printstat("  -color-none   Composite no color (depth only).\n");
+    printstat("  -depth-none   Composite no depth.  Implies -blend.\n");
+    printstat("  -blend        Use blending rather than z-buffer compositing.\n");
+    printstat("  -ordered      Composite in the order of process rank.\n");
+    printstat("  -pipeline-tiles Collect each tile while compositing the next\n"
+              "                (sequential strategy only).\n");
+    printstat("  -reduce       Use the reduce strategy (default).\n");
+    printstat("  -vtree        Use the virtual trees strategy.\n");
+    printstat("  -hybrid       Use the hybrid strategy.\n");
+    printstat("  -sequential   Use the sequential strategy.\n");
+    printstat("  -bswap        Use the binary-swap single-image strategy.\n");
+    printstat("  -bswapfold    Use the binary-swap with folding single-image strategy.\n");
+    printstat("  -radixk       Use the radix-k single-image strategy.\n");
+    printstat("  -radixkr      Use the radix-kr single-image strategy.\n");
+    printstat("  -tree         Use the tree single-image strategy.\n");
+    printstat("  -sweep-strategies Repeat for every multi-tile and single-image\n"
+              "                strategy.\n");
+    printstat("  -magic-k-study <num> Repeat for multiple values of k, up to <num>,\n"
+              "                doubling each time.\n");
+    printstat("  -max-image-split-study <num> Repeat for multiple maximum image\n"
+              "                splits starting at <num> and doubling each time.\n");
+    printstat("  -views <num>  Composite this many views each frame with\n"
+              "                icetCompositeImages (default 1).\n");
+    printstat("  -separate-views Composite the views with one icetCompositeImage\n"
+              "                call each rather than icetCompositeImages.\n");
+    printstat("  -json         Write records as JSON objects rather than CSV.\n");
+    printstat("  -o <file>     Write records to the given file rather than the\n"
+              "                standard output.\n");
+    printstat("  -h, -help     Print this help message.\n");
+    printstat("\nFor general testing options, try -h or -help before test name.\n");
+}
+
+static void parse_arguments(int argc, char *argv[])
+{
+    int arg;
+
+    g_width = SCREEN_WIDTH;
+    g_height = SCREEN_HEIGHT;
+    g_num_tiles_x = 1;
+    g_num_tiles_y = 1;
+    g_num_frames = 2;
+    g_seed = (IceTInt)time(NULL);
+    g_active_fraction = 0.25f;
+    g_num_clusters = 1;
+    g_color_format = ICET_IMAGE_COLOR_RGBA_UBYTE;
+    g_depth_format = ICET_IMAGE_DEPTH_FLOAT;
+    g_composite_mode = ICET_COMPOSITE_MODE_Z_BUFFER;
+    g_ordered = ICET_FALSE;
+    g_pipeline_tiles = ICET_FALSE;
+    g_strategy = ICET_STRATEGY_REDUCE;
+    g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC;
+    g_sweep_strategies = ICET_FALSE;
+    g_max_magic_k = 0;
+    g_min_image_split = 0;
+    g_num_views = 1;
+    g_separate_views = ICET_FALSE;
+    g_json = ICET_FALSE;
+    g_output_filename = NULL;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-width") == 0) {
+            arg++;
+            g_width = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-height") == 0) {
+            arg++;
+            g_height = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-tilesx") == 0) {
+            arg++;
+            g_num_tiles_x = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-tilesy") == 0) {
+            arg++;
+            g_num_tiles_y = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-frames") == 0) {
+            arg++;
+            g_num_frames = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-seed") == 0) {
+            arg++;
+            g_seed = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-active") == 0) {
+            arg++;
+            g_active_fraction = (IceTFloat)atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-clusters") == 0) {
+            arg++;
+            g_num_clusters = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-color-ubyte") == 0) {
+            g_color_format = ICET_IMAGE_COLOR_RGBA_UBYTE;
+        } else if (strcmp(argv[arg], "-color-float") == 0) {
+            g_color_format = ICET_IMAGE_COLOR_RGBA_FLOAT;
+        } else if (strcmp(argv[arg], "-color-none") == 0) {
+            g_color_format = ICET_IMAGE_COLOR_NONE;
+        } else if (strcmp(argv[arg], "-depth-none") == 0) {
+            g_depth_format = ICET_IMAGE_DEPTH_NONE;
+            g_composite_mode = ICET_COMPOSITE_MODE_BLEND;
+        } else if (strcmp(argv[arg], "-blend") == 0) {
+            g_composite_mode = ICET_COMPOSITE_MODE_BLEND;
+        } else if (strcmp(argv[arg], "-ordered") == 0) {
+            g_ordered = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-pipeline-tiles") == 0) {
+            g_pipeline_tiles = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-reduce") == 0) {
+            g_strategy = ICET_STRATEGY_REDUCE;
+        } else if (strcmp(argv[arg], "-vtree") == 0) {
+            g_strategy = ICET_STRATEGY_VTREE;
+        } else if (strcmp(argv[arg], "-hybrid") == 0) {
+            g_strategy = ICET_STRATEGY_HYBRID;
+        } else if (strcmp(argv[arg], "-sequential") == 0) {
+            g_strategy = ICET_STRATEGY_SEQUENTIAL;
+        } else if (strcmp(argv[arg], "-bswap") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP;
+        } else if (strcmp(argv[arg], "-bswapfold") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP_FOLDING;
+        } else if (strcmp(argv[arg], "-radixk") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXK;
+        } else if (strcmp(argv[arg], "-radixkr") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXKR;
+        } else if (strcmp(argv[arg], "-tree") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_TREE;
+        } else if (strcmp(argv[arg], "-sweep-strategies") == 0) {
+            g_sweep_strategies = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-magic-k-study") == 0) {
+            arg++;
+            g_max_magic_k = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-max-image-split-study") == 0) {
+            arg++;
+            g_min_image_split = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-views") == 0) {
+            arg++;
+            g_num_views = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-separate-views") == 0) {
+            g_separate_views = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-json") == 0) {
+            g_json = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-o") == 0) {
+            arg++;
+            g_output_filename = argv[arg];
+        } else if (   (strcmp(argv[arg], "-h") == 0)
+                   || (strcmp(argv[arg], "-help") == 0) ) {
+            usage(argv);
+            exit(0);
+        } else {
+            printstat("Unknown option `%s'.\n", argv[arg]);
+            usage(argv);
+            exit(1);
+        }
+    }
+}
+
+/* A simple linear congruential generator so that every platform produces the
+   same images for the same seed. */
+static IceTUInt g_random_state;
+
+static IceTFloat benchmark_random(void)
+{
+    g_random_state = g_random_state*1103515245u + 12345u;
+    return (IceTFloat)((g_random_state >> 8) & 0xFFFFFF)/(IceTFloat)0x1000000;
+}
+
+/* Fills the color and depth buffers of the global viewport with a synthetic
+   image.  Active pixels are either scattered uniformly or gathered into disks
+   so that the spatial coherence of the image can be controlled. */
+static void MakeSyntheticImage(IceTSizeType width,
+                               IceTSizeType height,
+                               IceTInt frame,
+                               IceTVoid *color_buffer,
+                               IceTFloat *depth_buffer)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTFloat red, green, blue;
+    IceTFloat *cluster_centers;
+    IceTFloat radius;
+    IceTInt cluster;
+    IceTSizeType x, y;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    g_random_state = (IceTUInt)(g_seed + 7919*rank + 104729*frame);
+    red = benchmark_random();
+    green = benchmark_random();
+    blue = benchmark_random();
+
+    cluster_centers = NULL;
+    radius = 0.0f;
+    if (g_num_clusters > 0) {
+        cluster_centers = malloc(2*g_num_clusters*sizeof(IceTFloat));
+        for (cluster = 0; cluster < g_num_clusters; cluster++) {
+            cluster_centers[2*cluster + 0] = benchmark_random()*width;
+            cluster_centers[2*cluster + 1] = benchmark_random()*height;
+        }
+        radius = (IceTFloat)sqrt(  g_active_fraction*width*height
+                                 / (g_num_clusters*M_PI));
+    }
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTBoolean active = ICET_FALSE;
+            IceTFloat alpha;
+
+            if (g_num_clusters > 0) {
+                for (cluster = 0; cluster < g_num_clusters; cluster++) {
+                    IceTFloat dx = x - cluster_centers[2*cluster + 0];
+                    IceTFloat dy = y - cluster_centers[2*cluster + 1];
+                    if (dx*dx + dy*dy < radius*radius) {
+                        active = ICET_TRUE;
+                        break;
+                    }
+                }
+            } else {
+                active = (benchmark_random() < g_active_fraction);
+            }
+
+            alpha = active ? 0.5f : 0.0f;
+            if (g_composite_mode == ICET_COMPOSITE_MODE_Z_BUFFER) {
+                alpha = active ? 1.0f : 0.0f;
+            }
+
+            if (g_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                IceTUByte *color = (IceTUByte *)color_buffer + 4*pixel;
+                color[0] = (IceTUByte)(255*red*alpha);
+                color[1] = (IceTUByte)(255*green*alpha);
+                color[2] = (IceTUByte)(255*blue*alpha);
+                color[3] = (IceTUByte)(255*alpha);
+            } else if (g_color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+                IceTFloat *color = (IceTFloat *)color_buffer + 4*pixel;
+                color[0] = red*alpha;
+                color[1] = green*alpha;
+                color[2] = blue*alpha;
+                color[3] = alpha;
+            }
+
+            if (depth_buffer != NULL) {
+                depth_buffer[pixel]
+                    = active ? ((IceTFloat)rank + 0.5f)/num_proc : 1.0f;
+            }
+        }
+    }
+
+    if (cluster_centers != NULL) {
+        free(cluster_centers);
+    }
+}
+
+static void BenchmarkPrintHeader(void)
+{
+    if (g_json) { return; }
+
+    fprintf(g_output,
+            "num processes,"
+            "multi-tile strategy,"
+            "single-image strategy,"
+            "tiles x,"
+            "tiles y,"
+            "width,"
+            "height,"
+            "color format,"
+            "depth format,"
+            "composite mode,"
+            "ordered,"
+            "pipeline tiles,"
+            "active fraction,"
+            "clusters,"
+            "magic k,"
+            "max image split,"
+            "views,"
+            "batched views,"
+            "frame,"
+            "composite time,"
+            "compress time,"
+            "blend time,"
+            "collect time,"
+            "total time,"
+            "bytes sent\n");
+}
+
+static const char *BenchmarkColorName(void)
+{
+    switch (g_color_format) {
+      case ICET_IMAGE_COLOR_RGBA_UBYTE: return "rgba_ubyte";
+      case ICET_IMAGE_COLOR_RGBA_FLOAT: return "rgba_float";
+      default:                          return "none";
+    }
+}
+
+/* Writes one record with the maximum of each timing over all processes. */
+static void BenchmarkPrintRecord(IceTInt frame, const IceTDouble *times)
+{
+    IceTInt num_proc;
+    IceTInt magic_k;
+    IceTInt max_image_split;
+    const char *depth_name;
+    const char *mode_name;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_MAGIC_K, &magic_k);
+    icetGetIntegerv(ICET_MAX_IMAGE_SPLIT, &max_image_split);
+    depth_name = (g_depth_format == ICET_IMAGE_DEPTH_FLOAT) ? "float" : "none";
+    mode_name = (g_composite_mode == ICET_COMPOSITE_MODE_BLEND)
+        ? "blend" : "z_buffer";
+
+    if (g_json) {
+        fprintf(g_output,
+                "{\"num_processes\":%d,"
+                "\"strategy\":\"%s\","
+                "\"single_image_strategy\":\"%s\","
+                "\"tiles_x\":%d,"
+                "\"tiles_y\":%d,"
+                "\"width\":%d,"
+                "\"height\":%d,"
+                "\"color_format\":\"%s\","
+                "\"depth_format\":\"%s\","
+                "\"composite_mode\":\"%s\","
+                "\"ordered\":%s,"
+                "\"pipeline_tiles\":%s,"
+                "\"active_fraction\":%g,"
+                "\"clusters\":%d,"
+                "\"magic_k\":%d,"
+                "\"max_image_split\":%d,"
+                "\"views\":%d,"
+                "\"batched_views\":%s,"
+                "\"frame\":%d,"
+                "\"composite_time\":%g,"
+                "\"compress_time\":%g,"
+                "\"blend_time\":%g,"
+                "\"collect_time\":%g,"
+                "\"total_time\":%g,"
+                "\"bytes_sent\":%.0f}\n",
+                num_proc,
+                icetGetStrategyName(),
+                icetGetSingleImageStrategyName(),
+                g_num_tiles_x,
+                g_num_tiles_y,
+                (int)g_width,
+                (int)g_height,
+                BenchmarkColorName(),
+                depth_name,
+                mode_name,
+                g_ordered ? "true" : "false",
+                g_pipeline_tiles ? "true" : "false",
+                g_active_fraction,
+                g_num_clusters,
+                magic_k,
+                max_image_split,
+                g_num_views,
+                g_separate_views ? "false" : "true",
+                frame,
+                times[BENCHMARK_COMPOSITE],
+                times[BENCHMARK_COMPRESS],
+                times[BENCHMARK_BLEND],
+                times[BENCHMARK_COLLECT],
+                times[BENCHMARK_TOTAL],
+                times[BENCHMARK_BYTES_SENT]);
+    } else {
+        fprintf(g_output,
+                "%d,%s,%s,%d,%d,%d,%d,%s,%s,%s,%s,%s,%g,%d,%d,%d,%d,%s,%d,"
+                "%g,%g,%g,%g,%g,%.0f\n",
+                num_proc,
+                icetGetStrategyName(),
+                icetGetSingleImageStrategyName(),
+                g_num_tiles_x,
+                g_num_tiles_y,
+                (int)g_width,
+                (int)g_height,
+                BenchmarkColorName(),
+                depth_name,
+                mode_name,
+                g_ordered ? "yes" : "no",
+                g_pipeline_tiles ? "yes" : "no",
+                g_active_fraction,
+                g_num_clusters,
+                magic_k,
+                max_image_split,
+                g_num_views,
+                g_separate_views ? "no" : "yes",
+                frame,
+                times[BENCHMARK_COMPOSITE],
+                times[BENCHMARK_COMPRESS],
+                times[BENCHMARK_BLEND],
+                times[BENCHMARK_COLLECT],
+                times[BENCHMARK_TOTAL],
+                times[BENCHMARK_BYTES_SENT]);
+    }
+    fflush(g_output);
+}
+
+/* Adds the timings of the last composite to times. */
+static void BenchmarkAddTimes(IceTDouble *times)
+{
+    IceTDouble value;
+    IceTInt bytes_sent;
+
+    icetGetDoublev(ICET_COMPOSITE_TIME, &value);
+    times[BENCHMARK_COMPOSITE] += value;
+    icetGetDoublev(ICET_COMPRESS_TIME, &value);
+    times[BENCHMARK_COMPRESS] += value;
+    icetGetDoublev(ICET_BLEND_TIME, &value);
+    times[BENCHMARK_BLEND] += value;
+    icetGetDoublev(ICET_COLLECT_TIME, &value);
+    times[BENCHMARK_COLLECT] += value;
+    icetGetDoublev(ICET_TOTAL_DRAW_TIME, &value);
+    times[BENCHMARK_TOTAL] += value;
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent);
+    times[BENCHMARK_BYTES_SENT] += bytes_sent;
+}
+
+/* Composites every view of a frame and sets times to the totals over the
+   views.  All views use the same synthetic image. */
+static void BenchmarkCompositeViews(const IceTVoid *color_buffer,
+                                    const IceTFloat *depth_buffer,
+                                    const IceTInt *valid_pixels_viewport,
+                                    const IceTFloat *background_color,
+                                    IceTDouble *times)
+{
+    IceTInt view;
+    IceTInt i;
+
+    for (i = 0; i < BENCHMARK_NUM_TIMES; i++) {
+        times[i] = 0.0;
+    }
+
+    if ((g_num_views > 1) && !g_separate_views) {
+        const IceTVoid **color_buffers;
+        const IceTVoid **depth_buffers;
+        IceTInt *valid_pixels_viewports;
+        IceTImage *images;
+
+        color_buffers = malloc(g_num_views*sizeof(const IceTVoid *));
+        depth_buffers = malloc(g_num_views*sizeof(const IceTVoid *));
+        valid_pixels_viewports = malloc(4*g_num_views*sizeof(IceTInt));
+        images = malloc(g_num_views*sizeof(IceTImage));
+        for (view = 0; view < g_num_views; view++) {
+            color_buffers[view] = color_buffer;
+            depth_buffers[view] = depth_buffer;
+            memcpy(valid_pixels_viewports + 4*view,
+                   valid_pixels_viewport,
+                   4*sizeof(IceTInt));
+        }
+
+        icetCompositeImages(g_num_views,
+                            color_buffers,
+                            depth_buffers,
+                            valid_pixels_viewports,
+                            NULL,
+                            NULL,
+                            background_color,
+                            images);
+        BenchmarkAddTimes(times);
+
+        free(color_buffers);
+        free(depth_buffers);
+        free(valid_pixels_viewports);
+        free(images);
+    } else {
+        for (view = 0; view < g_num_views; view++) {
+            icetCompositeImage(color_buffer,
+                               depth_buffer,
+                               valid_pixels_viewport,
+                               NULL,
+                               NULL,
+                               background_color);
+            BenchmarkAddTimes(times);
+        }
+    }
+}
+
+static int BenchmarkDoComposite(void)
+{
+    const IceTFloat background_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTSizeType global_width;
+    IceTSizeType global_height;
+    IceTInt valid_pixels_viewport[4];
+    IceTVoid *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTDouble *all_times;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt frame;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    global_width = g_num_tiles_x*g_width;
+    global_height = g_num_tiles_y*g_height;
+    valid_pixels_viewport[0] = 0;
+    valid_pixels_viewport[1] = 0;
+    valid_pixels_viewport[2] = global_width;
+    valid_pixels_viewport[3] = global_height;
+
+    color_buffer = NULL;
+    if (g_color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+        color_buffer = malloc(4*global_width*global_height);
+    } else if (g_color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+        color_buffer
+            = malloc(4*global_width*global_height*sizeof(IceTFloat));
+    }
+    depth_buffer = NULL;
+    if (g_depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+        depth_buffer = malloc(global_width*global_height*sizeof(IceTFloat));
+    }
+    all_times = malloc(num_proc*BENCHMARK_NUM_TIMES*sizeof(IceTDouble));
+
+    printstat("Compositing with strategy %s, single image strategy %s\n",
+              icetGetStrategyName(), icetGetSingleImageStrategyName());
+
+    for (frame = 0; frame < g_num_frames; frame++) {
+        IceTDouble times[BENCHMARK_NUM_TIMES];
+        IceTInt proc;
+        IceTInt i;
+
+        MakeSyntheticImage(global_width, global_height, frame,
+                           color_buffer, depth_buffer);
+
+        icetCommBarrier();
+        BenchmarkCompositeViews(color_buffer,
+                                depth_buffer,
+                                valid_pixels_viewport,
+                                background_color,
+                                times);
+
+        icetCommAllgather(times, BENCHMARK_NUM_TIMES, ICET_DOUBLE, all_times);
+        for (proc = 0; proc < num_proc; proc++) {
+            for (i = 0; i < BENCHMARK_BYTES_SENT; i++) {
+                IceTDouble value = all_times[proc*BENCHMARK_NUM_TIMES + i];
+                if (value > times[i]) { times[i] = value; }
+            }
+        }
+        /* Bytes sent is reported as the total over all processes. */
+        times[BENCHMARK_BYTES_SENT] = 0.0;
+        for (proc = 0; proc < num_proc; proc++) {
+            times[BENCHMARK_BYTES_SENT]
+                += all_times[proc*BENCHMARK_NUM_TIMES + BENCHMARK_BYTES_SENT];
+        }
+
+        if (rank == 0) {
+            BenchmarkPrintRecord(frame, times);
+        }
+    }
+
+    if (color_buffer != NULL) { free(color_buffer); }
+    if (depth_buffer != NULL) { free(depth_buffer); }
+    free(all_times);
+
+    return TEST_PASSED;
+}
+
+/* Repeats the compositing for each magic k and maximum image split in the
+   requested studies.  These are normally read from the environment when the
+   context is created, so they are set directly in the state here. */
+static int BenchmarkDoParameterStudies(void)
+{
+    IceTInt save_magic_k;
+    IceTInt save_max_image_split;
+    IceTInt num_proc;
+    IceTInt magic_k;
+    IceTInt image_split;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_MAGIC_K, &save_magic_k);
+    icetGetIntegerv(ICET_MAX_IMAGE_SPLIT, &save_max_image_split);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (g_max_magic_k > 0) {
+        for (magic_k = 2; magic_k <= g_max_magic_k; magic_k *= 2) {
+            icetStateSetInteger(ICET_MAGIC_K, magic_k);
+            result += BenchmarkDoComposite();
+        }
+    } else if (g_min_image_split > 0) {
+        for (image_split = g_min_image_split;
+             image_split <= num_proc;
+             image_split *= 2) {
+            icetStateSetInteger(ICET_MAX_IMAGE_SPLIT, image_split);
+            result += BenchmarkDoComposite();
+        }
+    } else {
+        result += BenchmarkDoComposite();
+    }
+
+    icetStateSetInteger(ICET_MAGIC_K, save_magic_k);
+    icetStateSetInteger(ICET_MAX_IMAGE_SPLIT, save_max_image_split);
+
+    return result;
+}
+
+static int BenchmarkDoStrategies(void)
+{
+    int result = TEST_PASSED;
+
+    if (g_sweep_strategies) {
+        int strategy_idx;
+        int si_strategy_idx;
+        for (strategy_idx = 0;
+             strategy_idx < STRATEGY_LIST_SIZE;
+             strategy_idx++) {
+            icetStrategy(strategy_list[strategy_idx]);
+            for (si_strategy_idx = 0;
+                 si_strategy_idx < SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+                 si_strategy_idx++) {
+                icetSingleImageStrategy(
+                            single_image_strategy_list[si_strategy_idx]);
+                result += BenchmarkDoParameterStudies();
+            }
+        }
+    } else {
+        icetStrategy(g_strategy);
+        icetSingleImageStrategy(g_single_image_strategy);
+        result += BenchmarkDoParameterStudies();
+    }
+
+    return result;
+}
+
+static int CompositeBenchmarkRun(void)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt x, y;
+    int result;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (g_num_tiles_x*g_num_tiles_y > num_proc) {
+        printstat("Not enough processes for %dx%d tiles.\n",
+                  g_num_tiles_x, g_num_tiles_y);
+        return TEST_NOT_RUN;
+    }
+
+    g_output = stdout;
+    if ((rank == 0) && (g_output_filename != NULL)) {
+        g_output = fopen(g_output_filename, "w");
+        if (g_output == NULL) {
+            printrank("Could not open %s for writing.\n", g_output_filename);
+            g_output = stdout;
+        }
+    }
+
+    icetCompositeMode(g_composite_mode);
+    icetSetColorFormat(g_color_format);
+    icetSetDepthFormat(g_depth_format);
+    if (g_ordered) {
+        IceTInt *order = malloc(num_proc*sizeof(IceTInt));
+        IceTInt proc;
+        for (proc = 0; proc < num_proc; proc++) { order[proc] = proc; }
+        icetEnable(ICET_ORDERED_COMPOSITE);
+        icetCompositeOrder(order);
+        free(order);
+    } else {
+        icetDisable(ICET_ORDERED_COMPOSITE);
+    }
+    icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+    if (g_pipeline_tiles) {
+        icetEnable(ICET_PIPELINE_TILES);
+    } else {
+        icetDisable(ICET_PIPELINE_TILES);
+    }
+
+    icetResetTiles();
+    for (y = 0; y < g_num_tiles_y; y++) {
+        for (x = 0; x < g_num_tiles_x; x++) {
+            icetAddTile(x*g_width, y*g_height, g_width, g_height,
+                        y*g_num_tiles_x + x);
+        }
+    }
+
+    if (rank == 0) {
+        BenchmarkPrintHeader();
+    }
+
+    result = BenchmarkDoStrategies();
+
+    if (g_output != stdout) {
+        fclose(g_output);
+    }
+
+    return result;
+}
+
+int CompositeBenchmark(int argc, char *argv[])
+{
+    parse_arguments(argc, argv);
+
+    return run_test(CompositeBenchmarkRun);
+}
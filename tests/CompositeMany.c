@@ -0,0 +1,253 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test checks that compositing several sparse images at once with
+** icetCompressedCompositeMany gives exactly the same result as compositing
+** them one at a time with icetCompressedComposite in each composite mode.
+*****************************************************************************/
+
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define IMAGE_WIDTH 37
+#define IMAGE_HEIGHT 23
+
+/* More than icetCompressedCompositeMany handles in one pass. */
+#define MAX_IMAGES 19
+
+/* Fills the image with rows of active pixels broken by random gaps. */
+static void RandomImage(IceTImage image)
+{
+    IceTEnum color_format = icetImageGetColorFormat(image);
+    IceTEnum depth_format = icetImageGetDepthFormat(image);
+    IceTSizeType num_pixels = icetImageGetNumPixels(image);
+    IceTSizeType run_left = 0;
+    IceTBoolean active = ICET_FALSE;
+    IceTSizeType pixel;
+
+    for (pixel = 0; pixel < num_pixels; pixel++) {
+        IceTFloat color[4];
+        IceTFloat depth;
+
+        if (run_left == 0) {
+            active = !active;
+            run_left = 1 + rand()%(2*IMAGE_WIDTH);
+        }
+        run_left--;
+
+        if (active) {
+            color[3] = (IceTFloat)(1 + rand()%255)/255.0f;
+            color[0] = color[3]*(IceTFloat)(rand()%256)/255.0f;
+            color[1] = color[3]*(IceTFloat)(rand()%256)/255.0f;
+            color[2] = color[3]*(IceTFloat)(rand()%256)/255.0f;
+            depth = (IceTFloat)(rand()%1024)/1024.0f;
+        } else {
+            color[0] = color[1] = color[2] = color[3] = 0.0f;
+            depth = 1.0f;
+        }
+
+        if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+            IceTUByte *out = icetImageGetColorub(image) + 4*pixel;
+            out[0] = (IceTUByte)(255*color[0]);
+            out[1] = (IceTUByte)(255*color[1]);
+            out[2] = (IceTUByte)(255*color[2]);
+            out[3] = (IceTUByte)(255*color[3]);
+        } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+            memcpy(icetImageGetColorf(image) + 4*pixel,
+                   color,
+                   4*sizeof(IceTFloat));
+        }
+        if (depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+            icetImageGetDepthf(image)[pixel] = depth;
+        }
+    }
+}
+
+static int TryCompositeMany(IceTInt num_images, int srcOnTop)
+{
+    IceTVoid *full_buffer;
+    IceTVoid *one_buffer;
+    IceTVoid *many_buffer;
+    IceTVoid *sparse_buffers[MAX_IMAGES];
+    IceTSparseImage sparse_images[MAX_IMAGES];
+    IceTImage full_image;
+    IceTImage one_image;
+    IceTImage many_image;
+    IceTSizeType full_size;
+    IceTSizeType sparse_size;
+    IceTSizeType num_bytes;
+    IceTInt image_index;
+    int result = TEST_PASSED;
+
+    full_size = icetImageBufferSize(IMAGE_WIDTH, IMAGE_HEIGHT);
+    sparse_size = icetSparseImageBufferSize(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    full_buffer = malloc(full_size);
+    full_image = icetImageAssignBuffer(full_buffer, IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    for (image_index = 0; image_index < num_images; image_index++) {
+        sparse_buffers[image_index] = malloc(sparse_size);
+        sparse_images[image_index]
+            = icetSparseImageAssignBuffer(sparse_buffers[image_index],
+                                          IMAGE_WIDTH,
+                                          IMAGE_HEIGHT);
+        RandomImage(full_image);
+        icetCompressImage(full_image, sparse_images[image_index]);
+    }
+
+    /* Both images start from the same random data. */
+    RandomImage(full_image);
+    one_buffer = malloc(full_size);
+    one_image = icetImageAssignBuffer(one_buffer, IMAGE_WIDTH, IMAGE_HEIGHT);
+    icetImageCopyPixels(full_image, 0, one_image, 0, IMAGE_WIDTH*IMAGE_HEIGHT);
+    many_buffer = malloc(full_size);
+    many_image = icetImageAssignBuffer(many_buffer, IMAGE_WIDTH, IMAGE_HEIGHT);
+    icetImageCopyPixels(full_image, 0, many_image, 0, IMAGE_WIDTH*IMAGE_HEIGHT);
+
+    for (image_index = 0; image_index < num_images; image_index++) {
+        icetCompressedComposite(one_image,
+                                sparse_images[image_index],
+                                srcOnTop);
+    }
+    icetCompressedCompositeMany(many_image,
+                                sparse_images,
+                                num_images,
+                                srcOnTop);
+
+    if (icetImageGetColorFormat(one_image) != ICET_IMAGE_COLOR_NONE) {
+        IceTSizeType pixel_size;
+        icetImageGetColorConstVoid(one_image, &pixel_size);
+        num_bytes = pixel_size*IMAGE_WIDTH*IMAGE_HEIGHT;
+        if (memcmp(icetImageGetColorConstVoid(one_image, NULL),
+                   icetImageGetColorConstVoid(many_image, NULL),
+                   num_bytes) != 0) {
+            printstat("*** Colors differ with %d images ***\n",
+                      (int)num_images);
+            result = TEST_FAILED;
+        }
+    }
+    if (icetImageGetDepthFormat(one_image) != ICET_IMAGE_DEPTH_NONE) {
+        IceTSizeType pixel_size;
+        icetImageGetDepthConstVoid(one_image, &pixel_size);
+        num_bytes = pixel_size*IMAGE_WIDTH*IMAGE_HEIGHT;
+        if (memcmp(icetImageGetDepthConstVoid(one_image, NULL),
+                   icetImageGetDepthConstVoid(many_image, NULL),
+                   num_bytes) != 0) {
+            printstat("*** Depths differ with %d images ***\n",
+                      (int)num_images);
+            result = TEST_FAILED;
+        }
+    }
+
+    for (image_index = 0; image_index < num_images; image_index++) {
+        free(sparse_buffers[image_index]);
+    }
+    free(full_buffer);
+    free(one_buffer);
+    free(many_buffer);
+
+    return result;
+}
+
+static int TryImageCounts(void)
+{
+    static const IceTInt image_counts[] = { 1, 2, 5, MAX_IMAGES };
+    IceTInt count_index;
+    int result = TEST_PASSED;
+
+    for (count_index = 0; count_index < 4; count_index++) {
+        IceTInt num_images = image_counts[count_index];
+        printstat("    %d images\n", (int)num_images);
+        if (TryCompositeMany(num_images, 1) != TEST_PASSED) {
+            result = TEST_FAILED;
+        }
+        if (TryCompositeMany(num_images, 0) != TEST_PASSED) {
+            result = TEST_FAILED;
+        }
+    }
+
+    return result;
+}
+
+static int CompositeManyRun(void)
+{
+    int result = TEST_PASSED;
+    unsigned int seed = (unsigned int)time(NULL);
+
+    printstat("Seed = %u\n", seed);
+    srand(seed);
+
+    /* Compression checks the background normally set up when a frame
+       starts. */
+    {
+        static const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        icetStateSetFloatv(ICET_TRUE_BACKGROUND_COLOR, 4, black);
+        icetStateSetInteger(ICET_TRUE_BACKGROUND_COLOR_WORD, 0);
+    }
+
+    printstat("\nZ buffer with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nZ buffer with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nZ buffer with depth only\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_NONE);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nBlending with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nBlending with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nMaximum with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_MAX);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nMinimum with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_MIN);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nAdding with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_ADD);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    printstat("\nAdding with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    if (TryImageCounts() != TEST_PASSED) { result = TEST_FAILED; }
+
+    return result;
+}
+
+int CompositeMany(int argc, char *argv[])
+{
+    /* To remove warning */
+    (void)argc;
+    (void)argv;
+
+    return run_test(CompositeManyRun);
+}
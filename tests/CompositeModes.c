@@ -0,0 +1,311 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the maximum, minimum, and add composite modes.  Each process renders
+** a known pattern, and the image composited with each strategy must match
+** the same reduction computed serially, with the background color applied.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const IceTFloat g_background_color[4] = { 0.25f, 0.5f, 0.0f, 0.75f };
+
+/* Float colors are not limited to 1, so the float background has a
+   component above all rendered values to make sure the minimum does not
+   clamp them. */
+static const IceTFloat g_float_background_color[4]
+    = { 0.25f, 0.5f, 0.0f, 8.0f };
+
+static const IceTFloat *g_frame_background_color;
+
+static IceTEnum g_composite_mode;
+
+/* Returns whether process rank renders something at pixel (x,y) of a tile.
+   Tiles are no bigger than the physical render size, so each is rendered on
+   its own with the tile in the corner of the image. */
+static IceTBoolean PixelActive(IceTInt rank, IceTSizeType x, IceTSizeType y)
+{
+    return (IceTBoolean)(((x/3)*7 + (y/5)*13 + rank*29)%3 != 0);
+}
+
+/* Returns component c rendered by process rank at pixel (x,y) as an 8-bit
+   value.  Float colors are this value over 64, which goes above 1 and still
+   adds exactly in any order. */
+static IceTUByte PixelComponent(IceTInt rank,
+                                IceTSizeType x,
+                                IceTSizeType y,
+                                int c)
+{
+    return (IceTUByte)((rank*37 + x*5 + y*3 + c*11)%256);
+}
+
+static IceTUByte IdentityUByte(void)
+{
+    return (g_composite_mode == ICET_COMPOSITE_MODE_MIN) ? 255 : 0;
+}
+
+static IceTFloat IdentityFloat(void)
+{
+    return (g_composite_mode == ICET_COMPOSITE_MODE_MIN) ? FLT_MAX : 0.0f;
+}
+
+static IceTUByte ReduceUByte(IceTUByte a, IceTUByte b)
+{
+    switch (g_composite_mode) {
+      case ICET_COMPOSITE_MODE_MAX: return (a > b) ? a : b;
+      case ICET_COMPOSITE_MODE_MIN: return (a < b) ? a : b;
+      default:
+          return (IceTUByte)(((IceTUInt)a + b > 255) ? 255 : a + b);
+    }
+}
+
+static IceTFloat ReduceFloat(IceTFloat a, IceTFloat b)
+{
+    switch (g_composite_mode) {
+      case ICET_COMPOSITE_MODE_MAX: return (a > b) ? a : b;
+      case ICET_COMPOSITE_MODE_MIN: return (a < b) ? a : b;
+      default:                      return a + b;
+    }
+}
+
+static void CompositeModesDraw(const IceTDouble *projection_matrix,
+                               const IceTDouble *modelview_matrix,
+                               const IceTFloat *background_color,
+                               const IceTInt *readback_viewport,
+                               IceTImage result)
+{
+    IceTInt rank;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+    int c;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)readback_viewport;
+
+    for (c = 0; c < 4; c++) {
+        if (background_color[c] != IdentityFloat()) {
+            printrank("**** Draw background is not the identity ****\n");
+            break;
+        }
+    }
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+
+    /* Inactive pixels are cleared to the background color given, which is
+       the identity of the reduction. */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTBoolean active = PixelActive(rank, x, y);
+            for (c = 0; c < 4; c++) {
+                if (   icetImageGetColorFormat(result)
+                    == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                    icetImageGetColorub(result)[4*pixel + c]
+                        = active ? PixelComponent(rank, x, y, c)
+                                 : (IceTUByte)(255*background_color[c]);
+                } else {
+                    icetImageGetColorf(result)[4*pixel + c]
+                        = active ? (IceTFloat)PixelComponent(rank, x, y, c)
+                                       /64.0f
+                                 : background_color[c];
+                }
+            }
+        }
+    }
+}
+
+static int CompositeModesCheckImage(const IceTImage image)
+{
+    IceTInt num_proc;
+    IceTEnum color_format;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    color_format = icetImageGetColorFormat(image);
+    width = icetImageGetWidth(image);
+    height = icetImageGetHeight(image);
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            int c;
+            for (c = 0; c < 4; c++) {
+                IceTInt proc;
+                if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                    IceTUByte expected = IdentityUByte();
+                    IceTUByte actual = icetImageGetColorcub(image)[4*pixel+c];
+                    for (proc = 0; proc < num_proc; proc++) {
+                        if (PixelActive(proc, x, y)) {
+                            expected
+                                = ReduceUByte(PixelComponent(proc, x, y, c),
+                                              expected);
+                        }
+                    }
+                    expected = ReduceUByte(
+                                 (IceTUByte)(255*g_frame_background_color[c]),
+                                 expected);
+                    if (actual != expected) {
+                        printrank("**** Bad color at %d,%d ****\n",
+                                  (int)x, (int)y);
+                        printrank("Component %d is %d, expected %d\n",
+                                  c, (int)actual, (int)expected);
+                        return TEST_FAILED;
+                    }
+                } else {
+                    IceTFloat expected = IdentityFloat();
+                    IceTFloat actual = icetImageGetColorcf(image)[4*pixel+c];
+                    for (proc = 0; proc < num_proc; proc++) {
+                        if (PixelActive(proc, x, y)) {
+                            expected = ReduceFloat(
+                                (IceTFloat)PixelComponent(proc, x, y, c)
+                                    /64.0f,
+                                expected);
+                        }
+                    }
+                    expected = ReduceFloat(g_frame_background_color[c],
+                                           expected);
+                    if (actual != expected) {
+                        printrank("**** Bad color at %d,%d ****\n",
+                                  (int)x, (int)y);
+                        printrank("Component %d is %g, expected %g\n",
+                                  c, actual, expected);
+                        return TEST_FAILED;
+                    }
+                }
+            }
+        }
+    }
+
+    return TEST_PASSED;
+}
+
+static int CompositeModesTryFrame(void)
+{
+    IceTDouble identity[16];
+    IceTImage image;
+    IceTInt tile_displayed;
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    image = icetDrawFrame(identity, identity, g_frame_background_color);
+
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+    if (tile_displayed < 0) {
+        return TEST_PASSED;
+    }
+
+    return CompositeModesCheckImage(image);
+}
+
+static int CompositeModesTryStrategies(void)
+{
+    int strategy_index;
+    int result = TEST_PASSED;
+
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        IceTEnum strategy = strategy_list[strategy_index];
+        int single_image_strategy_index;
+        int num_single_image_strategy;
+
+        icetStrategy(strategy);
+        if (strategy_uses_single_image_strategy(strategy)) {
+            num_single_image_strategy = SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+        } else {
+            num_single_image_strategy = 1;
+        }
+
+        for (single_image_strategy_index = 0;
+             single_image_strategy_index < num_single_image_strategy;
+             single_image_strategy_index++) {
+            icetSingleImageStrategy(
+                single_image_strategy_list[single_image_strategy_index]);
+            printstat("  Trying strategy %s, single image strategy %s\n",
+                      icetGetStrategyName(),
+                      icetGetSingleImageStrategyName());
+            if (CompositeModesTryFrame() != TEST_PASSED) {
+                result = TEST_FAILED;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int CompositeModesRun(void)
+{
+    static const IceTEnum modes[3] = {
+        ICET_COMPOSITE_MODE_MAX,
+        ICET_COMPOSITE_MODE_MIN,
+        ICET_COMPOSITE_MODE_ADD
+    };
+    static const char *mode_names[3] = { "Maximum", "Minimum", "Add" };
+    IceTInt num_proc;
+    int mode_index;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    icetDrawCallback(CompositeModesDraw);
+
+    /* Use two tiles when possible so that multi-tile collection is used. */
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT, 0);
+    if (num_proc > 1) {
+        icetAddTile(SCREEN_WIDTH/2, 0, SCREEN_WIDTH/2, SCREEN_HEIGHT, 1);
+    }
+
+    for (mode_index = 0; mode_index < 3; mode_index++) {
+        g_composite_mode = modes[mode_index];
+        icetCompositeMode(g_composite_mode);
+
+        printstat("\n%s with 8-bit colors\n", mode_names[mode_index]);
+        icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+        g_frame_background_color = g_background_color;
+        if (CompositeModesTryStrategies() != TEST_PASSED) {
+            result = TEST_FAILED;
+        }
+
+        printstat("\n%s with float colors\n", mode_names[mode_index]);
+        icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+        g_frame_background_color = g_float_background_color;
+        if (CompositeModesTryStrategies() != TEST_PASSED) {
+            result = TEST_FAILED;
+        }
+    }
+
+    return result;
+}
+
+int CompositeModes(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(CompositeModesRun);
+}
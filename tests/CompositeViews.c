@@ -0,0 +1,298 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests compositing several views in one call with icetCompositeImages and
+** icetDrawFrames.  Each view covers a different set of tiles, and the image
+** of every view must match the image composited for that view alone with
+** icetCompositeImage or icetDrawFrame.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 48
+#define MAX_TILES 4
+
+#define NUM_VIEWS 3
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+static IceTVoid *g_colors[NUM_VIEWS];
+static IceTFloat *g_depths[NUM_VIEWS];
+static IceTInt g_valid_viewports[4*NUM_VIEWS];
+
+/* The view drawn by icetDrawFrame, which does not set ICET_VIEW_INDEX. */
+static IceTInt g_draw_view;
+
+/* Makes an image whose active pixels cover a random range of tiles. */
+static void MakeImage(IceTInt view, IceTInt num_tiles)
+{
+    IceTInt *viewport = g_valid_viewports + 4*view;
+    IceTInt first_tile, last_tile;
+
+    first_tile = rand()%num_tiles;
+    last_tile = first_tile + rand()%(num_tiles - first_tile);
+    viewport[0] = first_tile*TILE_WIDTH + rand()%(TILE_WIDTH/2);
+    viewport[1] = rand()%(TILE_HEIGHT/2);
+    viewport[2] = (last_tile+1)*TILE_WIDTH - rand()%(TILE_WIDTH/2)
+                  - viewport[0];
+    viewport[3] = TILE_HEIGHT - rand()%(TILE_HEIGHT/2) - viewport[1];
+
+    make_test_image(num_tiles*TILE_WIDTH,
+                    TILE_HEIGHT,
+                    viewport,
+                    g_background_color,
+                    &g_colors[view],
+                    &g_depths[view]);
+}
+
+static IceTBoolean TryViews(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTByte *references[NUM_VIEWS];
+    IceTSizeType reference_bytes[NUM_VIEWS];
+    IceTImage images[NUM_VIEWS];
+    IceTInt tile_displayed;
+    IceTInt view;
+
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        references[view] = composite_and_copy(g_colors[view],
+                                              g_depths[view],
+                                              g_valid_viewports + 4*view,
+                                              g_background_color,
+                                              &reference_bytes[view]);
+    }
+
+    icetCompositeImages(NUM_VIEWS,
+                        (const IceTVoid *const *)g_colors,
+                        (const IceTVoid *const *)g_depths,
+                        g_valid_viewports,
+                        NULL,
+                        NULL,
+                        g_background_color,
+                        images);
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        if (tile_displayed < 0) {
+            if (!icetImageIsNull(images[view])) {
+                printrank("***** Got an image for view %d on a process"
+                          " with no tile *****\n", view);
+                success = ICET_FALSE;
+            }
+        } else {
+            IceTSizeType num_bytes;
+            IceTByte *result = copy_test_image(images[view], &num_bytes);
+            if (   (result == NULL)
+                || (num_bytes != reference_bytes[view])
+                || (memcmp(references[view], result, num_bytes) != 0) ) {
+                printrank("***** View %d differs *****\n", view);
+                success = ICET_FALSE;
+            }
+            free(result);
+        }
+        free(references[view]);
+    }
+
+    return success;
+}
+
+/* Draws a pattern that depends on the process and the view.  Tiles are no
+   bigger than the physical render size and floating viewports are off, so
+   each tile is drawn on its own with the tile in the corner of the image. */
+static void CompositeViewsDraw(const IceTDouble *projection_matrix,
+                               const IceTDouble *modelview_matrix,
+                               const IceTFloat *background_color,
+                               const IceTInt *readback_viewport,
+                               IceTImage result)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt view;
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_VIEW_INDEX, &view);
+    if (view < 0) { view = g_draw_view; }
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTUByte *color = color_buffer + 4*pixel;
+            IceTInt hash = (IceTInt)(x/3*7 + y/5*13 + rank*29 + view*31);
+            if (hash%4 == 0) {
+                depth_buffer[pixel] = 1.0f;
+                color[0] = color[1] = color[2] = color[3] = 0;
+            } else {
+                /* Depths differ between processes so that the winner does
+                   not depend on how ties are broken. */
+                depth_buffer[pixel]
+                    = (IceTFloat)((hash%251)*num_proc + rank)
+                      /(251.0f*num_proc);
+                color[0] = (IceTUByte)(40*rank);
+                color[1] = (IceTUByte)(80*view);
+                color[2] = (IceTUByte)(x + y);
+                color[3] = 255;
+            }
+        }
+    }
+}
+
+static IceTBoolean TryDrawFrames(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTByte *references[NUM_VIEWS];
+    IceTSizeType reference_bytes[NUM_VIEWS];
+    IceTImage images[NUM_VIEWS];
+    IceTInt tile_displayed;
+    IceTInt view;
+
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        IceTImage image;
+        g_draw_view = view;
+        image = icetDrawFrame(NULL, NULL, g_background_color);
+        references[view] = NULL;
+        if (tile_displayed >= 0) {
+            references[view] = copy_test_image(image, &reference_bytes[view]);
+        }
+    }
+
+    icetDrawFrames(NUM_VIEWS, NULL, NULL, g_background_color, images);
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        if (tile_displayed < 0) {
+            if (!icetImageIsNull(images[view])) {
+                printrank("***** Got a drawn image for view %d on a process"
+                          " with no tile *****\n", view);
+                success = ICET_FALSE;
+            }
+        } else {
+            IceTSizeType num_bytes;
+            IceTByte *result = copy_test_image(images[view], &num_bytes);
+            if (   (result == NULL)
+                || (num_bytes != reference_bytes[view])
+                || (memcmp(references[view], result, num_bytes) != 0) ) {
+                printrank("***** Drawn view %d differs *****\n", view);
+                success = ICET_FALSE;
+            }
+            free(result);
+        }
+        free(references[view]);
+    }
+
+    return success;
+}
+
+static int CompositeViewsRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt num_tiles;
+    IceTInt tile;
+    IceTInt view;
+    IceTInt strategy_index;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+
+    num_tiles = (num_proc < MAX_TILES) ? num_proc : MAX_TILES;
+    printstat("Using %dx1 tiles\n", num_tiles);
+    icetResetTiles();
+    for (tile = 0; tile < num_tiles; tile++) {
+        icetAddTile(tile*TILE_WIDTH, 0, TILE_WIDTH, TILE_HEIGHT, tile);
+    }
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        MakeImage(view, num_tiles);
+    }
+
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        icetStrategy(strategy_list[strategy_index]);
+        printstat("  Using %s strategy\n", icetGetStrategyName());
+        if (!TryViews()) { success = ICET_FALSE; }
+    }
+
+    printstat("Drawing views with the draw callback\n");
+    icetDrawCallback(CompositeViewsDraw);
+    icetDisable(ICET_FLOATING_VIEWPORT);
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        icetStrategy(strategy_list[strategy_index]);
+        printstat("  Using %s strategy\n", icetGetStrategyName());
+        if (!TryDrawFrames()) { success = ICET_FALSE; }
+    }
+
+    for (view = 0; view < NUM_VIEWS; view++) {
+        free(g_colors[view]);
+        free(g_depths[view]);
+    }
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int CompositeViews(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(CompositeViewsRun);
+}
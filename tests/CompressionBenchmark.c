@@ -0,0 +1,811 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test is a benchmark of the image compression functions.  It loads a
+** corpus of rendered images (or makes synthetic ones) and, for every image
+** format, measures the throughput of compressing, decompressing, compositing
+** two compressed images, splitting and interlacing along with the
+** compression ratio.  Results are written as CSV or JSON records so that
+** changes to the image code can be compared against a baseline.
+*****************************************************************************/
+
+#include <IceTDevImage.h>
+#include <IceTDevPorting.h>
+#include <IceTDevState.h>
+#include "test_util.h"
+#include "test_codes.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define COMPRESSION_NUM_OPERATIONS      5
+#define COMPRESSION_COMPRESS            0
+#define COMPRESSION_DECOMPRESS          1
+#define COMPRESSION_COMPOSITE           2
+#define COMPRESSION_SPLIT               3
+#define COMPRESSION_INTERLACE           4
+
+#define COMPRESSION_NUM_FORMATS         5
+
+static const IceTEnum g_color_formats[COMPRESSION_NUM_FORMATS] = {
+    ICET_IMAGE_COLOR_RGBA_UBYTE,
+    ICET_IMAGE_COLOR_RGBA_FLOAT,
+    ICET_IMAGE_COLOR_NONE,
+    ICET_IMAGE_COLOR_RGBA_UBYTE,
+    ICET_IMAGE_COLOR_RGBA_FLOAT
+};
+static const IceTEnum g_depth_formats[COMPRESSION_NUM_FORMATS] = {
+    ICET_IMAGE_DEPTH_FLOAT,
+    ICET_IMAGE_DEPTH_FLOAT,
+    ICET_IMAGE_DEPTH_FLOAT,
+    ICET_IMAGE_DEPTH_NONE,
+    ICET_IMAGE_DEPTH_NONE
+};
+
+#define NUM_SYNTHETIC_IMAGES 4
+static const IceTFloat g_synthetic_fractions[NUM_SYNTHETIC_IMAGES] = {
+    0.05f, 0.25f, 0.5f, 0.95f
+};
+
+/* An image of the corpus in a common format: RGBA colors and depths, both
+   stored bottom row first like IceT images.  Pixels that were not rendered
+   are zero with a depth of 1. */
+typedef struct {
+    char name[FILENAME_MAX];
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTUByte *colors;
+    IceTFloat *depths;
+} CorpusImage;
+
+static IceTSizeType g_width;
+static IceTSizeType g_height;
+static IceTInt g_seed;
+static IceTInt g_num_partitions;
+static IceTDouble g_min_time;
+static IceTBoolean g_json;
+static const char *g_output_filename;
+static char **g_filenames;
+static int g_num_filenames;
+
+static FILE *g_output;
+
+static void usage(char *argv[])
+{
+    printstat("\nUSAGE: %s [testargs] [image.ppm ...]\n", argv[0]);
+    printstat("\nWhere  testargs are:\n");
+    printstat("  -width <num>  Width of synthetic images (default 256).\n");
+    printstat("  -height <num> Height of synthetic images (default 256).\n");
+    printstat("  -seed <num>   Use the given number as the random seed.\n");
+    printstat("  -partitions <num> Number of pieces to split and interlace for\n"
+              "                (default 8).\n");
+    printstat("  -min-time <seconds> Repeat each operation for at least this long\n"
+              "                (default 0.02).\n");
+    printstat("  -json         Write records as JSON objects rather than CSV.\n");
+    printstat("  -o <file>     Write records to the given file rather than the\n"
+              "                standard output.\n");
+    printstat("  -h, -help     Print this help message.\n");
+    printstat("\nEach image is a binary PPM (P6) file of colors.  If a PFM (Pf) file\n"
+              "of depths with the same name but a .pfm extension exists, it is\n"
+              "used to find the rendered pixels.  Otherwise black pixels are\n"
+              "background.  Use a shell wildcard to benchmark a directory.\n"
+              "Without images, synthetic images of several active fractions are\n"
+              "used.  Throughput is bytes of uncompressed image per second.\n");
+    printstat("\nFor general testing options, try -h or -help before test name.\n");
+}
+
+static void parse_arguments(int argc, char *argv[])
+{
+    int arg;
+
+    g_width = 256;
+    g_height = 256;
+    g_seed = (IceTInt)time(NULL);
+    g_num_partitions = 8;
+    g_min_time = 0.02;
+    g_json = ICET_FALSE;
+    g_output_filename = NULL;
+    g_filenames = malloc(argc*sizeof(char *));
+    g_num_filenames = 0;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-width") == 0) {
+            arg++;
+            g_width = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-height") == 0) {
+            arg++;
+            g_height = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-seed") == 0) {
+            arg++;
+            g_seed = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-partitions") == 0) {
+            arg++;
+            g_num_partitions = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-min-time") == 0) {
+            arg++;
+            g_min_time = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-json") == 0) {
+            g_json = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-o") == 0) {
+            arg++;
+            g_output_filename = argv[arg];
+        } else if (   (strcmp(argv[arg], "-h") == 0)
+                   || (strcmp(argv[arg], "-help") == 0) ) {
+            usage(argv);
+            exit(0);
+        } else if (argv[arg][0] != '-') {
+            g_filenames[g_num_filenames++] = argv[arg];
+        } else {
+            printstat("Unknown option `%s'.\n", argv[arg]);
+            usage(argv);
+            exit(1);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Loading the corpus.                                                      */
+/* ------------------------------------------------------------------------ */
+
+/* Reads the next number of a PPM or PFM header, skipping comments. */
+static int read_header_number(FILE *fd, double *value)
+{
+    int c;
+
+    c = fgetc(fd);
+    while ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')
+           || (c == '#')) {
+        if (c == '#') {
+            while ((c != '\n') && (c != EOF)) { c = fgetc(fd); }
+        }
+        c = fgetc(fd);
+    }
+    if (c == EOF) { return 0; }
+    ungetc(c, fd);
+    if (fscanf(fd, "%lf", value) != 1) { return 0; }
+    /* Exactly one whitespace character separates the header from data. */
+    fgetc(fd);
+    return 1;
+}
+
+static IceTBoolean load_ppm(const char *filename, CorpusImage *image)
+{
+    FILE *fd;
+    char magic[3];
+    double width, height, maxval;
+    IceTUByte *row;
+    IceTSizeType x, y;
+
+    fd = fopen(filename, "rb");
+    if (fd == NULL) {
+        printstat("Could not open %s\n", filename);
+        return ICET_FALSE;
+    }
+
+    if (   (fread(magic, 1, 2, fd) != 2)
+        || (magic[0] != 'P') || (magic[1] != '6')
+        || !read_header_number(fd, &width)
+        || !read_header_number(fd, &height)
+        || !read_header_number(fd, &maxval)
+        || (maxval != 255) ) {
+        printstat("%s is not an 8-bit binary PPM file.\n", filename);
+        fclose(fd);
+        return ICET_FALSE;
+    }
+
+    image->width = (IceTSizeType)width;
+    image->height = (IceTSizeType)height;
+    image->colors = malloc(4*image->width*image->height);
+    row = malloc(3*image->width);
+
+    /* PPM files store the top row first. */
+    for (y = image->height - 1; y >= 0; y--) {
+        IceTUByte *color = image->colors + 4*y*image->width;
+        if (fread(row, 3, image->width, fd) != (size_t)image->width) {
+            printstat("%s is truncated.\n", filename);
+            free(row);
+            free(image->colors);
+            fclose(fd);
+            return ICET_FALSE;
+        }
+        for (x = 0; x < image->width; x++) {
+            color[4*x + 0] = row[3*x + 0];
+            color[4*x + 1] = row[3*x + 1];
+            color[4*x + 2] = row[3*x + 2];
+            color[4*x + 3] = 255;
+        }
+    }
+
+    free(row);
+    fclose(fd);
+    return ICET_TRUE;
+}
+
+/* Loads the depths of an image from a grayscale PFM file if one exists. */
+static IceTBoolean load_pfm(const char *filename, CorpusImage *image)
+{
+    FILE *fd;
+    char magic[3];
+    double width, height, scale;
+    IceTSizeType num_pixels;
+    IceTBoolean file_little_endian;
+    IceTBoolean host_little_endian;
+    union { IceTInt i; IceTUByte b[4]; } endian_test;
+    IceTSizeType pixel;
+
+    fd = fopen(filename, "rb");
+    if (fd == NULL) { return ICET_FALSE; }
+
+    if (   (fread(magic, 1, 2, fd) != 2)
+        || (magic[0] != 'P') || (magic[1] != 'f')
+        || !read_header_number(fd, &width)
+        || !read_header_number(fd, &height)
+        || !read_header_number(fd, &scale)
+        || ((IceTSizeType)width != image->width)
+        || ((IceTSizeType)height != image->height) ) {
+        printstat("%s is not a grayscale PFM file matching its image.\n",
+                  filename);
+        fclose(fd);
+        return ICET_FALSE;
+    }
+
+    num_pixels = image->width*image->height;
+    image->depths = malloc(num_pixels*sizeof(IceTFloat));
+    if (fread(image->depths, sizeof(IceTFloat), num_pixels, fd)
+        != (size_t)num_pixels) {
+        printstat("%s is truncated.\n", filename);
+        free(image->depths);
+        image->depths = NULL;
+        fclose(fd);
+        return ICET_FALSE;
+    }
+    fclose(fd);
+
+    /* A negative scale marks little endian data.  PFM files already store
+       the bottom row first. */
+    endian_test.i = 1;
+    host_little_endian = (endian_test.b[0] == 1);
+    file_little_endian = (scale < 0);
+    if (host_little_endian != file_little_endian) {
+        for (pixel = 0; pixel < num_pixels; pixel++) {
+            IceTUByte *bytes = (IceTUByte *)(image->depths + pixel);
+            IceTUByte swap;
+            swap = bytes[0]; bytes[0] = bytes[3]; bytes[3] = swap;
+            swap = bytes[1]; bytes[1] = bytes[2]; bytes[2] = swap;
+        }
+    }
+
+    return ICET_TRUE;
+}
+
+/* Makes pixels that were not rendered zero with a depth of 1 so that every
+   format agrees on which pixels are active. */
+static void mark_background(CorpusImage *image)
+{
+    IceTSizeType num_pixels = image->width*image->height;
+    IceTSizeType pixel;
+
+    if (image->depths == NULL) {
+        image->depths = malloc(num_pixels*sizeof(IceTFloat));
+        for (pixel = 0; pixel < num_pixels; pixel++) {
+            const IceTUByte *color = image->colors + 4*pixel;
+            if ((color[0] == 0) && (color[1] == 0) && (color[2] == 0)) {
+                image->depths[pixel] = 1.0f;
+            } else {
+                image->depths[pixel] = 0.5f;
+            }
+        }
+    }
+
+    for (pixel = 0; pixel < num_pixels; pixel++) {
+        if (!(image->depths[pixel] < 1.0f)) {
+            image->depths[pixel] = 1.0f;
+            memset(image->colors + 4*pixel, 0, 4);
+        }
+    }
+}
+
+static IceTBoolean load_corpus_image(const char *filename, CorpusImage *image)
+{
+    char depth_filename[FILENAME_MAX];
+    const char *name;
+    char *extension;
+
+    name = strrchr(filename, '/');
+    name = (name != NULL) ? name + 1 : filename;
+    strncpy(image->name, name, FILENAME_MAX-1);
+    image->name[FILENAME_MAX-1] = '\0';
+    image->depths = NULL;
+
+    if (!load_ppm(filename, image)) { return ICET_FALSE; }
+
+    strncpy(depth_filename, filename, FILENAME_MAX-5);
+    depth_filename[FILENAME_MAX-5] = '\0';
+    extension = strrchr(depth_filename, '.');
+    if ((extension != NULL) && (strchr(extension, '/') == NULL)) {
+        *extension = '\0';
+    }
+    strcat(depth_filename, ".pfm");
+    load_pfm(depth_filename, image);
+
+    mark_background(image);
+    return ICET_TRUE;
+}
+
+/* A simple linear congruential generator so that every platform produces the
+   same images for the same seed. */
+static IceTUInt g_random_state;
+
+static IceTFloat benchmark_random(void)
+{
+    g_random_state = g_random_state*1103515245u + 12345u;
+    return (IceTFloat)((g_random_state >> 8) & 0xFFFFFF)/(IceTFloat)0x1000000;
+}
+
+/* Returns the depth of a pixel covered by disks of the given radius. */
+static IceTFloat synthetic_depth(const IceTFloat *centers,
+                                 IceTInt num_clusters,
+                                 IceTFloat radius,
+                                 IceTSizeType x,
+                                 IceTSizeType y)
+{
+    IceTFloat depth = 1.0f;
+    IceTInt cluster;
+
+    for (cluster = 0; cluster < num_clusters; cluster++) {
+        IceTFloat dx = (x - centers[2*cluster + 0])/radius;
+        IceTFloat dy = (y - centers[2*cluster + 1])/radius;
+        IceTFloat r2 = dx*dx + dy*dy;
+        if (r2 < 1.0f) {
+            IceTFloat d = 0.2f*cluster + 0.1f*r2;
+            if (d < depth) { depth = d; }
+        }
+    }
+
+    return depth;
+}
+
+/* Makes an image whose active pixels are gathered into a few shaded disks,
+   which compresses much like a rendering of a few objects.  The radius of
+   the disks is searched for so that overlapping and clipped disks still
+   cover the requested fraction of the image. */
+static void make_synthetic_image(IceTFloat active_fraction,
+                                 CorpusImage *image)
+{
+#define NUM_CLUSTERS 4
+    IceTFloat centers[2*NUM_CLUSTERS];
+    IceTFloat low_radius, high_radius, radius;
+    IceTInt cluster;
+    IceTInt iteration;
+    IceTSizeType x, y;
+
+    sprintf(image->name, "synthetic-%g", active_fraction);
+    image->width = g_width;
+    image->height = g_height;
+    image->colors = malloc(4*g_width*g_height);
+    image->depths = malloc(g_width*g_height*sizeof(IceTFloat));
+
+    for (cluster = 0; cluster < NUM_CLUSTERS; cluster++) {
+        centers[2*cluster + 0] = benchmark_random()*g_width;
+        centers[2*cluster + 1] = benchmark_random()*g_height;
+    }
+
+    low_radius = 0.0f;
+    high_radius = 2.0f*(g_width + g_height);
+    radius = high_radius;
+    for (iteration = 0; iteration < 16; iteration++) {
+        IceTSizeType num_active = 0;
+        radius = 0.5f*(low_radius + high_radius);
+        for (y = 0; y < g_height; y++) {
+            for (x = 0; x < g_width; x++) {
+                if (synthetic_depth(centers, NUM_CLUSTERS, radius, x, y)
+                    < 1.0f) {
+                    num_active++;
+                }
+            }
+        }
+        if (num_active < active_fraction*g_width*g_height) {
+            low_radius = radius;
+        } else {
+            high_radius = radius;
+        }
+    }
+
+    for (y = 0; y < g_height; y++) {
+        for (x = 0; x < g_width; x++) {
+            IceTSizeType pixel = y*g_width + x;
+            IceTUByte *color = image->colors + 4*pixel;
+            IceTFloat depth
+                = synthetic_depth(centers, NUM_CLUSTERS, radius, x, y);
+            image->depths[pixel] = depth;
+            color[0] = (IceTUByte)(255*(1.0f - depth));
+            color[1] = (IceTUByte)(255*x/g_width);
+            color[2] = (IceTUByte)(255*y/g_height);
+            color[3] = 255;
+        }
+    }
+
+    mark_background(image);
+#undef NUM_CLUSTERS
+}
+
+/* ------------------------------------------------------------------------ */
+/* Measuring.                                                               */
+/* ------------------------------------------------------------------------ */
+
+/* Fills an IceT image of the current format from a corpus image.  When
+   shift is nonzero, every row is rotated by that many pixels to make a
+   second image with a different layout of active pixels. */
+static void fill_image(const CorpusImage *corpus,
+                       IceTSizeType shift,
+                       IceTImage image)
+{
+    IceTEnum color_format = icetImageGetColorFormat(image);
+    IceTEnum depth_format = icetImageGetDepthFormat(image);
+    IceTSizeType x, y;
+
+    for (y = 0; y < corpus->height; y++) {
+        for (x = 0; x < corpus->width; x++) {
+            IceTSizeType src = y*corpus->width + x;
+            IceTSizeType dest
+                = y*corpus->width + (x + shift)%corpus->width;
+            const IceTUByte *color = corpus->colors + 4*src;
+            if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                memcpy(icetImageGetColorub(image) + 4*dest, color, 4);
+            } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+                IceTFloat *out = icetImageGetColorf(image) + 4*dest;
+                out[0] = color[0]/255.0f;
+                out[1] = color[1]/255.0f;
+                out[2] = color[2]/255.0f;
+                out[3] = color[3]/255.0f;
+            }
+            if (depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+                icetImageGetDepthf(image)[dest] = corpus->depths[src];
+            }
+        }
+    }
+}
+
+static IceTSizeType uncompressed_size(IceTSizeType num_pixels,
+                                      IceTEnum color_format,
+                                      IceTEnum depth_format)
+{
+    IceTSizeType pixel_size = 0;
+    if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+        pixel_size += 4;
+    } else if (color_format == ICET_IMAGE_COLOR_RGBA_FLOAT) {
+        pixel_size += 4*sizeof(IceTFloat);
+    }
+    if (depth_format == ICET_IMAGE_DEPTH_FLOAT) {
+        pixel_size += sizeof(IceTFloat);
+    }
+    return num_pixels*pixel_size;
+}
+
+static const char *color_format_name(IceTEnum color_format)
+{
+    switch (color_format) {
+      case ICET_IMAGE_COLOR_RGBA_UBYTE: return "rgba_ubyte";
+      case ICET_IMAGE_COLOR_RGBA_FLOAT: return "rgba_float";
+      default:                          return "none";
+    }
+}
+
+static void print_header(void)
+{
+    if (g_json) { return; }
+
+    fprintf(g_output,
+            "image,"
+            "width,"
+            "height,"
+            "color format,"
+            "depth format,"
+            "active fraction,"
+            "compression ratio,"
+            "compress GB/s,"
+            "decompress GB/s,"
+            "composite GB/s,"
+            "split GB/s,"
+            "interlace GB/s\n");
+}
+
+static void print_record(const CorpusImage *corpus,
+                         IceTEnum color_format,
+                         IceTEnum depth_format,
+                         IceTDouble active_fraction,
+                         IceTDouble ratio,
+                         const IceTDouble *rates)
+{
+    const char *depth_name
+        = (depth_format == ICET_IMAGE_DEPTH_FLOAT) ? "float" : "none";
+
+    if (g_json) {
+        fprintf(g_output,
+                "{\"image\":\"%s\","
+                "\"width\":%d,"
+                "\"height\":%d,"
+                "\"color_format\":\"%s\","
+                "\"depth_format\":\"%s\","
+                "\"active_fraction\":%g,"
+                "\"compression_ratio\":%g,"
+                "\"compress_gbps\":%g,"
+                "\"decompress_gbps\":%g,"
+                "\"composite_gbps\":%g,"
+                "\"split_gbps\":%g,"
+                "\"interlace_gbps\":%g}\n",
+                corpus->name,
+                (int)corpus->width,
+                (int)corpus->height,
+                color_format_name(color_format),
+                depth_name,
+                active_fraction,
+                ratio,
+                rates[COMPRESSION_COMPRESS],
+                rates[COMPRESSION_DECOMPRESS],
+                rates[COMPRESSION_COMPOSITE],
+                rates[COMPRESSION_SPLIT],
+                rates[COMPRESSION_INTERLACE]);
+    } else {
+        fprintf(g_output,
+                "%s,%d,%d,%s,%s,%g,%g,%g,%g,%g,%g,%g\n",
+                corpus->name,
+                (int)corpus->width,
+                (int)corpus->height,
+                color_format_name(color_format),
+                depth_name,
+                active_fraction,
+                ratio,
+                rates[COMPRESSION_COMPRESS],
+                rates[COMPRESSION_DECOMPRESS],
+                rates[COMPRESSION_COMPOSITE],
+                rates[COMPRESSION_SPLIT],
+                rates[COMPRESSION_INTERLACE]);
+    }
+    fflush(g_output);
+}
+
+/* Runs one operation repeatedly for at least g_min_time seconds and returns
+   the rate in GB of uncompressed image per second. */
+#define MEASURE_RATE(rate, bytes, operation)                            \
+    {                                                                   \
+        IceTDouble start_time = icetWallTime();                         \
+        IceTDouble elapsed;                                             \
+        IceTInt repeat = 0;                                             \
+        do {                                                            \
+            operation;                                                  \
+            repeat++;                                                   \
+            elapsed = icetWallTime() - start_time;                      \
+        } while (elapsed < g_min_time);                                 \
+        rate = 1.0e-9*repeat*(IceTDouble)(bytes)/elapsed;               \
+    }
+
+static int benchmark_format(const CorpusImage *corpus,
+                            IceTEnum color_format,
+                            IceTEnum depth_format)
+{
+    IceTSizeType width = corpus->width;
+    IceTSizeType height = corpus->height;
+    IceTSizeType num_pixels = width*height;
+    IceTSizeType partition_pixels;
+    IceTSizeType bytes;
+    IceTVoid *image_buffer;
+    IceTVoid *shifted_buffer;
+    IceTVoid *result_buffer;
+    IceTVoid *sparse_buffer;
+    IceTVoid *shifted_sparse_buffer;
+    IceTVoid *composite_sparse_buffer;
+    IceTVoid *interlaced_sparse_buffer;
+    IceTVoid **partition_buffers;
+    IceTImage image;
+    IceTImage shifted;
+    IceTImage result;
+    IceTSparseImage sparse;
+    IceTSparseImage shifted_sparse;
+    IceTSparseImage composite_sparse;
+    IceTSparseImage interlaced_sparse;
+    IceTSparseImage *partitions;
+    IceTSizeType *offsets;
+    IceTDouble rates[COMPRESSION_NUM_OPERATIONS];
+    IceTSizeType num_active;
+    IceTSizeType pixel;
+    IceTInt partition;
+    int result_code = TEST_PASSED;
+
+    icetSetColorFormat(color_format);
+    icetSetDepthFormat(depth_format);
+    icetCompositeMode((depth_format == ICET_IMAGE_DEPTH_FLOAT)
+                      ? ICET_COMPOSITE_MODE_Z_BUFFER
+                      : ICET_COMPOSITE_MODE_BLEND);
+
+    image_buffer = malloc(icetImageBufferSize(width, height));
+    shifted_buffer = malloc(icetImageBufferSize(width, height));
+    result_buffer = malloc(icetImageBufferSize(width, height));
+    image = icetImageAssignBuffer(image_buffer, width, height);
+    shifted = icetImageAssignBuffer(shifted_buffer, width, height);
+    result = icetImageAssignBuffer(result_buffer, width, height);
+    fill_image(corpus, 0, image);
+    fill_image(corpus, width/3, shifted);
+
+    sparse_buffer = malloc(icetSparseImageBufferSize(width, height));
+    shifted_sparse_buffer = malloc(icetSparseImageBufferSize(width, height));
+    composite_sparse_buffer = malloc(icetSparseImageBufferSize(width, height));
+    interlaced_sparse_buffer
+        = malloc(icetSparseImageBufferSize(width, height));
+    sparse = icetSparseImageAssignBuffer(sparse_buffer, width, height);
+    shifted_sparse
+        = icetSparseImageAssignBuffer(shifted_sparse_buffer, width, height);
+    composite_sparse
+        = icetSparseImageAssignBuffer(composite_sparse_buffer, width, height);
+    interlaced_sparse
+        = icetSparseImageAssignBuffer(interlaced_sparse_buffer, width, height);
+
+    partition_pixels = icetSparseImageSplitPartitionNumPixels(
+                                  num_pixels, g_num_partitions,
+                                  g_num_partitions);
+    partition_buffers = malloc(g_num_partitions*sizeof(IceTVoid *));
+    partitions = malloc(g_num_partitions*sizeof(IceTSparseImage));
+    offsets = malloc(g_num_partitions*sizeof(IceTSizeType));
+    for (partition = 0; partition < g_num_partitions; partition++) {
+        partition_buffers[partition]
+            = malloc(icetSparseImageBufferSize(partition_pixels, 1));
+        partitions[partition]
+            = icetSparseImageAssignBuffer(partition_buffers[partition],
+                                          partition_pixels, 1);
+    }
+
+    icetCompressImage(shifted, shifted_sparse);
+    bytes = uncompressed_size(num_pixels, color_format, depth_format);
+
+    MEASURE_RATE(rates[COMPRESSION_COMPRESS], bytes,
+                 icetCompressImage(image, sparse));
+    MEASURE_RATE(rates[COMPRESSION_DECOMPRESS], bytes,
+                 icetDecompressImage(sparse, result));
+    MEASURE_RATE(rates[COMPRESSION_COMPOSITE], bytes,
+                 icetCompressedCompressedComposite(sparse,
+                                                   shifted_sparse,
+                                                   composite_sparse));
+    MEASURE_RATE(rates[COMPRESSION_SPLIT], bytes,
+                 icetSparseImageSplit(sparse,
+                                      0,
+                                      g_num_partitions,
+                                      g_num_partitions,
+                                      partitions,
+                                      offsets));
+    MEASURE_RATE(rates[COMPRESSION_INTERLACE], bytes,
+                 icetSparseImageInterlace(sparse,
+                                          g_num_partitions,
+                                          ICET_SI_STRATEGY_BUFFER_0,
+                                          interlaced_sparse));
+
+    /* Decompressing must give back the original image. */
+    if (   (color_format != ICET_IMAGE_COLOR_NONE)
+        && (memcmp(icetImageGetColorConstVoid(image, NULL),
+                   icetImageGetColorConstVoid(result, NULL),
+                   uncompressed_size(num_pixels, color_format,
+                                     ICET_IMAGE_DEPTH_NONE)) != 0) ) {
+        printrank("Colors of %s changed by compression.\n", corpus->name);
+        result_code = TEST_FAILED;
+    }
+    if (   (depth_format == ICET_IMAGE_DEPTH_FLOAT)
+        && (memcmp(icetImageGetDepthcf(image),
+                   icetImageGetDepthcf(result),
+                   num_pixels*sizeof(IceTFloat)) != 0) ) {
+        printrank("Depths of %s changed by compression.\n", corpus->name);
+        result_code = TEST_FAILED;
+    }
+
+    num_active = 0;
+    for (pixel = 0; pixel < num_pixels; pixel++) {
+        if (corpus->depths[pixel] < 1.0f) { num_active++; }
+    }
+
+    print_record(corpus,
+                 color_format,
+                 depth_format,
+                 (IceTDouble)num_active/num_pixels,
+                 (IceTDouble)bytes
+                 /icetSparseImageGetCompressedBufferSize(sparse),
+                 rates);
+
+    for (partition = 0; partition < g_num_partitions; partition++) {
+        free(partition_buffers[partition]);
+    }
+    free(partition_buffers);
+    free(partitions);
+    free(offsets);
+    free(image_buffer);
+    free(shifted_buffer);
+    free(result_buffer);
+    free(sparse_buffer);
+    free(shifted_sparse_buffer);
+    free(composite_sparse_buffer);
+    free(interlaced_sparse_buffer);
+
+    return result_code;
+}
+
+static int benchmark_image(const CorpusImage *corpus)
+{
+    int result = TEST_PASSED;
+    int format;
+
+    for (format = 0; format < COMPRESSION_NUM_FORMATS; format++) {
+        result += benchmark_format(corpus,
+                                   g_color_formats[format],
+                                   g_depth_formats[format]);
+    }
+
+    return result;
+}
+
+static int CompressionBenchmarkRun(void)
+{
+    IceTInt rank;
+    int result = TEST_PASSED;
+    int i;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    if (rank != 0) {
+        /* The benchmark is serial.  Other processes have nothing to do. */
+        return TEST_PASSED;
+    }
+
+    if (g_num_partitions < 1) {
+        printstat("Need at least one partition.\n");
+        return TEST_NOT_RUN;
+    }
+
+    g_output = stdout;
+    if (g_output_filename != NULL) {
+        g_output = fopen(g_output_filename, "w");
+        if (g_output == NULL) {
+            printrank("Could not open %s for writing.\n", g_output_filename);
+            g_output = stdout;
+        }
+    }
+
+    print_header();
+
+    if (g_num_filenames > 0) {
+        for (i = 0; i < g_num_filenames; i++) {
+            CorpusImage corpus;
+            if (!load_corpus_image(g_filenames[i], &corpus)) {
+                result = TEST_FAILED;
+                continue;
+            }
+            result += benchmark_image(&corpus);
+            free(corpus.colors);
+            free(corpus.depths);
+        }
+    } else {
+        g_random_state = (IceTUInt)g_seed;
+        for (i = 0; i < NUM_SYNTHETIC_IMAGES; i++) {
+            CorpusImage corpus;
+            make_synthetic_image(g_synthetic_fractions[i], &corpus);
+            result += benchmark_image(&corpus);
+            free(corpus.colors);
+            free(corpus.depths);
+        }
+    }
+
+    if (g_output != stdout) {
+        fclose(g_output);
+    }
+    free(g_filenames);
+
+    return result;
+}
+
+int CompressionBenchmark(int argc, char *argv[])
+{
+    parse_arguments(argc, argv);
+
+    return run_test(CompressionBenchmarkRun);
+}
@@ -0,0 +1,208 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests icetGetFrameStatistics.  It draws more frames than fit in the
+** statistics window and checks that the percentiles of each phase are
+** ordered and agree with the timings of the frames in the window.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevCommunication.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define FRAME_WINDOW    5
+#define NUM_FRAMES      8
+
+static void FrameStatisticsDraw(const IceTDouble *projection_matrix,
+                                const IceTDouble *modelview_matrix,
+                                const IceTFloat *background_color,
+                                const IceTInt *readback_viewport,
+                                IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType num_pixels;
+    IceTSizeType i;
+    IceTInt rank;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    num_pixels = icetImageGetNumPixels(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+    for (i = 0; i < num_pixels; i++) {
+        color_buffer[4*i + 0] = (IceTUByte)(rank & 0xFF);
+        color_buffer[4*i + 1] = 0;
+        color_buffer[4*i + 2] = 0;
+        color_buffer[4*i + 3] = 255;
+        depth_buffer[i] = ((i + rank)%3 == 0) ? 1.0f : 0.5f;
+    }
+}
+
+static int FrameStatisticsCheckOrder(const IceTDouble *statistics,
+                                     const char *summary_name)
+{
+    IceTInt num_proc;
+    IceTInt phase;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    for (phase = 0; phase < ICET_FRAME_NUM_PHASES; phase++) {
+        const IceTDouble *phase_statistics
+            = statistics + phase*ICET_FRAME_STATISTICS_SIZE;
+        if (   (phase_statistics[ICET_FRAME_STATISTIC_P50] < 0.0)
+            || (  phase_statistics[ICET_FRAME_STATISTIC_P50]
+                > phase_statistics[ICET_FRAME_STATISTIC_P95])
+            || (  phase_statistics[ICET_FRAME_STATISTIC_P95]
+                > phase_statistics[ICET_FRAME_STATISTIC_P99])
+            || (  phase_statistics[ICET_FRAME_STATISTIC_P99]
+                > phase_statistics[ICET_FRAME_STATISTIC_MAX])
+            || (  phase_statistics[ICET_FRAME_STATISTIC_MEAN]
+                > phase_statistics[ICET_FRAME_STATISTIC_MAX]) ) {
+            printrank("**** %s phase %d statistics out of order ****\n",
+                      summary_name, (int)phase);
+            result = TEST_FAILED;
+        }
+        if (   (phase_statistics[ICET_FRAME_STATISTIC_RANK] < 0)
+            || (phase_statistics[ICET_FRAME_STATISTIC_RANK] >= num_proc) ) {
+            printrank("**** %s phase %d has bad rank %g ****\n",
+                      summary_name, (int)phase,
+                      phase_statistics[ICET_FRAME_STATISTIC_RANK]);
+            result = TEST_FAILED;
+        }
+    }
+
+    return result;
+}
+
+static int FrameStatisticsRun(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTDouble total_draw_times[NUM_FRAMES];
+    IceTDouble local[ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE];
+    IceTDouble slowest[ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE];
+    IceTDouble slowest_ranks[ICET_FRAME_NUM_PHASES];
+    IceTDouble *all_slowest_ranks;
+    IceTDouble window_max;
+    IceTInt num_frames;
+    IceTInt num_proc;
+    IceTInt frame;
+    IceTInt phase;
+    IceTInt i;
+    int result = TEST_PASSED;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDrawCallback(FrameStatisticsDraw);
+    icetStrategy(ICET_STRATEGY_REDUCE);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    printstat("Checking that statistics are off by default.\n");
+    icetDrawFrame(identity, identity, black);
+    num_frames = icetGetFrameStatistics(ICET_FRAME_SUMMARY_LOCAL, NULL);
+    if (num_frames != 0) {
+        printrank("**** Recorded %d frames with no window ****\n",
+                  (int)num_frames);
+        result = TEST_FAILED;
+    }
+
+    printstat("Drawing %d frames with window of %d.\n",
+              NUM_FRAMES, FRAME_WINDOW);
+    icetFrameStatisticsWindow(FRAME_WINDOW);
+    for (frame = 0; frame < NUM_FRAMES; frame++) {
+        icetDrawFrame(identity, identity, black);
+        icetGetDoublev(ICET_TOTAL_DRAW_TIME, &total_draw_times[frame]);
+    }
+
+    num_frames = icetGetFrameStatistics(ICET_FRAME_SUMMARY_LOCAL, local);
+    if (num_frames != FRAME_WINDOW) {
+        printrank("**** Got %d frames, expected %d ****\n",
+                  (int)num_frames, FRAME_WINDOW);
+        result = TEST_FAILED;
+    }
+    result += FrameStatisticsCheckOrder(local, "Local");
+
+    /* Only the last frames are in the window. */
+    window_max = 0.0;
+    for (frame = NUM_FRAMES - FRAME_WINDOW; frame < NUM_FRAMES; frame++) {
+        if (total_draw_times[frame] > window_max) {
+            window_max = total_draw_times[frame];
+        }
+    }
+    if (  local[ICET_FRAME_PHASE_TOTAL_DRAW*ICET_FRAME_STATISTICS_SIZE
+                + ICET_FRAME_STATISTIC_MAX]
+        != window_max) {
+        printrank("**** Maximum total draw time does not match window ****\n");
+        result = TEST_FAILED;
+    }
+
+    icetGetFrameStatistics(ICET_FRAME_SUMMARY_SLOWEST, slowest);
+    result += FrameStatisticsCheckOrder(slowest, "Slowest");
+    for (i = 0; i < ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE; i++) {
+        if (   ((i%ICET_FRAME_STATISTICS_SIZE) != ICET_FRAME_STATISTIC_RANK)
+            && (slowest[i] < local[i]) ) {
+            printrank("**** Slowest statistic below local statistic ****\n");
+            result = TEST_FAILED;
+        }
+    }
+
+    /* Every process must name the same slowest rank, even for phases whose
+       means tie (such as phases that take no time anywhere). */
+    for (phase = 0; phase < ICET_FRAME_NUM_PHASES; phase++) {
+        slowest_ranks[phase]
+            = slowest[  phase*ICET_FRAME_STATISTICS_SIZE
+                      + ICET_FRAME_STATISTIC_RANK];
+    }
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    all_slowest_ranks = malloc(num_proc*ICET_FRAME_NUM_PHASES
+                               *sizeof(IceTDouble));
+    icetCommAllgather(slowest_ranks,
+                      ICET_FRAME_NUM_PHASES,
+                      ICET_DOUBLE,
+                      all_slowest_ranks);
+    for (i = 0; i < num_proc*ICET_FRAME_NUM_PHASES; i++) {
+        if (all_slowest_ranks[i] != slowest_ranks[i%ICET_FRAME_NUM_PHASES]) {
+            printrank("**** Processes disagree on the slowest rank ****\n");
+            result = TEST_FAILED;
+            break;
+        }
+    }
+    free(all_slowest_ranks);
+
+    icetFrameStatisticsWindow(0);
+
+    return result;
+}
+
+int FrameStatistics(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(FrameStatisticsRun);
+}
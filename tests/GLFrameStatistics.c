@@ -0,0 +1,111 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests that frame statistics recorded through the OpenGL layer include the
+** time the layer adds after compositing, most notably the buffer write.
+*****************************************************************************/
+
+#include <IceTGL.h>
+
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+static void draw(void)
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBegin(GL_QUADS);
+      glVertex3d(-1.0, -1.0, 0.0);
+      glVertex3d(1.0, -1.0, 0.0);
+      glVertex3d(1.0, 1.0, 0.0);
+      glVertex3d(-1.0, 1.0, 0.0);
+    glEnd();
+}
+
+static IceTDouble GetRecorded(const IceTDouble *stats, int phase)
+{
+    return stats[phase*ICET_FRAME_STATISTICS_SIZE + ICET_FRAME_STATISTIC_P50];
+}
+
+static int GLFrameStatisticsRun(void)
+{
+    IceTDouble stats[ICET_FRAME_NUM_PHASES*ICET_FRAME_STATISTICS_SIZE];
+    IceTDouble buf_write_time;
+    IceTDouble total_draw_time;
+    IceTDouble composite_time;
+    IceTInt num_frames;
+    int result = TEST_PASSED;
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+    icetGLDrawCallback(draw);
+    icetBoundingBoxd(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+    icetStrategy(ICET_STRATEGY_REDUCE);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glDisable(GL_LIGHTING);
+    glColor4d(1.0, 1.0, 1.0, 1.0);
+
+    /* A window of one frame makes every statistic the last frame's time. */
+    icetFrameStatisticsWindow(1);
+
+    printstat("Drawing frame through the OpenGL layer.\n");
+    icetGLDrawFrame();
+    swap_buffers();
+
+    num_frames = icetGetFrameStatistics(ICET_FRAME_SUMMARY_LOCAL, stats);
+    if (num_frames != 1) {
+        printrank("*** Expected 1 recorded frame, got %d ***\n",
+                  (int)num_frames);
+        return TEST_FAILED;
+    }
+
+    icetGetDoublev(ICET_BUFFER_WRITE_TIME, &buf_write_time);
+    icetGetDoublev(ICET_TOTAL_DRAW_TIME, &total_draw_time);
+    icetGetDoublev(ICET_COMPOSITE_TIME, &composite_time);
+
+    if (!(GetRecorded(stats, ICET_FRAME_PHASE_BUFFER_WRITE) > 0.0)) {
+        printrank("*** Recorded buffer write time is not positive ***\n");
+        result = TEST_FAILED;
+    }
+    if (GetRecorded(stats, ICET_FRAME_PHASE_BUFFER_WRITE) != buf_write_time) {
+        printrank("*** Recorded buffer write time %g, state has %g ***\n",
+                  GetRecorded(stats, ICET_FRAME_PHASE_BUFFER_WRITE),
+                  buf_write_time);
+        result = TEST_FAILED;
+    }
+    if (GetRecorded(stats, ICET_FRAME_PHASE_TOTAL_DRAW) != total_draw_time) {
+        printrank("*** Recorded total draw time %g, state has %g ***\n",
+                  GetRecorded(stats, ICET_FRAME_PHASE_TOTAL_DRAW),
+                  total_draw_time);
+        result = TEST_FAILED;
+    }
+    if (GetRecorded(stats, ICET_FRAME_PHASE_COMPOSITE) != composite_time) {
+        printrank("*** Recorded composite time %g, state has %g ***\n",
+                  GetRecorded(stats, ICET_FRAME_PHASE_COMPOSITE),
+                  composite_time);
+        result = TEST_FAILED;
+    }
+
+    return result;
+}
+
+int GLFrameStatistics(int argc, char *argv[])
+{
+    /* To remove warning */
+    (void)argc;
+    (void)argv;
+
+    icetGLInitialize();
+    return run_test(GLFrameStatisticsRun);
+}
@@ -0,0 +1,264 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests icetGatherEncodedImage.  It composites an image with and without
+** image collection, gathers the result as a QOI file, decodes it, and checks
+** the pixels.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Use a size that does not divide evenly so that image partitions do not
+   line up with rows. */
+#define TILE_WIDTH      (SCREEN_WIDTH - 3)
+#define TILE_HEIGHT     (SCREEN_HEIGHT - 1)
+
+static void GatherEncodedImageExpectedColor(IceTSizeType x,
+                                            IceTSizeType y,
+                                            IceTUByte *color)
+{
+    if ((x%64) < 16) {
+        /* Flat regions exercise runs and the color index. */
+        color[0] = 200;
+        color[1] = (IceTUByte)(50*((y/32)%3));
+        color[2] = 30;
+        color[3] = 255;
+    } else {
+        color[0] = (IceTUByte)(x & 0xFF);
+        color[1] = (IceTUByte)(y & 0xFF);
+        color[2] = (IceTUByte)(40*(x/256 + y/256));
+        color[3] = (IceTUByte)(((x/128)%2 == 0) ? 255 : 128);
+    }
+}
+
+static void GatherEncodedImageDraw(const IceTDouble *projection_matrix,
+                                   const IceTDouble *modelview_matrix,
+                                   const IceTFloat *background_color,
+                                   const IceTInt *readback_viewport,
+                                   IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+
+    /* Every process draws the same thing, so it does not matter which one
+       wins the depth test. */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            GatherEncodedImageExpectedColor(x, y, color_buffer + 4*(y*width+x));
+            depth_buffer[y*width + x] = 0.5f;
+        }
+    }
+}
+
+static IceTSizeType GatherEncodedImageReadBigEndian32(const IceTUByte *in)
+{
+    return (IceTSizeType)(  ((IceTUInt)in[0] << 24) | ((IceTUInt)in[1] << 16)
+                          | ((IceTUInt)in[2] << 8) | (IceTUInt)in[3] );
+}
+
+/* A straightforward QOI decoder.  Returns 0 on failure. */
+static int GatherEncodedImageDecode(const IceTUByte *in,
+                                    IceTSizeType size,
+                                    IceTUByte *pixels,
+                                    IceTSizeType num_pixels)
+{
+    IceTUByte index[64][4];
+    IceTUByte px[4];
+    IceTSizeType position = 14;
+    IceTSizeType pixel;
+    int run = 0;
+
+    memset(index, 0, sizeof(index));
+    px[0] = px[1] = px[2] = 0;
+    px[3] = 255;
+
+    for (pixel = 0; pixel < num_pixels; pixel++) {
+        if (run > 0) {
+            run--;
+        } else {
+            int op;
+            if (position >= size - 8) { return 0; }
+            op = in[position++];
+            if (op == 0xFE) {
+                px[0] = in[position++];
+                px[1] = in[position++];
+                px[2] = in[position++];
+            } else if (op == 0xFF) {
+                px[0] = in[position++];
+                px[1] = in[position++];
+                px[2] = in[position++];
+                px[3] = in[position++];
+            } else if ((op & 0xC0) == 0x00) {
+                memcpy(px, index[op], 4);
+            } else if ((op & 0xC0) == 0x40) {
+                px[0] = (IceTUByte)(px[0] + ((op >> 4) & 0x03) - 2);
+                px[1] = (IceTUByte)(px[1] + ((op >> 2) & 0x03) - 2);
+                px[2] = (IceTUByte)(px[2] + (op & 0x03) - 2);
+            } else if ((op & 0xC0) == 0x80) {
+                int b2 = in[position++];
+                int vg = (op & 0x3F) - 32;
+                px[0] = (IceTUByte)(px[0] + vg - 8 + ((b2 >> 4) & 0x0F));
+                px[1] = (IceTUByte)(px[1] + vg);
+                px[2] = (IceTUByte)(px[2] + vg - 8 + (b2 & 0x0F));
+            } else {
+                run = op & 0x3F;
+            }
+            memcpy(index[(px[0]*3 + px[1]*5 + px[2]*7 + px[3]*11)%64], px, 4);
+        }
+        memcpy(pixels + 4*pixel, px, 4);
+    }
+
+    /* All data should be consumed up to the end marker. */
+    if (position != size - 8) { return 0; }
+    return 1;
+}
+
+static int GatherEncodedImageCheck(const IceTUByte *encoded,
+                                   IceTSizeType encoded_size)
+{
+    IceTUByte *pixels;
+    IceTSizeType x, y;
+    int result = TEST_PASSED;
+
+    if (   (encoded_size < 22)
+        || (memcmp(encoded, "qoif", 4) != 0)
+        || (GatherEncodedImageReadBigEndian32(encoded + 4) != TILE_WIDTH)
+        || (GatherEncodedImageReadBigEndian32(encoded + 8) != TILE_HEIGHT)
+        || (encoded[12] != 4)
+        || (encoded[encoded_size-1] != 1) ) {
+        printrank("**** Bad QOI header or end marker ****\n");
+        return TEST_FAILED;
+    }
+
+    pixels = malloc(4*TILE_WIDTH*TILE_HEIGHT);
+    if (!GatherEncodedImageDecode(encoded,
+                                  encoded_size,
+                                  pixels,
+                                  TILE_WIDTH*TILE_HEIGHT)) {
+        printrank("**** Could not decode QOI stream ****\n");
+        free(pixels);
+        return TEST_FAILED;
+    }
+
+    /* QOI rows go top to bottom whereas IceT rows go bottom to top. */
+    for (y = 0; (y < TILE_HEIGHT) && (result == TEST_PASSED); y++) {
+        for (x = 0; x < TILE_WIDTH; x++) {
+            const IceTUByte *pixel
+                = pixels + 4*((TILE_HEIGHT - y - 1)*TILE_WIDTH + x);
+            IceTUByte expected[4];
+            GatherEncodedImageExpectedColor(x, y, expected);
+            if (memcmp(pixel, expected, 4) != 0) {
+                printrank("**** Found bad pixel!!!! ****\n");
+                printrank("Location x = %d, y = %d\n", (int)x, (int)y);
+                printrank("Got      %d %d %d %d\n",
+                          pixel[0], pixel[1], pixel[2], pixel[3]);
+                printrank("Expected %d %d %d %d\n",
+                          expected[0], expected[1], expected[2], expected[3]);
+                result = TEST_FAILED;
+                break;
+            }
+        }
+    }
+
+    free(pixels);
+    return result;
+}
+
+static int GatherEncodedImageTryFrame(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTImage image;
+    const IceTVoid *encoded;
+    IceTSizeType encoded_size;
+    IceTInt rank;
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    image = icetDrawFrame(identity, identity, black);
+    encoded = icetGatherEncodedImage(image,
+                                     ICET_IMAGE_ENCODING_QOI,
+                                     &encoded_size);
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    if (rank == 0) {
+        if (encoded == NULL) {
+            printrank("**** Display process got no encoded image ****\n");
+            return TEST_FAILED;
+        }
+        printrank("Encoded image is %d bytes\n", (int)encoded_size);
+        return GatherEncodedImageCheck(encoded, encoded_size);
+    } else if (encoded != NULL) {
+        printrank("**** Non-display process got an encoded image ****\n");
+        return TEST_FAILED;
+    }
+
+    return TEST_PASSED;
+}
+
+static int GatherEncodedImageRun(void)
+{
+    int strategy_idx;
+    int result = TEST_PASSED;
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+
+    icetDrawCallback(GatherEncodedImageDraw);
+
+    icetResetTiles();
+    icetAddTile(0, 0, TILE_WIDTH, TILE_HEIGHT, 0);
+
+    for (strategy_idx = 0; strategy_idx < STRATEGY_LIST_SIZE; strategy_idx++) {
+        icetStrategy(strategy_list[strategy_idx]);
+        printstat("Trying strategy %s\n", icetGetStrategyName());
+
+        printstat("  Encoding image partitions\n");
+        icetDisable(ICET_COLLECT_IMAGES);
+        result += GatherEncodedImageTryFrame();
+
+        printstat("  Encoding collected image\n");
+        icetEnable(ICET_COLLECT_IMAGES);
+        result += GatherEncodedImageTryFrame();
+    }
+
+    return result;
+}
+
+int GatherEncodedImage(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(GatherEncodedImageRun);
+}
@@ -0,0 +1,174 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the hybrid strategy on tiles with very different numbers of images.
+** The first tile has an image from every process while the last tiles have
+** only one or two, so the hybrid strategy sends some tiles directly to their
+** display processes and composites the others in groups.  The result must
+** match the image composited with the sequential strategy.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 48
+#define MAX_TILES 6
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+static IceTVoid *g_colors;
+static IceTFloat *g_depths;
+static IceTInt g_valid_viewport[4];
+
+/* Makes an image covering the first tiles.  Lower ranks cover more tiles, so
+   tile t has an image from num_tiles - t processes (or all of them). */
+static void MakeImage(IceTInt num_tiles)
+{
+    IceTInt rank;
+    IceTInt last_tile;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    last_tile = num_tiles - 1 - rank;
+    if (last_tile < 0) { last_tile = 0; }
+    g_valid_viewport[0] = rand()%(TILE_WIDTH/2);
+    g_valid_viewport[1] = rand()%(TILE_HEIGHT/2);
+    g_valid_viewport[2] = (last_tile+1)*TILE_WIDTH - rand()%(TILE_WIDTH/2)
+                          - g_valid_viewport[0];
+    g_valid_viewport[3] = TILE_HEIGHT - rand()%(TILE_HEIGHT/2)
+                          - g_valid_viewport[1];
+
+    make_test_image(num_tiles*TILE_WIDTH,
+                    TILE_HEIGHT,
+                    g_valid_viewport,
+                    g_background_color,
+                    &g_colors,
+                    &g_depths);
+}
+
+static IceTBoolean TryHybrid(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTByte *reference;
+    IceTSizeType reference_bytes;
+    IceTInt si_index;
+
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+    icetSingleImageStrategy(ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC);
+    reference = composite_and_copy(g_colors,
+                                   g_depths,
+                                   g_valid_viewport,
+                                   g_background_color,
+                                   &reference_bytes);
+
+    icetStrategy(ICET_STRATEGY_HYBRID);
+    for (si_index = 0; si_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE; si_index++){
+        IceTEnum single_image_strategy = single_image_strategy_list[si_index];
+        IceTByte *hybrid_result;
+        IceTSizeType hybrid_bytes;
+
+        icetSingleImageStrategy(single_image_strategy);
+        printstat("    Single image strategy %s\n",
+                  icetGetSingleImageStrategyName());
+
+        hybrid_result = composite_and_copy(g_colors,
+                                           g_depths,
+                                           g_valid_viewport,
+                                           g_background_color,
+                                           &hybrid_bytes);
+        if (   (hybrid_bytes != reference_bytes)
+            || (   (reference != NULL)
+                && (memcmp(reference, hybrid_result, reference_bytes)
+                    != 0) ) ) {
+            printrank("***** Hybrid differs with %s *****\n",
+                      icetGetSingleImageStrategyName());
+            success = ICET_FALSE;
+        }
+        free(hybrid_result);
+    }
+    free(reference);
+
+    return success;
+}
+
+static int HybridStrategyRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt num_tiles;
+    IceTInt tile;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (num_proc < 2) {
+        printstat("Need at least 2 processes to display multiple tiles.\n");
+        return TEST_NOT_RUN;
+    }
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+
+    num_tiles = (num_proc < MAX_TILES) ? num_proc : MAX_TILES;
+    printstat("Using %dx1 tiles\n", num_tiles);
+    icetResetTiles();
+    for (tile = 0; tile < num_tiles; tile++) {
+        icetAddTile(tile*TILE_WIDTH, 0, TILE_WIDTH, TILE_HEIGHT, tile);
+    }
+
+    MakeImage(num_tiles);
+
+    printstat("  Unordered\n");
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    if (!TryHybrid()) { success = ICET_FALSE; }
+
+    printstat("  Ordered\n");
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    if (!TryHybrid()) { success = ICET_FALSE; }
+
+    free(g_colors);
+    free(g_depths);
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int HybridStrategy(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(HybridStrategyRun);
+}
@@ -0,0 +1,182 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests the ICET_OCCLUSION_CULLING option.  Each process renders
+** overlapping geometry at staggered depths.  The result of a z-buffer
+** composite is checked against the same composite with culling turned off,
+** and culling is expected to reduce the data each process sends.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static void OcclusionCullingDraw(const IceTDouble *projection_matrix,
+                                 const IceTDouble *modelview_matrix,
+                                 const IceTFloat *background_color,
+                                 const IceTInt *readback_viewport,
+                                 IceTImage result)
+{
+    IceTInt rank;
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+
+    /* Patches of constant depth that do not line up with the culling blocks,
+       with some empty regions. */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTUByte *color = color_buffer + 4*(y*width + x);
+            IceTFloat *depth = depth_buffer + y*width + x;
+            if ((x/100 + y/70 + rank)%5 == 0) {
+                color[0] = color[1] = color[2] = color[3] = 0;
+                depth[0] = 1.0f;
+            } else {
+                color[0] = (IceTUByte)(50*rank);
+                color[1] = (IceTUByte)(x & 0xFF);
+                color[2] = (IceTUByte)(y & 0xFF);
+                color[3] = 255;
+                depth[0] = (  0.1f + 0.2f*(IceTFloat)((x/20 + y/12 + rank)%4)
+                            + 0.001f*(IceTFloat)(x%7) );
+            }
+        }
+    }
+}
+
+static IceTImage OcclusionCullingDrawFrame(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    return icetDrawFrame(identity, identity, black);
+}
+
+static int OcclusionCullingTryStrategy(IceTUByte *reference_buffer)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTImage image;
+    IceTInt bytes_sent_unculled;
+    IceTInt bytes_sent_culled;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetDisable(ICET_OCCLUSION_CULLING);
+    image = OcclusionCullingDrawFrame();
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent_unculled);
+    if (rank == 0) {
+        memcpy(reference_buffer,
+               icetImageGetColorcub(image),
+               4*SCREEN_WIDTH*SCREEN_HEIGHT);
+    }
+
+    icetEnable(ICET_OCCLUSION_CULLING);
+    image = OcclusionCullingDrawFrame();
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent_culled);
+    icetDisable(ICET_OCCLUSION_CULLING);
+
+    if (rank == 0) {
+        const IceTUByte *color_buffer = icetImageGetColorcub(image);
+        IceTSizeType i;
+        for (i = 0; i < SCREEN_WIDTH*SCREEN_HEIGHT; i++) {
+            const IceTUByte *pixel = color_buffer + 4*i;
+            const IceTUByte *expected = reference_buffer + 4*i;
+            if (   (pixel[0] != expected[0]) || (pixel[1] != expected[1])
+                || (pixel[2] != expected[2]) || (pixel[3] != expected[3]) ) {
+                printrank("**** Found bad pixel!!!! ****\n");
+                printrank("Pixel %d\n", (int)i);
+                printrank("Got      %d %d %d %d\n",
+                          pixel[0], pixel[1], pixel[2], pixel[3]);
+                printrank("Expected %d %d %d %d\n",
+                          expected[0], expected[1], expected[2], expected[3]);
+                return TEST_FAILED;
+            }
+        }
+    }
+
+    printrank("Bytes sent without culling %d, with culling %d\n",
+              bytes_sent_unculled, bytes_sent_culled);
+    /* Some strategies send no image data from some processes, in which case
+       the only thing sent is the depth exchange. */
+    if (   (num_proc > 1)
+        && (bytes_sent_unculled > 0)
+        && (bytes_sent_culled >= bytes_sent_unculled) ) {
+        printrank("**** Culling did not reduce data sent ****\n");
+        return TEST_FAILED;
+    }
+
+    return TEST_PASSED;
+}
+
+static int OcclusionCullingRun(void)
+{
+    IceTUByte *reference_buffer;
+    int single_image_strategy_index;
+    int result = TEST_PASSED;
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+
+    icetDrawCallback(OcclusionCullingDraw);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    reference_buffer = malloc(4*SCREEN_WIDTH*SCREEN_HEIGHT);
+
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+    for (single_image_strategy_index = 0;
+         single_image_strategy_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+         single_image_strategy_index++) {
+        icetSingleImageStrategy(
+                       single_image_strategy_list[single_image_strategy_index]);
+        printstat("Trying single image strategy %s\n",
+                  icetGetSingleImageStrategyName());
+
+        result += OcclusionCullingTryStrategy(reference_buffer);
+    }
+
+    free(reference_buffer);
+
+    return result;
+}
+
+int OcclusionCulling(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(OcclusionCullingRun);
+}
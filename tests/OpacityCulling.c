@@ -0,0 +1,197 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests the ICET_OPACITY_CULLING option.  Each process renders runs of
+** opaque, translucent, and empty pixels, and the result of an ordered blend
+** composite is checked against the same composite with culling turned off.
+** It also checks that culling reduces the data sent by the process in back.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static IceTInt g_order_position;
+
+static void OpacityCullingDraw(const IceTDouble *projection_matrix,
+                               const IceTDouble *modelview_matrix,
+                               const IceTFloat *background_color,
+                               const IceTInt *readback_viewport,
+                               IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTSizeType num_pixels;
+    IceTSizeType i;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    num_pixels = icetImageGetNumPixels(result);
+    color_buffer = icetImageGetColorub(result);
+
+    for (i = 0; i < num_pixels; i++) {
+        IceTUByte *pixel = color_buffer + 4*i;
+        switch ((i/37 + 3*g_order_position) % 5) {
+          case 0:
+          case 1:
+          case 2:
+              pixel[0] = (IceTUByte)(40*g_order_position);
+              pixel[1] = (IceTUByte)(i & 0xFF);
+              pixel[2] = 100;
+              pixel[3] = 255;
+              break;
+          case 3:
+              pixel[0] = pixel[1] = pixel[2] = 20;
+              pixel[3] = 64;
+              break;
+          default:
+              pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+              break;
+        }
+    }
+}
+
+static IceTImage OpacityCullingDrawFrame(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    return icetDrawFrame(identity, identity, black);
+}
+
+static int OpacityCullingTryStrategy(IceTUByte *reference_buffer)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTEnum strategy;
+    IceTImage image;
+    IceTInt bytes_sent_unculled;
+    IceTInt bytes_sent_culled;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetEnumv(ICET_SINGLE_IMAGE_STRATEGY, &strategy);
+
+    icetDisable(ICET_OPACITY_CULLING);
+    image = OpacityCullingDrawFrame();
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent_unculled);
+    if (rank == 0) {
+        memcpy(reference_buffer,
+               icetImageGetColorcub(image),
+               4*SCREEN_WIDTH*SCREEN_HEIGHT);
+    }
+
+    icetEnable(ICET_OPACITY_CULLING);
+    image = OpacityCullingDrawFrame();
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent_culled);
+    icetDisable(ICET_OPACITY_CULLING);
+
+    if (rank == 0) {
+        const IceTUByte *color_buffer = icetImageGetColorcub(image);
+        IceTSizeType i;
+        for (i = 0; i < SCREEN_WIDTH*SCREEN_HEIGHT; i++) {
+            const IceTUByte *pixel = color_buffer + 4*i;
+            const IceTUByte *expected = reference_buffer + 4*i;
+            if (   (pixel[0] != expected[0]) || (pixel[1] != expected[1])
+                || (pixel[2] != expected[2]) || (pixel[3] != expected[3]) ) {
+                printrank("**** Found bad pixel!!!! ****\n");
+                printrank("Pixel %d\n", (int)i);
+                printrank("Got      %d %d %d %d\n",
+                          pixel[0], pixel[1], pixel[2], pixel[3]);
+                printrank("Expected %d %d %d %d\n",
+                          expected[0], expected[1], expected[2], expected[3]);
+                return TEST_FAILED;
+            }
+        }
+    }
+
+    printrank("Bytes sent without culling %d, with culling %d\n",
+              bytes_sent_unculled, bytes_sent_culled);
+    if (   (num_proc > 1)
+        && (g_order_position == num_proc-1)
+        && (   (strategy == ICET_SINGLE_IMAGE_STRATEGY_RADIXK)
+            || (strategy == ICET_SINGLE_IMAGE_STRATEGY_RADIXKR) )
+        && (bytes_sent_culled >= bytes_sent_unculled) ) {
+        printrank("**** Culling did not reduce data sent from back ****\n");
+        return TEST_FAILED;
+    }
+
+    return TEST_PASSED;
+}
+
+static int OpacityCullingRun(void)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt *process_ranks;
+    IceTUByte *reference_buffer;
+    IceTInt proc;
+    int single_image_strategy_index;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+
+    icetDrawCallback(OpacityCullingDraw);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    /* Reverse the natural order so that the last rank is in front. */
+    process_ranks = malloc(num_proc * sizeof(IceTInt));
+    for (proc = 0; proc < num_proc; proc++) {
+        process_ranks[proc] = num_proc - proc - 1;
+    }
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    icetCompositeOrder(process_ranks);
+    free(process_ranks);
+    g_order_position = num_proc - rank - 1;
+
+    reference_buffer = malloc(4*SCREEN_WIDTH*SCREEN_HEIGHT);
+
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+    for (single_image_strategy_index = 0;
+         single_image_strategy_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+         single_image_strategy_index++) {
+        icetSingleImageStrategy(
+                       single_image_strategy_list[single_image_strategy_index]);
+        printstat("Trying single image strategy %s\n",
+                  icetGetSingleImageStrategyName());
+
+        result += OpacityCullingTryStrategy(reference_buffer);
+    }
+
+    free(reference_buffer);
+
+    return result;
+}
+
+int OpacityCulling(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(OpacityCullingRun);
+}
@@ -0,0 +1,532 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test measures the throughput of the core image kernels (compress,
+** decompress, z-buffer composite, blend and compressed-compressed
+** composite) on images of a fixed size, along with a composite of an image
+** from every process with the sequential strategy and radix-k, and compares
+** it against a baseline file.  The test fails if any measurement is slower
+** than its baseline by more than a tolerance.  The test is skipped if the
+** baseline file does not exist, and a baseline is only written when asked
+** for with -record.  It is not part of the regular test run.
+*****************************************************************************/
+
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevPorting.h>
+#include "test_util.h"
+#include "test_codes.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_KERNELS             6
+#define KERNEL_COMPRESS         0
+#define KERNEL_DECOMPRESS       1
+#define KERNEL_Z_COMPOSITE      2
+#define KERNEL_BLEND            3
+#define KERNEL_CC_COMPOSITE     4
+#define KERNEL_SEQUENTIAL_RADIXK 5
+
+static const char *g_kernel_names[NUM_KERNELS] = {
+    "compress",
+    "decompress",
+    "z_composite",
+    "blend",
+    "cc_composite",
+    "sequential_radixk"
+};
+
+/* What to do with the baseline file.  Every process needs to know because
+   they all take part in the strategy composite. */
+#define BASELINE_COMPARE        0
+#define BASELINE_RECORD         1
+#define BASELINE_MISSING        2
+#define BASELINE_UNUSABLE       3
+#define BASELINE_TAG            29
+
+/* Matches the SKIP_RETURN_CODE test property so that a missing baseline
+   shows up as a skipped test. */
+#define PERFORMANCE_SKIP_RETURN_CODE 77
+
+/* Each measurement is the best of this many trials to filter out
+   interference from the rest of the system. */
+#define NUM_TRIALS 5
+
+static IceTSizeType g_size;
+static IceTDouble g_min_time;
+static IceTDouble g_tolerance;
+static const char *g_baseline_filename;
+static IceTBoolean g_record;
+static IceTBoolean g_skipped;
+
+static void usage(char *argv[])
+{
+    printstat("\nUSAGE: %s [testargs]\n", argv[0]);
+    printstat("\nWhere  testargs are:\n");
+    printstat("  -baseline <file> Compare against the throughputs in this file.  The\n"
+              "                test is skipped if it does not exist.\n");
+    printstat("  -record       Write the measured throughputs to the baseline file\n"
+              "                instead of comparing against it.\n");
+    printstat("  -tolerance <fraction> Fail if a kernel is slower than its baseline\n"
+              "                by more than this fraction (default 0.25).\n");
+    printstat("  -size <num>   Width and height of the images (default 512).\n");
+    printstat("  -min-time <seconds> Time each trial for at least this long\n"
+              "                (default 0.1).\n");
+    printstat("  -h, -help     Print this help message.\n");
+    printstat("\nFor general testing options, try -h or -help before test name.\n");
+}
+
+static void parse_arguments(int argc, char *argv[])
+{
+    int arg;
+
+    g_size = 512;
+    g_min_time = 0.1;
+    g_tolerance = 0.25;
+    g_baseline_filename = NULL;
+    g_record = ICET_FALSE;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-baseline") == 0) {
+            arg++;
+            g_baseline_filename = argv[arg];
+        } else if (strcmp(argv[arg], "-record") == 0) {
+            g_record = ICET_TRUE;
+        } else if (strcmp(argv[arg], "-tolerance") == 0) {
+            arg++;
+            g_tolerance = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-size") == 0) {
+            arg++;
+            g_size = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-min-time") == 0) {
+            arg++;
+            g_min_time = atof(argv[arg]);
+        } else if (   (strcmp(argv[arg], "-h") == 0)
+                   || (strcmp(argv[arg], "-help") == 0) ) {
+            usage(argv);
+            exit(0);
+        } else {
+            printstat("Unknown option `%s'.\n", argv[arg]);
+            usage(argv);
+            exit(1);
+        }
+    }
+}
+
+/* Fills an image with a disk covering about half of it.  The disk is
+   centered at the given fraction of the image so that two images overlap
+   only partly. */
+static void fill_image(IceTImage image, IceTFloat center_x, IceTFloat depth)
+{
+    IceTSizeType width = icetImageGetWidth(image);
+    IceTSizeType height = icetImageGetHeight(image);
+    IceTFloat radius = 0.4f*width;
+    IceTUByte *colors = icetImageGetColorub(image);
+    IceTFloat *depths = NULL;
+    IceTSizeType x, y;
+
+    if (icetImageGetDepthFormat(image) == ICET_IMAGE_DEPTH_FLOAT) {
+        depths = icetImageGetDepthf(image);
+    }
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTSizeType pixel = y*width + x;
+            IceTFloat dx = x - center_x*width;
+            IceTFloat dy = y - 0.5f*height;
+            IceTUByte *color = colors + 4*pixel;
+            if (dx*dx + dy*dy < radius*radius) {
+                IceTUByte alpha = (IceTUByte)(64 + (x + y)%192);
+                color[0] = (IceTUByte)((x*alpha)/width);
+                color[1] = (IceTUByte)((y*alpha)/height);
+                color[2] = alpha/2;
+                color[3] = alpha;
+                if (depths) { depths[pixel] = depth + 0.0001f*(x%16); }
+            } else {
+                color[0] = color[1] = color[2] = color[3] = 0;
+                if (depths) { depths[pixel] = 1.0f; }
+            }
+        }
+    }
+}
+
+/* Runs an operation repeatedly and sets rate to the best throughput of
+   several trials in GB of uncompressed image per second. */
+#define MEASURE_RATE(rate, bytes, operation)                            \
+    {                                                                   \
+        IceTInt trial;                                                  \
+        rate = 0.0;                                                     \
+        for (trial = 0; trial < NUM_TRIALS; trial++) {                  \
+            IceTDouble start_time = icetWallTime();                     \
+            IceTDouble elapsed;                                         \
+            IceTDouble trial_rate;                                      \
+            IceTInt repeat = 0;                                         \
+            do {                                                        \
+                operation;                                              \
+                repeat++;                                               \
+                elapsed = icetWallTime() - start_time;                  \
+            } while (elapsed < g_min_time);                             \
+            trial_rate = 1.0e-9*repeat*(IceTDouble)(bytes)/elapsed;     \
+            if (trial_rate > rate) { rate = trial_rate; }               \
+        }                                                               \
+    }
+
+static void measure_kernels(IceTDouble *rates)
+{
+    IceTSizeType num_pixels = g_size*g_size;
+    IceTVoid *front_buffer;
+    IceTVoid *back_buffer;
+    IceTVoid *dest_buffer;
+    IceTVoid *front_sparse_buffer;
+    IceTVoid *back_sparse_buffer;
+    IceTVoid *dest_sparse_buffer;
+    IceTImage front;
+    IceTImage back;
+    IceTImage dest;
+    IceTSparseImage front_sparse;
+    IceTSparseImage back_sparse;
+    IceTSparseImage dest_sparse;
+    IceTSizeType bytes;
+
+    /* The z-buffer kernels use 8-bit colors with depths, which is the most
+       common format for rendering surfaces. */
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    bytes = num_pixels*(4 + sizeof(IceTFloat));
+
+    front_buffer = malloc(icetImageBufferSize(g_size, g_size));
+    back_buffer = malloc(icetImageBufferSize(g_size, g_size));
+    dest_buffer = malloc(icetImageBufferSize(g_size, g_size));
+    front_sparse_buffer = malloc(icetSparseImageBufferSize(g_size, g_size));
+    back_sparse_buffer = malloc(icetSparseImageBufferSize(g_size, g_size));
+    dest_sparse_buffer = malloc(icetSparseImageBufferSize(g_size, g_size));
+
+    front = icetImageAssignBuffer(front_buffer, g_size, g_size);
+    back = icetImageAssignBuffer(back_buffer, g_size, g_size);
+    dest = icetImageAssignBuffer(dest_buffer, g_size, g_size);
+    front_sparse
+        = icetSparseImageAssignBuffer(front_sparse_buffer, g_size, g_size);
+    back_sparse
+        = icetSparseImageAssignBuffer(back_sparse_buffer, g_size, g_size);
+    dest_sparse
+        = icetSparseImageAssignBuffer(dest_sparse_buffer, g_size, g_size);
+
+    fill_image(front, 0.4f, 0.25f);
+    fill_image(back, 0.6f, 0.5f);
+    icetCompressImage(back, back_sparse);
+
+    MEASURE_RATE(rates[KERNEL_COMPRESS], bytes,
+                 icetCompressImage(front, front_sparse));
+    MEASURE_RATE(rates[KERNEL_DECOMPRESS], bytes,
+                 icetDecompressImage(front_sparse, dest));
+    MEASURE_RATE(rates[KERNEL_Z_COMPOSITE], bytes,
+                 icetComposite(dest, back, ICET_FALSE));
+    MEASURE_RATE(rates[KERNEL_CC_COMPOSITE], bytes,
+                 icetCompressedCompressedComposite(front_sparse,
+                                                   back_sparse,
+                                                   dest_sparse));
+
+    /* Blending uses 8-bit colors without depth. */
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    bytes = num_pixels*4;
+    back = icetImageAssignBuffer(back_buffer, g_size, g_size);
+    dest = icetImageAssignBuffer(dest_buffer, g_size, g_size);
+    fill_image(back, 0.6f, 0.5f);
+    fill_image(dest, 0.4f, 0.25f);
+
+    MEASURE_RATE(rates[KERNEL_BLEND], bytes,
+                 icetComposite(dest, back, ICET_FALSE));
+
+    free(front_buffer);
+    free(back_buffer);
+    free(dest_buffer);
+    free(front_sparse_buffer);
+    free(back_sparse_buffer);
+    free(dest_sparse_buffer);
+}
+
+/* Composites an image from every process onto a single tile with the
+   sequential strategy and radix-k and sets rate to the best throughput of
+   several trials in GB of input image per second.  Every process must call
+   this, and the rate is only meaningful on the display process. */
+static void measure_strategy(IceTDouble *rate)
+{
+    static const IceTFloat background_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTSizeType num_pixels = g_size*g_size;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTVoid *buffer;
+    IceTImage image;
+    IceTDouble start_time;
+    IceTDouble elapsed;
+    IceTDouble *all_elapsed;
+    IceTDouble bytes;
+    IceTInt num_repeats;
+    IceTInt repeat;
+    IceTInt trial;
+    IceTInt proc;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+    icetSingleImageStrategy(ICET_SINGLE_IMAGE_STRATEGY_RADIXK);
+    icetPhysicalRenderSize(g_size, g_size);
+    icetResetTiles();
+    icetAddTile(0, 0, g_size, g_size, 0);
+    bytes = (IceTDouble)num_proc*num_pixels*(4 + sizeof(IceTFloat));
+
+    buffer = malloc(icetImageBufferSize(g_size, g_size));
+    image = icetImageAssignBuffer(buffer, g_size, g_size);
+    fill_image(image,
+               0.3f + (0.4f*rank)/num_proc,
+               0.1f + (0.8f*rank)/num_proc);
+
+#define COMPOSITE_INPUT()                                               \
+    icetCompositeImage(icetImageGetColorcub(image),                     \
+                       icetImageGetDepthcf(image),                      \
+                       NULL, NULL, NULL, background_color)
+
+    /* The composite is collective, so every process must repeat it the same
+       number of times.  Base the count on the slowest process. */
+    COMPOSITE_INPUT();
+    start_time = icetWallTime();
+    COMPOSITE_INPUT();
+    elapsed = icetWallTime() - start_time;
+    all_elapsed = malloc(num_proc*sizeof(IceTDouble));
+    icetCommAllgather(&elapsed, 1, ICET_DOUBLE, all_elapsed);
+    for (proc = 0; proc < num_proc; proc++) {
+        if (all_elapsed[proc] > elapsed) { elapsed = all_elapsed[proc]; }
+    }
+    free(all_elapsed);
+    num_repeats = (IceTInt)(g_min_time/elapsed) + 1;
+
+    *rate = 0.0;
+    for (trial = 0; trial < NUM_TRIALS; trial++) {
+        IceTDouble trial_rate;
+        icetCommBarrier();
+        start_time = icetWallTime();
+        for (repeat = 0; repeat < num_repeats; repeat++) {
+            COMPOSITE_INPUT();
+        }
+        elapsed = icetWallTime() - start_time;
+        trial_rate = 1.0e-9*num_repeats*bytes/elapsed;
+        if (trial_rate > *rate) { *rate = trial_rate; }
+    }
+
+#undef COMPOSITE_INPUT
+
+    free(buffer);
+}
+
+/* Reads a baseline file of "name value" lines.  Lines starting with # are
+   comments.  Returns false if the file cannot be opened. */
+static IceTBoolean read_baseline(IceTInt *size,
+                                 IceTInt *num_proc,
+                                 IceTDouble *baseline)
+{
+    FILE *fd;
+    char line[256];
+    IceTInt kernel;
+
+    fd = fopen(g_baseline_filename, "r");
+    if (fd == NULL) { return ICET_FALSE; }
+
+    *size = 0;
+    *num_proc = 0;
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++) {
+        baseline[kernel] = 0.0;
+    }
+
+    while (fgets(line, sizeof(line), fd) != NULL) {
+        char name[64];
+        double value;
+        if (   (line[0] == '#')
+            || (sscanf(line, "%63s %lf", name, &value) != 2) ) {
+            continue;
+        }
+        if (strcmp(name, "size") == 0) {
+            *size = (IceTInt)value;
+            continue;
+        }
+        if (strcmp(name, "processes") == 0) {
+            *num_proc = (IceTInt)value;
+            continue;
+        }
+        for (kernel = 0; kernel < NUM_KERNELS; kernel++) {
+            if (strcmp(name, g_kernel_names[kernel]) == 0) {
+                baseline[kernel] = value;
+            }
+        }
+    }
+
+    fclose(fd);
+    return ICET_TRUE;
+}
+
+static IceTBoolean write_baseline(const IceTDouble *rates)
+{
+    FILE *fd;
+    IceTInt num_proc;
+    IceTInt kernel;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    fd = fopen(g_baseline_filename, "w");
+    if (fd == NULL) {
+        printrank("Could not open %s for writing.\n", g_baseline_filename);
+        return ICET_FALSE;
+    }
+
+    fprintf(fd, "# IceT kernel throughput in GB of uncompressed image per"
+            " second.\n");
+    fprintf(fd, "# Run the test with -record to measure a new baseline.\n");
+    fprintf(fd, "size %d\n", (int)g_size);
+    fprintf(fd, "processes %d\n", (int)num_proc);
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++) {
+        fprintf(fd, "%s %g\n", g_kernel_names[kernel], rates[kernel]);
+    }
+
+    fclose(fd);
+    return ICET_TRUE;
+}
+
+/* Decides on the display process what to do with the baseline file and
+   tells the other processes. */
+static IceTInt check_baseline(IceTDouble *baseline)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt status;
+    IceTInt proc;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (rank != 0) {
+        icetCommRecv(&status, 1, ICET_INT, 0, BASELINE_TAG);
+        return status;
+    }
+
+    if (g_baseline_filename == NULL) {
+        printstat("Need a baseline file to compare against.\n");
+        status = BASELINE_UNUSABLE;
+    } else if (g_record) {
+        status = BASELINE_RECORD;
+    } else {
+        IceTInt baseline_size;
+        IceTInt baseline_num_proc;
+        if (!read_baseline(&baseline_size, &baseline_num_proc, baseline)) {
+            printstat("No baseline in %s.  Run with -record to measure one.\n",
+                      g_baseline_filename);
+            status = BASELINE_MISSING;
+        } else if (baseline_size != g_size) {
+            printstat("Baseline in %s was measured with size %d, not %d.\n",
+                      g_baseline_filename, (int)baseline_size, (int)g_size);
+            status = BASELINE_UNUSABLE;
+        } else if (baseline_num_proc != num_proc) {
+            printstat("Baseline in %s was measured with %d processes,"
+                      " not %d.\n",
+                      g_baseline_filename,
+                      (int)baseline_num_proc,
+                      (int)num_proc);
+            status = BASELINE_UNUSABLE;
+        } else {
+            status = BASELINE_COMPARE;
+        }
+    }
+
+    for (proc = 1; proc < num_proc; proc++) {
+        icetCommSend(&status, 1, ICET_INT, proc, BASELINE_TAG);
+    }
+    return status;
+}
+
+static int PerformanceRegressionRun(void)
+{
+    IceTInt rank;
+    IceTDouble rates[NUM_KERNELS];
+    IceTDouble baseline[NUM_KERNELS];
+    IceTInt status;
+    IceTInt kernel;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    status = check_baseline(baseline);
+    if (status == BASELINE_MISSING) {
+        g_skipped = ICET_TRUE;
+        return TEST_NOT_RUN;
+    }
+    if (status == BASELINE_UNUSABLE) {
+        return TEST_NOT_RUN;
+    }
+
+    /* The kernels are serial.  Other processes wait so that they do not
+       compete for the processor. */
+    if (rank == 0) {
+        measure_kernels(rates);
+    }
+    icetCommBarrier();
+    measure_strategy(&rates[KERNEL_SEQUENTIAL_RADIXK]);
+
+    if (rank != 0) {
+        return TEST_PASSED;
+    }
+
+    if (status == BASELINE_RECORD) {
+        printstat("Recording baseline in %s.\n", g_baseline_filename);
+        for (kernel = 0; kernel < NUM_KERNELS; kernel++) {
+            printstat("  %-18s %8.3f GB/s\n",
+                      g_kernel_names[kernel], rates[kernel]);
+        }
+        return write_baseline(rates) ? TEST_PASSED : TEST_NOT_RUN;
+    }
+
+    printstat("Kernel             Measured   Baseline   Ratio\n");
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++) {
+        const char *verdict = "";
+        if (baseline[kernel] <= 0.0) {
+            printstat("  %-18s has no baseline.\n", g_kernel_names[kernel]);
+            continue;
+        }
+        if (rates[kernel] < (1.0 - g_tolerance)*baseline[kernel]) {
+            verdict = "  REGRESSED";
+            result = TEST_FAILED;
+        } else if (rates[kernel] > (1.0 + g_tolerance)*baseline[kernel]) {
+            verdict = "  faster, consider a new baseline";
+        }
+        printstat("%-18s %8.3f   %8.3f   %5.2f%s\n",
+                  g_kernel_names[kernel],
+                  rates[kernel],
+                  baseline[kernel],
+                  rates[kernel]/baseline[kernel],
+                  verdict);
+    }
+
+    return result;
+}
+
+int PerformanceRegression(int argc, char *argv[])
+{
+    int result;
+
+    parse_arguments(argc, argv);
+
+    g_skipped = ICET_FALSE;
+    result = run_test(PerformanceRegressionRun);
+
+    return g_skipped ? PERFORMANCE_SKIP_RETURN_CODE : result;
+}
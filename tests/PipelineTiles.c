@@ -0,0 +1,230 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the ICET_PIPELINE_TILES option of the sequential strategy.  Each
+** process composites a random image onto several tiles with and without
+** the option.  The collection of tiles overlaps when it is enabled, but the
+** resulting images must be identical.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+static IceTVoid *g_colors;
+static IceTFloat *g_depths;
+
+static void SetUpTiles(IceTInt tiles_x, IceTInt tiles_y)
+{
+    IceTInt tile_index = 0;
+    IceTInt tile_x;
+    IceTInt tile_y;
+
+    icetResetTiles();
+    for (tile_y = 0; tile_y < tiles_y; tile_y++) {
+        for (tile_x = 0; tile_x < tiles_x; tile_x++) {
+            icetAddTile(tile_x*SCREEN_WIDTH,
+                        tile_y*SCREEN_HEIGHT,
+                        SCREEN_WIDTH,
+                        SCREEN_HEIGHT,
+                        tile_index);
+            tile_index++;
+        }
+    }
+}
+
+/* Fills the image with a random rectangle of patterned pixels surrounded by
+   inactive pixels. */
+static void MakeImage(void)
+{
+    IceTInt global_viewport[4];
+    IceTInt width, height;
+    IceTInt active_viewport[4];
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    width = global_viewport[2];
+    height = global_viewport[3];
+
+    active_viewport[0] = rand()%(width/2);
+    active_viewport[1] = rand()%(height/2);
+    active_viewport[2] = width/2 + rand()%(width/2) - active_viewport[0];
+    active_viewport[3] = height/2 + rand()%(height/2) - active_viewport[1];
+
+    make_test_image(width,
+                    height,
+                    active_viewport,
+                    g_background_color,
+                    &g_colors,
+                    &g_depths);
+}
+
+static void FreeImage(void)
+{
+    free(g_colors);
+    free(g_depths);
+}
+
+static IceTBoolean PipelineTilesTryComposite(void)
+{
+    IceTByte *serial_result;
+    IceTByte *pipelined_result;
+    IceTSizeType serial_bytes;
+    IceTSizeType pipelined_bytes;
+    IceTBoolean success = ICET_TRUE;
+
+    icetDisable(ICET_PIPELINE_TILES);
+    serial_result = composite_and_copy(g_colors,
+                                       g_depths,
+                                       NULL,
+                                       g_background_color,
+                                       &serial_bytes);
+
+    icetEnable(ICET_PIPELINE_TILES);
+    pipelined_result = composite_and_copy(g_colors,
+                                          g_depths,
+                                          NULL,
+                                          g_background_color,
+                                          &pipelined_bytes);
+    icetDisable(ICET_PIPELINE_TILES);
+
+    if (   (serial_bytes != pipelined_bytes)
+        || (   (serial_bytes > 0)
+            && (memcmp(serial_result, pipelined_result, serial_bytes) != 0))) {
+        IceTSizeType byte;
+        for (byte = 0; byte < serial_bytes; byte++) {
+            if (serial_result[byte] != pipelined_result[byte]) { break; }
+        }
+        printrank("***** Pipelined tiles differ from serial tiles *****\n");
+        printrank("Sizes %d and %d, first difference at byte %d\n",
+                  (int)serial_bytes, (int)pipelined_bytes, (int)byte);
+        success = ICET_FALSE;
+    }
+
+    free(serial_result);
+    free(pipelined_result);
+    return success;
+}
+
+static IceTBoolean PipelineTilesTryStrategies(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt si_index;
+
+    for (si_index = 0; si_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE; si_index++){
+        icetSingleImageStrategy(single_image_strategy_list[si_index]);
+        printstat("    Using %s single image strategy.\n",
+                  icetGetSingleImageStrategyName());
+        success &= PipelineTilesTryComposite();
+    }
+
+    return success;
+}
+
+static IceTBoolean PipelineTilesTryFormats(void)
+{
+    IceTBoolean success = ICET_TRUE;
+
+    printstat("  Z buffer with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= PipelineTilesTryStrategies();
+
+    printstat("  Z buffer keeping depth\n");
+    icetDisable(ICET_COMPOSITE_ONE_BUFFER);
+    success &= PipelineTilesTryStrategies();
+    icetEnable(ICET_COMPOSITE_ONE_BUFFER);
+    FreeImage();
+
+    printstat("  Z buffer with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    MakeImage();
+    success &= PipelineTilesTryStrategies();
+    FreeImage();
+
+    printstat("  Ordered blending with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= PipelineTilesTryStrategies();
+    FreeImage();
+
+    return success;
+}
+
+static int PipelineTilesRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (num_proc < 2) {
+        printstat("Need at least 2 processes to display multiple tiles.\n");
+        return TEST_NOT_RUN;
+    }
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+
+    printstat("\nUsing 2x1 tiles\n");
+    SetUpTiles(2, 1);
+    success &= PipelineTilesTryFormats();
+
+    if (num_proc >= 4) {
+        /* More tiles than the pipeline depth so that piece buffers are
+           reused while earlier tiles may still be in flight. */
+        IceTInt num_tiles = (num_proc < 6) ? num_proc : 6;
+        printstat("\nUsing %dx1 tiles\n", num_tiles);
+        SetUpTiles(num_tiles, 1);
+        success &= PipelineTilesTryFormats();
+    }
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int PipelineTiles(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(PipelineTilesRun);
+}
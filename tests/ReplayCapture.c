@@ -0,0 +1,591 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test replays frames written with icetCaptureFrames through
+** icetCompositeImage.  Given the -capture option, it replays the captured
+** frames of an application under any strategy and process count and reports
+** the compositing time.  When there are fewer processes than were captured,
+** each process merges the images of several captured processes.  When there
+** are more, the captured images are split among processes.  Without options,
+** it captures frames itself and checks that replaying them, at the same,
+** smaller and larger process counts, gives the same image.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevCommunication.h>
+#include <IceTDevContext.h>
+#include <IceTDevImage.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *g_capture_filename;
+static IceTInt g_num_captured;
+static IceTInt g_num_frames;
+static IceTInt g_num_repeats;
+static IceTEnum g_strategy;
+static IceTEnum g_single_image_strategy;
+
+static void usage(char *argv[])
+{
+    printstat("\nUSAGE: %s [testargs]\n", argv[0]);
+    printstat("\nWhere  testargs are:\n");
+    printstat("  -capture <file> Replay the frames captured to <file>.  As with\n"
+              "                icetCaptureFrames, %%d is replaced with the rank.\n");
+    printstat("  -captured-processes <num> Number of processes captured.  Read\n"
+              "                from the capture by default.\n");
+    printstat("  -frames <num> Number of captured frames to replay (default 1).\n");
+    printstat("  -repeat <num> Times to composite each frame (default 1).\n");
+    printstat("  -reduce       Use the reduce strategy (default).\n");
+    printstat("  -vtree        Use the virtual trees strategy.\n");
+    printstat("  -hybrid       Use the hybrid strategy.\n");
+    printstat("  -sequential   Use the sequential strategy.\n");
+    printstat("  -bswap        Use the binary-swap single-image strategy.\n");
+    printstat("  -bswapfold    Use the binary-swap with folding single-image strategy.\n");
+    printstat("  -radixk       Use the radix-k single-image strategy.\n");
+    printstat("  -radixkr      Use the radix-kr single-image strategy.\n");
+    printstat("  -tree         Use the tree single-image strategy.\n");
+    printstat("  -h, -help     Print this help message.\n");
+    printstat("\nFor general testing options, try -h or -help before test name.\n");
+}
+
+static void parse_arguments(int argc, char *argv[])
+{
+    int arg;
+
+    g_capture_filename = NULL;
+    g_num_captured = 0;
+    g_num_frames = 1;
+    g_num_repeats = 1;
+    g_strategy = ICET_STRATEGY_REDUCE;
+    g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-capture") == 0) {
+            arg++;
+            g_capture_filename = argv[arg];
+        } else if (strcmp(argv[arg], "-captured-processes") == 0) {
+            arg++;
+            g_num_captured = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-frames") == 0) {
+            arg++;
+            g_num_frames = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-repeat") == 0) {
+            arg++;
+            g_num_repeats = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-reduce") == 0) {
+            g_strategy = ICET_STRATEGY_REDUCE;
+        } else if (strcmp(argv[arg], "-vtree") == 0) {
+            g_strategy = ICET_STRATEGY_VTREE;
+        } else if (strcmp(argv[arg], "-hybrid") == 0) {
+            g_strategy = ICET_STRATEGY_HYBRID;
+        } else if (strcmp(argv[arg], "-sequential") == 0) {
+            g_strategy = ICET_STRATEGY_SEQUENTIAL;
+        } else if (strcmp(argv[arg], "-bswap") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP;
+        } else if (strcmp(argv[arg], "-bswapfold") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP_FOLDING;
+        } else if (strcmp(argv[arg], "-radixk") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXK;
+        } else if (strcmp(argv[arg], "-radixkr") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXKR;
+        } else if (strcmp(argv[arg], "-tree") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_TREE;
+        } else if (   (strcmp(argv[arg], "-h") == 0)
+                   || (strcmp(argv[arg], "-help") == 0) ) {
+            usage(argv);
+            exit(0);
+        } else {
+            printstat("Unknown option `%s'.\n", argv[arg]);
+            usage(argv);
+            exit(1);
+        }
+    }
+}
+
+static void ReplayFileName(const char *pattern, IceTInt rank, char *filename)
+{
+    const char *rank_marker = strstr(pattern, "%d");
+
+    if (rank_marker != NULL) {
+        size_t prefix_length = (size_t)(rank_marker - pattern);
+        memcpy(filename, pattern, prefix_length);
+        sprintf(filename + prefix_length, "%d%s", (int)rank, rank_marker + 2);
+    } else {
+        strcpy(filename, pattern);
+    }
+}
+
+static IceTInt ReplayNumCaptured(const char *pattern)
+{
+    char *filename = malloc(strlen(pattern) + 16);
+    IceTInt info[ICET_CAPTURE_INFO_SIZE];
+
+    ReplayFileName(pattern, 0, filename);
+    info[ICET_CAPTURE_INFO_NUM_PROCESSES] = 0;
+    icetLoadCapturedFrame(filename, 0, NULL, NULL, NULL, NULL, info);
+    free(filename);
+
+    return info[ICET_CAPTURE_INFO_NUM_PROCESSES];
+}
+
+/* Builds the input image of this process for a captured frame.  With fewer
+   processes than were captured, each process takes a contiguous block of
+   captured processes and composites their images.  With more processes, each
+   captured image is shared by several processes that each take a horizontal
+   stripe of its valid pixels.  Returns the position of the image in the
+   composite order, or -1 if the frame was not ordered. */
+static IceTInt ReplayLoadFrame(const char *pattern,
+                               IceTInt num_captured,
+                               IceTInt frame,
+                               IceTVoid **image_buffer,
+                               IceTImage *image,
+                               IceTInt *valid_pixels_viewport,
+                               IceTDouble *projection_matrix,
+                               IceTDouble *modelview_matrix,
+                               IceTFloat *background_color)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt first_captured;
+    IceTInt end_captured;
+    IceTInt captured;
+    IceTInt order = -1;
+    char *filename;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    filename = malloc(strlen(pattern) + 16);
+
+    if (num_proc <= num_captured) {
+        first_captured = (rank*num_captured)/num_proc;
+        end_captured = ((rank + 1)*num_captured)/num_proc;
+    } else {
+        first_captured = rank%num_captured;
+        end_captured = first_captured + 1;
+    }
+
+    *image_buffer = NULL;
+    for (captured = first_captured; captured < end_captured; captured++) {
+        IceTInt info[ICET_CAPTURE_INFO_SIZE];
+        IceTInt captured_viewport[4];
+        IceTImage captured_image;
+
+        ReplayFileName(pattern, captured, filename);
+        captured_image = icetLoadCapturedFrame(filename,
+                                               frame,
+                                               captured_viewport,
+                                               projection_matrix,
+                                               modelview_matrix,
+                                               background_color,
+                                               info);
+        if (icetImageIsNull(captured_image)) { continue; }
+
+        if (*image_buffer == NULL) {
+            IceTSizeType width = icetImageGetWidth(captured_image);
+            IceTSizeType height = icetImageGetHeight(captured_image);
+            *image_buffer = malloc(icetImageBufferSize(width, height));
+            *image = icetImageAssignBuffer(*image_buffer, width, height);
+            icetImageCopyPixels(captured_image, 0,
+                                *image, 0,
+                                icetImageGetNumPixels(captured_image));
+            memcpy(valid_pixels_viewport, captured_viewport,
+                   4*sizeof(IceTInt));
+            order = info[ICET_CAPTURE_INFO_ORDER];
+        } else {
+            IceTInt x_max, y_max;
+            /* Earlier images in the composite order go on top.  When the
+               frame is not ordered, lower ranks are treated as earlier. */
+            icetComposite(*image,
+                          captured_image,
+                          info[ICET_CAPTURE_INFO_ORDER] < order);
+            if (info[ICET_CAPTURE_INFO_ORDER] < order) {
+                order = info[ICET_CAPTURE_INFO_ORDER];
+            }
+            x_max = valid_pixels_viewport[0] + valid_pixels_viewport[2];
+            if (captured_viewport[0] + captured_viewport[2] > x_max) {
+                x_max = captured_viewport[0] + captured_viewport[2];
+            }
+            y_max = valid_pixels_viewport[1] + valid_pixels_viewport[3];
+            if (captured_viewport[1] + captured_viewport[3] > y_max) {
+                y_max = captured_viewport[1] + captured_viewport[3];
+            }
+            if (captured_viewport[0] < valid_pixels_viewport[0]) {
+                valid_pixels_viewport[0] = captured_viewport[0];
+            }
+            if (captured_viewport[1] < valid_pixels_viewport[1]) {
+                valid_pixels_viewport[1] = captured_viewport[1];
+            }
+            valid_pixels_viewport[2] = x_max - valid_pixels_viewport[0];
+            valid_pixels_viewport[3] = y_max - valid_pixels_viewport[1];
+        }
+    }
+
+    if (num_proc > num_captured) {
+        IceTInt num_pieces = num_proc/num_captured
+            + ((rank%num_captured < num_proc%num_captured) ? 1 : 0);
+        IceTInt piece = rank/num_captured;
+        IceTInt bottom = valid_pixels_viewport[1]
+            + (piece*valid_pixels_viewport[3])/num_pieces;
+        IceTInt top = valid_pixels_viewport[1]
+            + ((piece + 1)*valid_pixels_viewport[3])/num_pieces;
+        valid_pixels_viewport[1] = bottom;
+        valid_pixels_viewport[3] = top - bottom;
+    }
+
+    free(filename);
+    return order;
+}
+
+/* Composites a captured frame.  The returned image is only valid until the
+   next frame is composited. */
+static IceTImage ReplayCompositeFrame(const char *pattern,
+                                      IceTInt num_captured,
+                                      IceTInt frame,
+                                      IceTDouble *composite_time)
+{
+    IceTVoid *image_buffer;
+    IceTImage input_image;
+    IceTInt valid_pixels_viewport[4];
+    IceTDouble projection_matrix[16];
+    IceTDouble modelview_matrix[16];
+    IceTFloat background_color[4];
+    IceTInt order;
+    IceTInt *all_orders;
+    IceTInt num_proc;
+    IceTImage result;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    order = ReplayLoadFrame(pattern,
+                            num_captured,
+                            frame,
+                            &image_buffer,
+                            &input_image,
+                            valid_pixels_viewport,
+                            projection_matrix,
+                            modelview_matrix,
+                            background_color);
+    if (image_buffer == NULL) {
+        printrank("Could not load captured frame %d\n", (int)frame);
+        *composite_time = -1.0;
+        return icetImageNull();
+    }
+
+    /* Keep the captured order.  Each process is ordered by the first image
+       it holds, with stripes of the same image ordered by rank. */
+    all_orders = malloc(num_proc*sizeof(IceTInt));
+    icetCommAllgather(&order, 1, ICET_INT, all_orders);
+    if (all_orders[0] >= 0) {
+        IceTInt *process_ranks = malloc(num_proc*sizeof(IceTInt));
+        IceTInt position = 0;
+        IceTInt captured_order;
+        IceTInt proc;
+        for (captured_order = 0;
+             captured_order < num_captured;
+             captured_order++) {
+            for (proc = 0; proc < num_proc; proc++) {
+                if (all_orders[proc] == captured_order) {
+                    process_ranks[position++] = proc;
+                }
+            }
+        }
+        icetEnable(ICET_ORDERED_COMPOSITE);
+        icetCompositeOrder(process_ranks);
+        free(process_ranks);
+    } else {
+        icetDisable(ICET_ORDERED_COMPOSITE);
+    }
+    free(all_orders);
+
+    result = icetCompositeImage(
+                       (icetImageGetColorFormat(input_image)
+                        != ICET_IMAGE_COLOR_NONE)
+                           ? icetImageGetColorConstVoid(input_image, NULL)
+                           : NULL,
+                       (icetImageGetDepthFormat(input_image)
+                        != ICET_IMAGE_DEPTH_NONE)
+                           ? icetImageGetDepthConstVoid(input_image, NULL)
+                           : NULL,
+                       valid_pixels_viewport,
+                       projection_matrix,
+                       modelview_matrix,
+                       background_color);
+    icetGetDoublev(ICET_COMPOSITE_TIME, composite_time);
+
+    free(image_buffer);
+    return result;
+}
+
+static int ReplayCaptureReplay(void)
+{
+    IceTInt num_captured;
+    IceTInt frame;
+    IceTInt repeat;
+
+    num_captured = g_num_captured;
+    if (num_captured < 1) {
+        num_captured = ReplayNumCaptured(g_capture_filename);
+        if (num_captured < 1) {
+            printstat("Could not read capture %s\n", g_capture_filename);
+            return TEST_NOT_RUN;
+        }
+    }
+
+    icetStrategy(g_strategy);
+    icetSingleImageStrategy(g_single_image_strategy);
+    printstat("Replaying %d captured processes with strategy %s, single image"
+              " strategy %s\n",
+              (int)num_captured,
+              icetGetStrategyName(),
+              icetGetSingleImageStrategyName());
+
+    for (frame = 0; frame < g_num_frames; frame++) {
+        for (repeat = 0; repeat < g_num_repeats; repeat++) {
+            IceTDouble composite_time;
+            ReplayCompositeFrame(g_capture_filename,
+                                 num_captured,
+                                 frame,
+                                 &composite_time);
+            if (composite_time < 0.0) { return TEST_FAILED; }
+            printstat("Frame %d repeat %d: composite time %lg\n",
+                      (int)frame, (int)repeat, composite_time);
+        }
+    }
+
+    return TEST_PASSED;
+}
+
+#define CAPTURE_FILE_NAME       "ReplayCapture_%d.icap"
+#define REPLAY_NUM_FRAMES       2
+
+static void ReplayCaptureDraw(const IceTDouble *projection_matrix,
+                              const IceTDouble *modelview_matrix,
+                              const IceTFloat *background_color,
+                              const IceTInt *readback_viewport,
+                              IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType left;
+    IceTSizeType x, y;
+    IceTInt rank;
+    IceTInt num_proc;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+
+    /* Each process covers an overlapping band.  Depths are distinct among
+       processes so that the composited image does not depend on order. */
+    left = (rank*width)/(2*num_proc);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTUByte *pixel = color_buffer + 4*(y*width + x);
+            if ((x >= left) && (x < left + width/2)) {
+                pixel[0] = (IceTUByte)(rank & 0xFF);
+                pixel[1] = (IceTUByte)(x & 0xFF);
+                pixel[2] = (IceTUByte)(y & 0xFF);
+                pixel[3] = 255;
+                depth_buffer[y*width + x]
+                    = (  (IceTFloat)(((x + y + 3*rank)%11)*num_proc + rank)
+                       + 1.0f)
+                    / (IceTFloat)(11*num_proc + 2);
+            } else {
+                pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                depth_buffer[y*width + x] = 1.0f;
+            }
+        }
+    }
+}
+
+/* Draws and captures frames with the current context.  Returns a copy of the
+   colors of the last composited image on rank 0 and NULL elsewhere. */
+static IceTUByte *ReplayCaptureMakeCapture(const char *pattern)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTImage image = icetImageNull();
+    IceTUByte *reference_colors = NULL;
+    IceTInt rank;
+    IceTInt frame;
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDrawCallback(ReplayCaptureDraw);
+    icetStrategy(ICET_STRATEGY_REDUCE);
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    icetCaptureFrames(pattern, ICET_CAPTURE_SPARSE);
+    for (frame = 0; frame < REPLAY_NUM_FRAMES; frame++) {
+        image = icetDrawFrame(identity, identity, black);
+    }
+    icetCaptureFrames(NULL, ICET_CAPTURE_SPARSE);
+
+    if (rank == 0) {
+        reference_colors = malloc(4*SCREEN_WIDTH*SCREEN_HEIGHT);
+        memcpy(reference_colors,
+               icetImageGetColorcub(image),
+               4*SCREEN_WIDTH*SCREEN_HEIGHT);
+    }
+
+    return reference_colors;
+}
+
+static int ReplayCaptureCheck(const char *pattern,
+                              IceTInt num_captured,
+                              const IceTUByte *reference_colors)
+{
+    IceTInt rank;
+    IceTImage image;
+    IceTDouble composite_time;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    image = ReplayCompositeFrame(pattern,
+                                 num_captured,
+                                 REPLAY_NUM_FRAMES - 1,
+                                 &composite_time);
+    if (composite_time < 0.0) { return TEST_FAILED; }
+
+    if (rank == 0) {
+        const IceTUByte *colors = icetImageGetColorcub(image);
+        IceTSizeType i;
+        for (i = 0; i < 4*SCREEN_WIDTH*SCREEN_HEIGHT; i++) {
+            if (colors[i] != reference_colors[i]) {
+                printrank("**** Replayed image differs at pixel %d ****\n",
+                          (int)(i/4));
+                result = TEST_FAILED;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+static IceTCommunicator ReplayCaptureSubset(IceTInt size)
+{
+    IceTCommunicator comm = icetGetCommunicator();
+    IceTInt32 *ranks = malloc(size*sizeof(IceTInt32));
+    IceTCommunicator subset;
+    IceTInt i;
+
+    for (i = 0; i < size; i++) { ranks[i] = i; }
+    subset = comm->Subset(comm, size, ranks);
+    free(ranks);
+
+    return subset;
+}
+
+static int ReplayCaptureTest(void)
+{
+    IceTContext original_context = icetGetContext();
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt half;
+    IceTUByte *reference_colors;
+    IceTCommunicator subset_comm;
+    int strategy_idx;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    half = (num_proc + 1)/2;
+
+    printstat("Capturing %d frames on %d processes.\n",
+              REPLAY_NUM_FRAMES, (int)num_proc);
+    reference_colors = ReplayCaptureMakeCapture(CAPTURE_FILE_NAME);
+
+    for (strategy_idx = 0; strategy_idx < STRATEGY_LIST_SIZE; strategy_idx++) {
+        icetStrategy(strategy_list[strategy_idx]);
+        printstat("Replaying on %d processes with strategy %s.\n",
+                  (int)num_proc, icetGetStrategyName());
+        result += ReplayCaptureCheck(CAPTURE_FILE_NAME,
+                                     num_proc,
+                                     reference_colors);
+    }
+
+    /* Merge captured images on fewer processes. */
+    subset_comm = ReplayCaptureSubset(half);
+    if (rank < half) {
+        IceTContext subset_context = icetCreateContext(subset_comm);
+        printrank("Replaying on %d processes.\n", (int)half);
+        icetStrategy(ICET_STRATEGY_REDUCE);
+        result += ReplayCaptureCheck(CAPTURE_FILE_NAME,
+                                     num_proc,
+                                     reference_colors);
+        icetSetContext(original_context);
+        icetDestroyContext(subset_context);
+        subset_comm->Destroy(subset_comm);
+    }
+    icetCommBarrier();
+    if (reference_colors != NULL) { free(reference_colors); }
+
+    /* Split images captured on fewer processes. */
+    subset_comm = ReplayCaptureSubset(half);
+    reference_colors = NULL;
+    if (rank < half) {
+        IceTContext subset_context = icetCreateContext(subset_comm);
+        printrank("Capturing on %d processes.\n", (int)half);
+        reference_colors
+            = ReplayCaptureMakeCapture("ReplayCaptureHalf_%d.icap");
+        icetSetContext(original_context);
+        icetDestroyContext(subset_context);
+        subset_comm->Destroy(subset_comm);
+    }
+    icetCommBarrier();
+    printstat("Replaying on %d processes.\n", (int)num_proc);
+    result += ReplayCaptureCheck("ReplayCaptureHalf_%d.icap",
+                                 half,
+                                 reference_colors);
+    if (reference_colors != NULL) { free(reference_colors); }
+
+    return result;
+}
+
+static int ReplayCaptureRun(void)
+{
+    if (g_capture_filename != NULL) {
+        return ReplayCaptureReplay();
+    } else {
+        return ReplayCaptureTest();
+    }
+}
+
+int ReplayCapture(int argc, char *argv[])
+{
+    parse_arguments(argc, argv);
+
+    return run_test(ReplayCaptureRun);
+}
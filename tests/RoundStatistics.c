@@ -0,0 +1,315 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests icetGetRoundStatistics and icetGetRoundPartnerStatistics.  It
+** composites an image with each single image strategy and checks that the
+** per-round and per-partner statistics are consistent.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevCommunication.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+static void RoundStatisticsDraw(const IceTDouble *projection_matrix,
+                                const IceTDouble *modelview_matrix,
+                                const IceTFloat *background_color,
+                                const IceTInt *readback_viewport,
+                                IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType num_pixels;
+    IceTSizeType i;
+    IceTInt rank;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    num_pixels = icetImageGetNumPixels(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+    for (i = 0; i < num_pixels; i++) {
+        color_buffer[4*i + 0] = (IceTUByte)(rank & 0xFF);
+        color_buffer[4*i + 1] = 0;
+        color_buffer[4*i + 2] = 0;
+        color_buffer[4*i + 3] = 255;
+        depth_buffer[i] = ((i + rank)%3 == 0) ? 1.0f : 0.5f;
+    }
+}
+
+static int RoundStatisticsCheckSummaries(void)
+{
+    IceTDouble *local;
+    IceTDouble *minimum;
+    IceTDouble *maximum;
+    IceTDouble *mean;
+    IceTInt num_local_rounds;
+    IceTInt num_rounds;
+    IceTInt i;
+    int result = TEST_PASSED;
+
+    num_local_rounds = icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, NULL);
+    num_rounds = icetGetRoundStatistics(ICET_ROUND_SUMMARY_MAX, NULL);
+    if (num_rounds < num_local_rounds) {
+        printrank("**** Summary has fewer rounds than this process ****\n");
+        return TEST_FAILED;
+    }
+
+    local = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    minimum = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    maximum = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    mean = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, local);
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_MIN, minimum);
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_MAX, maximum);
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_MEAN, mean);
+
+    for (i = 0; i < num_rounds*ICET_ROUND_STATISTICS_SIZE; i++) {
+        if ((minimum[i] > mean[i]) || (mean[i] > maximum[i])) {
+            printrank("**** Round %d statistic %d has min %g, mean %g,"
+                      " max %g ****\n",
+                      (int)(i/ICET_ROUND_STATISTICS_SIZE),
+                      (int)(i%ICET_ROUND_STATISTICS_SIZE),
+                      minimum[i], mean[i], maximum[i]);
+            result = TEST_FAILED;
+        }
+        if (   (i < num_local_rounds*ICET_ROUND_STATISTICS_SIZE)
+            && ((local[i] < minimum[i]) || (local[i] > maximum[i])) ) {
+            printrank("**** Local statistic outside of global range ****\n");
+            result = TEST_FAILED;
+        }
+    }
+
+    free(local);
+    free(minimum);
+    free(maximum);
+    free(mean);
+    return result;
+}
+
+static int RoundStatisticsCheckTotals(void)
+{
+    IceTDouble *local;
+    IceTDouble totals[2];
+    IceTDouble *all_totals;
+    IceTDouble global_sent;
+    IceTDouble global_received;
+    IceTInt num_rounds;
+    IceTInt num_proc;
+    IceTInt bytes_sent;
+    IceTInt i;
+    int result = TEST_PASSED;
+
+    num_rounds = icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, NULL);
+    local = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, local);
+
+    totals[0] = totals[1] = 0.0;
+    for (i = 0; i < num_rounds; i++) {
+        const IceTDouble *round = local + i*ICET_ROUND_STATISTICS_SIZE;
+        if (round[ICET_ROUND_K] < 1) {
+            printrank("**** Round %d has k = %g ****\n",
+                      (int)i, round[ICET_ROUND_K]);
+            result = TEST_FAILED;
+        }
+        totals[0] += round[ICET_ROUND_BYTES_SENT];
+        totals[1] += round[ICET_ROUND_BYTES_RECEIVED];
+    }
+    free(local);
+
+    /* Bytes sent in rounds are a subset of all bytes sent. */
+    icetGetIntegerv(ICET_BYTES_SENT, &bytes_sent);
+    if (totals[0] > bytes_sent) {
+        printrank("**** Rounds sent %g bytes, but only %d were sent ****\n",
+                  totals[0], (int)bytes_sent);
+        result = TEST_FAILED;
+    }
+
+    /* Every image sent in a round is received in a round. */
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    all_totals = malloc(2*num_proc*sizeof(IceTDouble));
+    icetCommAllgather(totals, 2, ICET_DOUBLE, all_totals);
+    global_sent = global_received = 0.0;
+    for (i = 0; i < num_proc; i++) {
+        global_sent += all_totals[2*i];
+        global_received += all_totals[2*i + 1];
+    }
+    free(all_totals);
+
+    if (global_sent != global_received) {
+        printrank("**** %g bytes sent in rounds, but %g received ****\n",
+                  global_sent, global_received);
+        result = TEST_FAILED;
+    }
+    if ((num_proc > 1) && (global_sent <= 0.0)) {
+        printrank("**** No data recorded in rounds ****\n");
+        result = TEST_FAILED;
+    }
+
+    return result;
+}
+
+static int RoundStatisticsCheckPartners(void)
+{
+    IceTDouble *rounds;
+    IceTDouble *partners;
+    IceTDouble *round_totals;
+    IceTDouble *local_matrix;
+    IceTDouble *all_matrices;
+    IceTInt num_rounds;
+    IceTInt num_partners;
+    IceTInt num_proc;
+    IceTInt rank;
+    IceTInt i;
+    IceTInt from, to;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetIntegerv(ICET_RANK, &rank);
+
+    num_rounds = icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, NULL);
+    rounds = malloc(num_rounds*ICET_ROUND_STATISTICS_SIZE*sizeof(IceTDouble));
+    icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL, rounds);
+
+    num_partners = icetGetRoundPartnerStatistics(NULL);
+    partners = malloc(  num_partners*ICET_ROUND_PARTNER_STATISTICS_SIZE
+                      * sizeof(IceTDouble));
+    icetGetRoundPartnerStatistics(partners);
+    if ((num_rounds > 0) && (num_partners < 1)) {
+        printrank("**** %d rounds but no partners recorded ****\n",
+                  (int)num_rounds);
+        result = TEST_FAILED;
+    }
+
+    /* The partner entries of each round add up to the round totals.  The
+       matrix holds the bytes sent from the row process to the column
+       process as seen by the sender (first half) and the receiver (second
+       half). */
+    round_totals = calloc(2*num_rounds + 2, sizeof(IceTDouble));
+    local_matrix = calloc(2*num_proc*num_proc, sizeof(IceTDouble));
+    for (i = 0; i < num_partners; i++) {
+        const IceTDouble *entry
+            = partners + i*ICET_ROUND_PARTNER_STATISTICS_SIZE;
+        IceTInt round = (IceTInt)entry[ICET_ROUND_PARTNER_ROUND];
+        IceTInt partner = (IceTInt)entry[ICET_ROUND_PARTNER_RANK];
+        if (   (round < 0) || (round >= num_rounds)
+            || (partner < 0) || (partner >= num_proc)
+            || (partner == rank) ) {
+            printrank("**** Bad partner entry: round %d, rank %d ****\n",
+                      (int)round, (int)partner);
+            result = TEST_FAILED;
+            continue;
+        }
+        round_totals[2*round] += entry[ICET_ROUND_PARTNER_BYTES_SENT];
+        round_totals[2*round + 1] += entry[ICET_ROUND_PARTNER_BYTES_RECEIVED];
+        local_matrix[rank*num_proc + partner]
+            += entry[ICET_ROUND_PARTNER_BYTES_SENT];
+        local_matrix[num_proc*num_proc + partner*num_proc + rank]
+            += entry[ICET_ROUND_PARTNER_BYTES_RECEIVED];
+    }
+    for (i = 0; i < num_rounds; i++) {
+        const IceTDouble *round = rounds + i*ICET_ROUND_STATISTICS_SIZE;
+        if (   (round_totals[2*i] != round[ICET_ROUND_BYTES_SENT])
+            || (round_totals[2*i + 1] != round[ICET_ROUND_BYTES_RECEIVED]) ) {
+            printrank("**** Partners of round %d sent %g and received %g,"
+                      " but round sent %g and received %g ****\n",
+                      (int)i, round_totals[2*i], round_totals[2*i + 1],
+                      round[ICET_ROUND_BYTES_SENT],
+                      round[ICET_ROUND_BYTES_RECEIVED]);
+            result = TEST_FAILED;
+        }
+    }
+
+    /* Whatever one process sent to a partner, that partner received. */
+    all_matrices = malloc(num_proc*2*num_proc*num_proc*sizeof(IceTDouble));
+    icetCommAllgather(local_matrix,
+                      2*num_proc*num_proc,
+                      ICET_DOUBLE,
+                      all_matrices);
+    for (from = 0; from < num_proc; from++) {
+        for (to = 0; to < num_proc; to++) {
+            IceTDouble sent = 0.0;
+            IceTDouble received = 0.0;
+            for (i = 0; i < num_proc; i++) {
+                const IceTDouble *matrix = all_matrices + i*2*num_proc*num_proc;
+                sent += matrix[from*num_proc + to];
+                received += matrix[num_proc*num_proc + from*num_proc + to];
+            }
+            if (sent != received) {
+                printrank("**** %d sent %g bytes to %d, which received %g"
+                          " ****\n",
+                          (int)from, sent, (int)to, received);
+                result = TEST_FAILED;
+            }
+        }
+    }
+
+    free(rounds);
+    free(partners);
+    free(round_totals);
+    free(local_matrix);
+    free(all_matrices);
+    return result;
+}
+
+static int RoundStatisticsRun(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    int result = TEST_PASSED;
+    int si_strategy_idx;
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDrawCallback(RoundStatisticsDraw);
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    for (si_strategy_idx = 0;
+         si_strategy_idx < SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+         si_strategy_idx++) {
+        icetSingleImageStrategy(single_image_strategy_list[si_strategy_idx]);
+        printstat("Trying single image strategy %s\n",
+                  icetGetSingleImageStrategyName());
+
+        icetDrawFrame(identity, identity, black);
+
+        result += RoundStatisticsCheckTotals();
+        result += RoundStatisticsCheckSummaries();
+        result += RoundStatisticsCheckPartners();
+    }
+
+    return result;
+}
+
+int RoundStatistics(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(RoundStatisticsRun);
+}
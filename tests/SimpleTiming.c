@@ -141,6 +141,7 @@ static void usage(char *argv[])
     printstat("  -write-image  Write an image on the first frame.\n");
     printstat("  -reduce       Use the reduce strategy (default).\n");
     printstat("  -vtree        Use the virtual trees strategy.\n");
+    printstat("  -hybrid       Use the hybrid strategy.\n");
     printstat("  -sequential   Use the sequential strategy.\n");
     printstat("  -bswap        Use the binary-swap single-image strategy.\n");
     printstat("  -bswapfold    Use the binary-swap with folding single-image strategy.\n");
@@ -230,6 +231,8 @@ static void parse_arguments(int argc, char *argv[])
             g_strategy = ICET_STRATEGY_REDUCE;
         } else if (strcmp(argv[arg], "-vtree") == 0) {
             g_strategy = ICET_STRATEGY_VTREE;
+        } else if (strcmp(argv[arg], "-hybrid") == 0) {
+            g_strategy = ICET_STRATEGY_HYBRID;
         } else if (strcmp(argv[arg], "-sequential") == 0) {
             g_strategy = ICET_STRATEGY_SEQUENTIAL;
         } else if (strcmp(argv[arg], "-bswap") == 0) {
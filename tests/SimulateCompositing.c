@@ -0,0 +1,1626 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This test predicts the compositing time of a large machine by running many
+** virtual IceT processes inside a single process.  Each virtual process is a
+** coroutine with its own IceT context whose communicator passes messages in
+** memory.  The real compositing code runs, but rather than measure elapsed
+** time, each virtual process keeps a clock that is advanced by a LogGP style
+** model of the network for every message and by the (optionally scaled) time
+** spent computing between messages.
+*****************************************************************************/
+
+#include <IceTDevCommunication.h>
+#include <IceTDevDiagnostics.h>
+#include <IceTDevImage.h>
+#include <IceTDevPorting.h>
+#include <IceTDevState.h>
+#include <IceTDevTiming.h>
+#include "test_util.h"
+#include "test_codes.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#define SIM_STACK_SIZE                  (256*1024)
+
+#define SIM_REQUEST_MAGIC_NUMBER        ((IceTEnum)0x51C0B000)
+
+#define SIM_RANK_READY                  0
+#define SIM_RANK_BLOCKED                1
+#define SIM_RANK_DEFERRED               2
+#define SIM_RANK_DONE                   3
+
+#define SIM_REQUEST_SEND                0
+#define SIM_REQUEST_RECV                1
+
+#define SIM_BARRIER                     0
+#define SIM_GATHER                      1
+#define SIM_GATHERV                     2
+#define SIM_ALLGATHER                   3
+#define SIM_ALLTOALL                    4
+
+#define SIM_ROUND_K                     0
+#define SIM_ROUND_BYTES_SENT            1
+#define SIM_ROUND_COMM_TIME             2
+#define SIM_ROUND_COMPUTE_TIME          3
+#define SIM_ROUND_CRITICAL_PATH         4
+#define SIM_ROUND_FINISHED              5
+#define SIM_ROUND_SIZE                  6
+
+typedef struct SimMessageStruct {
+    IceTInt group;
+    IceTInt src;
+    IceTInt tag;
+    IceTSizeType size;
+    IceTDouble arrival;
+    IceTByte *data;
+    struct SimMessageStruct *next;
+} SimMessage;
+
+typedef struct SimRequestStruct {
+    IceTInt kind;
+    IceTBoolean complete;
+    IceTDouble time;
+    IceTVoid *buffer;
+    IceTSizeType size;
+    IceTInt group;
+    IceTInt src;
+    IceTInt tag;
+    struct SimRequestStruct *next;
+} SimRequest;
+
+typedef struct {
+    ucontext_t context;
+    IceTVoid *stack;
+    IceTContext icet_context;
+    IceTInt status;
+    IceTBoolean flushed;
+    IceTBoolean collective_done;
+    IceTDouble clock;
+    IceTDouble compute_start;
+    SimMessage *unexpected_head;
+    SimMessage *unexpected_tail;
+    SimRequest *posted_head;
+    SimRequest *posted_tail;
+    IceTInt valid_viewport[4];
+    IceTImage result;
+    IceTInt last_round;
+    IceTDouble round_comm[ICET_MAX_ROUNDS];
+    IceTDouble round_compute[ICET_MAX_ROUNDS];
+    IceTDouble round_end[ICET_MAX_ROUNDS];
+} SimRank;
+
+/* A group of virtual processes sharing a communicator.  Duplicates and
+   subsets are collective, so every process that makes its n-th derived
+   communicator from the same parent finds the same group. */
+typedef struct {
+    IceTInt parent;
+    IceTInt sequence;
+    IceTInt size;
+    IceTInt *members;
+    IceTInt num_arrived;
+    IceTDouble max_clock;
+    IceTInt kind;
+    IceTInt count;
+    IceTEnum datatype;
+    IceTInt root;
+    const int *recv_counts;
+    const int *recv_offsets;
+    const IceTVoid **send_buffers;
+    IceTVoid **recv_buffers;
+    IceTInt *send_counts;
+} SimGroup;
+
+typedef struct {
+    IceTInt group;
+    IceTInt rank;
+    IceTInt num_derived;
+} SimCommData;
+
+static IceTInt g_num_ranks;
+static IceTInt g_ranks_per_node;
+static IceTSizeType g_width;
+static IceTSizeType g_height;
+static IceTFloat g_active_fraction;
+static IceTInt g_num_frames;
+static IceTInt g_seed;
+static IceTDouble g_latency;
+static IceTDouble g_overhead;
+static IceTDouble g_gap;
+static IceTDouble g_bandwidth;
+static IceTDouble g_injection_bandwidth;
+static IceTDouble g_blend_rate;
+static IceTDouble g_compute_scale;
+static IceTEnum g_single_image_strategy;
+static IceTBoolean g_sweep_strategies;
+static IceTInt g_max_magic_k;
+
+static SimRank *g_ranks;
+static SimGroup *g_groups;
+static IceTInt g_num_groups;
+static IceTDouble *g_nic_free;
+static IceTInt *g_ready;
+static IceTInt g_ready_head;
+static IceTInt g_ready_count;
+static IceTInt *g_deferred;
+static IceTInt g_num_deferred;
+static IceTInt g_current;
+static ucontext_t g_main_context;
+
+static IceTUByte *g_color_buffer;
+static IceTFloat *g_depth_buffer;
+
+static void usage(char *argv[])
+{
+    printstat("\nUSAGE: %s [testargs]\n", argv[0]);
+    printstat("\nWhere  testargs are:\n");
+    printstat("  -ranks <num>  Number of virtual processes (default 48).\n");
+    printstat("  -ranks-per-node <num> Virtual processes sharing a network\n"
+              "                interface (default 1).\n");
+    printstat("  -width <num>  Width of the image (default 128).\n");
+    printstat("  -height <num> Height of the image (default 128).\n");
+    printstat("  -active <fraction> Fraction of the image each process covers\n"
+              "                (default 0.25).\n");
+    printstat("  -frames <num> Number of frames to simulate after a warm-up frame.\n"
+              "                The fastest is reported (default 3).\n");
+    printstat("  -seed <num>   Use the given number as the random seed.\n");
+    printstat("  -latency <seconds> Network latency L (default 2e-6).\n");
+    printstat("  -overhead <seconds> Processor time o to send or receive a\n"
+              "                message (default 5e-7).\n");
+    printstat("  -gap <seconds> Minimum time g between messages leaving a node\n"
+              "                (default 1e-7).\n");
+    printstat("  -bandwidth <bytes/second> Point to point bandwidth 1/G\n"
+              "                (default 1e10).\n");
+    printstat("  -injection-bandwidth <bytes/second> Bandwidth shared by all\n"
+              "                processes on a node (default 2.5e10).\n");
+    printstat("  -blend-rate <pixels/second> Blend rate of one core of the\n"
+              "                target machine.  Computation measured here is\n"
+              "                scaled by the ratio of the rate measured on this\n"
+              "                machine to this one.\n");
+    printstat("  -compute-scale <factor> Scale computation time directly\n"
+              "                (default 1).\n");
+    printstat("  -bswap        Use the binary-swap single-image strategy.\n");
+    printstat("  -bswapfold    Use the binary-swap with folding single-image strategy.\n");
+    printstat("  -radixk       Use the radix-k single-image strategy.\n");
+    printstat("  -radixkr      Use the radix-kr single-image strategy.\n");
+    printstat("  -tree         Use the tree single-image strategy.\n");
+    printstat("  -automatic    Use the automatic single-image strategy.\n");
+    printstat("  -magic-k-study <num> Repeat for multiple values of k, up to <num>,\n"
+              "                doubling each time.\n");
+    printstat("  -h, -help     Print this help message.\n");
+    printstat("\nWithout a single-image strategy option, every single-image\n"
+              "strategy is simulated.  Memory grows with the number of virtual\n"
+              "processes times the image size, so large process counts need\n"
+              "small images.\n");
+    printstat("\nFor general testing options, try -h or -help before test name.\n");
+}
+
+static void parse_arguments(int argc, char *argv[])
+{
+    int arg;
+
+    g_num_ranks = 48;
+    g_ranks_per_node = 1;
+    g_width = 128;
+    g_height = 128;
+    g_active_fraction = 0.25f;
+    g_num_frames = 3;
+    g_seed = (IceTInt)time(NULL);
+    g_latency = 2.0e-6;
+    g_overhead = 5.0e-7;
+    g_gap = 1.0e-7;
+    g_bandwidth = 1.0e10;
+    g_injection_bandwidth = 2.5e10;
+    g_blend_rate = 0.0;
+    g_compute_scale = 1.0;
+    g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC;
+    g_sweep_strategies = ICET_TRUE;
+    g_max_magic_k = 0;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-ranks") == 0) {
+            arg++;
+            g_num_ranks = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-ranks-per-node") == 0) {
+            arg++;
+            g_ranks_per_node = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-width") == 0) {
+            arg++;
+            g_width = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-height") == 0) {
+            arg++;
+            g_height = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-active") == 0) {
+            arg++;
+            g_active_fraction = (IceTFloat)atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-frames") == 0) {
+            arg++;
+            g_num_frames = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-seed") == 0) {
+            arg++;
+            g_seed = atoi(argv[arg]);
+        } else if (strcmp(argv[arg], "-latency") == 0) {
+            arg++;
+            g_latency = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-overhead") == 0) {
+            arg++;
+            g_overhead = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-gap") == 0) {
+            arg++;
+            g_gap = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-bandwidth") == 0) {
+            arg++;
+            g_bandwidth = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-injection-bandwidth") == 0) {
+            arg++;
+            g_injection_bandwidth = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-blend-rate") == 0) {
+            arg++;
+            g_blend_rate = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-compute-scale") == 0) {
+            arg++;
+            g_compute_scale = atof(argv[arg]);
+        } else if (strcmp(argv[arg], "-bswap") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-bswapfold") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_BSWAP_FOLDING;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-radixk") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXK;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-radixkr") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_RADIXKR;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-tree") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_TREE;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-automatic") == 0) {
+            g_single_image_strategy = ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC;
+            g_sweep_strategies = ICET_FALSE;
+        } else if (strcmp(argv[arg], "-magic-k-study") == 0) {
+            arg++;
+            g_max_magic_k = atoi(argv[arg]);
+        } else if (   (strcmp(argv[arg], "-h") == 0)
+                   || (strcmp(argv[arg], "-help") == 0) ) {
+            usage(argv);
+            exit(0);
+        } else {
+            printstat("Unknown option `%s'.\n", argv[arg]);
+            usage(argv);
+            exit(1);
+        }
+    }
+}
+
+/* A simple linear congruential generator so that every platform produces the
+   same layout for the same seed. */
+static IceTUInt g_random_state;
+
+static IceTFloat sim_random(void)
+{
+    g_random_state = g_random_state*1103515245u + 12345u;
+    return (IceTFloat)((g_random_state >> 8) & 0xFFFFFF)/(IceTFloat)0x1000000;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Scheduling of virtual processes.                                         */
+/* ------------------------------------------------------------------------ */
+
+static void SimMakeReady(IceTInt rank)
+{
+    g_ranks[rank].status = SIM_RANK_READY;
+    g_ready[(g_ready_head + g_ready_count)%g_num_ranks] = rank;
+    g_ready_count++;
+}
+
+static void SimWake(IceTInt rank)
+{
+    if (g_ranks[rank].status == SIM_RANK_BLOCKED) {
+        SimMakeReady(rank);
+    }
+}
+
+/* Suspends the current virtual process until the scheduler resumes it.  The
+   status must be set before calling. */
+static void SimYield(SimRank *rank)
+{
+    if (rank->status == SIM_RANK_DEFERRED) {
+        g_deferred[g_num_deferred++] = (IceTInt)(rank - g_ranks);
+    }
+    swapcontext(&rank->context, &g_main_context);
+}
+
+static void SimBlock(SimRank *rank)
+{
+    rank->status = SIM_RANK_BLOCKED;
+    SimYield(rank);
+}
+
+/* Computation is measured in processor time of this thread so that other
+   work on the machine does not show up as computation of some virtual
+   process.  The slowest of thousands of virtual processes would otherwise
+   almost always include an interruption. */
+static IceTDouble SimComputeTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + 1.0e-9*now.tv_nsec;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Accounting of virtual time.                                              */
+/* ------------------------------------------------------------------------ */
+
+static IceTInt SimGlobalRank(IceTCommunicator self, IceTInt rank)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    return g_groups[data->group].members[rank];
+}
+
+/* Called on entry to every communication.  Charges the computation done
+   since the last communication to the clock of the calling process.  The
+   computation is also charged to the round of the last communication, which
+   is where the received data gets blended. */
+static SimRank *SimEnter(IceTCommunicator self)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    SimRank *rank = &g_ranks[g_groups[data->group].members[data->rank]];
+    IceTDouble compute
+        = (SimComputeTime() - rank->compute_start)*g_compute_scale;
+
+    rank->clock += compute;
+    if (rank->last_round >= 0) {
+        rank->round_compute[rank->last_round] += compute;
+        rank->round_end[rank->last_round] = rank->clock;
+    }
+    return rank;
+}
+
+/* Called on exit of every communication.  The communication time is charged
+   to the round that the single image strategy marked active, if any. */
+static void SimLeave(SimRank *rank, IceTDouble entry_clock)
+{
+    IceTBoolean round_active;
+    IceTInt num_rounds;
+
+    icetGetBooleanv(ICET_ROUND_ACTIVE, &round_active);
+    icetGetIntegerv(ICET_NUM_ROUNDS, &num_rounds);
+    if (round_active && (num_rounds > 0) && (num_rounds <= ICET_MAX_ROUNDS)) {
+        rank->last_round = num_rounds - 1;
+        rank->round_comm[rank->last_round] += rank->clock - entry_clock;
+        rank->round_end[rank->last_round] = rank->clock;
+    } else {
+        rank->last_round = -1;
+    }
+
+    rank->compute_start = SimComputeTime();
+}
+
+/* ------------------------------------------------------------------------ */
+/* Point to point messages.                                                 */
+/* ------------------------------------------------------------------------ */
+
+static IceTCommRequest SimCreateRequest(IceTInt kind)
+{
+    IceTCommRequest request;
+    SimRequest *internals;
+
+    request = malloc(sizeof(struct IceTCommRequestStruct));
+    internals = malloc(sizeof(SimRequest));
+    internals->kind = kind;
+    internals->complete = ICET_FALSE;
+    internals->time = 0.0;
+    internals->buffer = NULL;
+    internals->size = 0;
+    internals->group = -1;
+    internals->src = -1;
+    internals->tag = -1;
+    internals->next = NULL;
+
+    request->magic_number = SIM_REQUEST_MAGIC_NUMBER;
+    request->internals = internals;
+
+    return request;
+}
+
+static void SimDestroyRequest(IceTCommRequest request)
+{
+    free(request->internals);
+    free(request);
+}
+
+static SimRequest *SimGetRequest(IceTCommRequest request)
+{
+    if (request->magic_number != SIM_REQUEST_MAGIC_NUMBER) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Request object is not from the simulated"
+                       " communicator.");
+        return NULL;
+    }
+    return (SimRequest *)request->internals;
+}
+
+static void SimMatch(SimRequest *request, SimMessage *message)
+{
+    IceTSizeType size = message->size;
+    if (size > request->size) {
+        icetRaiseError(ICET_INVALID_VALUE,
+                       "Simulated message of %d bytes truncated to %d.",
+                       (int)message->size, (int)request->size);
+        size = request->size;
+    }
+    memcpy(request->buffer, message->data, size);
+    request->time = message->arrival;
+    request->complete = ICET_TRUE;
+    free(message->data);
+    free(message);
+}
+
+/* Hands a message to the destination, either to a matching posted receive or
+   to its queue of unexpected messages. */
+static void SimDeliver(IceTInt dest, SimMessage *message)
+{
+    SimRank *rank = &g_ranks[dest];
+    SimRequest *previous = NULL;
+    SimRequest *request;
+
+    for (request = rank->posted_head;
+         request != NULL;
+         request = request->next) {
+        if (   (request->group == message->group)
+            && (request->src == message->src)
+            && (request->tag == message->tag) ) {
+            break;
+        }
+        previous = request;
+    }
+
+    if (request != NULL) {
+        if (previous != NULL) {
+            previous->next = request->next;
+        } else {
+            rank->posted_head = request->next;
+        }
+        if (rank->posted_tail == request) {
+            rank->posted_tail = previous;
+        }
+        request->next = NULL;
+        SimMatch(request, message);
+    } else {
+        message->next = NULL;
+        if (rank->unexpected_tail != NULL) {
+            rank->unexpected_tail->next = message;
+        } else {
+            rank->unexpected_head = message;
+        }
+        rank->unexpected_tail = message;
+    }
+
+    SimWake(dest);
+}
+
+/* Sends a message following the LogGP model.  The sender spends o, then the
+   message waits for the node's network interface, which is busy for the
+   larger of g and the message size over the injection bandwidth.  The message
+   arrives L plus the size over the point to point bandwidth after it starts.
+   Messages within a node skip the network interface.  Returns the time the
+   send buffer is free again. */
+static IceTDouble SimPostSend(IceTCommunicator self,
+                              SimRank *rank,
+                              const void *buf,
+                              IceTSizeType size,
+                              int dest,
+                              int tag)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    IceTInt global_dest = SimGlobalRank(self, dest);
+    IceTInt src_node = (IceTInt)(rank - g_ranks)/g_ranks_per_node;
+    IceTInt dest_node = global_dest/g_ranks_per_node;
+    SimMessage *message;
+    IceTDouble start;
+    IceTDouble injected;
+
+    rank->clock += g_overhead;
+    start = rank->clock;
+    injected = start;
+    if (src_node != dest_node) {
+        IceTDouble busy = size/g_injection_bandwidth;
+        if (busy < g_gap) { busy = g_gap; }
+        if (g_nic_free[src_node] > start) { start = g_nic_free[src_node]; }
+        injected = start + busy;
+        g_nic_free[src_node] = injected;
+    }
+
+    message = malloc(sizeof(SimMessage));
+    message->group = data->group;
+    message->src = data->rank;
+    message->tag = tag;
+    message->size = size;
+    message->arrival = start + g_latency + size/g_bandwidth;
+    if (message->arrival < injected + g_latency) {
+        message->arrival = injected + g_latency;
+    }
+    message->data = malloc(size > 0 ? size : 1);
+    memcpy(message->data, buf, size);
+    message->next = NULL;
+
+    SimDeliver(global_dest, message);
+
+    return injected;
+}
+
+static SimRequest *SimPostRecv(IceTCommunicator self,
+                               SimRank *rank,
+                               SimRequest *request,
+                               void *buf,
+                               IceTSizeType size,
+                               int src,
+                               int tag)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    SimMessage *previous = NULL;
+    SimMessage *message;
+
+    request->buffer = buf;
+    request->size = size;
+    request->group = data->group;
+    request->src = src;
+    request->tag = tag;
+
+    for (message = rank->unexpected_head;
+         message != NULL;
+         message = message->next) {
+        if (   (message->group == request->group)
+            && (message->src == src)
+            && (message->tag == tag) ) {
+            break;
+        }
+        previous = message;
+    }
+
+    if (message != NULL) {
+        if (previous != NULL) {
+            previous->next = message->next;
+        } else {
+            rank->unexpected_head = message->next;
+        }
+        if (rank->unexpected_tail == message) {
+            rank->unexpected_tail = previous;
+        }
+        SimMatch(request, message);
+    } else {
+        request->next = NULL;
+        if (rank->posted_tail != NULL) {
+            rank->posted_tail->next = request;
+        } else {
+            rank->posted_head = request;
+        }
+        rank->posted_tail = request;
+    }
+
+    return request;
+}
+
+/* Advances the clock of a process past a completed request. */
+static void SimFinishRequest(SimRank *rank, const SimRequest *request)
+{
+    if (rank->clock < request->time) { rank->clock = request->time; }
+    if (request->kind == SIM_REQUEST_RECV) {
+        rank->clock += g_overhead;
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* Collective operations.                                                   */
+/* ------------------------------------------------------------------------ */
+
+static IceTInt SimFindGroup(IceTInt parent, IceTInt sequence)
+{
+    IceTInt group;
+    for (group = 0; group < g_num_groups; group++) {
+        if (   (g_groups[group].parent == parent)
+            && (g_groups[group].sequence == sequence) ) {
+            return group;
+        }
+    }
+    return -1;
+}
+
+static IceTInt SimAddGroup(IceTInt parent,
+                           IceTInt sequence,
+                           IceTInt size,
+                           const IceTInt *members)
+{
+    SimGroup *group;
+
+    g_groups = realloc(g_groups, (g_num_groups+1)*sizeof(SimGroup));
+    group = &g_groups[g_num_groups];
+    group->parent = parent;
+    group->sequence = sequence;
+    group->size = size;
+    group->members = malloc(size*sizeof(IceTInt));
+    memcpy(group->members, members, size*sizeof(IceTInt));
+    group->num_arrived = 0;
+    group->max_clock = 0.0;
+    group->send_buffers = malloc(size*sizeof(const IceTVoid *));
+    group->recv_buffers = malloc(size*sizeof(IceTVoid *));
+    group->send_counts = malloc(size*sizeof(IceTInt));
+
+    return g_num_groups++;
+}
+
+static const IceTByte *SimCollectiveSource(const SimGroup *group,
+                                           IceTInt member,
+                                           IceTSizeType offset)
+{
+    if (group->send_buffers[member] == ICET_IN_PLACE_COLLECT) {
+        return (const IceTByte *)group->recv_buffers[member] + offset;
+    } else {
+        return (const IceTByte *)group->send_buffers[member];
+    }
+}
+
+/* Moves the data of a collective once every member has arrived and releases
+   them all at the same time.  Collectives are modeled as a tree of
+   ceil(log2(p)) latencies plus the bytes the busiest process receives. */
+static void SimFinishCollective(SimGroup *group)
+{
+    IceTSizeType width = icetTypeWidth(group->datatype);
+    IceTSizeType block = group->count*width;
+    IceTDouble bytes = 0.0;
+    IceTDouble done;
+    IceTInt num_steps;
+    IceTInt member;
+
+    switch (group->kind) {
+      case SIM_GATHER:
+          for (member = 0; member < group->size; member++) {
+              if (group->send_buffers[member] == ICET_IN_PLACE_COLLECT) {
+                  continue;
+              }
+              memcpy((IceTByte *)group->recv_buffers[group->root]
+                     + member*block,
+                     group->send_buffers[member],
+                     block);
+          }
+          bytes = (group->size - 1)*(IceTDouble)block;
+          break;
+      case SIM_GATHERV:
+          for (member = 0; member < group->size; member++) {
+              if (group->send_buffers[member] == ICET_IN_PLACE_COLLECT) {
+                  continue;
+              }
+              memcpy((IceTByte *)group->recv_buffers[group->root]
+                     + group->recv_offsets[member]*width,
+                     group->send_buffers[member],
+                     group->send_counts[member]*width);
+              if (member != group->root) {
+                  bytes += group->send_counts[member]*(IceTDouble)width;
+              }
+          }
+          break;
+      case SIM_ALLGATHER:
+          {
+              IceTByte *all = malloc(group->size*block);
+              for (member = 0; member < group->size; member++) {
+                  memcpy(all + member*block,
+                         SimCollectiveSource(group, member, member*block),
+                         block);
+              }
+              for (member = 0; member < group->size; member++) {
+                  memcpy(group->recv_buffers[member],
+                         all,
+                         group->size*block);
+              }
+              free(all);
+              bytes = (group->size - 1)*(IceTDouble)block;
+          }
+          break;
+      case SIM_ALLTOALL:
+          {
+              IceTSizeType row = group->size*block;
+              IceTByte *all = malloc(group->size*row);
+              IceTInt dest;
+              for (member = 0; member < group->size; member++) {
+                  memcpy(all + member*row,
+                         SimCollectiveSource(group, member, 0),
+                         row);
+              }
+              for (dest = 0; dest < group->size; dest++) {
+                  for (member = 0; member < group->size; member++) {
+                      memcpy((IceTByte *)group->recv_buffers[dest]
+                             + member*block,
+                             all + member*row + dest*block,
+                             block);
+                  }
+              }
+              free(all);
+              bytes = (group->size - 1)*(IceTDouble)block;
+          }
+          break;
+      default:
+          break;
+    }
+
+    num_steps = 0;
+    while ((1 << num_steps) < group->size) { num_steps++; }
+    done = group->max_clock
+        + num_steps*(g_latency + 2*g_overhead)
+        + bytes/g_bandwidth;
+
+    for (member = 0; member < group->size; member++) {
+        SimRank *rank = &g_ranks[group->members[member]];
+        rank->clock = done;
+        rank->collective_done = ICET_TRUE;
+        SimWake(group->members[member]);
+    }
+
+    group->num_arrived = 0;
+    group->max_clock = 0.0;
+}
+
+static void SimCollective(IceTCommunicator self,
+                          IceTInt kind,
+                          const void *sendbuf,
+                          int sendcount,
+                          IceTEnum datatype,
+                          void *recvbuf,
+                          const int *recvcounts,
+                          const int *recvoffsets,
+                          int root)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    SimGroup *group = &g_groups[data->group];
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+
+    group->send_buffers[data->rank] = sendbuf;
+    group->recv_buffers[data->rank] = recvbuf;
+    group->send_counts[data->rank] = sendcount;
+    if (data->rank == root) {
+        group->recv_counts = recvcounts;
+        group->recv_offsets = recvoffsets;
+        if ((sendbuf == ICET_IN_PLACE_COLLECT) && (recvcounts != NULL)) {
+            group->send_counts[data->rank] = recvcounts[data->rank];
+        }
+    }
+    group->kind = kind;
+    group->count = sendcount;
+    group->datatype = datatype;
+    group->root = root;
+    if (rank->clock > group->max_clock) { group->max_clock = rank->clock; }
+
+    rank->collective_done = ICET_FALSE;
+    group->num_arrived++;
+    if (group->num_arrived == group->size) {
+        SimFinishCollective(group);
+    }
+    while (!rank->collective_done) {
+        SimBlock(rank);
+    }
+
+    SimLeave(rank, entry_clock);
+}
+
+/* ------------------------------------------------------------------------ */
+/* The communicator interface.                                              */
+/* ------------------------------------------------------------------------ */
+
+static IceTCommunicator SimCreateCommunicator(IceTInt group, IceTInt rank);
+
+static IceTCommunicator SimDuplicate(IceTCommunicator self)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    IceTInt sequence = data->num_derived++;
+    IceTInt group = SimFindGroup(data->group, sequence);
+
+    if (group < 0) {
+        group = SimAddGroup(data->group,
+                            sequence,
+                            g_groups[data->group].size,
+                            g_groups[data->group].members);
+    }
+
+    return SimCreateCommunicator(group, data->rank);
+}
+
+static IceTCommunicator SimSubset(IceTCommunicator self,
+                                  int count,
+                                  const IceTInt32 *ranks)
+{
+    SimCommData *data = (SimCommData *)self->data;
+    IceTInt sequence = data->num_derived++;
+    IceTInt group = SimFindGroup(data->group, sequence);
+    IceTInt i;
+
+    if (group < 0) {
+        IceTInt *members = malloc(count*sizeof(IceTInt));
+        for (i = 0; i < count; i++) {
+            members[i] = g_groups[data->group].members[ranks[i]];
+        }
+        group = SimAddGroup(data->group, sequence, count, members);
+        free(members);
+    }
+
+    for (i = 0; i < count; i++) {
+        if (ranks[i] == data->rank) {
+            return SimCreateCommunicator(group, i);
+        }
+    }
+    return ICET_COMM_NULL;
+}
+
+static void SimDestroy(IceTCommunicator self)
+{
+    free(self->data);
+    free(self);
+}
+
+static void SimBarrier(IceTCommunicator self)
+{
+    SimCollective(self, SIM_BARRIER, NULL, 0, ICET_BYTE, NULL, NULL, NULL, 0);
+}
+
+static void SimSend(IceTCommunicator self,
+                    const void *buf,
+                    int count,
+                    IceTEnum datatype,
+                    int dest,
+                    int tag)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    IceTDouble injected;
+
+    injected = SimPostSend(self, rank, buf, count*icetTypeWidth(datatype),
+                           dest, tag);
+    if (rank->clock < injected) { rank->clock = injected; }
+
+    SimLeave(rank, entry_clock);
+}
+
+static void SimRecv(IceTCommunicator self,
+                    void *buf,
+                    int count,
+                    IceTEnum datatype,
+                    int src,
+                    int tag)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    SimRequest request;
+
+    request.kind = SIM_REQUEST_RECV;
+    request.complete = ICET_FALSE;
+    SimPostRecv(self, rank, &request, buf, count*icetTypeWidth(datatype),
+                src, tag);
+    while (!request.complete) {
+        SimBlock(rank);
+    }
+    SimFinishRequest(rank, &request);
+
+    SimLeave(rank, entry_clock);
+}
+
+static void SimSendrecv(IceTCommunicator self,
+                        const void *sendbuf,
+                        int sendcount,
+                        IceTEnum sendtype,
+                        int dest,
+                        int sendtag,
+                        void *recvbuf,
+                        int recvcount,
+                        IceTEnum recvtype,
+                        int src,
+                        int recvtag)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    IceTDouble injected;
+    SimRequest request;
+
+    request.kind = SIM_REQUEST_RECV;
+    request.complete = ICET_FALSE;
+    SimPostRecv(self, rank, &request, recvbuf,
+                recvcount*icetTypeWidth(recvtype), src, recvtag);
+    injected = SimPostSend(self, rank, sendbuf,
+                           sendcount*icetTypeWidth(sendtype), dest, sendtag);
+    while (!request.complete) {
+        SimBlock(rank);
+    }
+    SimFinishRequest(rank, &request);
+    if (rank->clock < injected) { rank->clock = injected; }
+
+    SimLeave(rank, entry_clock);
+}
+
+static void SimGather(IceTCommunicator self,
+                      const void *sendbuf,
+                      int sendcount,
+                      IceTEnum datatype,
+                      void *recvbuf,
+                      int root)
+{
+    SimCollective(self, SIM_GATHER, sendbuf, sendcount, datatype,
+                  recvbuf, NULL, NULL, root);
+}
+
+static void SimGatherv(IceTCommunicator self,
+                       const void *sendbuf,
+                       int sendcount,
+                       IceTEnum datatype,
+                       void *recvbuf,
+                       const int *recvcounts,
+                       const int *recvoffsets,
+                       int root)
+{
+    SimCollective(self, SIM_GATHERV, sendbuf, sendcount, datatype,
+                  recvbuf, recvcounts, recvoffsets, root);
+}
+
+static void SimAllgather(IceTCommunicator self,
+                         const void *sendbuf,
+                         int sendcount,
+                         IceTEnum datatype,
+                         void *recvbuf)
+{
+    SimCollective(self, SIM_ALLGATHER, sendbuf, sendcount, datatype,
+                  recvbuf, NULL, NULL, -1);
+}
+
+static void SimAlltoall(IceTCommunicator self,
+                        const void *sendbuf,
+                        int sendcount,
+                        IceTEnum datatype,
+                        void *recvbuf)
+{
+    SimCollective(self, SIM_ALLTOALL, sendbuf, sendcount, datatype,
+                  recvbuf, NULL, NULL, -1);
+}
+
+static IceTCommRequest SimIsend(IceTCommunicator self,
+                                const void *buf,
+                                int count,
+                                IceTEnum datatype,
+                                int dest,
+                                int tag)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    IceTCommRequest request = SimCreateRequest(SIM_REQUEST_SEND);
+    SimRequest *internals = (SimRequest *)request->internals;
+
+    internals->time = SimPostSend(self, rank, buf,
+                                  count*icetTypeWidth(datatype), dest, tag);
+    internals->complete = ICET_TRUE;
+
+    SimLeave(rank, entry_clock);
+    return request;
+}
+
+static IceTCommRequest SimIrecv(IceTCommunicator self,
+                                void *buf,
+                                int count,
+                                IceTEnum datatype,
+                                int src,
+                                int tag)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    IceTCommRequest request = SimCreateRequest(SIM_REQUEST_RECV);
+
+    rank->clock += g_overhead;
+    SimPostRecv(self, rank, (SimRequest *)request->internals,
+                buf, count*icetTypeWidth(datatype), src, tag);
+
+    SimLeave(rank, entry_clock);
+    return request;
+}
+
+static void SimWait(IceTCommunicator self, IceTCommRequest *request)
+{
+    SimRank *rank;
+    IceTDouble entry_clock;
+    SimRequest *internals;
+
+    if (*request == ICET_COMM_REQUEST_NULL) return;
+
+    rank = SimEnter(self);
+    entry_clock = rank->clock;
+    internals = SimGetRequest(*request);
+    if (internals != NULL) {
+        while (!internals->complete) {
+            SimBlock(rank);
+        }
+        SimFinishRequest(rank, internals);
+    }
+    SimDestroyRequest(*request);
+    *request = ICET_COMM_REQUEST_NULL;
+
+    SimLeave(rank, entry_clock);
+}
+
+/* Completes the request that finishes first in virtual time.  A message that
+   has not been sent yet might still arrive before those that have, so when
+   only some requests are complete the choice is deferred until no other
+   virtual process can make progress. */
+static int SimWaitany(IceTCommunicator self,
+                      int count, IceTCommRequest *array_of_requests)
+{
+    SimRank *rank = SimEnter(self);
+    IceTDouble entry_clock = rank->clock;
+    int idx = -1;
+
+    rank->flushed = ICET_FALSE;
+    while (idx < 0) {
+        int num_active = 0;
+        int num_complete = 0;
+        int i;
+
+        for (i = 0; i < count; i++) {
+            SimRequest *internals;
+            if (array_of_requests[i] == ICET_COMM_REQUEST_NULL) continue;
+            internals = SimGetRequest(array_of_requests[i]);
+            if (internals == NULL) continue;
+            num_active++;
+            if (!internals->complete) continue;
+            num_complete++;
+            if (   (idx < 0)
+                || (internals->time
+                    < SimGetRequest(array_of_requests[idx])->time) ) {
+                idx = i;
+            }
+        }
+
+        if (num_active == 0) {
+            icetRaiseError(ICET_INVALID_VALUE,
+                           "Waitany called with no active requests.");
+            break;
+        }
+        if ((num_complete < num_active) && !rank->flushed) {
+            idx = -1;
+            rank->status
+                = (num_complete > 0) ? SIM_RANK_DEFERRED : SIM_RANK_BLOCKED;
+            SimYield(rank);
+        }
+    }
+
+    if (idx >= 0) {
+        SimFinishRequest(rank, SimGetRequest(array_of_requests[idx]));
+        SimDestroyRequest(array_of_requests[idx]);
+        array_of_requests[idx] = ICET_COMM_REQUEST_NULL;
+    }
+
+    SimLeave(rank, entry_clock);
+    return idx;
+}
+
+static int SimComm_size(IceTCommunicator self)
+{
+    return g_groups[((SimCommData *)self->data)->group].size;
+}
+
+static int SimComm_rank(IceTCommunicator self)
+{
+    return ((SimCommData *)self->data)->rank;
+}
+
+static IceTCommunicator SimCreateCommunicator(IceTInt group, IceTInt rank)
+{
+    IceTCommunicator comm;
+    SimCommData *data;
+
+    comm = malloc(sizeof(struct IceTCommunicatorStruct));
+    comm->Duplicate = SimDuplicate;
+    comm->Subset = SimSubset;
+    comm->Destroy = SimDestroy;
+    comm->Barrier = SimBarrier;
+    comm->Send = SimSend;
+    comm->Recv = SimRecv;
+    comm->Sendrecv = SimSendrecv;
+    comm->Gather = SimGather;
+    comm->Gatherv = SimGatherv;
+    comm->Allgather = SimAllgather;
+    comm->Alltoall = SimAlltoall;
+    comm->Isend = SimIsend;
+    comm->Irecv = SimIrecv;
+    comm->Wait = SimWait;
+    comm->Waitany = SimWaitany;
+    comm->Comm_size = SimComm_size;
+    comm->Comm_rank = SimComm_rank;
+
+    data = malloc(sizeof(SimCommData));
+    data->group = group;
+    data->rank = rank;
+    data->num_derived = 0;
+    comm->data = data;
+
+    return comm;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Running a frame.                                                         */
+/* ------------------------------------------------------------------------ */
+
+static void SimRankMain(void)
+{
+    const IceTFloat background_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    SimRank *rank = &g_ranks[g_current];
+
+    rank->compute_start = SimComputeTime();
+    rank->result = icetCompositeImage(g_color_buffer,
+                                      g_depth_buffer,
+                                      rank->valid_viewport,
+                                      NULL,
+                                      NULL,
+                                      background_color);
+    rank->clock += (SimComputeTime() - rank->compute_start)*g_compute_scale;
+    rank->status = SIM_RANK_DONE;
+}
+
+/* Composites one frame with every virtual process.  Returns ICET_FALSE if
+   the virtual processes deadlock. */
+static IceTBoolean SimRunFrame(void)
+{
+    IceTInt num_done;
+    IceTInt i;
+
+    for (i = 0; i < g_num_ranks; i++) {
+        SimRank *rank = &g_ranks[i];
+        getcontext(&rank->context);
+        rank->context.uc_stack.ss_sp = rank->stack;
+        rank->context.uc_stack.ss_size = SIM_STACK_SIZE;
+        rank->context.uc_link = &g_main_context;
+        makecontext(&rank->context, SimRankMain, 0);
+        rank->clock = 0.0;
+        rank->flushed = ICET_FALSE;
+        rank->last_round = -1;
+        memset(rank->round_comm, 0, sizeof(rank->round_comm));
+        memset(rank->round_compute, 0, sizeof(rank->round_compute));
+        memset(rank->round_end, 0, sizeof(rank->round_end));
+    }
+    for (i = 0; i < (g_num_ranks+g_ranks_per_node-1)/g_ranks_per_node; i++) {
+        g_nic_free[i] = 0.0;
+    }
+
+    g_ready_head = 0;
+    g_ready_count = 0;
+    g_num_deferred = 0;
+    for (i = 0; i < g_num_ranks; i++) {
+        SimMakeReady(i);
+    }
+
+    while ((g_ready_count > 0) || (g_num_deferred > 0)) {
+        SimRank *rank;
+
+        if (g_ready_count == 0) {
+            for (i = 0; i < g_num_deferred; i++) {
+                g_ranks[g_deferred[i]].flushed = ICET_TRUE;
+                SimMakeReady(g_deferred[i]);
+            }
+            g_num_deferred = 0;
+        }
+
+        g_current = g_ready[g_ready_head];
+        g_ready_head = (g_ready_head + 1)%g_num_ranks;
+        g_ready_count--;
+
+        rank = &g_ranks[g_current];
+        icetSetContext(rank->icet_context);
+        swapcontext(&g_main_context, &rank->context);
+    }
+
+    num_done = 0;
+    for (i = 0; i < g_num_ranks; i++) {
+        if (g_ranks[i].status == SIM_RANK_DONE) { num_done++; }
+    }
+    return (num_done == g_num_ranks);
+}
+
+/* Finds the rate this machine blends at so that computation can be scaled to
+   the blend rate of the target machine. */
+static IceTDouble SimMeasureBlendRate(void)
+{
+    IceTVoid *dest_buffer;
+    IceTVoid *src_buffer;
+    IceTImage dest_image;
+    IceTImage src_image;
+    IceTDouble start_time;
+    IceTDouble elapsed;
+    IceTInt repeat;
+
+    dest_buffer = malloc(icetImageBufferSize(g_width, g_height));
+    src_buffer = malloc(icetImageBufferSize(g_width, g_height));
+    dest_image = icetImageAssignBuffer(dest_buffer, g_width, g_height);
+    src_image = icetImageAssignBuffer(src_buffer, g_width, g_height);
+    memcpy(icetImageGetColorub(dest_image),
+           g_color_buffer, 4*g_width*g_height);
+    memcpy(icetImageGetColorub(src_image),
+           g_color_buffer, 4*g_width*g_height);
+    memcpy(icetImageGetDepthf(dest_image),
+           g_depth_buffer, sizeof(IceTFloat)*g_width*g_height);
+    memcpy(icetImageGetDepthf(src_image),
+           g_depth_buffer, sizeof(IceTFloat)*g_width*g_height);
+
+    repeat = 0;
+    start_time = SimComputeTime();
+    do {
+        icetComposite(dest_image, src_image, ICET_FALSE);
+        repeat++;
+        elapsed = SimComputeTime() - start_time;
+    } while (elapsed < 0.1);
+
+    free(dest_buffer);
+    free(src_buffer);
+
+    return repeat*(IceTDouble)(g_width*g_height)/elapsed;
+}
+
+/* Fills the image shared by all the virtual processes and gives each process
+   a random rectangle of it as its valid pixels. */
+static void SimMakeImages(void)
+{
+    IceTSizeType x, y;
+    IceTInt i;
+
+    g_color_buffer = malloc(4*g_width*g_height);
+    g_depth_buffer = malloc(sizeof(IceTFloat)*g_width*g_height);
+    for (y = 0; y < g_height; y++) {
+        for (x = 0; x < g_width; x++) {
+            IceTSizeType pixel = y*g_width + x;
+            g_color_buffer[4*pixel + 0] = (IceTUByte)(255*x/g_width);
+            g_color_buffer[4*pixel + 1] = (IceTUByte)(255*y/g_height);
+            g_color_buffer[4*pixel + 2] = 128;
+            g_color_buffer[4*pixel + 3] = 255;
+            g_depth_buffer[pixel] = 0.25f + 0.5f*(IceTFloat)x/g_width;
+        }
+    }
+
+    g_random_state = (IceTUInt)g_seed;
+    for (i = 0; i < g_num_ranks; i++) {
+        IceTInt *viewport = g_ranks[i].valid_viewport;
+        IceTInt width = (IceTInt)(g_width*sqrt(g_active_fraction));
+        IceTInt height = (IceTInt)(g_height*sqrt(g_active_fraction));
+        if (width < 1) { width = 1; }
+        if (height < 1) { height = 1; }
+        viewport[0] = (IceTInt)(sim_random()*(g_width - width + 1));
+        viewport[1] = (IceTInt)(sim_random()*(g_height - height + 1));
+        viewport[2] = width;
+        viewport[3] = height;
+    }
+}
+
+/* Checks the image on the display process.  All processes share the same
+   pixels, so the result is the shared image wherever any process has valid
+   pixels and background elsewhere. */
+static int SimCheckResult(void)
+{
+    const IceTUByte *colors;
+    IceTSizeType x, y;
+    IceTInt i;
+
+    icetSetContext(g_ranks[0].icet_context);
+    colors = icetImageGetColorcub(g_ranks[0].result);
+
+    for (y = 0; y < g_height; y++) {
+        for (x = 0; x < g_width; x++) {
+            IceTSizeType pixel = y*g_width + x;
+            IceTBoolean covered = ICET_FALSE;
+            IceTInt c;
+            for (i = 0; i < g_num_ranks; i++) {
+                const IceTInt *viewport = g_ranks[i].valid_viewport;
+                if (   (x >= viewport[0]) && (x < viewport[0] + viewport[2])
+                    && (y >= viewport[1]) && (y < viewport[1] + viewport[3])) {
+                    covered = ICET_TRUE;
+                    break;
+                }
+            }
+            for (c = 0; c < 4; c++) {
+                IceTUByte expected
+                    = covered ? g_color_buffer[4*pixel + c] : 0;
+                if (colors[4*pixel + c] != expected) {
+                    printf("Simulated image differs at pixel %d, %d\n",
+                           (int)x, (int)y);
+                    return TEST_FAILED;
+                }
+            }
+        }
+    }
+
+    return TEST_PASSED;
+}
+
+static void SimMax(IceTDouble *value, IceTDouble candidate)
+{
+    if (candidate > *value) { *value = candidate; }
+}
+
+/* Summarizes the rounds of the single image strategy.  For each round this
+   finds the largest k, bytes sent, communication and compute time of any
+   process, the longest time any process spent in the round (the critical
+   path), and the time by which all processes finished it. */
+static IceTInt SimSummarizeRounds(IceTDouble *rounds)
+{
+    IceTDouble *statistics;
+    IceTInt max_rounds = 0;
+    IceTInt i;
+
+    statistics = malloc(ICET_MAX_ROUNDS*ICET_ROUND_STATISTICS_SIZE
+                        *sizeof(IceTDouble));
+    memset(rounds, 0, ICET_MAX_ROUNDS*SIM_ROUND_SIZE*sizeof(IceTDouble));
+
+    for (i = 0; i < g_num_ranks; i++) {
+        SimRank *rank = &g_ranks[i];
+        IceTInt num_rounds;
+        IceTInt round;
+
+        icetSetContext(rank->icet_context);
+        num_rounds = icetGetRoundStatistics(ICET_ROUND_SUMMARY_LOCAL,
+                                            statistics);
+        if (num_rounds > max_rounds) { max_rounds = num_rounds; }
+
+        for (round = 0; round < num_rounds; round++) {
+            const IceTDouble *local
+                = statistics + round*ICET_ROUND_STATISTICS_SIZE;
+            IceTDouble *summary = rounds + round*SIM_ROUND_SIZE;
+            IceTDouble critical
+                = rank->round_comm[round] + rank->round_compute[round];
+
+            SimMax(&summary[SIM_ROUND_K], local[ICET_ROUND_K]);
+            SimMax(&summary[SIM_ROUND_BYTES_SENT],
+                   local[ICET_ROUND_BYTES_SENT]);
+            SimMax(&summary[SIM_ROUND_COMM_TIME], rank->round_comm[round]);
+            SimMax(&summary[SIM_ROUND_COMPUTE_TIME],
+                   rank->round_compute[round]);
+            SimMax(&summary[SIM_ROUND_CRITICAL_PATH], critical);
+            SimMax(&summary[SIM_ROUND_FINISHED], rank->round_end[round]);
+        }
+    }
+
+    free(statistics);
+    return max_rounds;
+}
+
+static int SimDoComposite(IceTContext original_context)
+{
+    IceTDouble rounds[ICET_MAX_ROUNDS*SIM_ROUND_SIZE];
+    IceTDouble frame_rounds[ICET_MAX_ROUNDS*SIM_ROUND_SIZE];
+    IceTDouble frame_time;
+    IceTInt num_rounds;
+    IceTInt magic_k;
+    const char *strategy_name;
+    int result;
+    IceTInt frame;
+    IceTInt i;
+
+    /* The first frame allocates buffers, which would be charged as
+       computation, so a warm-up frame is composited first.  Anything else
+       running on this machine can only make a frame slower, so the fastest
+       of the remaining frames is reported. */
+    if (!SimRunFrame()) {
+        icetSetContext(original_context);
+        printstat("Virtual processes deadlocked.\n");
+        return TEST_FAILED;
+    }
+    result = SimCheckResult();
+
+    frame_time = -1.0;
+    num_rounds = 0;
+    for (frame = 0; frame < g_num_frames; frame++) {
+        IceTDouble time = 0.0;
+        IceTInt frame_num_rounds;
+
+        if (!SimRunFrame()) {
+            icetSetContext(original_context);
+            printstat("Virtual processes deadlocked.\n");
+            return TEST_FAILED;
+        }
+        for (i = 0; i < g_num_ranks; i++) {
+            if (g_ranks[i].clock > time) { time = g_ranks[i].clock; }
+        }
+        frame_num_rounds = SimSummarizeRounds(frame_rounds);
+        if ((frame_time < 0.0) || (time < frame_time)) {
+            frame_time = time;
+            num_rounds = frame_num_rounds;
+            memcpy(rounds, frame_rounds, sizeof(rounds));
+        }
+        result += SimCheckResult();
+    }
+
+    icetSetContext(g_ranks[0].icet_context);
+    strategy_name = icetGetSingleImageStrategyName();
+    icetGetIntegerv(ICET_MAGIC_K, &magic_k);
+
+    icetSetContext(original_context);
+    printstat("%s, magic k %d, %d processes: predicted frame time %g s\n",
+              strategy_name, magic_k, g_num_ranks, frame_time);
+    if (num_rounds > 0) {
+        printstat("  round   k    bytes sent     comm time  compute time"
+                  "      critical      finished\n");
+    }
+    for (i = 0; i < num_rounds; i++) {
+        const IceTDouble *summary = rounds + i*SIM_ROUND_SIZE;
+        printstat("  %5d %3d %13.0f %13.6g %13.6g %13.6g %13.6g\n",
+                  i,
+                  (int)summary[SIM_ROUND_K],
+                  summary[SIM_ROUND_BYTES_SENT],
+                  summary[SIM_ROUND_COMM_TIME],
+                  summary[SIM_ROUND_COMPUTE_TIME],
+                  summary[SIM_ROUND_CRITICAL_PATH],
+                  summary[SIM_ROUND_FINISHED]);
+    }
+
+    if (frame_time <= 0.0) {
+        printstat("Predicted frame time is not positive.\n");
+        result = TEST_FAILED;
+    }
+
+    return result;
+}
+
+static void SimSetStrategy(IceTEnum single_image_strategy, IceTInt magic_k)
+{
+    IceTInt i;
+    for (i = 0; i < g_num_ranks; i++) {
+        icetSetContext(g_ranks[i].icet_context);
+        icetSingleImageStrategy(single_image_strategy);
+        if (magic_k > 0) {
+            icetStateSetInteger(ICET_MAGIC_K, magic_k);
+        }
+    }
+}
+
+static int SimDoStrategy(IceTContext original_context,
+                         IceTEnum single_image_strategy)
+{
+    int result = TEST_PASSED;
+
+    if (g_max_magic_k > 0) {
+        IceTInt magic_k;
+        for (magic_k = 2; magic_k <= g_max_magic_k; magic_k *= 2) {
+            SimSetStrategy(single_image_strategy, magic_k);
+            result += SimDoComposite(original_context);
+            if (result != TEST_PASSED) { break; }
+        }
+    } else {
+        SimSetStrategy(single_image_strategy, 0);
+        result += SimDoComposite(original_context);
+    }
+
+    return result;
+}
+
+static int SimulateCompositingRun(void)
+{
+    IceTContext original_context = icetGetContext();
+    IceTInt *all_ranks;
+    IceTInt num_nodes;
+    IceTDouble host_blend_rate;
+    IceTInt rank;
+    int result = TEST_PASSED;
+    IceTInt i;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    if (rank != 0) {
+        /* The simulation is serial.  Other processes have nothing to do. */
+        return TEST_PASSED;
+    }
+
+    if ((g_num_ranks < 1) || (g_ranks_per_node < 1) || (g_num_frames < 1)) {
+        printstat("Need at least one virtual process, node and frame.\n");
+        return TEST_NOT_RUN;
+    }
+
+    g_ranks = malloc(g_num_ranks*sizeof(SimRank));
+    g_ready = malloc(g_num_ranks*sizeof(IceTInt));
+    g_deferred = malloc(g_num_ranks*sizeof(IceTInt));
+    num_nodes = (g_num_ranks + g_ranks_per_node - 1)/g_ranks_per_node;
+    g_nic_free = malloc(num_nodes*sizeof(IceTDouble));
+    g_groups = NULL;
+    g_num_groups = 0;
+
+    SimMakeImages();
+
+    all_ranks = malloc(g_num_ranks*sizeof(IceTInt));
+    for (i = 0; i < g_num_ranks; i++) { all_ranks[i] = i; }
+    SimAddGroup(-1, 0, g_num_ranks, all_ranks);
+    free(all_ranks);
+
+    for (i = 0; i < g_num_ranks; i++) {
+        SimRank *sim_rank = &g_ranks[i];
+        IceTCommunicator comm = SimCreateCommunicator(0, i);
+
+        sim_rank->stack = malloc(SIM_STACK_SIZE);
+        sim_rank->status = SIM_RANK_DONE;
+        sim_rank->unexpected_head = NULL;
+        sim_rank->unexpected_tail = NULL;
+        sim_rank->posted_head = NULL;
+        sim_rank->posted_tail = NULL;
+        sim_rank->result = icetImageNull();
+
+        sim_rank->icet_context = icetCreateContext(comm);
+        SimDestroy(comm);
+
+        icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+        icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+        icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+        icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+        icetDisable(ICET_ORDERED_COMPOSITE);
+        icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+        icetResetTiles();
+        icetAddTile(0, 0, g_width, g_height, 0);
+    }
+
+    host_blend_rate = SimMeasureBlendRate();
+    if (g_blend_rate > 0.0) {
+        g_compute_scale = host_blend_rate/g_blend_rate;
+    }
+
+    icetSetContext(original_context);
+    printstat("Simulating %d processes, %d per node, %dx%d image\n",
+              g_num_ranks, g_ranks_per_node, (int)g_width, (int)g_height);
+    printstat("L %g s, o %g s, g %g s, bandwidth %g B/s,"
+              " injection bandwidth %g B/s\n",
+              g_latency, g_overhead, g_gap,
+              g_bandwidth, g_injection_bandwidth);
+    printstat("Blend rate on this machine %g pixels/s,"
+              " computation scaled by %g\n",
+              host_blend_rate, g_compute_scale);
+
+    if (g_sweep_strategies) {
+        IceTInt strategy_idx;
+        for (strategy_idx = 0;
+             strategy_idx < SINGLE_IMAGE_STRATEGY_LIST_SIZE;
+             strategy_idx++) {
+            result += SimDoStrategy(
+                          original_context,
+                          single_image_strategy_list[strategy_idx]);
+            if (result != TEST_PASSED) { break; }
+        }
+    } else {
+        result += SimDoStrategy(original_context, g_single_image_strategy);
+    }
+
+    if (result == TEST_PASSED) {
+        /* Contexts of deadlocked processes are left alone because their
+           coroutines never returned. */
+        for (i = 0; i < g_num_ranks; i++) {
+            icetDestroyContext(g_ranks[i].icet_context);
+            free(g_ranks[i].stack);
+        }
+        for (i = 0; i < g_num_groups; i++) {
+            free(g_groups[i].members);
+            free((void *)g_groups[i].send_buffers);
+            free(g_groups[i].recv_buffers);
+            free(g_groups[i].send_counts);
+        }
+        free(g_groups);
+        free(g_ranks);
+    }
+    icetSetContext(original_context);
+
+    free(g_ready);
+    free(g_deferred);
+    free(g_nic_free);
+    free(g_color_buffer);
+    free(g_depth_buffer);
+
+    return result;
+}
+
+int SimulateCompositing(int argc, char *argv[])
+{
+    parse_arguments(argc, argv);
+
+    return run_test(SimulateCompositingRun);
+}
@@ -0,0 +1,290 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests icetCompositeSparseImage, which composites images given as spans of
+** active pixels.  Each process makes random spans and composites them both
+** as spans and as the equivalent full image through icetCompositeImage.
+** The two results must be identical.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Spans of the local image and its pixels packed in span order. */
+static IceTInt *g_row_span_starts;
+static IceTInt *g_spans;
+static IceTVoid *g_span_colors;
+static IceTFloat *g_span_depths;
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+/* The same image as full buffers. */
+static IceTVoid *g_full_colors;
+static IceTFloat *g_full_depths;
+
+static void SetUpTiles(IceTInt tile_dimension)
+{
+    IceTInt tile_index = 0;
+    IceTInt tile_x;
+    IceTInt tile_y;
+
+    icetResetTiles();
+    for (tile_y = 0; tile_y < tile_dimension; tile_y++) {
+        for (tile_x = 0; tile_x < tile_dimension; tile_x++) {
+            icetAddTile(tile_x*SCREEN_WIDTH,
+                        tile_y*SCREEN_HEIGHT,
+                        SCREEN_WIDTH,
+                        SCREEN_HEIGHT,
+                        tile_index);
+            tile_index++;
+        }
+    }
+}
+
+/* Makes random spans, leaving some rows empty, and fills both the full
+   buffers and the pixels packed in span order. */
+static void MakeSpans(void)
+{
+    IceTInt global_viewport[4];
+    IceTInt width, height;
+    IceTEnum color_format;
+    IceTSizeType color_size;
+    IceTBoolean *active_mask;
+    IceTInt num_spans;
+    IceTInt num_pixels;
+    IceTInt span;
+    IceTInt x, y;
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    width = global_viewport[2];
+    height = global_viewport[3];
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    color_size = (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE)
+        ? 4 : 4*sizeof(IceTFloat);
+
+    g_row_span_starts = malloc((height + 1)*sizeof(IceTInt));
+    g_spans = malloc(width*height*sizeof(IceTInt));
+    active_mask = malloc(width*height*sizeof(IceTBoolean));
+    memset(active_mask, 0, width*height*sizeof(IceTBoolean));
+
+    num_spans = 0;
+    for (y = 0; y < height; y++) {
+        g_row_span_starts[y] = num_spans;
+        if (rand()%4 == 0) { continue; }
+        x = rand()%16;
+        while (x < width) {
+            IceTInt length = 1 + rand()%24;
+            if (x + length > width) { length = width - x; }
+            g_spans[2*num_spans + 0] = x;
+            g_spans[2*num_spans + 1] = length;
+            num_spans++;
+            memset(active_mask + y*width + x, 1, length*sizeof(IceTBoolean));
+            x += length + 1 + rand()%32;
+        }
+    }
+    g_row_span_starts[height] = num_spans;
+
+    make_test_image_from_mask(width,
+                              height,
+                              active_mask,
+                              g_background_color,
+                              &g_full_colors,
+                              &g_full_depths);
+    free(active_mask);
+
+    g_span_colors = malloc(width*height*color_size);
+    g_span_depths = malloc(width*height*sizeof(IceTFloat));
+    num_pixels = 0;
+    for (y = 0; y < height; y++) {
+        for (span = g_row_span_starts[y];
+             span < g_row_span_starts[y+1];
+             span++) {
+            IceTInt full_pixel = y*width + g_spans[2*span + 0];
+            IceTInt length = g_spans[2*span + 1];
+            memcpy((IceTByte *)g_span_colors + num_pixels*color_size,
+                   (IceTByte *)g_full_colors + full_pixel*color_size,
+                   length*color_size);
+            memcpy(g_span_depths + num_pixels,
+                   g_full_depths + full_pixel,
+                   length*sizeof(IceTFloat));
+            num_pixels += length;
+        }
+    }
+}
+
+static void FreeSpans(void)
+{
+    free(g_row_span_starts);
+    free(g_spans);
+    free(g_span_colors);
+    free(g_span_depths);
+    free(g_full_colors);
+    free(g_full_depths);
+}
+
+static IceTBoolean SparseInputTryComposite(void)
+{
+    IceTEnum depth_format;
+    IceTImage image;
+    IceTInt tile_displayed;
+    IceTByte *sparse_result;
+    IceTSizeType sparse_num_bytes;
+    IceTByte *full_result;
+    IceTSizeType full_num_bytes;
+    IceTBoolean success = ICET_TRUE;
+
+    icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+
+    image = icetCompositeSparseImage(
+                g_row_span_starts,
+                g_spans,
+                g_span_colors,
+                (depth_format != ICET_IMAGE_DEPTH_NONE) ? g_span_depths : NULL,
+                NULL,
+                NULL,
+                g_background_color);
+    /* Keep the result because the next composite reuses its buffer. */
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+    if (tile_displayed >= 0) {
+        sparse_result = copy_test_image(image, &sparse_num_bytes);
+    } else {
+        sparse_result = NULL;
+        sparse_num_bytes = 0;
+    }
+
+    full_result = composite_and_copy(g_full_colors,
+                                     g_full_depths,
+                                     NULL,
+                                     g_background_color,
+                                     &full_num_bytes);
+
+    if (   (sparse_num_bytes != full_num_bytes)
+        || (   (full_result != NULL)
+            && (memcmp(sparse_result, full_result, full_num_bytes) != 0) ) ) {
+        printrank("***** Spans and full image composite differently *****\n");
+        success = ICET_FALSE;
+    }
+
+    free(sparse_result);
+    free(full_result);
+    return success;
+}
+
+static IceTBoolean SparseInputTryStrategies(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt strategy_index;
+
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        IceTBoolean supports_ordering;
+
+        icetStrategy(strategy_list[strategy_index]);
+        printstat("    Using %s strategy.\n", icetGetStrategyName());
+
+        icetGetBooleanv(ICET_STRATEGY_SUPPORTS_ORDERING, &supports_ordering);
+        if (icetIsEnabled(ICET_ORDERED_COMPOSITE) && !supports_ordering) {
+            printstat("    Strategy does not support ordering, skipping.\n");
+            continue;
+        }
+
+        success &= SparseInputTryComposite();
+    }
+
+    return success;
+}
+
+static IceTBoolean SparseInputTryFormats(void)
+{
+    IceTBoolean success = ICET_TRUE;
+
+    printstat("  Z buffer with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    MakeSpans();
+    success &= SparseInputTryStrategies();
+    FreeSpans();
+
+    printstat("  Z buffer with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    MakeSpans();
+    success &= SparseInputTryStrategies();
+    FreeSpans();
+
+    printstat("  Ordered blending with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    icetEnable(ICET_CORRECT_COLORED_BACKGROUND);
+    MakeSpans();
+    success &= SparseInputTryStrategies();
+    FreeSpans();
+    icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+
+    return success;
+}
+
+static int SparseInputRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt tile_dimension;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    for (tile_dimension = 1;
+         (tile_dimension <= 2) && (tile_dimension*tile_dimension <= num_proc);
+         tile_dimension++) {
+        printstat("\nUsing %dx%d tiles\n", tile_dimension, tile_dimension);
+        SetUpTiles(tile_dimension);
+        success &= SparseInputTryFormats();
+    }
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int SparseInput(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(SparseInputRun);
+}
@@ -0,0 +1,341 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the buffer layouts set with icetInputBufferLayout.  Each process
+** makes a random image and composites it from tightly packed buffers and
+** from the same pixels stored with padded rows, interleaved color and depth,
+** and top down rows.  All results must be identical.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define LAYOUT_PADDED_ROWS      0
+#define LAYOUT_INTERLEAVED      1
+#define LAYOUT_TOP_DOWN         2
+#define NUM_LAYOUTS             3
+
+static const char *g_layout_names[NUM_LAYOUTS] = {
+    "padded rows", "interleaved color and depth", "top down rows"
+};
+
+/* Extra bytes at the end of each row of padded layouts. */
+#define ROW_PADDING             12
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+/* The local image in tightly packed buffers. */
+static IceTVoid *g_packed_colors;
+static IceTFloat *g_packed_depths;
+
+/* The same image in the layout being tested. */
+static IceTByte *g_layout_buffer;
+static IceTByte *g_layout_depth_buffer;
+
+static void SetUpTiles(IceTInt tile_dimension)
+{
+    IceTInt tile_index = 0;
+    IceTInt tile_x;
+    IceTInt tile_y;
+
+    icetResetTiles();
+    for (tile_y = 0; tile_y < tile_dimension; tile_y++) {
+        for (tile_x = 0; tile_x < tile_dimension; tile_x++) {
+            icetAddTile(tile_x*SCREEN_WIDTH,
+                        tile_y*SCREEN_HEIGHT,
+                        SCREEN_WIDTH,
+                        SCREEN_HEIGHT,
+                        tile_index);
+            tile_index++;
+        }
+    }
+}
+
+static IceTSizeType ColorSize(void)
+{
+    IceTEnum color_format;
+
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    return (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE)
+            ? 4 : 4*sizeof(IceTFloat);
+}
+
+/* Fills the packed buffers with a random rectangle of patterned pixels
+   surrounded by inactive pixels. */
+static void MakeImage(void)
+{
+    IceTInt global_viewport[4];
+    IceTInt width, height;
+    IceTInt active_viewport[4];
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    width = global_viewport[2];
+    height = global_viewport[3];
+
+    active_viewport[0] = rand()%(width/2);
+    active_viewport[1] = rand()%(height/2);
+    active_viewport[2] = width/2 + rand()%(width/2) - active_viewport[0];
+    active_viewport[3] = height/2 + rand()%(height/2) - active_viewport[1];
+
+    make_test_image(width,
+                    height,
+                    active_viewport,
+                    g_background_color,
+                    &g_packed_colors,
+                    &g_packed_depths);
+}
+
+static void FreeImage(void)
+{
+    free(g_packed_colors);
+    free(g_packed_depths);
+}
+
+/* Copies the packed image into the given layout, tells IceT about the
+   layout, and returns the color and depth pointers to give to
+   icetCompositeImage. */
+static void MakeLayout(int layout,
+                       const IceTVoid **color_buffer,
+                       const IceTVoid **depth_buffer)
+{
+    IceTInt global_viewport[4];
+    IceTSizeType width, height;
+    IceTSizeType color_size = ColorSize();
+    IceTSizeType depth_size = sizeof(IceTFloat);
+    IceTSizeType color_pixel_stride, color_row_stride;
+    IceTSizeType depth_pixel_stride, depth_row_stride;
+    IceTEnum row_order;
+    IceTByte *colors;
+    IceTByte *depths;
+    IceTSizeType x, y;
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    width = global_viewport[2];
+    height = global_viewport[3];
+
+    switch (layout) {
+      case LAYOUT_INTERLEAVED:
+          /* One record of color followed by depth per pixel. */
+          color_pixel_stride = depth_pixel_stride = color_size + depth_size;
+          color_row_stride = depth_row_stride = 0;
+          row_order = ICET_ROWS_BOTTOM_UP;
+          g_layout_buffer = malloc(width*height*color_pixel_stride);
+          g_layout_depth_buffer = NULL;
+          colors = g_layout_buffer;
+          depths = g_layout_buffer + color_size;
+          break;
+      case LAYOUT_TOP_DOWN:
+      case LAYOUT_PADDED_ROWS:
+      default:
+          color_pixel_stride = 0;
+          depth_pixel_stride = 0;
+          color_row_stride = width*color_size + ROW_PADDING;
+          depth_row_stride = width*depth_size + ROW_PADDING;
+          row_order = (layout == LAYOUT_TOP_DOWN)
+                      ? ICET_ROWS_TOP_DOWN : ICET_ROWS_BOTTOM_UP;
+          g_layout_buffer = malloc(height*color_row_stride);
+          g_layout_depth_buffer = malloc(height*depth_row_stride);
+          colors = g_layout_buffer;
+          depths = g_layout_depth_buffer;
+          break;
+    }
+
+    for (y = 0; y < height; y++) {
+        IceTSizeType memory_row
+            = (row_order == ICET_ROWS_TOP_DOWN) ? height - 1 - y : y;
+        IceTSizeType color_step
+            = (color_pixel_stride > 0) ? color_pixel_stride : color_size;
+        IceTSizeType depth_step
+            = (depth_pixel_stride > 0) ? depth_pixel_stride : depth_size;
+        IceTSizeType color_row
+            = (color_row_stride > 0) ? color_row_stride : width*color_step;
+        IceTSizeType depth_row
+            = (depth_row_stride > 0) ? depth_row_stride : width*depth_step;
+        for (x = 0; x < width; x++) {
+            memcpy(colors + memory_row*color_row + x*color_step,
+                   (IceTByte *)g_packed_colors + (y*width + x)*color_size,
+                   color_size);
+            memcpy(depths + memory_row*depth_row + x*depth_step,
+                   g_packed_depths + y*width + x,
+                   depth_size);
+        }
+    }
+
+    icetInputBufferLayout(ICET_INPUT_COLOR_BUFFER,
+                          color_pixel_stride,
+                          color_row_stride,
+                          row_order);
+    icetInputBufferLayout(ICET_INPUT_DEPTH_BUFFER,
+                          depth_pixel_stride,
+                          depth_row_stride,
+                          row_order);
+
+    *color_buffer = colors;
+    *depth_buffer = depths;
+}
+
+static void FreeLayout(void)
+{
+    free(g_layout_buffer);
+    free(g_layout_depth_buffer);
+    icetInputBufferLayout(ICET_INPUT_COLOR_BUFFER, 0, 0, ICET_ROWS_BOTTOM_UP);
+    icetInputBufferLayout(ICET_INPUT_DEPTH_BUFFER, 0, 0, ICET_ROWS_BOTTOM_UP);
+}
+
+static IceTBoolean StridedInputTryComposite(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTByte *packed_result;
+    IceTSizeType packed_num_bytes;
+    int layout;
+
+    packed_result = composite_and_copy(g_packed_colors,
+                                       g_packed_depths,
+                                       NULL,
+                                       g_background_color,
+                                       &packed_num_bytes);
+
+    for (layout = 0; layout < NUM_LAYOUTS; layout++) {
+        const IceTVoid *color_buffer;
+        const IceTVoid *depth_buffer;
+        IceTByte *layout_result;
+        IceTSizeType layout_num_bytes;
+
+        MakeLayout(layout, &color_buffer, &depth_buffer);
+        layout_result = composite_and_copy(color_buffer,
+                                           (const IceTFloat *)depth_buffer,
+                                           NULL,
+                                           g_background_color,
+                                           &layout_num_bytes);
+        if (   (layout_num_bytes != packed_num_bytes)
+            || (   (packed_result != NULL)
+                && (memcmp(layout_result, packed_result, packed_num_bytes)
+                    != 0) ) ) {
+            printrank("***** Input with %s composites differently *****\n",
+                      g_layout_names[layout]);
+            success = ICET_FALSE;
+        }
+        free(layout_result);
+        FreeLayout();
+    }
+
+    free(packed_result);
+    return success;
+}
+
+static IceTBoolean StridedInputTryStrategies(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt strategy_index;
+
+    for (strategy_index = 0;
+         strategy_index < STRATEGY_LIST_SIZE;
+         strategy_index++) {
+        IceTBoolean supports_ordering;
+
+        icetStrategy(strategy_list[strategy_index]);
+        printstat("    Using %s strategy.\n", icetGetStrategyName());
+
+        icetGetBooleanv(ICET_STRATEGY_SUPPORTS_ORDERING, &supports_ordering);
+        if (icetIsEnabled(ICET_ORDERED_COMPOSITE) && !supports_ordering) {
+            printstat("    Strategy does not support ordering, skipping.\n");
+            continue;
+        }
+
+        success &= StridedInputTryComposite();
+    }
+
+    return success;
+}
+
+static IceTBoolean StridedInputTryFormats(void)
+{
+    IceTBoolean success = ICET_TRUE;
+
+    printstat("  Z buffer with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= StridedInputTryStrategies();
+    FreeImage();
+
+    printstat("  Z buffer with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    MakeImage();
+    success &= StridedInputTryStrategies();
+    FreeImage();
+
+    printstat("  Ordered blending with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= StridedInputTryStrategies();
+    FreeImage();
+
+    return success;
+}
+
+static int StridedInputRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt tile_dimension;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    for (tile_dimension = 1;
+         (tile_dimension <= 2) && (tile_dimension*tile_dimension <= num_proc);
+         tile_dimension++) {
+        printstat("\nUsing %dx%d tiles\n", tile_dimension, tile_dimension);
+        SetUpTiles(tile_dimension);
+        success &= StridedInputTryFormats();
+    }
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int StridedInput(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(StridedInputRun);
+}
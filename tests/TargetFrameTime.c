@@ -0,0 +1,224 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2003 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests the ICET_TARGET_FRAME_TIME option.  It sets a target that cannot
+** be met so that IceT has to render at a reduced scale while the camera
+** moves and makes sure the image is properly blown up to full resolution.
+** It also checks that IceT goes back to full resolution when the camera
+** stops moving or the target is removed.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevMatrix.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+static IceTBoolean g_readback_viewport_correct;
+static IceTBoolean g_layout_correct;
+
+static void TargetFrameTimeDraw(const IceTDouble *projection_matrix,
+                                const IceTDouble *modelview_matrix,
+                                const IceTFloat *background_color,
+                                const IceTInt *readback_viewport,
+                                IceTImage result)
+{
+    IceTInt scale;
+    IceTInt global_viewport[4];
+    IceTInt scaled_viewport[4];
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTUByte *colors;
+    IceTFloat *depths;
+    IceTSizeType x, y;
+
+    /* To remove warning. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+
+    icetGetIntegerv(ICET_RENDER_SCALE, &scale);
+
+    if (   (readback_viewport[2] != (SCREEN_WIDTH + scale - 1)/scale)
+        || (readback_viewport[3] != (SCREEN_HEIGHT + scale - 1)/scale) ) {
+        printrank("Got readback viewport of %dx%d at scale %d\n",
+                  readback_viewport[2], readback_viewport[3], scale);
+        g_readback_viewport_correct = ICET_FALSE;
+    }
+
+    /* The layout given by icetAddTile must be left alone while the scaled
+       layout is in use. */
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    icetGetIntegerv(ICET_SCALED_GLOBAL_VIEWPORT, scaled_viewport);
+    if (   (global_viewport[2] != SCREEN_WIDTH)
+        || (global_viewport[3] != SCREEN_HEIGHT)
+        || (scaled_viewport[2] != readback_viewport[2])
+        || (scaled_viewport[3] != readback_viewport[3]) ) {
+        printrank("Got global viewport of %dx%d and scaled viewport of"
+                  " %dx%d at scale %d\n",
+                  global_viewport[2], global_viewport[3],
+                  scaled_viewport[2], scaled_viewport[3], scale);
+        g_layout_correct = ICET_FALSE;
+    }
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    colors = icetImageGetColorub(result);
+    depths = icetImageGetDepthf(result);
+
+    /* Encode the location of each (possibly scaled) pixel in its color. */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTUByte *pixel = colors + 4*(y*width + x);
+            pixel[0] = (IceTUByte)(x & 0xFF);
+            pixel[1] = (IceTUByte)(y & 0xFF);
+            pixel[2] = 0;
+            pixel[3] = 255;
+            depths[y*width + x] = 0.5f;
+        }
+    }
+}
+
+static void TargetFrameTimeSetupRender(void)
+{
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDisable(ICET_FLOATING_VIEWPORT);
+
+    icetDrawCallback(TargetFrameTimeDraw);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+}
+
+static int TargetFrameTimeCheckImage(const IceTImage image, IceTInt scale)
+{
+    IceTInt rank;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    if (rank == 0) {
+        const IceTUByte *colors;
+        IceTSizeType x, y;
+
+        if (   (icetImageGetWidth(image) != SCREEN_WIDTH)
+            || (icetImageGetHeight(image) != SCREEN_HEIGHT) ) {
+            printrank("Got image of size %dx%d. Expected %dx%d\n",
+                      (int)icetImageGetWidth(image),
+                      (int)icetImageGetHeight(image),
+                      (int)SCREEN_WIDTH, (int)SCREEN_HEIGHT);
+            return TEST_FAILED;
+        }
+
+        colors = icetImageGetColorcub(image);
+        for (y = 0; y < SCREEN_HEIGHT; y++) {
+            for (x = 0; x < SCREEN_WIDTH; x++) {
+                const IceTUByte *pixel = colors + 4*(y*SCREEN_WIDTH + x);
+                if (   (pixel[0] != ((x/scale) & 0xFF))
+                    || (pixel[1] != ((y/scale) & 0xFF)) ) {
+                    printrank("**** Found bad pixel!!!! ****\n");
+                    printrank("Location x = %d, y = %d, scale = %d\n",
+                              (int)x, (int)y, scale);
+                    printrank("Got color %d %d\n", pixel[0], pixel[1]);
+                    return TEST_FAILED;
+                }
+            }
+        }
+    }
+
+    return TEST_PASSED;
+}
+
+static int TargetFrameTimeTryFrame(IceTDouble camera_offset,
+                                   IceTBoolean expect_reduced)
+{
+    const IceTFloat background_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble projection_matrix[16];
+    IceTDouble modelview_matrix[16];
+    IceTImage image;
+    IceTInt scale;
+
+    icetMatrixIdentity(projection_matrix);
+    icetMatrixTranslate(camera_offset, 0.0, 0.0, modelview_matrix);
+
+    g_readback_viewport_correct = ICET_TRUE;
+    g_layout_correct = ICET_TRUE;
+    image = icetDrawFrame(projection_matrix,
+                          modelview_matrix,
+                          background_color);
+
+    icetGetIntegerv(ICET_RENDER_SCALE, &scale);
+    printstat("  Rendered at scale %d\n", scale);
+    if (expect_reduced != (scale > 1)) {
+        printrank("**** Wrong render scale %d ****\n", scale);
+        return TEST_FAILED;
+    }
+    if (!g_readback_viewport_correct) {
+        printrank("**** Draw callback got the wrong viewport ****\n");
+        return TEST_FAILED;
+    }
+    if (!g_layout_correct) {
+        printrank("**** Tile layout was not kept separate ****\n");
+        return TEST_FAILED;
+    }
+
+    return TargetFrameTimeCheckImage(image, scale);
+}
+
+static int TargetFrameTimeTryStrategy(void)
+{
+    int result = TEST_PASSED;
+
+    printstat("No target frame time.\n");
+    icetTargetFrameTime(0.0);
+    result += TargetFrameTimeTryFrame(0.0, ICET_FALSE);
+    result += TargetFrameTimeTryFrame(0.1, ICET_FALSE);
+
+    printstat("Impossible target frame time with moving camera.\n");
+    icetTargetFrameTime(1.0e-9);
+    result += TargetFrameTimeTryFrame(0.2, ICET_TRUE);
+    result += TargetFrameTimeTryFrame(0.3, ICET_TRUE);
+
+    printstat("Camera at rest.\n");
+    result += TargetFrameTimeTryFrame(0.3, ICET_FALSE);
+
+    printstat("Easy target frame time with moving camera.\n");
+    icetTargetFrameTime(1000.0);
+    result += TargetFrameTimeTryFrame(0.4, ICET_FALSE);
+
+    icetTargetFrameTime(0.0);
+
+    return result;
+}
+
+static int TargetFrameTimeRun(void)
+{
+    int result = TEST_PASSED;
+    int strategy_idx;
+
+    TargetFrameTimeSetupRender();
+
+    for (strategy_idx = 0; strategy_idx < STRATEGY_LIST_SIZE; strategy_idx++) {
+        icetStrategy(strategy_list[strategy_idx]);
+        printstat("Trying strategy %s\n", icetGetStrategyName());
+        result += TargetFrameTimeTryStrategy();
+    }
+
+    return result;
+}
+
+int TargetFrameTime(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(TargetFrameTimeRun);
+}
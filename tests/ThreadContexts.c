@@ -0,0 +1,104 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Checks that the current context and the current error are kept separately
+** for each thread.  The threads take turns so that no context is used by two
+** threads at once, and no communication happens outside the main thread.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+typedef struct {
+    IceTContext context;
+    IceTContext initial_context;
+    IceTEnum error;
+    IceTInt rank;
+} ThreadResult;
+
+static void *ThreadMain(void *arg)
+{
+    ThreadResult *result = (ThreadResult *)arg;
+
+    /* A new thread starts with no current context. */
+    result->initial_context = icetGetContext();
+
+    icetSetContext(result->context);
+    icetGetIntegerv(ICET_RANK, &result->rank);
+
+    /* Raise an error that only this thread should see. */
+    icetEnable(ICET_STATE_ENABLE_END);
+    result->error = icetGetError();
+
+    icetSetContext(NULL);
+    return NULL;
+}
+
+static int ThreadContextsRun(void)
+{
+    pthread_t thread;
+    ThreadResult result;
+    IceTBitField diag_level;
+    IceTInt rank;
+    int success = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_DIAGNOSTIC_LEVEL, (IceTInt *)&diag_level);
+    /* Do not report the error raised on purpose. */
+    icetDiagnostics(ICET_DIAG_OFF);
+    icetGetError();
+
+    result.context = icetGetContext();
+    result.initial_context = result.context;
+    result.error = ICET_NO_ERROR;
+    result.rank = -1;
+    if (pthread_create(&thread, NULL, ThreadMain, &result) != 0) {
+        printrank("Could not create a thread.\n");
+        icetDiagnostics(diag_level);
+        return TEST_NOT_RUN;
+    }
+    pthread_join(thread, NULL);
+
+    icetDiagnostics(diag_level);
+
+    if (result.initial_context != NULL) {
+        printrank("*** New thread started with a current context ***\n");
+        success = TEST_FAILED;
+    }
+    if (result.rank != rank) {
+        printrank("*** Thread read rank %d, expected %d ***\n",
+                  result.rank, rank);
+        success = TEST_FAILED;
+    }
+    if (result.error != ICET_INVALID_VALUE) {
+        printrank("*** Thread did not see its own error ***\n");
+        success = TEST_FAILED;
+    }
+    if (icetGetContext() != result.context) {
+        printrank("*** Thread changed the context of the main thread ***\n");
+        success = TEST_FAILED;
+    }
+    if (icetGetError() != ICET_NO_ERROR) {
+        printrank("*** Error of the thread leaked to the main thread ***\n");
+        success = TEST_FAILED;
+    }
+
+    return success;
+}
+
+int ThreadContexts(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(ThreadContextsRun);
+}
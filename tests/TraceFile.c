@@ -0,0 +1,166 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests icetTraceFile.  It traces a few frames and checks that each
+** process wrote a complete Chrome trace with the expected events.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_FILENAME  "TraceFile%d.json"
+#define NUM_FRAMES      3
+
+static void TraceFileDraw(const IceTDouble *projection_matrix,
+                          const IceTDouble *modelview_matrix,
+                          const IceTFloat *background_color,
+                          const IceTInt *readback_viewport,
+                          IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType num_pixels;
+    IceTSizeType i;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    num_pixels = icetImageGetNumPixels(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+    for (i = 0; i < num_pixels; i++) {
+        color_buffer[4*i + 0] = 255;
+        color_buffer[4*i + 1] = 0;
+        color_buffer[4*i + 2] = 0;
+        color_buffer[4*i + 3] = 255;
+        depth_buffer[i] = 0.5f;
+    }
+}
+
+static int TraceFileCount(const char *trace, const char *pattern)
+{
+    int count = 0;
+    const char *location = strstr(trace, pattern);
+    while (location != NULL) {
+        count++;
+        location = strstr(location + 1, pattern);
+    }
+    return count;
+}
+
+static int TraceFileCheck(void)
+{
+    char filename[64];
+    FILE *file;
+    char *trace;
+    long size;
+    IceTInt rank;
+    IceTInt num_proc;
+    int result = TEST_PASSED;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    sprintf(filename, "TraceFile%d.json", (int)rank);
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        printrank("**** Could not open %s ****\n", filename);
+        return TEST_FAILED;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    trace = malloc(size + 1);
+    if (fread(trace, 1, size, file) != (size_t)size) {
+        printrank("**** Could not read %s ****\n", filename);
+        fclose(file);
+        free(trace);
+        return TEST_FAILED;
+    }
+    trace[size] = '\0';
+    fclose(file);
+
+    if (   (size < 4)
+        || (trace[0] != '[')
+        || (strcmp(trace + size - 3, "\n]\n") != 0) ) {
+        printrank("**** Trace is not a complete JSON array ****\n");
+        result = TEST_FAILED;
+    }
+
+    if (   (TraceFileCount(trace, "\"name\":\"draw frame\",\"cat\":\"icet\","
+                                  "\"ph\":\"B\"") != NUM_FRAMES)
+        || (TraceFileCount(trace, "\"name\":\"draw frame\",\"cat\":\"icet\","
+                                  "\"ph\":\"E\"") != NUM_FRAMES) ) {
+        printrank("**** Expected %d draw frame events ****\n", NUM_FRAMES);
+        result = TEST_FAILED;
+    }
+
+    if (   (TraceFileCount(trace, "\"name\":\"render\"") < 2*NUM_FRAMES)
+        || (TraceFileCount(trace, "\"name\":\"composite\"")
+            != 2*NUM_FRAMES) ) {
+        printrank("**** Missing render or composite events ****\n");
+        result = TEST_FAILED;
+    }
+
+    if ((num_proc > 1) && (TraceFileCount(trace, "\"peer\":") < 1)) {
+        printrank("**** No communication was traced ****\n");
+        result = TEST_FAILED;
+    }
+
+    free(trace);
+    remove(filename);
+    return result;
+}
+
+static int TraceFileRun(void)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    IceTDouble identity[16];
+    IceTInt i;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDrawCallback(TraceFileDraw);
+    icetStrategy(ICET_STRATEGY_REDUCE);
+
+    icetResetTiles();
+    icetAddTile(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+
+    /* Flush every other frame so that the trace is written in pieces. */
+    icetTraceFile(TRACE_FILENAME, 2);
+    for (i = 0; i < NUM_FRAMES; i++) {
+        icetDrawFrame(identity, identity, black);
+    }
+    icetTraceFile(NULL, 0);
+
+    /* Nothing should be recorded once tracing is off. */
+    icetDrawFrame(identity, identity, black);
+
+    return TraceFileCheck();
+}
+
+int TraceFile(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(TraceFileRun);
+}
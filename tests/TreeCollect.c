@@ -0,0 +1,246 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests collecting image pieces up a tree.  Each process composites a
+** random image onto small tiles, which are collected with a direct gather
+** and then up trees of different fan in.  The resulting images must be
+** identical.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include <IceTDevState.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+/* Keep tiles small so that pieces are collected through a tree. */
+#define TILE_WIDTH 67
+#define TILE_HEIGHT 43
+
+static IceTVoid *g_colors;
+static IceTFloat *g_depths;
+
+static void SetUpTiles(IceTInt tiles_x, IceTInt tiles_y)
+{
+    IceTInt tile_index = 0;
+    IceTInt tile_x;
+    IceTInt tile_y;
+
+    icetResetTiles();
+    for (tile_y = 0; tile_y < tiles_y; tile_y++) {
+        for (tile_x = 0; tile_x < tiles_x; tile_x++) {
+            icetAddTile(tile_x*TILE_WIDTH,
+                        tile_y*TILE_HEIGHT,
+                        TILE_WIDTH,
+                        TILE_HEIGHT,
+                        tile_index);
+            tile_index++;
+        }
+    }
+}
+
+/* Fills the image with a random rectangle of patterned pixels surrounded by
+   inactive pixels. */
+static void MakeImage(void)
+{
+    IceTInt global_viewport[4];
+    IceTInt width, height;
+    IceTInt active_viewport[4];
+
+    icetGetIntegerv(ICET_GLOBAL_VIEWPORT, global_viewport);
+    width = global_viewport[2];
+    height = global_viewport[3];
+
+    active_viewport[0] = rand()%(width/2);
+    active_viewport[1] = rand()%(height/2);
+    active_viewport[2] = width/2 + rand()%(width/2) - active_viewport[0];
+    active_viewport[3] = height/2 + rand()%(height/2) - active_viewport[1];
+
+    make_test_image(width,
+                    height,
+                    active_viewport,
+                    g_background_color,
+                    &g_colors,
+                    &g_depths);
+}
+
+static void FreeImage(void)
+{
+    free(g_colors);
+    free(g_depths);
+}
+
+static IceTBoolean TreeCollectTryComposite(void)
+{
+    IceTByte *direct_result;
+    IceTSizeType direct_bytes;
+    IceTInt num_proc;
+    IceTInt fan_in;
+    IceTBoolean success = ICET_TRUE;
+
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    /* A fan in as large as the number of processes gathers directly. */
+    icetStateSetInteger(ICET_COLLECT_FAN_IN, num_proc);
+    direct_result = composite_and_copy(g_colors,
+                                       g_depths,
+                                       NULL,
+                                       g_background_color,
+                                       &direct_bytes);
+
+    for (fan_in = 2; fan_in < num_proc; fan_in++) {
+        IceTByte *tree_result;
+        IceTSizeType tree_bytes;
+
+        icetStateSetInteger(ICET_COLLECT_FAN_IN, fan_in);
+        tree_result = composite_and_copy(g_colors,
+                                         g_depths,
+                                         NULL,
+                                         g_background_color,
+                                         &tree_bytes);
+
+        if (   (direct_bytes != tree_bytes)
+            || (   (direct_bytes > 0)
+                && (memcmp(direct_result, tree_result, direct_bytes) != 0))) {
+            IceTSizeType byte;
+            for (byte = 0; byte < direct_bytes; byte++) {
+                if (direct_result[byte] != tree_result[byte]) { break; }
+            }
+            printrank("***** Tree collect with fan in %d differs from"
+                      " direct collect *****\n", fan_in);
+            printrank("Sizes %d and %d, first difference at byte %d\n",
+                      (int)direct_bytes, (int)tree_bytes, (int)byte);
+            success = ICET_FALSE;
+        }
+
+        free(tree_result);
+    }
+
+    free(direct_result);
+    return success;
+}
+
+static IceTBoolean TreeCollectTryStrategies(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt si_index;
+
+    for (si_index = 0; si_index < SINGLE_IMAGE_STRATEGY_LIST_SIZE; si_index++){
+        icetSingleImageStrategy(single_image_strategy_list[si_index]);
+        printstat("    Using %s single image strategy.\n",
+                  icetGetSingleImageStrategyName());
+        success &= TreeCollectTryComposite();
+    }
+
+    return success;
+}
+
+static IceTBoolean TreeCollectTryFormats(void)
+{
+    IceTBoolean success = ICET_TRUE;
+
+    printstat("  Z buffer with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= TreeCollectTryStrategies();
+
+    printstat("  Z buffer keeping depth\n");
+    icetDisable(ICET_COMPOSITE_ONE_BUFFER);
+    success &= TreeCollectTryStrategies();
+    icetEnable(ICET_COMPOSITE_ONE_BUFFER);
+    FreeImage();
+
+    printstat("  Z buffer with float colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_FLOAT);
+    MakeImage();
+    success &= TreeCollectTryStrategies();
+    FreeImage();
+
+    printstat("  Ordered blending with 8-bit colors\n");
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_NONE);
+    icetCompositeMode(ICET_COMPOSITE_MODE_BLEND);
+    icetEnable(ICET_ORDERED_COMPOSITE);
+    MakeImage();
+    success &= TreeCollectTryStrategies();
+    FreeImage();
+
+    return success;
+}
+
+static int TreeCollectRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt save_fan_in;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (num_proc < 3) {
+        printstat("Need at least 3 processes to collect through a tree.\n");
+        return TEST_NOT_RUN;
+    }
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetGetIntegerv(ICET_COLLECT_FAN_IN, &save_fan_in);
+
+    printstat("\nUsing reduce strategy with 1 tile\n");
+    icetStrategy(ICET_STRATEGY_REDUCE);
+    SetUpTiles(1, 1);
+    success &= TreeCollectTryFormats();
+
+    printstat("\nUsing reduce strategy with 2x1 tiles\n");
+    SetUpTiles(2, 1);
+    success &= TreeCollectTryFormats();
+
+    printstat("\nUsing sequential strategy with 2x1 tiles\n");
+    icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+    success &= TreeCollectTryFormats();
+
+    icetStateSetInteger(ICET_COLLECT_FAN_IN, save_fan_in);
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int TreeCollect(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(TreeCollectRun);
+}
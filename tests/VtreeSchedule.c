@@ -0,0 +1,174 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** Tests the vtree strategy over several frames.  The vtree strategy keeps
+** its transfer schedule while the tiles each process covers stay the same,
+** so the frames alternate between a few layouts of the local images and
+** other strategies run in between.  Every frame must match the image
+** composited with the sequential strategy.
+*****************************************************************************/
+
+#include <IceT.h>
+#include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 48
+#define MAX_TILES 8
+
+#define NUM_LAYOUTS 3
+#define NUM_FRAMES 6
+
+static const IceTFloat g_background_color[4] = {
+    0.25f, 0.5f, 0.75f, 1.0f
+};
+
+/* The layout of each frame.  Repeated layouts should reuse the schedule. */
+static const IceTInt g_frame_layouts[NUM_FRAMES] = { 0, 0, 1, 1, 0, 2 };
+
+static IceTVoid *g_colors[NUM_LAYOUTS];
+static IceTFloat *g_depths[NUM_LAYOUTS];
+static IceTInt g_valid_viewports[NUM_LAYOUTS][4];
+
+/* Makes an image whose active pixels cover a random range of tiles. */
+static void MakeImage(IceTInt layout, IceTInt num_tiles)
+{
+    IceTInt *viewport = g_valid_viewports[layout];
+    IceTInt first_tile, last_tile;
+
+    first_tile = rand()%num_tiles;
+    last_tile = first_tile + rand()%(num_tiles - first_tile);
+    viewport[0] = first_tile*TILE_WIDTH + rand()%(TILE_WIDTH/2);
+    viewport[1] = rand()%(TILE_HEIGHT/2);
+    viewport[2] = (last_tile+1)*TILE_WIDTH - rand()%(TILE_WIDTH/2)
+                  - viewport[0];
+    viewport[3] = TILE_HEIGHT - rand()%(TILE_HEIGHT/2) - viewport[1];
+
+    make_test_image(num_tiles*TILE_WIDTH,
+                    TILE_HEIGHT,
+                    viewport,
+                    g_background_color,
+                    &g_colors[layout],
+                    &g_depths[layout]);
+}
+
+/* Composites the image of a layout and returns a copy of the displayed
+   tile (NULL if no tile is displayed). */
+static IceTByte *CompositeLayout(IceTInt layout, IceTSizeType *num_bytes)
+{
+    return composite_and_copy(g_colors[layout],
+                              g_depths[layout],
+                              g_valid_viewports[layout],
+                              g_background_color,
+                              num_bytes);
+}
+
+static int VtreeScheduleRun(void)
+{
+    IceTBoolean success = ICET_TRUE;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt num_tiles;
+    IceTInt tile;
+    IceTInt layout;
+    IceTInt frame;
+    unsigned int seed;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+
+    if (num_proc < 2) {
+        printstat("Need at least 2 processes to display multiple tiles.\n");
+        return TEST_NOT_RUN;
+    }
+
+    /* Establish a random seed. */
+    if (rank == 0) {
+        IceTInt remote_process;
+
+        seed = (int)time(NULL);
+        printstat("Base seed = %u\n", seed);
+
+        for (remote_process = 1; remote_process < num_proc; remote_process++) {
+            icetCommSend(&seed, 1, ICET_INT, remote_process, 29);
+        }
+    } else {
+        icetCommRecv(&seed, 1, ICET_INT, 0, 29);
+    }
+    srand(seed + rank);
+
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetDisable(ICET_ORDERED_COMPOSITE);
+    /* The vtree strategy always returns depth, so keep it for the reference
+       as well. */
+    icetDisable(ICET_COMPOSITE_ONE_BUFFER);
+
+    num_tiles = (num_proc < MAX_TILES) ? num_proc : MAX_TILES;
+    printstat("Using %dx1 tiles\n", num_tiles);
+    icetResetTiles();
+    for (tile = 0; tile < num_tiles; tile++) {
+        icetAddTile(tile*TILE_WIDTH, 0, TILE_WIDTH, TILE_HEIGHT, tile);
+    }
+
+    for (layout = 0; layout < NUM_LAYOUTS; layout++) {
+        MakeImage(layout, num_tiles);
+    }
+
+    for (frame = 0; frame < NUM_FRAMES; frame++) {
+        IceTByte *reference;
+        IceTSizeType reference_bytes;
+        IceTInt repeat;
+
+        layout = g_frame_layouts[frame];
+        printstat("  Frame %d with layout %d\n", frame, layout);
+
+        icetStrategy(ICET_STRATEGY_SEQUENTIAL);
+        reference = CompositeLayout(layout, &reference_bytes);
+
+        /* The second composite has no other strategy in between. */
+        icetStrategy(ICET_STRATEGY_VTREE);
+        for (repeat = 0; repeat < 2; repeat++) {
+            IceTSizeType vtree_bytes;
+            IceTByte *vtree_result = CompositeLayout(layout, &vtree_bytes);
+            if (   (vtree_bytes != reference_bytes)
+                || (   (reference != NULL)
+                    && (memcmp(reference, vtree_result, reference_bytes)
+                        != 0) ) ) {
+                printrank("***** Frame %d differs with vtree *****\n",
+                          frame);
+                success = ICET_FALSE;
+            }
+            free(vtree_result);
+        }
+        free(reference);
+    }
+
+    for (layout = 0; layout < NUM_LAYOUTS; layout++) {
+        free(g_colors[layout]);
+        free(g_depths[layout]);
+    }
+
+    return (success ? TEST_PASSED : TEST_FAILED);
+}
+
+int VtreeSchedule(int argc, char *argv[])
+{
+    /* Suppress warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(VtreeScheduleRun);
+}
@@ -0,0 +1,320 @@
+/* -*- c -*- *****************************************************************
+** Copyright (C) 2011 Sandia Corporation
+** Under the terms of Contract DE-AC04-94AL85000 with Sandia Corporation,
+** the U.S. Government retains certain rights in this software.
+**
+** This source code is released under the New BSD License.
+**
+** This tests icetWriteImageFile.  It composites an image with and without
+** image collection, has every process write its part of the image to shared
+** files, and reads the files back to check the pixels.
+*****************************************************************************/
+
+#include <IceT.h>
+#include "test_codes.h"
+#include "test_util.h"
+
+#include <IceTDevCommunication.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Use a size that does not divide evenly so that image partitions do not
+   line up with rows. */
+#define TILE_WIDTH      (SCREEN_WIDTH - 3)
+#define TILE_HEIGHT     (SCREEN_HEIGHT - 1)
+
+#define COLOR_FILENAME  "WriteImageFileColor"
+#define DEPTH_FILENAME  "WriteImageFileDepth.pfm"
+
+static void WriteImageFileExpectedColor(IceTSizeType x,
+                                        IceTSizeType y,
+                                        IceTUByte *color)
+{
+    color[0] = (IceTUByte)(x & 0xFF);
+    color[1] = (IceTUByte)(y & 0xFF);
+    color[2] = (IceTUByte)(40*(x/256 + y/256));
+    color[3] = 255;
+}
+
+static IceTFloat WriteImageFileExpectedDepth(IceTSizeType x, IceTSizeType y)
+{
+    return (IceTFloat)(x + y)/(TILE_WIDTH + TILE_HEIGHT);
+}
+
+static void WriteImageFileDraw(const IceTDouble *projection_matrix,
+                               const IceTDouble *modelview_matrix,
+                               const IceTFloat *background_color,
+                               const IceTInt *readback_viewport,
+                               IceTImage result)
+{
+    IceTUByte *color_buffer;
+    IceTFloat *depth_buffer;
+    IceTSizeType width;
+    IceTSizeType height;
+    IceTSizeType x, y;
+
+    /* Suppress compiler warnings. */
+    (void)projection_matrix;
+    (void)modelview_matrix;
+    (void)background_color;
+    (void)readback_viewport;
+
+    width = icetImageGetWidth(result);
+    height = icetImageGetHeight(result);
+    color_buffer = icetImageGetColorub(result);
+    depth_buffer = icetImageGetDepthf(result);
+
+    /* Every process draws the same thing, so it does not matter which one
+       wins the depth test. */
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            WriteImageFileExpectedColor(x, y, color_buffer + 4*(y*width + x));
+            depth_buffer[y*width + x] = WriteImageFileExpectedDepth(x, y);
+        }
+    }
+}
+
+/* Reads a whole file.  Returns NULL on failure. */
+static IceTUByte *WriteImageFileRead(const char *filename, long *size)
+{
+    FILE *file = fopen(filename, "rb");
+    IceTUByte *data;
+
+    if (file == NULL) { return NULL; }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = malloc(*size);
+    if (fread(data, 1, *size, file) != (size_t)*size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+/* Checks the header of a file and returns the start of the pixel data. */
+static const IceTUByte *WriteImageFileCheckHeader(const IceTUByte *data,
+                                                  long size,
+                                                  const char *magic,
+                                                  const char *max_value,
+                                                  IceTSizeType pixel_size)
+{
+    char header[64];
+    IceTSizeType header_size;
+
+    sprintf(header, "%s\n%d %d\n%s\n",
+            magic, (int)TILE_WIDTH, (int)TILE_HEIGHT, max_value);
+    header_size = (IceTSizeType)strlen(header);
+
+    if (   (size != header_size + (long)TILE_WIDTH*TILE_HEIGHT*pixel_size)
+        || (memcmp(data, header, header_size) != 0) ) {
+        printrank("**** Bad %s file header or size ****\n", magic);
+        return NULL;
+    }
+    return data + header_size;
+}
+
+static int WriteImageFileCheckPPM(void)
+{
+    IceTUByte *data;
+    const IceTUByte *pixels;
+    long size;
+    IceTSizeType x, y;
+    int result = TEST_PASSED;
+
+    data = WriteImageFileRead(COLOR_FILENAME ".ppm", &size);
+    if (data == NULL) {
+        printrank("**** Could not read PPM file ****\n");
+        return TEST_FAILED;
+    }
+    pixels = WriteImageFileCheckHeader(data, size, "P6", "255", 3);
+    if (pixels == NULL) {
+        free(data);
+        return TEST_FAILED;
+    }
+
+    /* PPM rows go top to bottom whereas IceT rows go bottom to top. */
+    for (y = 0; (y < TILE_HEIGHT) && (result == TEST_PASSED); y++) {
+        for (x = 0; x < TILE_WIDTH; x++) {
+            const IceTUByte *pixel
+                = pixels + 3*((TILE_HEIGHT - y - 1)*TILE_WIDTH + x);
+            IceTUByte expected[4];
+            WriteImageFileExpectedColor(x, y, expected);
+            if (memcmp(pixel, expected, 3) != 0) {
+                printrank("**** Found bad pixel!!!! ****\n");
+                printrank("Location x = %d, y = %d\n", (int)x, (int)y);
+                printrank("Got      %d %d %d\n", pixel[0], pixel[1], pixel[2]);
+                printrank("Expected %d %d %d\n",
+                          expected[0], expected[1], expected[2]);
+                result = TEST_FAILED;
+                break;
+            }
+        }
+    }
+
+    free(data);
+    return result;
+}
+
+static int WriteImageFileCheckPFM(const char *filename,
+                                  IceTBoolean is_depth)
+{
+    const IceTInt one = 1;
+    const char *scale = (*((const IceTUByte *)&one) == 1) ? "-1.0" : "1.0";
+    IceTSizeType num_channels = is_depth ? 1 : 3;
+    IceTUByte *data;
+    const IceTUByte *pixels;
+    long size;
+    IceTSizeType x, y;
+    int result = TEST_PASSED;
+
+    data = WriteImageFileRead(filename, &size);
+    if (data == NULL) {
+        printrank("**** Could not read %s ****\n", filename);
+        return TEST_FAILED;
+    }
+    pixels = WriteImageFileCheckHeader(data,
+                                       size,
+                                       is_depth ? "Pf" : "PF",
+                                       scale,
+                                       num_channels*sizeof(IceTFloat));
+    if (pixels == NULL) {
+        free(data);
+        return TEST_FAILED;
+    }
+
+    /* PFM rows go bottom to top like IceT rows. */
+    for (y = 0; (y < TILE_HEIGHT) && (result == TEST_PASSED); y++) {
+        for (x = 0; x < TILE_WIDTH; x++) {
+            IceTFloat pixel[3];
+            IceTFloat expected[3];
+            IceTSizeType c;
+
+            memcpy(pixel,
+                   pixels + num_channels*sizeof(IceTFloat)*(y*TILE_WIDTH + x),
+                   num_channels*sizeof(IceTFloat));
+            if (is_depth) {
+                expected[0] = WriteImageFileExpectedDepth(x, y);
+            } else {
+                IceTUByte color[4];
+                WriteImageFileExpectedColor(x, y, color);
+                for (c = 0; c < 3; c++) { expected[c] = color[c]/255.0f; }
+            }
+
+            for (c = 0; c < num_channels; c++) {
+                if (pixel[c] != expected[c]) {
+                    printrank("**** Found bad pixel in %s!!!! ****\n",
+                              filename);
+                    printrank("Location x = %d, y = %d, channel = %d\n",
+                              (int)x, (int)y, (int)c);
+                    printrank("Got %f, expected %f\n", pixel[c], expected[c]);
+                    result = TEST_FAILED;
+                    break;
+                }
+            }
+            if (result != TEST_PASSED) { break; }
+        }
+    }
+
+    free(data);
+    return result;
+}
+
+static int WriteImageFileTryFrame(IceTEnum file_format,
+                                  IceTBoolean with_depth)
+{
+    const IceTFloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const char *color_filename = (file_format == ICET_IMAGE_FILE_PPM)
+        ? COLOR_FILENAME ".ppm" : COLOR_FILENAME ".pfm";
+    IceTDouble identity[16];
+    IceTImage image;
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTInt check_rank;
+    IceTInt i;
+    int result = TEST_PASSED;
+
+    for (i = 0; i < 16; i++) {
+        identity[i] = ((i%5) == 0) ? 1.0 : 0.0;
+    }
+
+    /* The files are complete everywhere once icetWriteImageFile returns, so
+       check them on a process other than the one writing the header. */
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    check_rank = num_proc - 1;
+
+    /* Make sure we do not read files left over from a previous frame. */
+    if (rank == check_rank) {
+        remove(color_filename);
+        remove(DEPTH_FILENAME);
+    }
+    icetCommBarrier();
+
+    image = icetDrawFrame(identity, identity, black);
+    icetWriteImageFile(image,
+                       file_format,
+                       color_filename,
+                       with_depth ? DEPTH_FILENAME : NULL);
+
+    if (rank == check_rank) {
+        if (file_format == ICET_IMAGE_FILE_PPM) {
+            result += WriteImageFileCheckPPM();
+        } else {
+            result += WriteImageFileCheckPFM(color_filename, ICET_FALSE);
+        }
+        if (with_depth) {
+            result += WriteImageFileCheckPFM(DEPTH_FILENAME, ICET_TRUE);
+        }
+        remove(color_filename);
+        remove(DEPTH_FILENAME);
+    }
+
+    return result;
+}
+
+static int WriteImageFileRun(void)
+{
+    int strategy_idx;
+    int result = TEST_PASSED;
+
+    icetCompositeMode(ICET_COMPOSITE_MODE_Z_BUFFER);
+    icetSetColorFormat(ICET_IMAGE_COLOR_RGBA_UBYTE);
+    icetSetDepthFormat(ICET_IMAGE_DEPTH_FLOAT);
+    icetDisable(ICET_CORRECT_COLORED_BACKGROUND);
+    icetDrawCallback(WriteImageFileDraw);
+
+    icetResetTiles();
+    icetAddTile(0, 0, TILE_WIDTH, TILE_HEIGHT, 0);
+
+    for (strategy_idx = 0; strategy_idx < STRATEGY_LIST_SIZE; strategy_idx++) {
+        icetStrategy(strategy_list[strategy_idx]);
+        printstat("Trying strategy %s\n", icetGetStrategyName());
+
+        printstat("  Writing image partitions as PPM\n");
+        icetDisable(ICET_COLLECT_IMAGES);
+        result += WriteImageFileTryFrame(ICET_IMAGE_FILE_PPM, ICET_TRUE);
+
+        printstat("  Writing image partitions as PFM\n");
+        result += WriteImageFileTryFrame(ICET_IMAGE_FILE_PFM, ICET_TRUE);
+
+        /* Depth is not collected to the display process. */
+        printstat("  Writing collected image\n");
+        icetEnable(ICET_COLLECT_IMAGES);
+        result += WriteImageFileTryFrame(ICET_IMAGE_FILE_PPM, ICET_FALSE);
+    }
+
+    return result;
+}
+
+int WriteImageFile(int argc, char *argv[])
+{
+    /* To remove warning. */
+    (void)argc;
+    (void)argv;
+
+    return run_test(WriteImageFileRun);
+}
@@ -11,6 +11,7 @@
 #include "test_codes.h"
 
 #include <IceTDevCommunication.h>
+#include <IceTDevImage.h>
 #include <IceTDevPorting.h>
 
 #ifndef __USE_POSIX
@@ -35,8 +36,8 @@
 #define dup2(fildes, fildes2)   _dup2(fildes, fildes2)
 #endif
 
-IceTEnum strategy_list[5];
-int STRATEGY_LIST_SIZE = 5;
+IceTEnum strategy_list[6];
+int STRATEGY_LIST_SIZE = 6;
 /* int STRATEGY_LIST_SIZE = 1; */
 
 IceTEnum single_image_strategy_list[6];
@@ -247,6 +248,7 @@ void initialize_test(int *argcp, char ***argvp, IceTCommunicator comm)
     strategy_list[2] = ICET_STRATEGY_SPLIT;
     strategy_list[3] = ICET_STRATEGY_REDUCE;
     strategy_list[4] = ICET_STRATEGY_VTREE;
+    strategy_list[5] = ICET_STRATEGY_HYBRID;
 
     single_image_strategy_list[0] = ICET_SINGLE_IMAGE_STRATEGY_AUTOMATIC;
     single_image_strategy_list[1] = ICET_SINGLE_IMAGE_STRATEGY_BSWAP;
@@ -264,12 +266,186 @@ IceTBoolean strategy_uses_single_image_strategy(IceTEnum strategy)
       case ICET_STRATEGY_SPLIT:         return ICET_FALSE;
       case ICET_STRATEGY_REDUCE:        return ICET_TRUE;
       case ICET_STRATEGY_VTREE:         return ICET_FALSE;
+      case ICET_STRATEGY_HYBRID:        return ICET_TRUE;
       default:
           printrank("ERROR: unknown strategy type.");
           return ICET_TRUE;
     }
 }
 
+static void make_test_image_pixels(IceTSizeType width,
+                                   IceTSizeType height,
+                                   const IceTInt *active_viewport,
+                                   const IceTBoolean *active_mask,
+                                   const IceTFloat *background_color,
+                                   IceTVoid **colors_p,
+                                   IceTFloat **depths_p)
+{
+    IceTInt rank;
+    IceTInt num_proc;
+    IceTEnum color_format;
+    IceTEnum composite_mode;
+    IceTVoid *colors;
+    IceTFloat *depths;
+    IceTInt x, y;
+
+    icetGetIntegerv(ICET_RANK, &rank);
+    icetGetIntegerv(ICET_NUM_PROCESSES, &num_proc);
+    icetGetEnumv(ICET_COLOR_FORMAT, &color_format);
+    icetGetEnumv(ICET_COMPOSITE_MODE, &composite_mode);
+
+    colors = malloc(width*height*4*sizeof(IceTFloat));
+    depths = malloc(width*height*sizeof(IceTFloat));
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            IceTInt pixel = y*width + x;
+            IceTFloat color[4];
+            IceTBoolean active;
+
+            if (active_mask != NULL) {
+                active = active_mask[pixel];
+            } else {
+                active = (   (x >= active_viewport[0])
+                          && (x < active_viewport[0] + active_viewport[2])
+                          && (y >= active_viewport[1])
+                          && (y < active_viewport[1] + active_viewport[3])
+                          && ((x/8 + y/8 + rank)%3 != 0) );
+            }
+
+            if (active) {
+                color[0] = (IceTUByte)(rank*37 + x)/255.0f;
+                color[1] = (IceTUByte)y/255.0f;
+                color[2] = (IceTUByte)rank/255.0f;
+                color[3] = (IceTUByte)(1 + rand()%255)/255.0f;
+                /* Depths differ between processes so that the result
+                   does not depend on how ties are broken. */
+                depths[pixel] = (IceTFloat)((rand()%256)*num_proc + rank)
+                                /(256.0f*num_proc);
+            } else {
+                /* A renderer clears inactive pixels to the background for
+                   z-buffer compositing and to transparent black for
+                   blending. */
+                if (composite_mode == ICET_COMPOSITE_MODE_BLEND) {
+                    color[0] = color[1] = color[2] = color[3] = 0.0f;
+                } else {
+                    memcpy(color, background_color, 4*sizeof(IceTFloat));
+                }
+                depths[pixel] = 1.0f;
+            }
+
+            if (color_format == ICET_IMAGE_COLOR_RGBA_UBYTE) {
+                IceTUByte *out = (IceTUByte *)colors + 4*pixel;
+                out[0] = (IceTUByte)(255*color[0]);
+                out[1] = (IceTUByte)(255*color[1]);
+                out[2] = (IceTUByte)(255*color[2]);
+                out[3] = (IceTUByte)(255*color[3]);
+            } else {
+                memcpy((IceTFloat *)colors + 4*pixel,
+                       color,
+                       4*sizeof(IceTFloat));
+            }
+        }
+    }
+
+    *colors_p = colors;
+    *depths_p = depths;
+}
+
+void make_test_image(IceTSizeType width,
+                     IceTSizeType height,
+                     const IceTInt *active_viewport,
+                     const IceTFloat *background_color,
+                     IceTVoid **colors_p,
+                     IceTFloat **depths_p)
+{
+    make_test_image_pixels(width,
+                           height,
+                           active_viewport,
+                           NULL,
+                           background_color,
+                           colors_p,
+                           depths_p);
+}
+
+void make_test_image_from_mask(IceTSizeType width,
+                               IceTSizeType height,
+                               const IceTBoolean *active_mask,
+                               const IceTFloat *background_color,
+                               IceTVoid **colors_p,
+                               IceTFloat **depths_p)
+{
+    make_test_image_pixels(width,
+                           height,
+                           NULL,
+                           active_mask,
+                           background_color,
+                           colors_p,
+                           depths_p);
+}
+
+IceTByte *copy_test_image(const IceTImage image, IceTSizeType *num_bytes)
+{
+    IceTByte *result;
+    IceTSizeType color_bytes = 0;
+    IceTSizeType depth_bytes = 0;
+    IceTSizeType pixel_size;
+
+    if (icetImageIsNull(image)) {
+        *num_bytes = 0;
+        return NULL;
+    }
+
+    if (icetImageGetColorFormat(image) != ICET_IMAGE_COLOR_NONE) {
+        icetImageGetColorConstVoid(image, &pixel_size);
+        color_bytes = icetImageGetNumPixels(image)*pixel_size;
+    }
+    if (icetImageGetDepthFormat(image) != ICET_IMAGE_DEPTH_NONE) {
+        icetImageGetDepthConstVoid(image, &pixel_size);
+        depth_bytes = icetImageGetNumPixels(image)*pixel_size;
+    }
+
+    *num_bytes = color_bytes + depth_bytes;
+    result = malloc(*num_bytes);
+    if (color_bytes > 0) {
+        memcpy(result, icetImageGetColorConstVoid(image, NULL), color_bytes);
+    }
+    if (depth_bytes > 0) {
+        memcpy(result + color_bytes,
+               icetImageGetDepthConstVoid(image, NULL),
+               depth_bytes);
+    }
+    return result;
+}
+
+IceTByte *composite_and_copy(const IceTVoid *colors,
+                             const IceTFloat *depths,
+                             const IceTInt *valid_viewport,
+                             const IceTFloat *background_color,
+                             IceTSizeType *num_bytes)
+{
+    IceTEnum depth_format;
+    IceTImage image;
+    IceTInt tile_displayed;
+
+    icetGetEnumv(ICET_DEPTH_FORMAT, &depth_format);
+    image = icetCompositeImage(
+                colors,
+                (depth_format != ICET_IMAGE_DEPTH_NONE) ? depths : NULL,
+                valid_viewport,
+                NULL,
+                NULL,
+                background_color);
+
+    icetGetIntegerv(ICET_TILE_DISPLAYED, &tile_displayed);
+    if (tile_displayed < 0) {
+        *num_bytes = 0;
+        return NULL;
+    }
+
+    return copy_test_image(image, num_bytes);
+}
+
 int run_test_base(int (*test_function)())
 {
     int result;
@@ -51,6 +51,38 @@ void write_ppm(const char *filename,
 
 IceTBoolean strategy_uses_single_image_strategy(IceTEnum strategy);
 
+/* Allocates and fills color and depth buffers of the given size in the
+   current color format.  Active pixels get a pattern that depends on the
+   rank and a random depth.  Inactive pixels are cleared the way a renderer
+   would for the current composite mode.  make_test_image activates most of
+   the pixels in active_viewport.  make_test_image_from_mask activates the
+   pixels that are true in active_mask.  Free the buffers with free. */
+void make_test_image(IceTSizeType width,
+                     IceTSizeType height,
+                     const IceTInt *active_viewport,
+                     const IceTFloat *background_color,
+                     IceTVoid **colors_p,
+                     IceTFloat **depths_p);
+void make_test_image_from_mask(IceTSizeType width,
+                               IceTSizeType height,
+                               const IceTBoolean *active_mask,
+                               const IceTFloat *background_color,
+                               IceTVoid **colors_p,
+                               IceTFloat **depths_p);
+
+/* Returns a copy of the color followed by the depth values of an image
+   (NULL for a null image).  Free the copy with free. */
+IceTByte *copy_test_image(const IceTImage image, IceTSizeType *num_bytes);
+
+/* Composites the given buffers with icetCompositeImage and returns a copy
+   of the displayed tile as copy_test_image does (NULL if no tile is
+   displayed).  The depths are ignored if there is no depth format. */
+IceTByte *composite_and_copy(const IceTVoid *colors,
+                             const IceTFloat *depths,
+                             const IceTInt *valid_viewport,
+                             const IceTFloat *background_color,
+                             IceTSizeType *num_bytes);
+
 #ifdef __cplusplus
 }
 #endif